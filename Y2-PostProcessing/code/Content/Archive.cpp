@@ -0,0 +1,352 @@
+/*
+	Year 2 Direct3D 11 workshop template.
+	Content - Asset archive ('.y2pak'): all content in one file, looked up by resource ID.
+*/
+
+#include "../Platform.h"
+#include <fstream>
+#include "Archive.h"
+#include "LZ4.h"
+
+namespace Content
+{
+	static uint64_t Align(uint64_t offset, size_t alignment)
+	{
+		return (offset + alignment-1) & ~(uint64_t) (alignment-1);
+	}
+
+	ResourceID GetResourceID(const std::string &path)
+	{
+		std::string normalized(path);
+		for (char &character : normalized)
+			character = ('\\' == character) ? '/' : (char) tolower((unsigned char) character);
+
+		return HashedString(normalized);
+	}
+
+	void ResourceData::Release()
+	{
+		m_file.Close();
+		std::vector<uint8_t>().swap(m_buffer);
+		m_pData = nullptr;
+		m_size = 0;
+	}
+
+	/*
+		Archive.
+	*/
+
+	bool Archive::Open(const std::string &path)
+	{
+		if (false == m_file.Open(path))
+			return false;
+
+		m_path = path;
+
+		const size_t size = m_file.GetSize();
+		if (size < sizeof(ArchiveHeader))
+		{
+			SetLastError("Archive truncated: " + path);
+			m_file.Close();
+			return false;
+		}
+
+		const ArchiveHeader &header = *reinterpret_cast<const ArchiveHeader *>(m_file.GetData());
+		if (kArchiveMagic != header.magic || kArchiveVersion != header.version)
+		{
+			SetLastError("Not an archive (or wrong version): " + path);
+			m_file.Close();
+			return false;
+		}
+
+		// Power of 2 & never full, or Find() wouldn't terminate (the slots themselves are checked below).
+		const bool isValid =
+			0 != header.numSlots && 0 == (header.numSlots & (header.numSlots-1)) && header.numEntries < header.numSlots
+			&& header.entryOffset <= size && (uint64_t) header.numEntries*sizeof(ArchiveEntry) <= size - header.entryOffset
+			&& header.slotOffset <= size && (uint64_t) header.numSlots*sizeof(uint32_t) <= size - header.slotOffset;
+
+		if (false == isValid)
+		{
+			SetLastError("Archive corrupt: " + path);
+			m_file.Close();
+			return false;
+		}
+
+		m_pHeader = &header;
+		m_pEntries = reinterpret_cast<const ArchiveEntry *>(m_file.GetData() + header.entryOffset);
+		m_pSlots = reinterpret_cast<const uint32_t *>(m_file.GetData() + header.slotOffset);
+
+		for (uint32_t iEntry = 0; iEntry < header.numEntries; ++iEntry)
+		{
+			const ArchiveEntry &entry = m_pEntries[iEntry];
+
+			// Written so nothing can overflow; the raw size is checked too, as Read() allocates that much.
+			bool isEntryValid = entry.offset <= size && entry.size <= size - entry.offset;
+			if (kArchiveLZ4 == entry.codec)
+				isEntryValid = isEntryValid && entry.rawSize <= GetLZ4MaxDecompressedSize(entry.size) && entry.rawSize <= SIZE_MAX;
+			else if (kArchiveStored != entry.codec)
+				isEntryValid = false;
+
+			if (false == isEntryValid)
+			{
+				SetLastError("Archive corrupt: " + path);
+				m_file.Close();
+				m_pHeader = nullptr;
+				return false;
+			}
+		}
+
+		// Each slot holds an entry (by index) or is empty, and at least one must be: Find() probes until it hits one.
+		bool hasEmptySlot = false, areSlotsValid = true;
+		for (uint32_t iSlot = 0; iSlot < header.numSlots; ++iSlot)
+		{
+			const uint32_t iEntry = m_pSlots[iSlot];
+			if (kArchiveEmptySlot == iEntry)
+			{
+				hasEmptySlot = true;
+			}
+			else if (iEntry >= header.numEntries)
+			{
+				areSlotsValid = false;
+				break;
+			}
+		}
+
+		if (false == hasEmptySlot || false == areSlotsValid)
+		{
+			SetLastError("Archive corrupt: " + path);
+			m_file.Close();
+			m_pHeader = nullptr;
+			return false;
+		}
+
+		return true;
+	}
+
+	const ArchiveEntry *Archive::Find(ResourceID ID) const
+	{
+		if (nullptr == m_pHeader)
+			return nullptr;
+
+		const uint32_t mask = m_pHeader->numSlots-1;
+		for (uint32_t iSlot = (uint32_t) ID.GetHash() & mask; ; iSlot = (iSlot+1) & mask)
+		{
+			const uint32_t iEntry = m_pSlots[iSlot];
+			if (kArchiveEmptySlot == iEntry)
+				return nullptr;
+
+			if (ID.GetHash() == m_pEntries[iEntry].ID)
+				return &m_pEntries[iEntry];
+		}
+	}
+
+	bool Archive::Read(const ArchiveEntry &entry, ResourceData &data) const
+	{
+		data.Release();
+
+		const uint8_t *pSource = m_file.GetData() + entry.offset;
+		if (kArchiveStored == entry.codec)
+		{
+			data.m_pData = pSource;
+			data.m_size = (size_t) entry.size;
+			return true;
+		}
+
+		// Straight from the mapping into the buffer, front to back.
+		data.m_buffer.resize((size_t) entry.rawSize);
+		if (false == DecompressLZ4(pSource, (size_t) entry.size, data.m_buffer.data(), data.m_buffer.size()))
+		{
+			SetLastError("Archive entry corrupt: " + m_path);
+			data.Release();
+			return false;
+		}
+
+		data.m_pData = data.m_buffer.data();
+		data.m_size = data.m_buffer.size();
+		return true;
+	}
+
+	/*
+		Offline.
+	*/
+
+	bool BuildArchive(const std::string &path, const std::vector<std::string> &sourcePaths, ArchiveStats *pStats /* = nullptr */)
+	{
+		const uint32_t numEntries = (uint32_t) sourcePaths.size();
+
+		std::vector<ArchiveEntry> entries(numEntries);
+		std::vector<std::vector<uint8_t>> contents(numEntries);
+
+		// Read & compress; the bulk of the work.
+		std::atomic<bool> isFailed(false);
+		ParallelFor(numEntries, 1, [&](unsigned int iEntry)
+		{
+			MappedFile file;
+			if (false == file.Open(sourcePaths[iEntry]))
+			{
+				isFailed = true;
+				return;
+			}
+
+			ArchiveEntry &entry = entries[iEntry];
+			memset(&entry, 0, sizeof(entry));
+			entry.ID = GetResourceID(sourcePaths[iEntry]).GetHash();
+			entry.rawSize = file.GetSize();
+
+			std::vector<uint8_t> &content = contents[iEntry];
+			content.resize(GetLZ4MaxCompressedSize(file.GetSize()));
+			const size_t compressedSize = CompressLZ4(file.GetData(), file.GetSize(), content.data());
+
+			if (compressedSize <= file.GetSize() - file.GetSize()/8)
+			{
+				entry.codec = kArchiveLZ4;
+				content.resize(compressedSize);
+			}
+			else
+			{
+				entry.codec = kArchiveStored;
+				content.assign(file.GetData(), file.GetData() + file.GetSize());
+			}
+
+			entry.size = content.size();
+		});
+
+		if (true == isFailed)
+			return false;
+
+		// Hash table, at most half full.
+		uint32_t numSlots = 16;
+		while (numSlots < 2*numEntries)
+			numSlots *= 2;
+
+		std::vector<uint32_t> slots(numSlots, kArchiveEmptySlot);
+		for (uint32_t iEntry = 0; iEntry < numEntries; ++iEntry)
+		{
+			uint32_t iSlot = (uint32_t) entries[iEntry].ID & (numSlots-1);
+			while (kArchiveEmptySlot != slots[iSlot])
+			{
+				if (entries[slots[iSlot]].ID == entries[iEntry].ID)
+				{
+					SetLastError("Archive: duplicate (or colliding) resource ID: " + sourcePaths[slots[iSlot]] + " & " + sourcePaths[iEntry]);
+					return false;
+				}
+
+				iSlot = (iSlot+1) & (numSlots-1);
+			}
+
+			slots[iSlot] = iEntry;
+		}
+
+		ArchiveHeader header;
+		memset(&header, 0, sizeof(header));
+		header.magic = kArchiveMagic;
+		header.version = kArchiveVersion;
+		header.numEntries = numEntries;
+		header.numSlots = numSlots;
+		header.entryOffset = Align(sizeof(ArchiveHeader), kArchiveCompressedAlignment);
+		header.slotOffset = Align(header.entryOffset + numEntries*sizeof(ArchiveEntry), kArchiveCompressedAlignment);
+
+		uint64_t offset = header.slotOffset + numSlots*sizeof(uint32_t);
+		for (ArchiveEntry &entry : entries)
+		{
+			entry.offset = Align(offset, (kArchiveStored == entry.codec) ? kArchivePageAlignment : kArchiveCompressedAlignment);
+			offset = entry.offset + entry.size;
+		}
+
+		std::ofstream file(path, std::ios::binary);
+		if (false == file.is_open())
+		{
+			SetLastError("Can not write archive: " + path);
+			return false;
+		}
+
+		auto writeAt = [&file](uint64_t offset, const void *pData, size_t numBytes)
+		{
+			static const char kPadding[kArchivePageAlignment] = { 0 };
+			const uint64_t position = (uint64_t) file.tellp();
+			ASSERT(offset >= position && offset - position < kArchivePageAlignment);
+			file.write(kPadding, (std::streamsize) (offset - position));
+			file.write(static_cast<const char *>(pData), (std::streamsize) numBytes);
+		};
+
+		writeAt(0, &header, sizeof(header));
+		writeAt(header.entryOffset, entries.data(), entries.size()*sizeof(ArchiveEntry));
+		writeAt(header.slotOffset, slots.data(), slots.size()*sizeof(uint32_t));
+		for (uint32_t iEntry = 0; iEntry < numEntries; ++iEntry)
+			writeAt(entries[iEntry].offset, contents[iEntry].data(), contents[iEntry].size());
+
+		if (false == file.good())
+		{
+			SetLastError("Can not write archive: " + path);
+			return false;
+		}
+
+		if (nullptr != pStats)
+		{
+			memset(pStats, 0, sizeof(ArchiveStats));
+			pStats->numEntries = numEntries;
+			for (const ArchiveEntry &entry : entries)
+			{
+				pStats->numCompressed += (kArchiveLZ4 == entry.codec) ? 1 : 0;
+				pStats->rawSize += entry.rawSize;
+				pStats->storedSize += entry.size;
+			}
+		}
+
+		return true;
+	}
+
+	/*
+		Mounted archives.
+	*/
+
+	static std::mutex s_archiveLock;
+	static std::vector<Archive::Ptr> s_archives;
+
+	bool MountArchive(const std::string &path)
+	{
+		Archive::Ptr archive(new Archive());
+		if (false == archive->Open(path))
+			return false;
+
+		DEBUG_LOG("Mounted archive: %s (%u entries)", path.c_str(), archive->GetNumEntries());
+
+		std::lock_guard<std::mutex> lock(s_archiveLock);
+		s_archives.push_back(std::move(archive));
+		return true;
+	}
+
+	void UnmountArchives()
+	{
+		std::lock_guard<std::mutex> lock(s_archiveLock);
+		s_archives.clear();
+	}
+
+	bool ReadResource(const std::string &path, ResourceData &data)
+	{
+		const ResourceID ID = GetResourceID(path);
+
+		// Archives aren't unmounted while resources load, so reading needn't hold the lock.
+		const Archive *pArchive = nullptr;
+		const ArchiveEntry *pEntry = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(s_archiveLock);
+			for (auto iArchive = s_archives.rbegin(); iArchive != s_archives.rend() && nullptr == pEntry; ++iArchive)
+			{
+				pArchive = iArchive->get();
+				pEntry = pArchive->Find(ID);
+			}
+		}
+
+		if (nullptr != pEntry)
+			return pArchive->Read(*pEntry, data);
+
+		data.Release();
+		if (false == data.m_file.Open(path))
+			return false;
+
+		data.m_pData = data.m_file.GetData();
+		data.m_size = data.m_file.GetSize();
+		return true;
+	}
+}
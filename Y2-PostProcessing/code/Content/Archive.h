@@ -0,0 +1,127 @@
+/*
+	Year 2 Direct3D 11 workshop template.
+	Content - Asset archive ('.y2pak'): all content in one file, looked up by resource ID.
+
+	Layout (little endian):
+	- ArchiveHeader
+	- Entry table (ArchiveEntry, in pack order)
+	- Slot table: open addressing (linear probing) on the low bits of the ID, power of 2 in size,
+	  at most half full; each slot holds an entry index or kArchiveEmptySlot.
+	- Data, in pack order: LZ4 compressed entries 16-byte aligned, stored entries 4KB (page) aligned
+	  so they can be used straight from the mapping.
+
+	The table sits up front and data is laid out in the order it was packed, so a cold start
+	is a single open followed by (mostly) sequential reads.
+*/
+
+#if !defined(ARCHIVE_H)
+#define ARCHIVE_H
+
+namespace Content
+{
+	// Hash of the normalized path: lower case with '/' as separator (so '\' equals '/').
+	// Write literals that way too, and they're hashed at compile time: FindTexture("textures/logo.dds").
+	typedef HashedString ResourceID;
+
+	ResourceID GetResourceID(const std::string &path);
+
+	const uint32_t kArchiveMagic = 0x4b503259; // "Y2PK"
+	const uint32_t kArchiveVersion = 1;
+	const uint32_t kArchiveEmptySlot = 0xffffffff;
+	const size_t kArchivePageAlignment = 4096;
+	const size_t kArchiveCompressedAlignment = 16;
+
+	enum ArchiveCodec
+	{
+		kArchiveStored, // As-is (page aligned).
+		kArchiveLZ4     // LZ4 block, see LZ4.h.
+	};
+
+	struct ArchiveHeader
+	{
+		uint32_t magic, version;
+		uint32_t numEntries, numSlots;
+		uint64_t entryOffset, slotOffset;
+	};
+
+	struct ArchiveEntry
+	{
+		uint64_t ID; // ResourceID::GetHash()
+		uint64_t offset;
+		uint64_t size, rawSize; // Stored & original size.
+		uint32_t codec;         // ArchiveCodec
+		uint32_t reserved;
+	};
+
+	// A resource's bytes: either mapped (loose file or stored entry) or decompressed into a buffer of it's own.
+	class ResourceData : public boost::noncopyable
+	{
+	public:
+		ResourceData() :
+			m_pData(nullptr), m_size(0) {}
+
+		const uint8_t *GetData() const { return m_pData; }
+		size_t GetSize() const { return m_size; }
+
+		void Release();
+
+	private:
+		friend class Archive;
+		friend bool ReadResource(const std::string &path, ResourceData &data);
+
+		MappedFile m_file;
+		std::vector<uint8_t> m_buffer;
+		const uint8_t *m_pData;
+		size_t m_size;
+	};
+
+	class Archive : public boost::noncopyable
+	{
+	public:
+		typedef std::unique_ptr<Archive> Ptr;
+
+		Archive() :
+			m_pHeader(nullptr), m_pEntries(nullptr), m_pSlots(nullptr) {}
+
+		bool Open(const std::string &path);
+
+		// O(1): nullptr if not in this archive.
+		const ArchiveEntry *Find(ResourceID ID) const;
+
+		// Thread safe; stored entries point into the archive's mapping (so don't close it while they're in use).
+		bool Read(const ArchiveEntry &entry, ResourceData &data) const;
+
+		unsigned int GetNumEntries() const { return (nullptr != m_pHeader) ? m_pHeader->numEntries : 0; }
+
+	private:
+		std::string m_path;
+		MappedFile m_file;
+		const ArchiveHeader *m_pHeader;
+		const ArchiveEntry *m_pEntries;
+		const uint32_t *m_pSlots;
+	};
+
+	struct ArchiveStats
+	{
+		unsigned int numEntries, numCompressed;
+		uint64_t rawSize, storedSize; // Entry data only (alignment excluded).
+	};
+
+	// Offline: packs the files in the order given (which becomes the read order, so pass load order if you can).
+	// Each file's ID is GetResourceID() of the path as passed, i.e. as it's requested at runtime.
+	// Files are compressed in parallel and stored as-is unless LZ4 saves at least 1/8th.
+	bool BuildArchive(const std::string &path, const std::vector<std::string> &sourcePaths, ArchiveStats *pStats = nullptr);
+
+	/*
+		Mounted archives; what all loaders read through.
+	*/
+
+	// Archives mounted later take precedence. Unmount only after all resources are gone (see DestroyResources()).
+	bool MountArchive(const std::string &path);
+	void UnmountArchives();
+
+	// From the mounted archives, or (if not packed) the loose file; sets an error if neither exists.
+	bool ReadResource(const std::string &path, ResourceData &data);
+}
+
+#endif // ARCHIVE_H
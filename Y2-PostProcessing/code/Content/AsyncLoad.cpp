@@ -0,0 +1,168 @@
+/*
+	Year 2 Direct3D 11 workshop template.
+	Content - Asynchronous loading: I/O & decoding on a pool of worker threads, GPU work on the render thread.
+*/
+
+#include "../Platform.h"
+#include <condition_variable>
+#include <deque>
+#include "AsyncLoad.h"
+
+namespace Content
+{
+	static std::mutex s_lock;
+	static std::condition_variable s_workAdded, s_workDone;
+	static std::deque<AsyncWork> s_work;
+	static std::deque<AsyncFinish> s_finished;
+	static std::vector<std::thread> s_workers;
+	static bool s_isStopping = false;
+	static unsigned int s_numPending = 0; // Work queued or running, plus finishing halves not yet run.
+	static std::thread::id s_renderThread;
+
+	static void Worker()
+	{
+		for (;;)
+		{
+			AsyncWork work;
+			{
+				std::unique_lock<std::mutex> lock(s_lock);
+				s_workAdded.wait(lock, []() { return true == s_isStopping || false == s_work.empty(); });
+				if (true == s_work.empty())
+					return;
+
+				work = std::move(s_work.front());
+				s_work.pop_front();
+			}
+
+			AsyncFinish finish = work();
+
+			{
+				std::lock_guard<std::mutex> lock(s_lock);
+				if (finish)
+					s_finished.push_back(std::move(finish));
+				else
+					--s_numPending;
+			}
+
+			s_workDone.notify_all();
+		}
+	}
+
+	void StartAsyncLoading(unsigned int numThreads /* = 0 */)
+	{
+		ASSERT(true == s_workers.empty());
+
+		// Workers block on I/O a fair share of the time, so don't leave cores idle for it.
+		if (0 == numThreads)
+			numThreads = std::max<unsigned int>(GetNumHardwareThreads()-1, 2);
+
+		s_renderThread = std::this_thread::get_id();
+		s_isStopping = false;
+		for (unsigned int iThread = 0; iThread < numThreads; ++iThread)
+			s_workers.emplace_back(Worker);
+	}
+
+	void StopAsyncLoading()
+	{
+		if (true == s_workers.empty())
+			return;
+
+		WaitForAsyncLoads();
+
+		{
+			std::lock_guard<std::mutex> lock(s_lock);
+			s_isStopping = true;
+		}
+
+		s_workAdded.notify_all();
+		for (auto &worker : s_workers)
+			worker.join();
+
+		s_workers.clear();
+	}
+
+	void RunAsync(const AsyncWork &work)
+	{
+		// Not started (offline tools): just do it here.
+		if (true == s_workers.empty())
+		{
+			AsyncFinish finish = work();
+			if (finish)
+				finish();
+
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(s_lock);
+			s_work.push_back(work);
+			++s_numPending;
+		}
+
+		s_workAdded.notify_one();
+	}
+
+	void ProcessAsyncLoads(float maxTime /* = 0.002f */)
+	{
+		ASSERT(std::this_thread::get_id() == s_renderThread);
+
+		const Timer timer;
+		do
+		{
+			AsyncFinish finish;
+			{
+				std::lock_guard<std::mutex> lock(s_lock);
+				if (true == s_finished.empty())
+					break;
+
+				finish = std::move(s_finished.front());
+				s_finished.pop_front();
+			}
+
+			finish();
+
+			{
+				std::lock_guard<std::mutex> lock(s_lock);
+				--s_numPending;
+			}
+		}
+		while (timer.Get() < maxTime);
+	}
+
+	void WaitForAsyncLoads()
+	{
+		for (;;)
+		{
+			ProcessAsyncLoads(FLT_MAX);
+
+			std::unique_lock<std::mutex> lock(s_lock);
+			if (0 == s_numPending)
+				break;
+
+			s_workDone.wait(lock, []() { return false == s_finished.empty() || 0 == s_numPending; });
+		}
+	}
+
+	void WaitForAsyncLoad(const std::shared_future<void> &loaded)
+	{
+		if (std::this_thread::get_id() != s_renderThread || true == s_workers.empty())
+		{
+			loaded.wait();
+			return;
+		}
+
+		while (std::future_status::ready != loaded.wait_for(std::chrono::milliseconds(0)))
+		{
+			ProcessAsyncLoads(FLT_MAX);
+
+			std::unique_lock<std::mutex> lock(s_lock);
+			s_workDone.wait_for(lock, std::chrono::milliseconds(1), []() { return false == s_finished.empty(); });
+		}
+	}
+
+	unsigned int GetNumPendingLoads()
+	{
+		std::lock_guard<std::mutex> lock(s_lock);
+		return s_numPending;
+	}
+}
@@ -0,0 +1,42 @@
+/*
+	Year 2 Direct3D 11 workshop template.
+	Content - Asynchronous loading: I/O & decoding on a pool of worker threads, GPU work on the render thread.
+
+	A load is a function that runs on a worker (read, decompress, parse) and returns what's left to do
+	on the render thread (create the Direct3D objects), which ProcessAsyncLoads() runs once per frame.
+	With a few workers, one file's read overlaps another's decompression and a third's parsing.
+*/
+
+#if !defined(ASYNC_LOAD_H)
+#define ASYNC_LOAD_H
+
+#include <functional>
+#include <future>
+
+namespace Content
+{
+	typedef std::function<void()> AsyncFinish;
+	typedef std::function<AsyncFinish()> AsyncWork;
+
+	// Call from the render thread, which is the one that runs the finishing halves; 0 threads picks a default.
+	void StartAsyncLoading(unsigned int numThreads = 0);
+
+	// Completes everything still in flight first (World::Destroy() before, DestroyResources() after).
+	void StopAsyncLoading();
+
+	// Any thread; 'work' may return an empty function if there's nothing left for the render thread.
+	void RunAsync(const AsyncWork &work);
+
+	// Render thread, once per frame: finishes completed loads for at most 'maxTime' seconds (at least one).
+	void ProcessAsyncLoads(float maxTime = 0.002f);
+
+	// Render thread: blocks until nothing's in flight (e.g. at the end of a loading screen).
+	void WaitForAsyncLoads();
+
+	// Waits for a single load; on the render thread it keeps finishing loads meanwhile (as this one may depend on it).
+	void WaitForAsyncLoad(const std::shared_future<void> &loaded);
+
+	unsigned int GetNumPendingLoads();
+}
+
+#endif // ASYNC_LOAD_H
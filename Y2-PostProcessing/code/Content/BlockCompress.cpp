@@ -0,0 +1,890 @@
+/*
+	Year 2 Direct3D 11 workshop template.
+	Content - Block compression (BC1/BC3/BC4/BC5/BC7) encoder & decoder.
+
+	Endpoints are fit along the principal axis of each block (power iteration on the covariance),
+	indices are picked by testing all palette entries at once with SSE, and the high quality preset
+	re-solves the endpoints by least squares for the chosen indices (a la stb_dxt & squish).
+*/
+
+#include "../Platform.h"
+#include <limits.h>
+#include <emmintrin.h>
+#include "BlockCompress.h"
+
+namespace Content
+{
+	// One 4x4 block of RGBA pixels.
+	typedef uint8_t Block[16][4];
+
+	// Lowest set bit of a 4-bit mask (movemask results).
+	static const uint8_t kLowestBit[16] = { 0, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0 };
+
+	// BC7 4-bit index interpolation weights (out of 64).
+	static const int kBC7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	static int Clamp(int value, int min, int max)
+	{
+		return std::max<int>(min, std::min<int>(max, value));
+	}
+
+	// Edge blocks of non-multiple-of-4 images replicate the last row & column.
+	static void FetchBlock(const Image &image, unsigned int blockX, unsigned int blockY, Block &block)
+	{
+		for (unsigned int iY = 0; iY < 4; ++iY)
+		{
+			const uint32_t *pRow = image.GetRow(std::min<unsigned int>(blockY*4 + iY, image.height-1));
+			for (unsigned int iX = 0; iX < 4; ++iX)
+			{
+				const uint32_t pixel = pRow[std::min<unsigned int>(blockX*4 + iX, image.width-1)];
+				memcpy(block[iY*4 + iX], &pixel, 4);
+			}
+		}
+	}
+
+	static void StoreBlock(const Block &block, unsigned int blockX, unsigned int blockY, Image &image)
+	{
+		for (unsigned int iY = 0; iY < 4 && blockY*4 + iY < image.height; ++iY)
+		{
+			uint32_t *pRow = image.GetRow(blockY*4 + iY);
+			for (unsigned int iX = 0; iX < 4 && blockX*4 + iX < image.width; ++iX)
+				memcpy(&pRow[blockX*4 + iX], block[iY*4 + iX], 4);
+		}
+	}
+
+	class BitWriter
+	{
+	public:
+		BitWriter(uint8_t *pOut, size_t numBytes) :
+			m_pOut(pOut), m_position(0)
+		{
+			memset(pOut, 0, numBytes);
+		}
+
+		void Write(uint32_t value, unsigned int numBits)
+		{
+			for (unsigned int iBit = 0; iBit < numBits; ++iBit, ++m_position)
+				if (value & (1 << iBit))
+					m_pOut[m_position >> 3] |= 1 << (m_position & 7);
+		}
+
+	private:
+		uint8_t *m_pOut;
+		unsigned int m_position;
+	};
+
+	class BitReader
+	{
+	public:
+		BitReader(const uint8_t *pIn) :
+			m_pIn(pIn), m_position(0) {}
+
+		uint32_t Read(unsigned int numBits)
+		{
+			uint32_t value = 0;
+			for (unsigned int iBit = 0; iBit < numBits; ++iBit, ++m_position)
+				value |= ((m_pIn[m_position >> 3] >> (m_position & 7)) & 1) << iBit;
+
+			return value;
+		}
+
+	private:
+		const uint8_t *m_pIn;
+		unsigned int m_position;
+	};
+
+	/*
+		Endpoint fitting (shared by BC1 & BC7).
+	*/
+
+	static void FitEndpoints(const Block &block, unsigned int numChannels, BCQuality quality, float start[4], float end[4])
+	{
+		float mean[4] = { 0.f }, lo[4], hi[4];
+		for (unsigned int iChan = 0; iChan < numChannels; ++iChan)
+		{
+			lo[iChan] = 255.f;
+			hi[iChan] = 0.f;
+		}
+
+		for (unsigned int iPixel = 0; iPixel < 16; ++iPixel)
+		{
+			for (unsigned int iChan = 0; iChan < numChannels; ++iChan)
+			{
+				const float value = block[iPixel][iChan];
+				mean[iChan] += value;
+				lo[iChan] = std::min<float>(lo[iChan], value);
+				hi[iChan] = std::max<float>(hi[iChan], value);
+			}
+		}
+
+		for (unsigned int iChan = 0; iChan < numChannels; ++iChan)
+			mean[iChan] *= 1.f/16.f;
+
+		float covariance[4][4] = { { 0.f } };
+		for (unsigned int iPixel = 0; iPixel < 16; ++iPixel)
+		{
+			float delta[4];
+			for (unsigned int iChan = 0; iChan < numChannels; ++iChan)
+				delta[iChan] = block[iPixel][iChan] - mean[iChan];
+
+			for (unsigned int iRow = 0; iRow < numChannels; ++iRow)
+				for (unsigned int iCol = 0; iCol < numChannels; ++iCol)
+					covariance[iRow][iCol] += delta[iRow]*delta[iCol];
+		}
+
+		if (kBCQualityFast == quality)
+		{
+			// Bounding box diagonal; flip channels that run against the widest one.
+			unsigned int iWidest = 0;
+			for (unsigned int iChan = 1; iChan < numChannels; ++iChan)
+				if (hi[iChan]-lo[iChan] > hi[iWidest]-lo[iWidest])
+					iWidest = iChan;
+
+			for (unsigned int iChan = 0; iChan < numChannels; ++iChan)
+			{
+				// Inset by 1/16th of the range, as the extremes are rarely hit by the interpolated entries.
+				const float inset = (hi[iChan]-lo[iChan])/16.f;
+				const bool flip = covariance[iWidest][iChan] < 0.f;
+				start[iChan] = (flip) ? hi[iChan]-inset : lo[iChan]+inset;
+				end[iChan]   = (flip) ? lo[iChan]+inset : hi[iChan]-inset;
+			}
+
+			return;
+		}
+
+		// Principal axis by power iteration, seeded with the bounding box diagonal.
+		float axis[4];
+		for (unsigned int iChan = 0; iChan < numChannels; ++iChan)
+			axis[iChan] = hi[iChan]-lo[iChan];
+
+		for (unsigned int iIter = 0; iIter < 8; ++iIter)
+		{
+			float next[4] = { 0.f }, maxComponent = 0.f;
+			for (unsigned int iRow = 0; iRow < numChannels; ++iRow)
+			{
+				for (unsigned int iCol = 0; iCol < numChannels; ++iCol)
+					next[iRow] += covariance[iRow][iCol]*axis[iCol];
+
+				maxComponent = std::max<float>(maxComponent, fabsf(next[iRow]));
+			}
+
+			if (maxComponent < kEpsilon)
+				break;
+
+			for (unsigned int iChan = 0; iChan < numChannels; ++iChan)
+				axis[iChan] = next[iChan]/maxComponent;
+		}
+
+		float lengthSqr = 0.f;
+		for (unsigned int iChan = 0; iChan < numChannels; ++iChan)
+			lengthSqr += axis[iChan]*axis[iChan];
+
+		if (lengthSqr < kEpsilon)
+		{
+			// Flat block.
+			for (unsigned int iChan = 0; iChan < numChannels; ++iChan)
+				start[iChan] = end[iChan] = mean[iChan];
+
+			return;
+		}
+
+		const float oneOverLength = 1.f/sqrtf(lengthSqr);
+		for (unsigned int iChan = 0; iChan < numChannels; ++iChan)
+			axis[iChan] *= oneOverLength;
+
+		float minT = FLT_MAX, maxT = -FLT_MAX;
+		for (unsigned int iPixel = 0; iPixel < 16; ++iPixel)
+		{
+			float T = 0.f;
+			for (unsigned int iChan = 0; iChan < numChannels; ++iChan)
+				T += (block[iPixel][iChan] - mean[iChan])*axis[iChan];
+
+			minT = std::min<float>(minT, T);
+			maxT = std::max<float>(maxT, T);
+		}
+
+		for (unsigned int iChan = 0; iChan < numChannels; ++iChan)
+		{
+			start[iChan] = saturatef((mean[iChan] + minT*axis[iChan])/255.f)*255.f;
+			end[iChan]   = saturatef((mean[iChan] + maxT*axis[iChan])/255.f)*255.f;
+		}
+	}
+
+	// Least-squares endpoints for fixed weights: pixel = (1-weight)*start + weight*end.
+	static bool SolveEndpoints(const Block &block, unsigned int numChannels, const float weights[16], float start[4], float end[4])
+	{
+		float AA = 0.f, AB = 0.f, BB = 0.f, AX[4] = { 0.f }, BX[4] = { 0.f };
+		for (unsigned int iPixel = 0; iPixel < 16; ++iPixel)
+		{
+			const float B = weights[iPixel], A = 1.f-B;
+			AA += A*A;
+			AB += A*B;
+			BB += B*B;
+			for (unsigned int iChan = 0; iChan < numChannels; ++iChan)
+			{
+				AX[iChan] += A*block[iPixel][iChan];
+				BX[iChan] += B*block[iPixel][iChan];
+			}
+		}
+
+		const float determinant = AA*BB - AB*AB;
+		if (fabsf(determinant) < 1e-6f)
+			return false;
+
+		const float oneOverDet = 1.f/determinant;
+		for (unsigned int iChan = 0; iChan < numChannels; ++iChan)
+		{
+			start[iChan] = saturatef((AX[iChan]*BB - BX[iChan]*AB)*oneOverDet/255.f)*255.f;
+			end[iChan]   = saturatef((BX[iChan]*AA - AX[iChan]*AB)*oneOverDet/255.f)*255.f;
+		}
+
+		return true;
+	}
+
+	// Horizontal minimum, broadcast to all lanes.
+	static __m128 HorizontalMin(__m128 value)
+	{
+		value = _mm_min_ps(value, _mm_shuffle_ps(value, value, _MM_SHUFFLE(2, 3, 0, 1)));
+		return _mm_min_ps(value, _mm_shuffle_ps(value, value, _MM_SHUFFLE(1, 0, 3, 2)));
+	}
+
+	/*
+		BC1 (colour).
+	*/
+
+	static uint16_t To565(const float color[4])
+	{
+		const int R = Clamp((int) (color[0]*31.f/255.f + 0.5f), 0, 31);
+		const int G = Clamp((int) (color[1]*63.f/255.f + 0.5f), 0, 63);
+		const int B = Clamp((int) (color[2]*31.f/255.f + 0.5f), 0, 31);
+		return (uint16_t) ((R << 11) | (G << 5) | B);
+	}
+
+	static void From565(uint16_t packed, int color[3])
+	{
+		const int R = (packed >> 11) & 31, G = (packed >> 5) & 63, B = packed & 31;
+		color[0] = (R << 3) | (R >> 2);
+		color[1] = (G << 2) | (G >> 4);
+		color[2] = (B << 3) | (B >> 2);
+	}
+
+	static void BuildPaletteBC1(uint16_t C0, uint16_t C1, int palette[4][3])
+	{
+		From565(C0, palette[0]);
+		From565(C1, palette[1]);
+		for (unsigned int iChan = 0; iChan < 3; ++iChan)
+		{
+			if (C0 > C1)
+			{
+				palette[2][iChan] = (2*palette[0][iChan] + palette[1][iChan])/3;
+				palette[3][iChan] = (palette[0][iChan] + 2*palette[1][iChan])/3;
+			}
+			else
+			{
+				palette[2][iChan] = (palette[0][iChan] + palette[1][iChan])/2;
+				palette[3][iChan] = 0;
+			}
+		}
+	}
+
+	// Nearest of 4 entries per pixel (one SSE register holds the distance to all of them); returns squared error.
+	static unsigned int PickIndicesBC1(const Block &block, const int palette[4][3], uint8_t indices[16])
+	{
+		const __m128 palR = _mm_set_ps((float) palette[3][0], (float) palette[2][0], (float) palette[1][0], (float) palette[0][0]);
+		const __m128 palG = _mm_set_ps((float) palette[3][1], (float) palette[2][1], (float) palette[1][1], (float) palette[0][1]);
+		const __m128 palB = _mm_set_ps((float) palette[3][2], (float) palette[2][2], (float) palette[1][2], (float) palette[0][2]);
+
+		float error = 0.f;
+		for (unsigned int iPixel = 0; iPixel < 16; ++iPixel)
+		{
+			const __m128 dR = _mm_sub_ps(palR, _mm_set1_ps(block[iPixel][0]));
+			const __m128 dG = _mm_sub_ps(palG, _mm_set1_ps(block[iPixel][1]));
+			const __m128 dB = _mm_sub_ps(palB, _mm_set1_ps(block[iPixel][2]));
+			const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dR, dR), _mm_mul_ps(dG, dG)), _mm_mul_ps(dB, dB));
+			const __m128 minimum = HorizontalMin(distance);
+
+			indices[iPixel] = kLowestBit[_mm_movemask_ps(_mm_cmpeq_ps(distance, minimum))];
+			error += _mm_cvtss_f32(minimum);
+		}
+
+		return (unsigned int) error;
+	}
+
+	// Orders endpoints for 4-colour mode (C0 > C1) and picks indices.
+	static unsigned int ResolveBC1(const Block &block, uint16_t &C0, uint16_t &C1, uint8_t indices[16])
+	{
+		if (C0 < C1)
+			std::swap(C0, C1);
+
+		if (C0 == C1)
+		{
+			// Nudge one endpoint a step; the exact colour remains available as an entry.
+			if (0 == C0) C0 = 1; else C1 = C0-1;
+		}
+
+		int palette[4][3];
+		BuildPaletteBC1(C0, C1, palette);
+		return PickIndicesBC1(block, palette, indices);
+	}
+
+	static void EncodeBC1(const Block &block, BCQuality quality, uint8_t *pOut)
+	{
+		float start[4], end[4];
+		FitEndpoints(block, 3, quality, start, end);
+
+		uint16_t C0 = To565(end), C1 = To565(start);
+		uint8_t indices[16];
+		unsigned int error = ResolveBC1(block, C0, C1, indices);
+
+		if (kBCQualityHigh == quality)
+		{
+			// Fraction of C1 per index.
+			const float kWeights[4] = { 0.f, 1.f, 1.f/3.f, 2.f/3.f };
+
+			for (unsigned int iIter = 0; iIter < 2 && 0 != error; ++iIter)
+			{
+				float weights[16];
+				for (unsigned int iPixel = 0; iPixel < 16; ++iPixel)
+					weights[iPixel] = kWeights[indices[iPixel]];
+
+				if (false == SolveEndpoints(block, 3, weights, end, start))
+					break;
+
+				uint16_t refinedC0 = To565(end), refinedC1 = To565(start);
+				uint8_t refinedIndices[16];
+				const unsigned int refinedError = ResolveBC1(block, refinedC0, refinedC1, refinedIndices);
+				if (refinedError >= error)
+					break;
+
+				C0 = refinedC0;
+				C1 = refinedC1;
+				memcpy(indices, refinedIndices, 16);
+				error = refinedError;
+			}
+		}
+
+		uint32_t packedIndices = 0;
+		for (unsigned int iPixel = 0; iPixel < 16; ++iPixel)
+			packedIndices |= indices[iPixel] << (iPixel*2);
+
+		memcpy(pOut, &C0, 2);
+		memcpy(pOut+2, &C1, 2);
+		memcpy(pOut+4, &packedIndices, 4);
+	}
+
+	static void DecodeBC1(const uint8_t *pIn, Block &block)
+	{
+		uint16_t C0, C1;
+		uint32_t packedIndices;
+		memcpy(&C0, pIn, 2);
+		memcpy(&C1, pIn+2, 2);
+		memcpy(&packedIndices, pIn+4, 4);
+
+		int palette[4][3];
+		BuildPaletteBC1(C0, C1, palette);
+
+		for (unsigned int iPixel = 0; iPixel < 16; ++iPixel)
+		{
+			const unsigned int index = (packedIndices >> (iPixel*2)) & 3;
+			block[iPixel][0] = (uint8_t) palette[index][0];
+			block[iPixel][1] = (uint8_t) palette[index][1];
+			block[iPixel][2] = (uint8_t) palette[index][2];
+			block[iPixel][3] = (C0 <= C1 && 3 == index) ? 0 : 255;
+		}
+	}
+
+	/*
+		BC4 (single channel; also BC3 alpha & both BC5 halves).
+	*/
+
+	static void BuildPaletteBC4(int A0, int A1, int palette[8])
+	{
+		palette[0] = A0;
+		palette[1] = A1;
+		if (A0 > A1)
+		{
+			for (int iStep = 1; iStep < 7; ++iStep)
+				palette[iStep+1] = ((7-iStep)*A0 + iStep*A1 + 3)/7;
+		}
+		else
+		{
+			for (int iStep = 1; iStep < 5; ++iStep)
+				palette[iStep+1] = ((5-iStep)*A0 + iStep*A1 + 2)/5;
+
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+	}
+
+	static unsigned int PickIndicesBC4(const Block &block, unsigned int channel, const int palette[8], uint8_t indices[16])
+	{
+		unsigned int error = 0;
+		for (unsigned int iPixel = 0; iPixel < 16; ++iPixel)
+		{
+			const int value = block[iPixel][channel];
+			int bestDistance = INT_MAX;
+			for (unsigned int iEntry = 0; iEntry < 8; ++iEntry)
+			{
+				const int distance = (palette[iEntry]-value)*(palette[iEntry]-value);
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					indices[iPixel] = (uint8_t) iEntry;
+				}
+			}
+
+			error += bestDistance;
+		}
+
+		return error;
+	}
+
+	static void EncodeBC4(const Block &block, unsigned int channel, BCQuality quality, uint8_t *pOut)
+	{
+		int lo = 255, hi = 0;
+		for (unsigned int iPixel = 0; iPixel < 16; ++iPixel)
+		{
+			lo = std::min<int>(lo, block[iPixel][channel]);
+			hi = std::max<int>(hi, block[iPixel][channel]);
+		}
+
+		// 8-value mode (A0 > A1).
+		int A0 = hi, A1 = lo, palette[8];
+		uint8_t indices[16];
+		BuildPaletteBC4(A0, A1, palette);
+		unsigned int error = PickIndicesBC4(block, channel, palette, indices);
+
+		if (kBCQualityHigh == quality && 0 != error)
+		{
+			// 6-value mode spans the range without the exact 0 & 255, which are free entries.
+			int innerLo = 255, innerHi = 0;
+			for (unsigned int iPixel = 0; iPixel < 16; ++iPixel)
+			{
+				const int value = block[iPixel][channel];
+				if (0 != value && 255 != value)
+				{
+					innerLo = std::min<int>(innerLo, value);
+					innerHi = std::max<int>(innerHi, value);
+				}
+			}
+
+			if (innerLo <= innerHi)
+			{
+				int palette6[8];
+				uint8_t indices6[16];
+				BuildPaletteBC4(innerLo, innerHi, palette6);
+				const unsigned int error6 = PickIndicesBC4(block, channel, palette6, indices6);
+				if (error6 < error)
+				{
+					A0 = innerLo;
+					A1 = innerHi;
+					memcpy(indices, indices6, 16);
+				}
+			}
+		}
+
+		pOut[0] = (uint8_t) A0;
+		pOut[1] = (uint8_t) A1;
+
+		uint64_t packedIndices = 0;
+		for (unsigned int iPixel = 0; iPixel < 16; ++iPixel)
+			packedIndices |= (uint64_t) indices[iPixel] << (iPixel*3);
+
+		for (unsigned int iByte = 0; iByte < 6; ++iByte)
+			pOut[2+iByte] = (uint8_t) (packedIndices >> (iByte*8));
+	}
+
+	static void DecodeBC4(const uint8_t *pIn, unsigned int channel, Block &block)
+	{
+		int palette[8];
+		BuildPaletteBC4(pIn[0], pIn[1], palette);
+
+		uint64_t packedIndices = 0;
+		for (unsigned int iByte = 0; iByte < 6; ++iByte)
+			packedIndices |= (uint64_t) pIn[2+iByte] << (iByte*8);
+
+		for (unsigned int iPixel = 0; iPixel < 16; ++iPixel)
+			block[iPixel][channel] = (uint8_t) palette[(packedIndices >> (iPixel*3)) & 7];
+	}
+
+	/*
+		BC7 (mode 6).
+	*/
+
+	struct BC7Endpoints
+	{
+		int quantized[2][4]; // 7-bit.
+		int pBits[2];
+	};
+
+	static void ExpandBC7(const BC7Endpoints &endpoints, int colors[2][4])
+	{
+		for (unsigned int iEnd = 0; iEnd < 2; ++iEnd)
+			for (unsigned int iChan = 0; iChan < 4; ++iChan)
+				colors[iEnd][iChan] = (endpoints.quantized[iEnd][iChan] << 1) | endpoints.pBits[iEnd];
+	}
+
+	static void QuantizeBC7(const float endpoint[4], int pBit, int quantized[4])
+	{
+		for (unsigned int iChan = 0; iChan < 4; ++iChan)
+			quantized[iChan] = Clamp((int) ((endpoint[iChan] - pBit)*0.5f + 0.5f), 0, 127);
+	}
+
+	// Nearest of 16 entries, 4 at a time; returns squared error.
+	static unsigned int PickIndicesBC7(const Block &block, const BC7Endpoints &endpoints, uint8_t indices[16])
+	{
+		int colors[2][4];
+		ExpandBC7(endpoints, colors);
+
+		__m128 palette[4][4]; // [channel][group of 4 entries]
+		for (unsigned int iChan = 0; iChan < 4; ++iChan)
+		{
+			float entries[16];
+			for (unsigned int iEntry = 0; iEntry < 16; ++iEntry)
+				entries[iEntry] = (float) (((64-kBC7Weights[iEntry])*colors[0][iChan] + kBC7Weights[iEntry]*colors[1][iChan] + 32) >> 6);
+
+			for (unsigned int iGroup = 0; iGroup < 4; ++iGroup)
+				palette[iChan][iGroup] = _mm_loadu_ps(entries + iGroup*4);
+		}
+
+		float error = 0.f;
+		for (unsigned int iPixel = 0; iPixel < 16; ++iPixel)
+		{
+			__m128 distance[4];
+			for (unsigned int iGroup = 0; iGroup < 4; ++iGroup)
+			{
+				distance[iGroup] = _mm_setzero_ps();
+				for (unsigned int iChan = 0; iChan < 4; ++iChan)
+				{
+					const __m128 delta = _mm_sub_ps(palette[iChan][iGroup], _mm_set1_ps(block[iPixel][iChan]));
+					distance[iGroup] = _mm_add_ps(distance[iGroup], _mm_mul_ps(delta, delta));
+				}
+			}
+
+			const __m128 minimum = HorizontalMin(_mm_min_ps(_mm_min_ps(distance[0], distance[1]), _mm_min_ps(distance[2], distance[3])));
+			for (unsigned int iGroup = 0; iGroup < 4; ++iGroup)
+			{
+				const int mask = _mm_movemask_ps(_mm_cmpeq_ps(distance[iGroup], minimum));
+				if (0 != mask)
+				{
+					indices[iPixel] = (uint8_t) (iGroup*4 + kLowestBit[mask]);
+					break;
+				}
+			}
+
+			error += _mm_cvtss_f32(minimum);
+		}
+
+		return (unsigned int) error;
+	}
+
+	static void EncodeBC7(const Block &block, BCQuality quality, uint8_t *pOut)
+	{
+		float start[4], end[4];
+		FitEndpoints(block, 4, quality, start, end);
+
+		BC7Endpoints best = {};
+		uint8_t bestIndices[16] = {};
+		unsigned int bestError = UINT_MAX;
+
+		auto tryEndpoints = [&](const float start[4], const float end[4])
+		{
+			// High quality tries all p-bit combinations, otherwise each follows the parity of (rounded) green.
+			const int numCombos = (kBCQualityHigh == quality) ? 4 : 1;
+			for (int iCombo = 0; iCombo < numCombos; ++iCombo)
+			{
+				BC7Endpoints candidate;
+				candidate.pBits[0] = (kBCQualityHigh == quality) ? iCombo & 1  : (int) (start[1] + 0.5f) & 1;
+				candidate.pBits[1] = (kBCQualityHigh == quality) ? iCombo >> 1 : (int) (end[1] + 0.5f) & 1;
+
+				QuantizeBC7(start, candidate.pBits[0], candidate.quantized[0]);
+				QuantizeBC7(end, candidate.pBits[1], candidate.quantized[1]);
+
+				uint8_t indices[16];
+				const unsigned int error = PickIndicesBC7(block, candidate, indices);
+				if (error < bestError)
+				{
+					best = candidate;
+					memcpy(bestIndices, indices, 16);
+					bestError = error;
+				}
+			}
+		};
+
+		tryEndpoints(start, end);
+
+		if (kBCQualityHigh == quality)
+		{
+			for (unsigned int iIter = 0; iIter < 2 && 0 != bestError; ++iIter)
+			{
+				float weights[16];
+				for (unsigned int iPixel = 0; iPixel < 16; ++iPixel)
+					weights[iPixel] = kBC7Weights[bestIndices[iPixel]]/64.f;
+
+				if (false == SolveEndpoints(block, 4, weights, start, end))
+					break;
+
+				const unsigned int prevError = bestError;
+				tryEndpoints(start, end);
+				if (bestError >= prevError)
+					break;
+			}
+		}
+
+		// The anchor (first) index has an implicit zero MSB: swap the endpoints if need be.
+		if (bestIndices[0] & 8)
+		{
+			std::swap(best.pBits[0], best.pBits[1]);
+			for (unsigned int iChan = 0; iChan < 4; ++iChan)
+				std::swap(best.quantized[0][iChan], best.quantized[1][iChan]);
+
+			for (unsigned int iPixel = 0; iPixel < 16; ++iPixel)
+				bestIndices[iPixel] = 15 - bestIndices[iPixel];
+		}
+
+		BitWriter writer(pOut, 16);
+		writer.Write(1 << 6, 7); // Mode 6.
+		for (unsigned int iChan = 0; iChan < 4; ++iChan)
+		{
+			writer.Write(best.quantized[0][iChan], 7);
+			writer.Write(best.quantized[1][iChan], 7);
+		}
+
+		writer.Write(best.pBits[0], 1);
+		writer.Write(best.pBits[1], 1);
+
+		writer.Write(bestIndices[0], 3);
+		for (unsigned int iPixel = 1; iPixel < 16; ++iPixel)
+			writer.Write(bestIndices[iPixel], 4);
+	}
+
+	static void DecodeBC7(const uint8_t *pIn, Block &block)
+	{
+		if (0x40 != (pIn[0] & 0x7f))
+		{
+			// Not mode 6: not ours.
+			for (unsigned int iPixel = 0; iPixel < 16; ++iPixel)
+			{
+				block[iPixel][0] = block[iPixel][2] = block[iPixel][3] = 255;
+				block[iPixel][1] = 0;
+			}
+
+			return;
+		}
+
+		BitReader reader(pIn);
+		reader.Read(7);
+
+		BC7Endpoints endpoints;
+		for (unsigned int iChan = 0; iChan < 4; ++iChan)
+		{
+			endpoints.quantized[0][iChan] = reader.Read(7);
+			endpoints.quantized[1][iChan] = reader.Read(7);
+		}
+
+		endpoints.pBits[0] = reader.Read(1);
+		endpoints.pBits[1] = reader.Read(1);
+
+		int colors[2][4];
+		ExpandBC7(endpoints, colors);
+
+		for (unsigned int iPixel = 0; iPixel < 16; ++iPixel)
+		{
+			const int weight = kBC7Weights[reader.Read((0 == iPixel) ? 3 : 4)];
+			for (unsigned int iChan = 0; iChan < 4; ++iChan)
+				block[iPixel][iChan] = (uint8_t) (((64-weight)*colors[0][iChan] + weight*colors[1][iChan] + 32) >> 6);
+		}
+	}
+
+	/*
+		Interface.
+	*/
+
+	const char *GetBCFormatName(BCFormat format)
+	{
+		static const char *kNames[kNumBCFormats] = { "BC1", "BC3", "BC4", "BC5", "BC7" };
+		ASSERT(format < kNumBCFormats);
+		return kNames[format];
+	}
+
+	DXGI_FORMAT GetBCFormatDXGI(BCFormat format, bool isSRGB)
+	{
+		switch (format)
+		{
+		case kBC1: return (isSRGB) ? DXGI_FORMAT_BC1_UNORM_SRGB : DXGI_FORMAT_BC1_UNORM;
+		case kBC3: return (isSRGB) ? DXGI_FORMAT_BC3_UNORM_SRGB : DXGI_FORMAT_BC3_UNORM;
+		case kBC4: return DXGI_FORMAT_BC4_UNORM;
+		case kBC5: return DXGI_FORMAT_BC5_UNORM;
+		case kBC7: return (isSRGB) ? DXGI_FORMAT_BC7_UNORM_SRGB : DXGI_FORMAT_BC7_UNORM;
+		default:   ASSERT(false); return DXGI_FORMAT_UNKNOWN;
+		}
+	}
+
+	size_t GetBlockSize(BCFormat format)
+	{
+		return (kBC1 == format || kBC4 == format) ? 8 : 16;
+	}
+
+	size_t GetBlockRowPitch(BCFormat format, unsigned int width)
+	{
+		return std::max<unsigned int>(1, (width+3)/4)*GetBlockSize(format);
+	}
+
+	size_t GetCompressedSize(BCFormat format, unsigned int width, unsigned int height)
+	{
+		return GetBlockRowPitch(format, width)*std::max<unsigned int>(1, (height+3)/4);
+	}
+
+	void Compress(const Image &image, BCFormat format, BCQuality quality, std::vector<uint8_t> &blocks)
+	{
+		ASSERT(0 != image.width && 0 != image.height);
+
+		const unsigned int blocksWide = (image.width+3)/4;
+		const unsigned int blocksHigh = (image.height+3)/4;
+		const size_t blockSize = GetBlockSize(format);
+		blocks.resize(GetCompressedSize(format, image.width, image.height));
+
+		ParallelFor(blocksHigh, 1, [&](unsigned int iBlockRow)
+		{
+			uint8_t *pOut = &blocks[iBlockRow*blocksWide*blockSize];
+			for (unsigned int iBlock = 0; iBlock < blocksWide; ++iBlock, pOut += blockSize)
+			{
+				Block block;
+				FetchBlock(image, iBlock, iBlockRow, block);
+
+				switch (format)
+				{
+				case kBC1:
+					EncodeBC1(block, quality, pOut);
+					break;
+
+				case kBC3:
+					EncodeBC4(block, 3, quality, pOut);
+					EncodeBC1(block, quality, pOut+8);
+					break;
+
+				case kBC4:
+					EncodeBC4(block, 0, quality, pOut);
+					break;
+
+				case kBC5:
+					EncodeBC4(block, 0, quality, pOut);
+					EncodeBC4(block, 1, quality, pOut+8);
+					break;
+
+				case kBC7:
+					EncodeBC7(block, quality, pOut);
+					break;
+
+				default:
+					ASSERT(false);
+				}
+			}
+		});
+	}
+
+	void Decompress(const uint8_t *pBlocks, BCFormat format, Image &image)
+	{
+		ASSERT(nullptr != pBlocks);
+		ASSERT(image.pixels.size() == image.width*image.height);
+
+		const unsigned int blocksWide = (image.width+3)/4;
+		const unsigned int blocksHigh = (image.height+3)/4;
+		const size_t blockSize = GetBlockSize(format);
+
+		ParallelFor(blocksHigh, 1, [&](unsigned int iBlockRow)
+		{
+			const uint8_t *pIn = pBlocks + iBlockRow*blocksWide*blockSize;
+			for (unsigned int iBlock = 0; iBlock < blocksWide; ++iBlock, pIn += blockSize)
+			{
+				Block block;
+				memset(block, 0, sizeof(Block));
+				for (unsigned int iPixel = 0; iPixel < 16; ++iPixel)
+					block[iPixel][3] = 255;
+
+				switch (format)
+				{
+				case kBC1:
+					DecodeBC1(pIn, block);
+					break;
+
+				case kBC3:
+					DecodeBC1(pIn+8, block);
+					DecodeBC4(pIn, 3, block);
+					break;
+
+				case kBC4:
+					DecodeBC4(pIn, 0, block);
+					break;
+
+				case kBC5:
+					DecodeBC4(pIn, 0, block);
+					DecodeBC4(pIn+8, 1, block);
+					break;
+
+				case kBC7:
+					DecodeBC7(pIn, block);
+					break;
+
+				default:
+					ASSERT(false);
+				}
+
+				StoreBlock(block, iBlock, iBlockRow, image);
+			}
+		});
+	}
+
+	float ComputePSNR(const Image &A, const Image &B, unsigned int channelMask)
+	{
+		ASSERT(A.width == B.width && A.height == B.height);
+
+		double sum = 0.0;
+		size_t count = 0;
+		for (size_t iPixel = 0; iPixel < A.pixels.size(); ++iPixel)
+		{
+			for (unsigned int iChan = 0; iChan < 4; ++iChan)
+			{
+				if (channelMask & (1 << iChan))
+				{
+					const int delta = (int) ((A.pixels[iPixel] >> (iChan*8)) & 0xff) - (int) ((B.pixels[iPixel] >> (iChan*8)) & 0xff);
+					sum += delta*delta;
+					++count;
+				}
+			}
+		}
+
+		if (0.0 == sum || 0 == count)
+			return 999.f;
+
+		const double MSE = sum/count;
+		return (float) (10.0*log10(255.0*255.0/MSE));
+	}
+
+	void BenchmarkBlockCompression(const Image &image)
+	{
+		static const unsigned int kChannelMasks[kNumBCFormats] = { 7, 15, 1, 3, 15 };
+		static const char *kQualityNames[] = { "fast", "normal", "high" };
+
+		const float megaPixels = image.width*image.height/1000000.f;
+		DEBUG_LOG("Block compression benchmark (%ux%u, %u threads):", image.width, image.height, GetNumHardwareThreads());
+
+		for (unsigned int iFormat = 0; iFormat < kNumBCFormats; ++iFormat)
+		{
+			const BCFormat format = (BCFormat) iFormat;
+			for (unsigned int iQuality = kBCQualityFast; iQuality <= kBCQualityHigh; ++iQuality)
+			{
+				std::vector<uint8_t> blocks;
+				Timer timer;
+				Compress(image, format, (BCQuality) iQuality, blocks);
+				const float seconds = std::max<float>(timer.Get(), 1e-6f);
+
+				Image decoded(image.width, image.height);
+				Decompress(blocks.data(), format, decoded);
+				const float PSNR = ComputePSNR(image, decoded, kChannelMasks[iFormat]);
+
+				DEBUG_LOG("- %s (%s): %.2f MP/s, PSNR %.2f dB", GetBCFormatName(format), kQualityNames[iQuality], megaPixels/seconds, PSNR);
+			}
+		}
+	}
+}
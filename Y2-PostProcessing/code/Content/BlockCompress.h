@@ -0,0 +1,59 @@
+/*
+	Year 2 Direct3D 11 workshop template.
+	Content - Block compression (BC1/BC3/BC4/BC5/BC7) encoder & decoder.
+
+	Input is R8G8B8A8 (so *not* the B8G8R8A8 we render to): BC4 takes R, BC5 takes R & G,
+	BC1 ignores alpha (opaque 4-colour blocks only).
+
+	BC7 is encoded using mode 6 only (single subset RGBA, 7777 endpoints + p-bits, 4-bit indices).
+	That's a sound all-rounder; the decoder handles just that mode too and flags any other as magenta.
+
+	Output is a tight array of block rows, i.e. pitch = GetBlockRowPitch(), which is what
+	D3D11_SUBRESOURCE_DATA wants.
+*/
+
+#if !defined(BLOCK_COMPRESS_H)
+#define BLOCK_COMPRESS_H
+
+#include "Image.h"
+
+namespace Content
+{
+	enum BCFormat
+	{
+		kBC1,
+		kBC3,
+		kBC4,
+		kBC5,
+		kBC7,
+		kNumBCFormats
+	};
+
+	enum BCQuality
+	{
+		kBCQualityFast,   // Bounding box endpoints, projected indices.
+		kBCQualityNormal, // Principal axis endpoints, nearest indices.
+		kBCQualityHigh    // Normal + least-squares endpoint refinement (and BC4 6-value & BC7 p-bit search).
+	};
+
+	const char *GetBCFormatName(BCFormat format);
+	DXGI_FORMAT GetBCFormatDXGI(BCFormat format, bool isSRGB);
+
+	size_t GetBlockSize(BCFormat format); // 8 or 16 bytes.
+	size_t GetBlockRowPitch(BCFormat format, unsigned int width);
+	size_t GetCompressedSize(BCFormat format, unsigned int width, unsigned int height);
+
+	// Splits block rows over all cores.
+	void Compress(const Image &image, BCFormat format, BCQuality quality, std::vector<uint8_t> &blocks);
+
+	// 'image' must be sized beforehand. Channels not stored by the format are set to 0 (alpha to 255).
+	void Decompress(const uint8_t *pBlocks, BCFormat format, Image &image);
+
+	// Peak signal-to-noise ratio over the selected channels (bit 0 = R, 1 = G, ...); returns 999 when identical.
+	float ComputePSNR(const Image &A, const Image &B, unsigned int channelMask);
+
+	// Logs megapixels per second & PSNR for each format and quality to the debug output.
+	void BenchmarkBlockCompression(const Image &image);
+}
+
+#endif // BLOCK_COMPRESS_H
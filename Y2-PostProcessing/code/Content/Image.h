@@ -0,0 +1,39 @@
+/*
+	Content: 32-bit 4-channel image container & colour space helpers.
+
+	Channel order is either B8G8R8A8 or R8G8B8A8; none of the content tools care which one it is,
+	as long as alpha lives in the top byte.
+*/
+
+#pragma once
+
+namespace Content
+{
+	struct Image
+	{
+		Image() :
+			width(0), height(0) {}
+
+		Image(unsigned int width, unsigned int height) :
+			width(width), height(height), pixels(width*height) {}
+
+		uint32_t *GetRow(unsigned int Y)             { ASSERT(Y < height); return &pixels[Y*width]; }
+		const uint32_t *GetRow(unsigned int Y) const { ASSERT(Y < height); return &pixels[Y*width]; }
+
+		size_t GetSize() const { return pixels.size()*sizeof(uint32_t); }
+
+		unsigned int width, height;
+		std::vector<uint32_t> pixels;
+	};
+
+	// Exact sRGB transfer functions (IEC 61966-2-1); use a table if you need these per pixel.
+	inline float SRGBToLinear(float value)
+	{
+		return (value <= 0.04045f) ? value/12.92f : powf((value + 0.055f)/1.055f, 2.4f);
+	}
+
+	inline float LinearToSRGB(float value)
+	{
+		return (value <= 0.0031308f) ? value*12.92f : 1.055f*powf(value, 1.f/2.4f) - 0.055f;
+	}
+}
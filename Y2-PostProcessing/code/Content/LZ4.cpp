@@ -0,0 +1,194 @@
+/*
+	Year 2 Direct3D 11 workshop template.
+	Content - LZ4 block (de)compression.
+
+	Format: a sequence is a token (literal length << 4 | match length-4), the literal length's overflow
+	(runs of 255), the literals, a 16-bit offset and the match length's overflow. The last sequence has
+	literals only; the final 5 bytes are always literals & no match starts within the final 12.
+*/
+
+#include "../Platform.h"
+#include "LZ4.h"
+
+namespace Content
+{
+	const size_t kMinMatch = 4;
+	const size_t kLastLiterals = 5;
+	const size_t kMatchStartLimit = 12;
+	const size_t kMaxOffset = 0xffff;
+
+	const unsigned int kHashBits = 16;
+
+	static uint32_t Read32(const uint8_t *pData)
+	{
+		uint32_t value;
+		memcpy(&value, pData, sizeof(value));
+		return value;
+	}
+
+	static unsigned int Hash(uint32_t sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - kHashBits);
+	}
+
+	static uint8_t *WriteLength(uint8_t *pTarget, size_t length)
+	{
+		for (; length >= 255; length -= 255)
+			*pTarget++ = 255;
+
+		*pTarget++ = (uint8_t) length;
+		return pTarget;
+	}
+
+	// Match length 0 means literals only (the last sequence).
+	static uint8_t *WriteSequence(uint8_t *pTarget, const uint8_t *pLiterals, size_t numLiterals, size_t offset, size_t matchLength)
+	{
+		uint8_t *pToken = pTarget++;
+		*pToken = (uint8_t) (std::min<size_t>(numLiterals, 15) << 4);
+		if (numLiterals >= 15)
+			pTarget = WriteLength(pTarget, numLiterals-15);
+
+		memcpy(pTarget, pLiterals, numLiterals);
+		pTarget += numLiterals;
+
+		if (0 != matchLength)
+		{
+			*pTarget++ = (uint8_t) offset;
+			*pTarget++ = (uint8_t) (offset >> 8);
+
+			const size_t length = matchLength - kMinMatch;
+			*pToken |= (uint8_t) std::min<size_t>(length, 15);
+			if (length >= 15)
+				pTarget = WriteLength(pTarget, length-15);
+		}
+
+		return pTarget;
+	}
+
+	size_t CompressLZ4(const uint8_t *pSource, size_t size, uint8_t *pTarget)
+	{
+		uint8_t *pOut = pTarget;
+		size_t anchor = 0;
+
+		if (size > kMatchStartLimit)
+		{
+			// Last position seen for each hashed 4-byte sequence (0 is as good a start as any: candidates are verified).
+			std::vector<uint32_t> table(1 << kHashBits, 0);
+
+			const size_t matchStartLimit = size - kMatchStartLimit;
+			const size_t matchEndLimit = size - kLastLiterals;
+
+			size_t position = 0;
+			while (position <= matchStartLimit)
+			{
+				const uint32_t sequence = Read32(pSource + position);
+				uint32_t &slot = table[Hash(sequence)];
+				size_t candidate = slot;
+				slot = (uint32_t) position;
+
+				if (candidate >= position || position - candidate > kMaxOffset || Read32(pSource + candidate) != sequence)
+				{
+					++position;
+					continue;
+				}
+
+				// Grow backwards into the pending literals, then forwards.
+				while (position > anchor && candidate > 0 && pSource[position-1] == pSource[candidate-1])
+				{
+					--position;
+					--candidate;
+				}
+
+				size_t length = kMinMatch;
+				while (position + length < matchEndLimit && pSource[candidate + length] == pSource[position + length])
+					++length;
+
+				pOut = WriteSequence(pOut, pSource + anchor, position - anchor, position - candidate, length);
+				position += length;
+				anchor = position;
+
+				// Seed the table with the tail of the match.
+				if (position <= matchStartLimit)
+					table[Hash(Read32(pSource + position-2))] = (uint32_t) (position-2);
+			}
+		}
+
+		pOut = WriteSequence(pOut, pSource + anchor, size - anchor, 0, 0);
+
+		ASSERT((size_t) (pOut - pTarget) <= GetLZ4MaxCompressedSize(size));
+		return (size_t) (pOut - pTarget);
+	}
+
+	static bool ReadLength(const uint8_t *&pSource, const uint8_t *pEnd, size_t &length)
+	{
+		uint8_t value;
+		do
+		{
+			if (pSource == pEnd)
+				return false;
+
+			value = *pSource++;
+			length += value;
+		}
+		while (255 == value);
+
+		return true;
+	}
+
+	bool DecompressLZ4(const uint8_t *pSource, size_t size, uint8_t *pTarget, size_t rawSize)
+	{
+		const uint8_t *pEnd = pSource + size;
+		uint8_t *pOut = pTarget;
+		uint8_t *pOutEnd = pTarget + rawSize;
+
+		while (pSource < pEnd)
+		{
+			const uint8_t token = *pSource++;
+
+			size_t numLiterals = token >> 4;
+			if (15 == numLiterals && false == ReadLength(pSource, pEnd, numLiterals))
+				return false;
+
+			if (numLiterals > (size_t) (pEnd - pSource) || numLiterals > (size_t) (pOutEnd - pOut))
+				return false;
+
+			memcpy(pOut, pSource, numLiterals);
+			pSource += numLiterals;
+			pOut += numLiterals;
+
+			// Last sequence?
+			if (pSource == pEnd)
+				break;
+
+			if (pEnd - pSource < 2)
+				return false;
+
+			const size_t offset = pSource[0] | (pSource[1] << 8);
+			pSource += 2;
+			if (0 == offset || offset > (size_t) (pOut - pTarget))
+				return false;
+
+			size_t length = token & 15;
+			if (15 == length && false == ReadLength(pSource, pEnd, length))
+				return false;
+
+			length += kMinMatch;
+			if (length > (size_t) (pOutEnd - pOut))
+				return false;
+
+			// Matches may overlap their own output (that's how runs are encoded).
+			const uint8_t *pMatch = pOut - offset;
+			if (offset >= length)
+				memcpy(pOut, pMatch, length);
+			else
+			{
+				for (size_t iByte = 0; iByte < length; ++iByte)
+					pOut[iByte] = pMatch[iByte];
+			}
+
+			pOut += length;
+		}
+
+		return pOut == pOutEnd;
+	}
+}
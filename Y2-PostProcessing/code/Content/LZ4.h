@@ -0,0 +1,28 @@
+/*
+	Year 2 Direct3D 11 workshop template.
+	Content - LZ4 block (de)compression.
+
+	Raw LZ4 blocks (no frame header or checksum), compatible with the reference implementation's
+	LZ4_compress_default() & LZ4_decompress_safe(). The compressor is the plain greedy single-probe one:
+	quick enough to run on all of our content at pack time, and decompression runs at memory speed.
+*/
+
+#if !defined(LZ4_H)
+#define LZ4_H
+
+namespace Content
+{
+	// Worst case (incompressible input).
+	inline size_t GetLZ4MaxCompressedSize(size_t size) { return size + size/255 + 16; }
+
+	// Best case (long runs): a match costs at least a byte per 255 it repeats.
+	inline uint64_t GetLZ4MaxDecompressedSize(uint64_t size) { return size*255; }
+
+	// Target must hold GetLZ4MaxCompressedSize(size) bytes; returns the compressed size.
+	size_t CompressLZ4(const uint8_t *pSource, size_t size, uint8_t *pTarget);
+
+	// Decodes exactly 'rawSize' bytes; any malformed or truncated input fails (no reads or writes out of bounds).
+	bool DecompressLZ4(const uint8_t *pSource, size_t size, uint8_t *pTarget, size_t rawSize);
+}
+
+#endif // LZ4_H
@@ -0,0 +1,223 @@
+/*
+	Year 2 Direct3D 11 workshop template.
+	Content - Binary runtime mesh format ('.y2mesh').
+*/
+
+#include "../Platform.h"
+#include <fstream>
+#include "../D3D.h"
+#include "MeshFile.h"
+
+namespace Content
+{
+	static uint64_t Align(uint64_t offset)
+	{
+		return (offset + kMeshFileAlignment-1) & ~(uint64_t) (kMeshFileAlignment-1);
+	}
+
+	// Aligned (as the tables are used in place) & within the file; written so nothing can overflow.
+	static bool IsSectionValid(uint64_t offset, uint64_t count, uint64_t stride, size_t size)
+	{
+		return 0 == (offset % kMeshFileAlignment) && offset <= size && count*stride <= size - offset;
+	}
+
+	unsigned int GetMeshVertexStride(uint32_t vertexFormat)
+	{
+		ASSERT(0 != (vertexFormat & kMeshPosition));
+
+		unsigned int stride = 3*sizeof(float);
+		if (vertexFormat & kMeshNormal)   stride += 3*sizeof(float);
+		if (vertexFormat & kMeshTexCoord) stride += 2*sizeof(float);
+		return stride;
+	}
+
+	D3D::VertexDecl GetMeshVertexDecl(uint32_t vertexFormat)
+	{
+		ASSERT(0 != (vertexFormat & kMeshPosition));
+
+		D3D::VertexDecl decl;
+		decl.Add("POSITION", 0, D3D::kVertexFloat3);
+		if (vertexFormat & kMeshNormal)   decl.Add("NORMAL", 0, D3D::kVertexFloat3);
+		if (vertexFormat & kMeshTexCoord) decl.Add("TEXCOORD", 0, D3D::kVertexFloat2);
+
+		ASSERT(decl.GetStride(0) == GetMeshVertexStride(vertexFormat));
+		return decl;
+	}
+
+	bool WriteMeshFile(const std::string &path, const MeshData &mesh)
+	{
+		ASSERT(false == mesh.LODs.empty());
+
+		MeshFileHeader header;
+		memset(&header, 0, sizeof(header));
+		header.magic = kMeshFileMagic;
+		header.version = kMeshFileVersion;
+		header.vertexFormat = mesh.vertexFormat;
+		header.vertexStride = GetMeshVertexStride(mesh.vertexFormat);
+		header.numVertices = mesh.GetNumVertices();
+		header.indexSize = (header.numVertices <= 0xffff) ? 2 : 4;
+		header.numIndices = (uint32_t) mesh.indices.size();
+		header.numSubmeshes = (uint32_t) mesh.submeshes.size();
+		header.numLODs = (uint32_t) mesh.LODs.size();
+		header.bounds = mesh.bounds;
+		header.submeshOffset = Align(sizeof(MeshFileHeader));
+		header.LODOffset = Align(header.submeshOffset + header.numSubmeshes*sizeof(MeshFileSubmesh));
+		header.vertexOffset = Align(header.LODOffset + header.numLODs*sizeof(MeshFileLOD));
+		header.indexOffset = Align(header.vertexOffset + (uint64_t) header.numVertices*header.vertexStride);
+
+		std::ofstream file(path, std::ios::binary);
+		if (false == file.is_open())
+		{
+			SetLastError("Can not write mesh file: " + path);
+			return false;
+		}
+
+		auto writeAt = [&file](uint64_t offset, const void *pData, size_t numBytes)
+		{
+			static const char kPadding[kMeshFileAlignment] = { 0 };
+			const uint64_t position = (uint64_t) file.tellp();
+			ASSERT(offset >= position && offset - position < kMeshFileAlignment);
+			file.write(kPadding, (std::streamsize) (offset - position));
+			file.write(static_cast<const char *>(pData), (std::streamsize) numBytes);
+		};
+
+		writeAt(0, &header, sizeof(header));
+		writeAt(header.submeshOffset, mesh.submeshes.data(), mesh.submeshes.size()*sizeof(MeshFileSubmesh));
+		writeAt(header.LODOffset, mesh.LODs.data(), mesh.LODs.size()*sizeof(MeshFileLOD));
+		writeAt(header.vertexOffset, mesh.vertices.data(), mesh.vertices.size()*sizeof(float));
+		if (2 == header.indexSize)
+		{
+			std::vector<uint16_t> indices(mesh.indices.begin(), mesh.indices.end());
+			writeAt(header.indexOffset, indices.data(), indices.size()*sizeof(uint16_t));
+		}
+		else
+			writeAt(header.indexOffset, mesh.indices.data(), mesh.indices.size()*sizeof(uint32_t));
+
+		if (false == file.good())
+		{
+			SetLastError("Can not write mesh file: " + path);
+			return false;
+		}
+
+		return true;
+	}
+
+	bool MeshFile::Open(const std::string &path)
+	{
+		if (false == ReadResource(path, m_data))
+			return false;
+
+		const size_t size = m_data.GetSize();
+		if (size < sizeof(MeshFileHeader))
+		{
+			SetLastError("Mesh file truncated: " + path);
+			m_data.Release();
+			return false;
+		}
+
+		const MeshFileHeader &header = GetHeader();
+		if (kMeshFileMagic != header.magic || kMeshFileVersion != header.version)
+		{
+			SetLastError("Not a mesh file (or wrong version): " + path);
+			m_data.Release();
+			return false;
+		}
+
+		// Check every section lies within the file (counts are 32-bit, so their products can't overflow).
+		const uint32_t knownFormats = kMeshPosition | kMeshNormal | kMeshTexCoord;
+		bool isValid =
+			0 != (header.vertexFormat & kMeshPosition) && 0 == (header.vertexFormat & ~knownFormats)
+			&& header.vertexStride == GetMeshVertexStride(header.vertexFormat)
+			&& (2 == header.indexSize || 4 == header.indexSize)
+			&& 0 != header.numLODs
+			&& IsSectionValid(header.submeshOffset, header.numSubmeshes, sizeof(MeshFileSubmesh), size)
+			&& IsSectionValid(header.LODOffset, header.numLODs, sizeof(MeshFileLOD), size)
+			&& IsSectionValid(header.vertexOffset, header.numVertices, header.vertexStride, size)
+			&& IsSectionValid(header.indexOffset, header.numIndices, header.indexSize, size);
+
+		// And that submeshes & LODs only refer to what's there, as they're drawn as-is.
+		for (uint32_t iSubmesh = 0; true == isValid && iSubmesh < header.numSubmeshes; ++iSubmesh)
+		{
+			const MeshFileSubmesh &submesh = GetSubmeshes()[iSubmesh];
+			isValid = submesh.firstIndex <= header.numIndices && submesh.numIndices <= header.numIndices - submesh.firstIndex;
+		}
+
+		for (uint32_t iLOD = 0; true == isValid && iLOD < header.numLODs; ++iLOD)
+		{
+			const MeshFileLOD &LOD = GetLODs()[iLOD];
+			isValid = LOD.firstSubmesh <= header.numSubmeshes && LOD.numSubmeshes <= header.numSubmeshes - LOD.firstSubmesh;
+		}
+
+		if (false == isValid)
+		{
+			SetLastError("Mesh file corrupt: " + path);
+			m_data.Release();
+			return false;
+		}
+
+		return true;
+	}
+
+	Mesh *CreateMesh(const MeshFile &file)
+	{
+		const MeshFileHeader &header = file.GetHeader();
+
+		std::unique_ptr<Mesh> mesh(new Mesh());
+		mesh->vertexFormat = header.vertexFormat;
+		mesh->vertexStride = header.vertexStride;
+		mesh->decl = GetMeshVertexDecl(header.vertexFormat);
+		mesh->bounds = header.bounds;
+		mesh->submeshes.assign(file.GetSubmeshes(), file.GetSubmeshes() + header.numSubmeshes);
+		mesh->LODs.assign(file.GetLODs(), file.GetLODs() + header.numLODs);
+
+		// Immutable buffers, initialized straight from the file (or decompressed archive entry).
+		mesh->vertices.reset(D3D::CreateVertexBuffer(header.numVertices*header.vertexStride, file.GetVertices()));
+		mesh->indices.reset(D3D::CreateIndexBuffer(header.numIndices*header.indexSize, file.GetIndices(), (2 == header.indexSize) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT));
+		if (nullptr == mesh->vertices || nullptr == mesh->indices)
+			return nullptr;
+
+		return mesh.release();
+	}
+
+	Mesh *LoadMesh(const std::string &path)
+	{
+		MeshFile file;
+		if (false == file.Open(path))
+			return nullptr;
+
+		return CreateMesh(file);
+	}
+
+	float GetDistance(const MeshBounds &bounds, const Vector3 &point)
+	{
+		const float position[3] = { point.x, point.y, point.z };
+		float distanceSq = 0.f;
+		for (unsigned int iAxis = 0; iAxis < 3; ++iAxis)
+		{
+			const float delta = std::max<float>(bounds.min[iAxis] - position[iAxis], position[iAxis] - bounds.max[iAxis]);
+			if (delta > 0.f)
+				distanceSq += delta*delta;
+		}
+
+		return sqrtf(distanceSq);
+	}
+
+	float GetLODErrorScale(const Matrix44 &projection, float viewportHeight)
+	{
+		// Row 1 holds the Y scale: 1/tan(FOV/2) maps to half the viewport.
+		return projection.rows[1].y * viewportHeight*0.5f;
+	}
+
+	unsigned int SelectLOD(const Mesh &mesh, float distance, float errorScale, float maxPixelError /* = 1.f */)
+	{
+		ASSERT(false == mesh.LODs.empty());
+
+		// Errors increase monotonically, so just walk down the chain.
+		const float maxError = maxPixelError*distance/errorScale;
+		unsigned int iLOD = 0;
+		while (iLOD+1 < mesh.LODs.size() && mesh.LODs[iLOD+1].error <= maxError)
+			++iLOD;
+
+		return iLOD;
+	}
+}
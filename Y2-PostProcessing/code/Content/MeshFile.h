@@ -0,0 +1,137 @@
+/*
+	Year 2 Direct3D 11 workshop template.
+	Content - Binary runtime mesh format ('.y2mesh').
+
+	Layout (little endian, all sections 64-byte aligned so they can be used straight from a mapping):
+	- MeshFileHeader
+	- Submesh table (MeshFileSubmesh, all LODs back to back)
+	- LOD table (MeshFileLOD, highest detail first)
+	- Vertex stream (interleaved, see MeshVertexFormat)
+	- Index stream (16 or 32-bit)
+
+	Bump kMeshFileVersion whenever any of it changes; old files are rejected, not patched.
+*/
+
+#if !defined(MESH_FILE_H)
+#define MESH_FILE_H
+
+#include "Archive.h"
+
+namespace Content
+{
+	const uint32_t kMeshFileMagic = 0x48534d59; // "YMSH"
+	const uint32_t kMeshFileVersion = 2;
+	const size_t kMeshFileAlignment = 64;
+
+	// Vertex attributes, in the order they appear in a vertex.
+	enum MeshVertexFormat
+	{
+		kMeshPosition = 1 << 0, // float3 (always present)
+		kMeshNormal   = 1 << 1, // float3
+		kMeshTexCoord = 1 << 2  // float2
+	};
+
+	unsigned int GetMeshVertexStride(uint32_t vertexFormat);
+
+	// POSITION, NORMAL & TEXCOORD0 (floats), as stored; pack with D3D::ConvertVertices() for a more compact layout.
+	D3D::VertexDecl GetMeshVertexDecl(uint32_t vertexFormat);
+
+	// Axis-aligned box (plain floats, as this is stored as-is).
+	struct MeshBounds
+	{
+		float min[3], max[3];
+	};
+
+	struct MeshFileHeader
+	{
+		uint32_t magic, version;
+		uint32_t vertexFormat, vertexStride, numVertices;
+		uint32_t indexSize, numIndices; // Index size is 2 or 4 bytes.
+		uint32_t numSubmeshes, numLODs;
+		MeshBounds bounds;
+		uint32_t reserved; // Keeps the offsets 8-byte aligned without relying on compiler padding.
+		uint64_t submeshOffset, LODOffset, vertexOffset, indexOffset;
+	};
+
+	struct MeshFileSubmesh
+	{
+		uint32_t firstIndex, numIndices;
+		uint64_t materialHash; // HashedString of the material name.
+		MeshBounds bounds;
+	};
+
+	struct MeshFileLOD
+	{
+		uint32_t firstSubmesh, numSubmeshes;
+		float error; // Object space geometric error (0 for the original), see SelectLOD().
+	};
+
+	// Source data for WriteMeshFile(); indices are always 32-bit here.
+	struct MeshData
+	{
+		uint32_t vertexFormat;
+		std::vector<float> vertices;
+		std::vector<uint32_t> indices;
+		std::vector<MeshFileSubmesh> submeshes;
+		std::vector<MeshFileLOD> LODs;
+		MeshBounds bounds;
+
+		unsigned int GetNumVertices() const { return (unsigned int) (vertices.size()*sizeof(float)/GetMeshVertexStride(vertexFormat)); }
+	};
+
+	// Stores 16-bit indices whenever the vertex count allows it.
+	bool WriteMeshFile(const std::string &path, const MeshData &mesh);
+
+	// Mesh file read through the archives (see ReadResource()); pointers stay valid for as long as the object lives.
+	class MeshFile : public boost::noncopyable
+	{
+	public:
+		bool Open(const std::string &path);
+
+		const MeshFileHeader  &GetHeader()    const { return *reinterpret_cast<const MeshFileHeader *>(m_data.GetData()); }
+		const MeshFileSubmesh *GetSubmeshes() const { return reinterpret_cast<const MeshFileSubmesh *>(m_data.GetData() + GetHeader().submeshOffset); }
+		const MeshFileLOD     *GetLODs()      const { return reinterpret_cast<const MeshFileLOD *>(m_data.GetData() + GetHeader().LODOffset); }
+		const void            *GetVertices()  const { return m_data.GetData() + GetHeader().vertexOffset; }
+		const void            *GetIndices()   const { return m_data.GetData() + GetHeader().indexOffset; }
+
+	private:
+		ResourceData m_data;
+	};
+
+	// GPU-resident mesh.
+	struct Mesh
+	{
+		typedef std::unique_ptr<Mesh> Ptr;
+
+		D3D::VertexBuffer::Ptr vertices;
+		D3D::IndexBuffer::Ptr indices;
+		uint32_t vertexFormat, vertexStride;
+		D3D::VertexDecl decl; // For D3D::InputLayoutCache.
+		std::vector<MeshFileSubmesh> submeshes;
+		std::vector<MeshFileLOD> LODs;
+		MeshBounds bounds;
+	};
+
+	// Second half of LoadMesh(), for when the file's opened on a loader thread (see AsyncLoad.h).
+	Mesh *CreateMesh(const MeshFile &file);
+
+	// Buffers are created directly from the file's streams; returns nullptr on failure (see SetLastError()).
+	Mesh *LoadMesh(const std::string &path);
+
+	/*
+		Runtime LOD selection by projected (screen space) error.
+	*/
+
+	// Distance from a point to the box (0 if inside).
+	float GetDistance(const MeshBounds &bounds, const Vector3 &point);
+
+	// For a projection made by Matrix44::Perspective(): an object space error 'E' at view distance 'Z'
+	// covers E*scale/Z pixels vertically.
+	float GetLODErrorScale(const Matrix44 &projection, float viewportHeight);
+
+	// Picks the coarsest LOD whose error stays below 'maxPixelError' at 'distance' (in object space units,
+	// to the nearest point of the bounds); at a pixel or less LOD switches don't visibly pop.
+	unsigned int SelectLOD(const Mesh &mesh, float distance, float errorScale, float maxPixelError = 1.f);
+}
+
+#endif // MESH_FILE_H
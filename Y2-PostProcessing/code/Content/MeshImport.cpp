@@ -0,0 +1,319 @@
+/*
+	Year 2 Direct3D 11 workshop template.
+	Content - Offline mesh import & conversion to '.y2mesh' (see MeshFile.h).
+
+	The OBJ parser works on the mapped file (a line at a time) and uses strtof()/strtol() directly; it's not
+	meant to be fast enough for load time (that's what the binary format is for), just not silly.
+*/
+
+#include "../Platform.h"
+#include <unordered_map>
+#include "../D3D.h"
+#include "MeshImport.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplify.h"
+
+namespace Content
+{
+	// Corner of an OBJ face: 1-based position, texture coordinate & normal index (0 means absent).
+	struct OBJCorner
+	{
+		int position, texCoord, normal;
+
+		bool operator ==(const OBJCorner &B) const { return position == B.position && texCoord == B.texCoord && normal == B.normal; }
+	};
+
+	struct OBJCornerHash
+	{
+		size_t operator()(const OBJCorner &corner) const
+		{
+			return ((size_t) corner.position*73856093u) ^ ((size_t) corner.texCoord*19349663u) ^ ((size_t) corner.normal*83492791u);
+		}
+	};
+
+	struct OBJGroup
+	{
+		std::string material;
+		std::vector<OBJCorner> corners; // 3 per triangle.
+	};
+
+	static const char *SkipSpaces(const char *pText, const char *pEnd)
+	{
+		while (pText < pEnd && (' ' == *pText || '\t' == *pText))
+			++pText;
+
+		return pText;
+	}
+
+	// Resolves a (possibly negative, i.e. relative) OBJ index to 1-based absolute.
+	static int ResolveIndex(long index, size_t count)
+	{
+		return (index < 0) ? (int) (count + index + 1) : (int) index;
+	}
+
+	static void ExtendBounds(MeshBounds &bounds, const float *pPosition)
+	{
+		for (unsigned int iAxis = 0; iAxis < 3; ++iAxis)
+		{
+			bounds.min[iAxis] = std::min<float>(bounds.min[iAxis], pPosition[iAxis]);
+			bounds.max[iAxis] = std::max<float>(bounds.max[iAxis], pPosition[iAxis]);
+		}
+	}
+
+	static void ResetBounds(MeshBounds &bounds)
+	{
+		for (unsigned int iAxis = 0; iAxis < 3; ++iAxis)
+		{
+			bounds.min[iAxis] = FLT_MAX;
+			bounds.max[iAxis] = -FLT_MAX;
+		}
+	}
+
+	bool ImportOBJ(const std::string &path, MeshData &mesh)
+	{
+		MappedFile file;
+		if (false == file.Open(path))
+			return false;
+
+		std::vector<float> positions, texCoords, normals;
+		std::vector<OBJGroup> groups(1);
+		std::vector<OBJCorner> polygon;
+
+		const char *pText = reinterpret_cast<const char *>(file.GetData());
+		const char *pEnd = pText + file.GetSize();
+		unsigned int lineNumber = 0;
+
+		// The mapping isn't NUL-terminated, and strtof() & co. skip leading whitespace (newlines too), so
+		// each line is parsed from a terminated copy: they can't run into the next line or past the file.
+		std::string line;
+
+		while (pText < pEnd)
+		{
+			const char *pMappedEnd = static_cast<const char *>(memchr(pText, '\n', pEnd-pText));
+			if (nullptr == pMappedEnd)
+				pMappedEnd = pEnd;
+
+			++lineNumber;
+
+			line.assign(pText, pMappedEnd);
+			pText = pMappedEnd+1;
+
+			const char *pLineEnd = line.c_str() + line.size();
+			const char *pLine = SkipSpaces(line.c_str(), pLineEnd);
+
+			if (pLineEnd-pLine < 2)
+				continue;
+
+			if ('v' == pLine[0] && (' ' == pLine[1] || '\t' == pLine[1]))
+			{
+				char *pNext = const_cast<char *>(pLine+1);
+				for (unsigned int iAxis = 0; iAxis < 3; ++iAxis)
+					positions.push_back(strtof(pNext, &pNext));
+			}
+			else if ('v' == pLine[0] && 't' == pLine[1])
+			{
+				char *pNext = const_cast<char *>(pLine+2);
+				texCoords.push_back(strtof(pNext, &pNext));
+				texCoords.push_back(strtof(pNext, &pNext));
+			}
+			else if ('v' == pLine[0] && 'n' == pLine[1])
+			{
+				char *pNext = const_cast<char *>(pLine+2);
+				for (unsigned int iAxis = 0; iAxis < 3; ++iAxis)
+					normals.push_back(strtof(pNext, &pNext));
+			}
+			else if ('f' == pLine[0] && (' ' == pLine[1] || '\t' == pLine[1]))
+			{
+				// Corners are 'v', 'v/vt', 'v//vn' or 'v/vt/vn'.
+				polygon.clear();
+				const char *pCorner = SkipSpaces(pLine+1, pLineEnd);
+				while (pCorner < pLineEnd && '\r' != *pCorner)
+				{
+					char *pNext;
+					OBJCorner corner = { 0, 0, 0 };
+					corner.position = ResolveIndex(strtol(pCorner, &pNext, 10), positions.size()/3);
+					if ('/' == *pNext)
+					{
+						if ('/' != *++pNext)
+							corner.texCoord = ResolveIndex(strtol(pNext, &pNext, 10), texCoords.size()/2);
+
+						if ('/' == *pNext)
+							corner.normal = ResolveIndex(strtol(pNext+1, &pNext, 10), normals.size()/3);
+					}
+
+					if (pNext == pCorner || corner.position <= 0 || corner.position > (int) positions.size()/3
+						|| corner.texCoord < 0 || corner.texCoord > (int) texCoords.size()/2
+						|| corner.normal < 0 || corner.normal > (int) normals.size()/3)
+					{
+						SetLastError("OBJ: invalid face on line " + std::to_string(lineNumber) + ": " + path);
+						return false;
+					}
+
+					polygon.push_back(corner);
+					pCorner = SkipSpaces(pNext, pLineEnd);
+				}
+
+				// Fan; winding is flipped along with Z (right to left-handed).
+				for (size_t iCorner = 2; iCorner < polygon.size(); ++iCorner)
+				{
+					groups.back().corners.push_back(polygon[0]);
+					groups.back().corners.push_back(polygon[iCorner]);
+					groups.back().corners.push_back(polygon[iCorner-1]);
+				}
+			}
+			else if (0 == strncmp(pLine, "usemtl", 6))
+			{
+				const char *pName = SkipSpaces(pLine+6, pLineEnd);
+				const char *pNameEnd = pLineEnd;
+				while (pNameEnd > pName && isspace((unsigned char) pNameEnd[-1]))
+					--pNameEnd;
+
+				const std::string material(pName, pNameEnd);
+
+				// Merge with an earlier group of the same material, so each ends up in a single submesh.
+				auto iGroup = std::find_if(groups.begin(), groups.end(), [&material](const OBJGroup &group) { return group.material == material; });
+				if (groups.end() != iGroup)
+				{
+					OBJGroup group = std::move(*iGroup);
+					groups.erase(iGroup);
+					groups.push_back(std::move(group));
+				}
+				else if (groups.back().corners.empty())
+					groups.back().material = material;
+				else
+				{
+					groups.push_back(OBJGroup());
+					groups.back().material = material;
+				}
+			}
+		}
+
+		mesh.vertexFormat = kMeshPosition;
+		if (false == normals.empty())   mesh.vertexFormat |= kMeshNormal;
+		if (false == texCoords.empty()) mesh.vertexFormat |= kMeshTexCoord;
+
+		mesh.vertices.clear();
+		mesh.indices.clear();
+		mesh.submeshes.clear();
+		mesh.LODs.clear();
+		ResetBounds(mesh.bounds);
+
+		std::unordered_map<OBJCorner, uint32_t, OBJCornerHash> vertexMap;
+		uint32_t numVertices = 0;
+
+		for (const OBJGroup &group : groups)
+		{
+			if (true == group.corners.empty())
+				continue;
+
+			MeshFileSubmesh submesh;
+			submesh.firstIndex = (uint32_t) mesh.indices.size();
+			submesh.numIndices = (uint32_t) group.corners.size();
+			submesh.materialHash = HashedString(group.material).GetHash();
+			ResetBounds(submesh.bounds);
+
+			for (const OBJCorner &corner : group.corners)
+			{
+				auto iVertex = vertexMap.find(corner);
+				if (vertexMap.end() == iVertex)
+				{
+					const float *pPosition = &positions[(corner.position-1)*3];
+					mesh.vertices.push_back(pPosition[0]);
+					mesh.vertices.push_back(pPosition[1]);
+					mesh.vertices.push_back(-pPosition[2]);
+
+					if (mesh.vertexFormat & kMeshNormal)
+					{
+						const float *pNormal = (0 != corner.normal) ? &normals[(corner.normal-1)*3] : nullptr;
+						mesh.vertices.push_back((pNormal) ? pNormal[0] : 0.f);
+						mesh.vertices.push_back((pNormal) ? pNormal[1] : 0.f);
+						mesh.vertices.push_back((pNormal) ? -pNormal[2] : 0.f);
+					}
+
+					if (mesh.vertexFormat & kMeshTexCoord)
+					{
+						const float *pTexCoord = (0 != corner.texCoord) ? &texCoords[(corner.texCoord-1)*2] : nullptr;
+						mesh.vertices.push_back((pTexCoord) ? pTexCoord[0] : 0.f);
+						mesh.vertices.push_back((pTexCoord) ? 1.f-pTexCoord[1] : 0.f);
+					}
+
+					iVertex = vertexMap.insert(std::make_pair(corner, numVertices++)).first;
+				}
+
+				const float flipped[3] = { positions[(corner.position-1)*3], positions[(corner.position-1)*3 + 1], -positions[(corner.position-1)*3 + 2] };
+				ExtendBounds(submesh.bounds, flipped);
+				mesh.indices.push_back(iVertex->second);
+			}
+
+			ExtendBounds(mesh.bounds, submesh.bounds.min);
+			ExtendBounds(mesh.bounds, submesh.bounds.max);
+			mesh.submeshes.push_back(submesh);
+		}
+
+		if (true == mesh.submeshes.empty())
+		{
+			SetLastError("OBJ: no faces: " + path);
+			return false;
+		}
+
+		MeshFileLOD LOD;
+		LOD.firstSubmesh = 0;
+		LOD.numSubmeshes = (uint32_t) mesh.submeshes.size();
+		LOD.error = 0.f;
+		mesh.LODs.push_back(LOD);
+
+		return true;
+	}
+
+	bool ConvertMesh(const std::string &sourcePath, const std::string &targetPath)
+	{
+		Timer timer;
+
+		MeshData mesh;
+		if (false == ImportOBJ(sourcePath, mesh))
+			return false;
+
+		GenerateLODs(mesh);
+		OptimizeMesh(mesh);
+
+		if (false == WriteMeshFile(targetPath, mesh))
+			return false;
+
+		const MeshFileSubmesh &firstSubmesh = mesh.submeshes[0];
+		const VertexCacheStats stats = AnalyzeVertexCache(&mesh.indices[firstSubmesh.firstIndex], firstSubmesh.numIndices, mesh.GetNumVertices());
+		DEBUG_LOG("Converted %s: %u vertices, %u submeshes, ACMR %.3f (%.2f sec.)",
+			sourcePath.c_str(), mesh.GetNumVertices(), mesh.LODs[0].numSubmeshes, stats.ACMR, timer.Get());
+
+		for (const MeshFileLOD &LOD : mesh.LODs)
+		{
+			uint32_t numIndices = 0;
+			for (uint32_t iSubmesh = LOD.firstSubmesh; iSubmesh < LOD.firstSubmesh + LOD.numSubmeshes; ++iSubmesh)
+				numIndices += mesh.submeshes[iSubmesh].numIndices;
+
+			DEBUG_LOG("- LOD %u: %u triangles, error %f", (unsigned int) (&LOD - mesh.LODs.data()), numIndices/3, LOD.error);
+		}
+
+		return true;
+	}
+
+	bool ConvertMeshes(const std::vector<std::string> &sourcePaths, const std::vector<std::string> &targetPaths)
+	{
+		ASSERT(sourcePaths.size() == targetPaths.size());
+
+		// Simplification dominates and is strictly serial per mesh, so each mesh gets a thread of it's own.
+		std::vector<std::thread> threads;
+		std::unique_ptr<bool[]> results(new bool[sourcePaths.size()]);
+		for (size_t iMesh = 0; iMesh < sourcePaths.size(); ++iMesh)
+		{
+			threads.emplace_back([&, iMesh]() 
+			{ 
+				results[iMesh] = ConvertMesh(sourcePaths[iMesh], targetPaths[iMesh]); 
+			});
+		}
+
+		for (auto &thread : threads)
+			thread.join();
+
+		return std::all_of(results.get(), results.get() + sourcePaths.size(), [](bool result) { return result; });
+	}
+}
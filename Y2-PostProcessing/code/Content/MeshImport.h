@@ -0,0 +1,24 @@
+/*
+	Year 2 Direct3D 11 workshop template.
+	Content - Offline mesh import & conversion to '.y2mesh' (see MeshFile.h).
+*/
+
+#if !defined(MESH_IMPORT_H)
+#define MESH_IMPORT_H
+
+#include "MeshFile.h"
+
+namespace Content
+{
+	// Wavefront OBJ: polygons are triangulated as fans, each material ('usemtl') becomes a submesh.
+	// Converts to our left-handed convention (Z & winding flipped) and top-left UV origin.
+	bool ImportOBJ(const std::string &path, MeshData &mesh);
+
+	// Source (OBJ) to optimized (see MeshOptimizer.h) runtime format, including LODs (see MeshSimplify.h), in one go.
+	bool ConvertMesh(const std::string &sourcePath, const std::string &targetPath);
+
+	// Converts a batch of meshes, one thread per mesh.
+	bool ConvertMeshes(const std::vector<std::string> &sourcePaths, const std::vector<std::string> &targetPaths);
+}
+
+#endif // MESH_IMPORT_H
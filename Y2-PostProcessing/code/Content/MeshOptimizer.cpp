@@ -0,0 +1,443 @@
+/*
+	Year 2 Direct3D 11 workshop template.
+	Content - Offline mesh optimization.
+
+	Forsyth: https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
+	Clustering follows the 'hard' & 'soft' boundary idea from Sander et al. (SIGGRAPH 2007):
+	a cluster starts wherever the (simulated) cache is cold anyway, then is split further as
+	long as doing so doesn't push the cache miss ratio over the threshold.
+*/
+
+#include "../Platform.h"
+#include "../D3D.h"
+#include "MeshOptimizer.h"
+
+namespace Content
+{
+	/*
+		FIFO cache simulation: a vertex is cached if fewer than 'cacheSize' misses happened since it's own miss.
+	*/
+
+	class VertexCacheFIFO
+	{
+	public:
+		VertexCacheFIFO(unsigned int numVertices, unsigned int cacheSize) :
+			m_timeStamps(numVertices, 0), m_cacheSize(cacheSize), m_time(cacheSize+1) {}
+
+		// Returns true on a miss.
+		bool Access(uint32_t index)
+		{
+			ASSERT(index < m_timeStamps.size());
+			if (m_time - m_timeStamps[index] > m_cacheSize)
+			{
+				m_timeStamps[index] = m_time++;
+				return true;
+			}
+
+			return false;
+		}
+
+		unsigned int AccessTriangle(const uint32_t *pTriangle)
+		{
+			return (unsigned int) Access(pTriangle[0]) + Access(pTriangle[1]) + Access(pTriangle[2]);
+		}
+
+		void Flush()
+		{
+			m_time += m_cacheSize+1;
+		}
+
+	private:
+		std::vector<unsigned int> m_timeStamps;
+		const unsigned int m_cacheSize;
+		unsigned int m_time;
+	};
+
+	VertexCacheStats AnalyzeVertexCache(const uint32_t *pIndices, size_t numIndices, unsigned int numVertices, unsigned int cacheSize /* = kVertexCacheSize */)
+	{
+		VertexCacheFIFO cache(numVertices, cacheSize);
+		std::vector<bool> isReferenced(numVertices, false);
+		unsigned int numReferenced = 0;
+
+		VertexCacheStats stats;
+		stats.numTransformed = 0;
+		for (size_t iIndex = 0; iIndex < numIndices; ++iIndex)
+		{
+			const uint32_t index = pIndices[iIndex];
+			stats.numTransformed += cache.Access(index);
+
+			if (false == isReferenced[index])
+			{
+				isReferenced[index] = true;
+				++numReferenced;
+			}
+		}
+
+		stats.ACMR = (0 != numIndices) ? stats.numTransformed/(numIndices/3.f) : 0.f;
+		stats.ATVR = (0 != numReferenced) ? (float) stats.numTransformed/numReferenced : 0.f;
+		return stats;
+	}
+
+	/*
+		Forsyth.
+	*/
+
+	const unsigned int kForsythCacheSize = 32;
+	const unsigned int kForsythMaxValence = 64;
+	const float kCacheDecayPower = 1.5f;
+	const float kLastTriScore = 0.75f;
+	const float kValenceBoostScale = 2.f;
+	const float kValenceBoostPower = 0.5f;
+
+	// Score table: [cache position + 1][min(valence, max.)] (position -1 means not cached).
+	struct ForsythScores
+	{
+		ForsythScores()
+		{
+			for (int iPosition = -1; iPosition < (int) kForsythCacheSize; ++iPosition)
+			{
+				for (unsigned int valence = 0; valence <= kForsythMaxValence; ++valence)
+				{
+					float score = -1.f;
+					if (0 != valence)
+					{
+						score = 0.f;
+						if (iPosition >= 0)
+							score = (iPosition < 3) ? kLastTriScore : powf(1.f - (iPosition-3)/(float) (kForsythCacheSize-3), kCacheDecayPower);
+
+						score += kValenceBoostScale*powf((float) valence, -kValenceBoostPower);
+					}
+
+					table[iPosition+1][valence] = score;
+				}
+			}
+		}
+
+		float Get(int position, unsigned int valence) const
+		{
+			return table[position+1][std::min<unsigned int>(valence, kForsythMaxValence)];
+		}
+
+		float table[kForsythCacheSize+1][kForsythMaxValence+1];
+	};
+
+	void OptimizeVertexCache(uint32_t *pIndices, size_t numIndices, unsigned int numVertices)
+	{
+		ASSERT(0 == numIndices % 3);
+
+		static const ForsythScores kScores;
+		const size_t numTris = numIndices/3;
+		if (0 == numTris)
+			return;
+
+		// A degenerate triangle repeats a vertex; that vertex only lists it once (it's retired once, too).
+		auto isRepeat = [pIndices](size_t iIndex)
+		{
+			const size_t iCorner = iIndex % 3;
+			return (iCorner > 0 && pIndices[iIndex] == pIndices[iIndex-1]) || (2 == iCorner && pIndices[iIndex] == pIndices[iIndex-2]);
+		};
+
+		// Triangles per vertex; the active ones are kept at the front of each vertex' range.
+		std::vector<unsigned int> numActive(numVertices, 0), offsets(numVertices+1, 0), adjacency(numIndices);
+		for (size_t iIndex = 0; iIndex < numIndices; ++iIndex)
+			if (false == isRepeat(iIndex))
+				++numActive[pIndices[iIndex]];
+
+		for (unsigned int iVertex = 0; iVertex < numVertices; ++iVertex)
+			offsets[iVertex+1] = offsets[iVertex] + numActive[iVertex];
+
+		{
+			std::vector<unsigned int> cursors(offsets.begin(), offsets.end()-1);
+			for (size_t iIndex = 0; iIndex < numIndices; ++iIndex)
+				if (false == isRepeat(iIndex))
+					adjacency[cursors[pIndices[iIndex]]++] = (unsigned int) (iIndex/3);
+		}
+
+		std::vector<int> cachePositions(numVertices, -1);
+		std::vector<float> vertexScores(numVertices), triScores(numTris);
+		std::vector<bool> isEmitted(numTris, false);
+
+		for (unsigned int iVertex = 0; iVertex < numVertices; ++iVertex)
+			vertexScores[iVertex] = kScores.Get(-1, numActive[iVertex]);
+
+		size_t bestTri = 0;
+		for (size_t iTri = 0; iTri < numTris; ++iTri)
+		{
+			const uint32_t *pTri = pIndices + iTri*3;
+			triScores[iTri] = vertexScores[pTri[0]] + vertexScores[pTri[1]] + vertexScores[pTri[2]];
+			if (triScores[iTri] > triScores[bestTri])
+				bestTri = iTri;
+		}
+
+		std::vector<uint32_t> output;
+		output.reserve(numIndices);
+
+		std::vector<uint32_t> cache, newCache;
+		cache.reserve(kForsythCacheSize+3);
+		newCache.reserve(kForsythCacheSize+3);
+
+		const size_t kNone = (size_t) -1;
+		size_t scanCursor = 0;
+
+		for (size_t iEmit = 0; iEmit < numTris; ++iEmit)
+		{
+			if (kNone == bestTri)
+			{
+				// Nothing in the cache connects to the rest: continue with the next unused triangle in input order.
+				while (true == isEmitted[scanCursor])
+					++scanCursor;
+
+				bestTri = scanCursor;
+			}
+
+			ASSERT(false == isEmitted[bestTri]);
+			isEmitted[bestTri] = true;
+			const uint32_t tri[3] = { pIndices[bestTri*3], pIndices[bestTri*3 + 1], pIndices[bestTri*3 + 2] };
+			output.insert(output.end(), tri, tri+3);
+
+			// Retire the triangle from it's vertices' active lists & push them on the cache (front).
+			newCache.clear();
+			for (unsigned int iCorner = 0; iCorner < 3; ++iCorner)
+			{
+				const uint32_t vertex = tri[iCorner];
+				if (newCache.end() != std::find(newCache.begin(), newCache.end(), vertex))
+					continue; // Repeated (degenerate), and thus listed once.
+
+				unsigned int *pFirst = &adjacency[offsets[vertex]];
+				unsigned int *pLast = pFirst + numActive[vertex];
+				unsigned int *pFound = std::find(pFirst, pLast, (unsigned int) bestTri);
+				ASSERT(pFound != pLast);
+				std::swap(*pFound, *(pLast-1));
+				--numActive[vertex];
+
+				newCache.push_back(vertex);
+			}
+
+			const size_t numTriVertices = newCache.size();
+			for (uint32_t vertex : cache)
+				if (newCache.begin()+numTriVertices == std::find(newCache.begin(), newCache.begin()+numTriVertices, vertex))
+					newCache.push_back(vertex);
+
+			// Update positions & scores; the ones pushed out lose their cache bonus.
+			for (size_t iEntry = 0; iEntry < newCache.size(); ++iEntry)
+			{
+				const uint32_t vertex = newCache[iEntry];
+				cachePositions[vertex] = (iEntry < kForsythCacheSize) ? (int) iEntry : -1;
+				vertexScores[vertex] = kScores.Get(cachePositions[vertex], numActive[vertex]);
+			}
+
+			// Rescore the triangles around those vertices, picking the best as we go.
+			bestTri = kNone;
+			float bestScore = -FLT_MAX;
+			for (uint32_t vertex : newCache)
+			{
+				for (unsigned int iAdjacent = 0; iAdjacent < numActive[vertex]; ++iAdjacent)
+				{
+					const unsigned int iTri = adjacency[offsets[vertex] + iAdjacent];
+					const uint32_t *pTri = pIndices + iTri*3;
+					const float score = vertexScores[pTri[0]] + vertexScores[pTri[1]] + vertexScores[pTri[2]];
+					triScores[iTri] = score;
+
+					if (score > bestScore)
+					{
+						bestScore = score;
+						bestTri = iTri;
+					}
+				}
+			}
+
+			if (newCache.size() > kForsythCacheSize)
+				newCache.resize(kForsythCacheSize);
+
+			cache.swap(newCache);
+		}
+
+		// Each triangle exactly once.
+		ASSERT(numIndices == output.size() && isEmitted.end() == std::find(isEmitted.begin(), isEmitted.end(), false));
+		memcpy(pIndices, output.data(), numIndices*sizeof(uint32_t));
+	}
+
+	/*
+		Overdraw.
+	*/
+
+	struct TriangleCluster
+	{
+		size_t firstTri, numTris;
+		float sortKey;
+	};
+
+	void OptimizeOverdraw(uint32_t *pIndices, size_t numIndices, const float *pPositions, size_t stride, unsigned int numVertices, float threshold /* = 1.05f */)
+	{
+		ASSERT(0 == numIndices % 3);
+
+		const size_t numTris = numIndices/3;
+		if (numTris < 2)
+			return;
+
+		// Hard boundaries: triangles that miss on all 3 vertices (the cache is effectively cold there).
+		// The first always starts one, as it might not miss 3 times (if degenerate).
+		std::vector<size_t> hardBoundaries(1, 0);
+		{
+			VertexCacheFIFO cache(numVertices, kVertexCacheSize);
+			cache.AccessTriangle(pIndices);
+			for (size_t iTri = 1; iTri < numTris; ++iTri)
+				if (3 == cache.AccessTriangle(pIndices + iTri*3))
+					hardBoundaries.push_back(iTri);
+
+			hardBoundaries.push_back(numTris);
+		}
+
+		// Soft boundaries: split hard clusters wherever the miss ratio since the last split is within the threshold.
+		std::vector<TriangleCluster> clusters;
+		{
+			VertexCacheFIFO cache(numVertices, kVertexCacheSize);
+			for (size_t iHard = 0; iHard+1 < hardBoundaries.size(); ++iHard)
+			{
+				const size_t first = hardBoundaries[iHard], end = hardBoundaries[iHard+1];
+
+				cache.Flush();
+				unsigned int clusterMisses = 0;
+				for (size_t iTri = first; iTri < end; ++iTri)
+					clusterMisses += cache.AccessTriangle(pIndices + iTri*3);
+
+				const float maxACMR = threshold*clusterMisses/(end-first);
+
+				cache.Flush();
+				size_t start = first;
+				unsigned int misses = 0;
+				for (size_t iTri = first; iTri < end; ++iTri)
+				{
+					misses += cache.AccessTriangle(pIndices + iTri*3);
+					if (iTri+1 == end || (float) misses/(iTri+1 - start) <= maxACMR)
+					{
+						const TriangleCluster cluster = { start, iTri+1 - start, 0.f };
+						clusters.push_back(cluster);
+
+						cache.Flush();
+						start = iTri+1;
+						misses = 0;
+					}
+				}
+			}
+		}
+
+		// Sort key: how much a cluster faces away from the mesh' center (outward first, as they tend to occlude).
+		auto getPosition = [pPositions, stride](uint32_t index)
+		{
+			const float *pPosition = reinterpret_cast<const float *>(reinterpret_cast<const uint8_t *>(pPositions) + index*stride);
+			return Vector3(pPosition[0], pPosition[1], pPosition[2]);
+		};
+
+		std::vector<Vector3> centroids(clusters.size()), normals(clusters.size());
+		Vector3 meshCentroid(0.f);
+		float meshArea = 0.f;
+		for (size_t iCluster = 0; iCluster < clusters.size(); ++iCluster)
+		{
+			const TriangleCluster &cluster = clusters[iCluster];
+			Vector3 centroid(0.f), normal(0.f);
+			float area = 0.f;
+			for (size_t iTri = cluster.firstTri; iTri < cluster.firstTri + cluster.numTris; ++iTri)
+			{
+				const Vector3 A = getPosition(pIndices[iTri*3]), B = getPosition(pIndices[iTri*3 + 1]), C = getPosition(pIndices[iTri*3 + 2]);
+
+				// Clockwise front faces (see D3D.cpp): (B-A)x(C-A) points outward.
+				const Vector3 cross = Vector3::Cross(B-A, C-A);
+				const float triArea = cross.Length();
+				centroid += (A+B+C)*(triArea/3.f);
+				normal += cross;
+				area += triArea;
+			}
+
+			centroids[iCluster] = (area > 0.f) ? centroid/area : getPosition(pIndices[cluster.firstTri*3]);
+			normals[iCluster] = normal;
+			meshCentroid += centroid;
+			meshArea += area;
+		}
+
+		if (meshArea > 0.f)
+			meshCentroid /= meshArea;
+
+		for (size_t iCluster = 0; iCluster < clusters.size(); ++iCluster)
+		{
+			const float length = normals[iCluster].Length();
+			clusters[iCluster].sortKey = (length > 0.f) ? Vector3::Dot(centroids[iCluster] - meshCentroid, normals[iCluster]/length) : 0.f;
+		}
+
+		std::stable_sort(clusters.begin(), clusters.end(), [](const TriangleCluster &A, const TriangleCluster &B) { return A.sortKey > B.sortKey; });
+
+		std::vector<uint32_t> sorted;
+		sorted.reserve(numIndices);
+		for (const TriangleCluster &cluster : clusters)
+			sorted.insert(sorted.end(), pIndices + cluster.firstTri*3, pIndices + (cluster.firstTri + cluster.numTris)*3);
+
+		// The clusters must cover every triangle; leave the order be if (somehow) they don't.
+		ASSERT(numIndices == sorted.size());
+		if (numIndices != sorted.size())
+			return;
+
+		memcpy(pIndices, sorted.data(), numIndices*sizeof(uint32_t));
+	}
+
+	/*
+		Vertex fetch.
+	*/
+
+	unsigned int OptimizeVertexFetch(void *pVertices, size_t stride, unsigned int numVertices, uint32_t *pIndices, size_t numIndices)
+	{
+		const uint32_t kUnused = ~0u;
+		std::vector<uint32_t> remap(numVertices, kUnused);
+		uint32_t numUsed = 0;
+
+		for (size_t iIndex = 0; iIndex < numIndices; ++iIndex)
+		{
+			uint32_t &newIndex = remap[pIndices[iIndex]];
+			if (kUnused == newIndex)
+				newIndex = numUsed++;
+
+			pIndices[iIndex] = newIndex;
+		}
+
+		uint8_t *pBytes = static_cast<uint8_t *>(pVertices);
+		std::vector<uint8_t> reordered(numUsed*stride);
+		for (unsigned int iVertex = 0; iVertex < numVertices; ++iVertex)
+			if (kUnused != remap[iVertex])
+				memcpy(&reordered[remap[iVertex]*stride], pBytes + iVertex*stride, stride);
+
+		memcpy(pVertices, reordered.data(), reordered.size());
+		return numUsed;
+	}
+
+	void OptimizeMesh(MeshData &mesh)
+	{
+		const unsigned int stride = GetMeshVertexStride(mesh.vertexFormat);
+		const unsigned int numVertices = mesh.GetNumVertices();
+
+		// Submeshes are drawn separately, so each is ordered on it's own.
+		for (const MeshFileSubmesh &submesh : mesh.submeshes)
+		{
+			uint32_t *pIndices = &mesh.indices[submesh.firstIndex];
+			OptimizeVertexCache(pIndices, submesh.numIndices, numVertices);
+			OptimizeOverdraw(pIndices, submesh.numIndices, mesh.vertices.data(), stride, numVertices);
+		}
+
+		const unsigned int numUsed = OptimizeVertexFetch(mesh.vertices.data(), stride, numVertices, mesh.indices.data(), mesh.indices.size());
+		mesh.vertices.resize(numUsed*stride/sizeof(float));
+	}
+
+	void BenchmarkMeshOptimizer(const MeshData &mesh)
+	{
+		const VertexCacheStats before = AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.GetNumVertices());
+
+		MeshData optimized = mesh;
+		Timer timer;
+		OptimizeMesh(optimized);
+		const float seconds = timer.Get();
+
+		const VertexCacheStats after = AnalyzeVertexCache(optimized.indices.data(), optimized.indices.size(), optimized.GetNumVertices());
+
+		DEBUG_LOG("Mesh optimizer (%u triangles, %.3f sec.):", (unsigned int) mesh.indices.size()/3, seconds);
+		DEBUG_LOG("- Before: %u vertex shader invocations, ACMR %.3f, ATVR %.3f", before.numTransformed, before.ACMR, before.ATVR);
+		DEBUG_LOG("- After:  %u vertex shader invocations, ACMR %.3f, ATVR %.3f", after.numTransformed, after.ACMR, after.ATVR);
+	}
+}
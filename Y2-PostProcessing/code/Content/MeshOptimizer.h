@@ -0,0 +1,49 @@
+/*
+	Year 2 Direct3D 11 workshop template.
+	Content - Offline mesh optimization.
+
+	- Post-transform vertex cache: Tom Forsyth's linear-speed triangle order.
+	- Overdraw: cache-friendly clusters, sorted outward-facing first (Sander, Nehab & Barczak, 'Fast Triangle Reordering').
+	- Vertex fetch: vertices are renumbered in order of first use.
+
+	All index functions operate on 32-bit triangle lists; whether 16-bit indices suffice is up to WriteMeshFile().
+*/
+
+#if !defined(MESH_OPTIMIZER_H)
+#define MESH_OPTIMIZER_H
+
+#include "MeshFile.h"
+
+namespace Content
+{
+	// FIFO size used for statistics: a conservative guess at what most hardware does.
+	const unsigned int kVertexCacheSize = 16;
+
+	struct VertexCacheStats
+	{
+		unsigned int numTransformed; // Simulated vertex shader invocations.
+		float ACMR;                  // Average cache miss ratio: transformed per triangle (0.5 is ideal, 3 is worst).
+		float ATVR;                  // Average transform to vertex ratio: transformed per referenced vertex (1 is ideal).
+	};
+
+	VertexCacheStats AnalyzeVertexCache(const uint32_t *pIndices, size_t numIndices, unsigned int numVertices, unsigned int cacheSize = kVertexCacheSize);
+
+	// Reorders triangles (in place) for the post-transform cache.
+	void OptimizeVertexCache(uint32_t *pIndices, size_t numIndices, unsigned int numVertices);
+
+	// Reorders cache-optimized triangles (in place) in clusters to reduce overdraw, allowing the ACMR to worsen
+	// by at most 'threshold'; positions are float3 at the start of each 'stride' bytes.
+	void OptimizeOverdraw(uint32_t *pIndices, size_t numIndices, const float *pPositions, size_t stride, unsigned int numVertices, float threshold = 1.05f);
+
+	// Renumbers vertices by first use, reorders the vertex data to match & drops unreferenced vertices.
+	// Returns the new vertex count.
+	unsigned int OptimizeVertexFetch(void *pVertices, size_t stride, unsigned int numVertices, uint32_t *pIndices, size_t numIndices);
+
+	// All of the above, submesh by submesh.
+	void OptimizeMesh(MeshData &mesh);
+
+	// Logs cache statistics before & after OptimizeMesh() to the debug output.
+	void BenchmarkMeshOptimizer(const MeshData &mesh);
+}
+
+#endif // MESH_OPTIMIZER_H
@@ -0,0 +1,292 @@
+/*
+	Year 2 Direct3D 11 workshop template.
+	Content - Offline mesh simplification (quadric error metric, Garland & Heckbert) & LOD chain generation.
+
+	Collapses are done in passes: all candidate edges are scored, then the cheapest are applied as long
+	as no vertex is involved twice in the same pass (the quadrics & adjacency would be stale otherwise).
+*/
+
+#include "../Platform.h"
+#include "../D3D.h"
+#include "MeshSimplify.h"
+
+namespace Content
+{
+	// Symmetric 4x4 matrix: sum of squared distances to a set of planes.
+	struct Quadric
+	{
+		double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+
+		void AddPlane(const Vector3 &normal, float distance)
+		{
+			const double a = normal.x, b = normal.y, c = normal.z, d = distance;
+			a2 += a*a; ab += a*b; ac += a*c; ad += a*d;
+			b2 += b*b; bc += b*c; bd += b*d;
+			c2 += c*c; cd += c*d;
+			d2 += d*d;
+		}
+
+		void Add(const Quadric &B)
+		{
+			a2 += B.a2; ab += B.ab; ac += B.ac; ad += B.ad;
+			b2 += B.b2; bc += B.bc; bd += B.bd;
+			c2 += B.c2; cd += B.cd;
+			d2 += B.d2;
+		}
+
+		double Evaluate(const Vector3 &position) const
+		{
+			const double x = position.x, y = position.y, z = position.z;
+			const double error =
+				a2*x*x + 2.0*ab*x*y + 2.0*ac*x*z + 2.0*ad*x +
+				b2*y*y + 2.0*bc*y*z + 2.0*bd*y +
+				c2*z*z + 2.0*cd*z +
+				d2;
+
+			return std::max<double>(0.0, error); // Rounding.
+		}
+	};
+
+	struct EdgeCollapse
+	{
+		uint32_t from, to;
+		float cost;
+	};
+
+	// Only the cheapest fraction of candidates is considered per pass, which keeps the order close to
+	// that of a (much slower) priority queue.
+	const unsigned int kCollapsePassFraction = 3;
+	const unsigned int kMaxSimplifyPasses = 64;
+
+	float SimplifyIndices(const float *pPositions, size_t stride, unsigned int numVertices,
+		const uint32_t *pIndices, size_t numIndices, size_t targetNumIndices, std::vector<uint32_t> &result)
+	{
+		ASSERT(0 == numIndices % 3);
+
+		result.assign(pIndices, pIndices + numIndices);
+		if (numIndices <= targetNumIndices)
+			return 0.f;
+
+		auto getPosition = [pPositions, stride](uint32_t index)
+		{
+			const float *pPosition = reinterpret_cast<const float *>(reinterpret_cast<const uint8_t *>(pPositions) + index*stride);
+			return Vector3(pPosition[0], pPosition[1], pPosition[2]);
+		};
+
+		// Initial quadrics: planes of all adjacent triangles.
+		std::vector<Quadric> quadrics(numVertices);
+		memset(quadrics.data(), 0, numVertices*sizeof(Quadric));
+		for (size_t iIndex = 0; iIndex < numIndices; iIndex += 3)
+		{
+			const Vector3 A = getPosition(pIndices[iIndex]), B = getPosition(pIndices[iIndex+1]), C = getPosition(pIndices[iIndex+2]);
+			const Vector3 cross = Vector3::Cross(B-A, C-A);
+			const float length = cross.Length();
+			if (0.f == length)
+				continue;
+
+			const Vector3 normal = cross/length;
+			const float distance = -Vector3::Dot(normal, A);
+			for (unsigned int iCorner = 0; iCorner < 3; ++iCorner)
+				quadrics[pIndices[iIndex+iCorner]].AddPlane(normal, distance);
+		}
+
+		// Lock vertices on open edges: a directed edge without it's opposite.
+		std::vector<bool> isLocked(numVertices, false);
+		{
+			std::vector<uint64_t> edges(numIndices);
+			for (size_t iIndex = 0; iIndex < numIndices; ++iIndex)
+			{
+				const uint64_t from = pIndices[iIndex], to = pIndices[iIndex - iIndex%3 + (iIndex+1)%3];
+				edges[iIndex] = from<<32 | to;
+			}
+
+			std::sort(edges.begin(), edges.end());
+			for (uint64_t edge : edges)
+			{
+				const uint64_t opposite = edge<<32 | edge>>32;
+				if (false == std::binary_search(edges.begin(), edges.end(), opposite))
+				{
+					isLocked[(uint32_t) (edge>>32)] = true;
+					isLocked[(uint32_t) edge] = true;
+				}
+			}
+		}
+
+		std::vector<uint32_t> remap(numVertices);
+		std::vector<bool> isTouched(numVertices);
+		std::vector<unsigned int> numAdjacent(numVertices), offsets(numVertices+1), adjacency;
+		std::vector<EdgeCollapse> candidates;
+		double maxError = 0.0;
+
+		for (unsigned int iPass = 0; iPass < kMaxSimplifyPasses && result.size() > targetNumIndices; ++iPass)
+		{
+			// Triangles per vertex (for the flip test).
+			std::fill(numAdjacent.begin(), numAdjacent.end(), 0);
+			for (uint32_t index : result)
+				++numAdjacent[index];
+
+			offsets[0] = 0;
+			for (unsigned int iVertex = 0; iVertex < numVertices; ++iVertex)
+				offsets[iVertex+1] = offsets[iVertex] + numAdjacent[iVertex];
+
+			adjacency.resize(result.size());
+			std::fill(numAdjacent.begin(), numAdjacent.end(), 0);
+			for (size_t iIndex = 0; iIndex < result.size(); ++iIndex)
+			{
+				const uint32_t index = result[iIndex];
+				adjacency[offsets[index] + numAdjacent[index]++] = (unsigned int) (iIndex/3);
+			}
+
+			// Score each (undirected) edge once, in the cheapest allowed direction.
+			candidates.clear();
+			for (size_t iIndex = 0; iIndex < result.size(); ++iIndex)
+			{
+				const uint32_t A = result[iIndex], B = result[iIndex - iIndex%3 + (iIndex+1)%3];
+				if (A > B || (true == isLocked[A] && true == isLocked[B]))
+					continue;
+
+				Quadric merged = quadrics[A];
+				merged.Add(quadrics[B]);
+
+				EdgeCollapse collapse = { A, B, FLT_MAX };
+				if (false == isLocked[A])
+					collapse.cost = (float) merged.Evaluate(getPosition(B));
+
+				if (false == isLocked[B])
+				{
+					const float cost = (float) merged.Evaluate(getPosition(A));
+					if (cost < collapse.cost)
+					{
+						collapse.from = B;
+						collapse.to = A;
+						collapse.cost = cost;
+					}
+				}
+
+				candidates.push_back(collapse);
+			}
+
+			if (true == candidates.empty())
+				break;
+
+			std::sort(candidates.begin(), candidates.end(), [](const EdgeCollapse &A, const EdgeCollapse &B) { return A.cost < B.cost; });
+			const float maxPassCost = candidates[(candidates.size()-1)/kCollapsePassFraction].cost;
+
+			for (unsigned int iVertex = 0; iVertex < numVertices; ++iVertex)
+				remap[iVertex] = iVertex;
+
+			std::fill(isTouched.begin(), isTouched.end(), false);
+
+			// Each (interior) collapse removes 2 triangles.
+			const size_t numToRemove = (result.size() - targetNumIndices)/3;
+			size_t numRemoved = 0;
+			for (const EdgeCollapse &collapse : candidates)
+			{
+				if (collapse.cost > maxPassCost || numRemoved >= numToRemove)
+					break;
+
+				if (true == isTouched[collapse.from] || true == isTouched[collapse.to])
+					continue;
+
+				// Reject if any remaining triangle around 'from' would flip (or collapse to nothing).
+				const Vector3 target = getPosition(collapse.to);
+				bool flips = false;
+				for (unsigned int iAdjacent = offsets[collapse.from]; iAdjacent < offsets[collapse.from+1] && false == flips; ++iAdjacent)
+				{
+					const uint32_t *pTri = &result[adjacency[iAdjacent]*3];
+					if (collapse.to == pTri[0] || collapse.to == pTri[1] || collapse.to == pTri[2])
+						continue;
+
+					Vector3 corners[3] = { getPosition(pTri[0]), getPosition(pTri[1]), getPosition(pTri[2]) };
+					const Vector3 before = Vector3::Cross(corners[1]-corners[0], corners[2]-corners[0]);
+					for (unsigned int iCorner = 0; iCorner < 3; ++iCorner)
+						if (collapse.from == pTri[iCorner])
+							corners[iCorner] = target;
+
+					const Vector3 after = Vector3::Cross(corners[1]-corners[0], corners[2]-corners[0]);
+					flips = Vector3::Dot(before, after) <= 0.f;
+				}
+
+				if (true == flips)
+					continue;
+
+				remap[collapse.from] = collapse.to;
+				isTouched[collapse.from] = isTouched[collapse.to] = true;
+				quadrics[collapse.to].Add(quadrics[collapse.from]);
+				maxError = std::max<double>(maxError, collapse.cost);
+				numRemoved += 2;
+			}
+
+			if (0 == numRemoved)
+				break;
+
+			// Apply & drop the triangles that became degenerate.
+			size_t numKept = 0;
+			for (size_t iIndex = 0; iIndex < result.size(); iIndex += 3)
+			{
+				const uint32_t A = remap[result[iIndex]], B = remap[result[iIndex+1]], C = remap[result[iIndex+2]];
+				if (A != B && B != C && C != A)
+				{
+					result[numKept++] = A;
+					result[numKept++] = B;
+					result[numKept++] = C;
+				}
+			}
+
+			result.resize(numKept);
+		}
+
+		return (float) sqrt(maxError);
+	}
+
+	void GenerateLODs(MeshData &mesh, unsigned int maxLODs /* = 5 */, float reduction /* = 0.5f */)
+	{
+		ASSERT(1 == mesh.LODs.size());
+		ASSERT(reduction > 0.f && reduction < 1.f);
+
+		const unsigned int stride = GetMeshVertexStride(mesh.vertexFormat);
+		const unsigned int numVertices = mesh.GetNumVertices();
+		const uint32_t numSubmeshes = mesh.LODs[0].numSubmeshes;
+
+		std::vector<uint32_t> simplified;
+		for (unsigned int iLOD = 1; iLOD < maxLODs; ++iLOD)
+		{
+			const MeshFileLOD previous = mesh.LODs.back();
+
+			MeshFileLOD LOD;
+			LOD.firstSubmesh = (uint32_t) mesh.submeshes.size();
+			LOD.numSubmeshes = numSubmeshes;
+			LOD.error = 0.f;
+
+			size_t numPrevious = 0, numCurrent = 0;
+			for (uint32_t iSubmesh = 0; iSubmesh < numSubmeshes; ++iSubmesh)
+			{
+				MeshFileSubmesh submesh = mesh.submeshes[previous.firstSubmesh + iSubmesh];
+				const size_t target = (size_t) (submesh.numIndices/3*reduction)*3;
+				const float error = SimplifyIndices(mesh.vertices.data(), stride, numVertices,
+					&mesh.indices[submesh.firstIndex], submesh.numIndices, target, simplified);
+
+				// Errors add up, as each level is simplified from the one before.
+				LOD.error = std::max<float>(LOD.error, previous.error + error);
+				numPrevious += submesh.numIndices;
+				numCurrent += simplified.size();
+
+				// Bounds are kept: they're still conservative.
+				submesh.firstIndex = (uint32_t) mesh.indices.size();
+				submesh.numIndices = (uint32_t) simplified.size();
+				mesh.indices.insert(mesh.indices.end(), simplified.begin(), simplified.end());
+				mesh.submeshes.push_back(submesh);
+			}
+
+			// Not worth another level?
+			if (numCurrent > numPrevious - numPrevious/10)
+			{
+				mesh.indices.resize(mesh.submeshes[LOD.firstSubmesh].firstIndex);
+				mesh.submeshes.resize(LOD.firstSubmesh);
+				break;
+			}
+
+			mesh.LODs.push_back(LOD);
+		}
+	}
+}
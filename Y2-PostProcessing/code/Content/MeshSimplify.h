@@ -0,0 +1,29 @@
+/*
+	Year 2 Direct3D 11 workshop template.
+	Content - Offline mesh simplification (quadric error metric, Garland & Heckbert) & LOD chain generation.
+
+	Simplification is done by collapsing edges onto one of their existing vertices, so no new vertex
+	data is needed and every LOD draws from the same vertex buffer.
+	Vertices on an open edge (of the index list, not of the welded surface) are never moved: that keeps
+	mesh borders, submesh borders and attribute seams (UV, normal) intact.
+*/
+
+#if !defined(MESH_SIMPLIFY_H)
+#define MESH_SIMPLIFY_H
+
+#include "MeshFile.h"
+
+namespace Content
+{
+	// Simplifies a triangle list towards 'targetNumIndices' (it may stop short if nothing's left to collapse).
+	// Positions are float3 at the start of each 'stride' bytes.
+	// Returns the object space error introduced (approx. max. distance to the original surface).
+	float SimplifyIndices(const float *pPositions, size_t stride, unsigned int numVertices,
+		const uint32_t *pIndices, size_t numIndices, size_t targetNumIndices, std::vector<uint32_t> &result);
+
+	// Appends up to 'maxLODs'-1 levels to a mesh that has only it's original LOD, each 'reduction' times
+	// the triangle count of the one before it; stops early once simplification stalls.
+	void GenerateLODs(MeshData &mesh, unsigned int maxLODs = 5, float reduction = 0.5f);
+}
+
+#endif // MESH_SIMPLIFY_H
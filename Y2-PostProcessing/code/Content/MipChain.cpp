@@ -0,0 +1,319 @@
+/*
+	Year 2 Direct3D 11 workshop template.
+	Content - Mip chain generation (offline/load time).
+
+	Each level is filtered from the previous one, kept in linear floating point, so quantization
+	error doesn't accumulate down the chain. Filtering is separable (horizontal, then vertical),
+	one __m128 per pixel, with rows spread over all cores.
+*/
+
+#include "../Platform.h"
+#include <xmmintrin.h>
+#include "MipChain.h"
+
+namespace Content
+{
+	// Precision of the linear-to-sRGB table; 14 bits keeps the darkest sRGB steps apart.
+	const unsigned int kLinearToSRGBBits = 14;
+	const unsigned int kLinearToSRGBSize = 1 << kLinearToSRGBBits;
+
+	// Rows per ParallelFor() fetch.
+	const unsigned int kRowGrain = 8;
+
+	struct ConversionTables
+	{
+		ConversionTables() :
+			toLinear(256), toSRGB(kLinearToSRGBSize)
+		{
+			for (unsigned int iValue = 0; iValue < 256; ++iValue)
+				toLinear[iValue] = SRGBToLinear(iValue/255.f);
+
+			for (unsigned int iValue = 0; iValue < kLinearToSRGBSize; ++iValue)
+				toSRGB[iValue] = (uint8_t) (LinearToSRGB((float) iValue/(kLinearToSRGBSize-1))*255.f + 0.5f);
+		}
+
+		std::vector<float> toLinear;
+		std::vector<uint8_t> toSRGB;
+	};
+
+	static const ConversionTables &GetTables()
+	{
+		static const ConversionTables tables;
+		return tables;
+	}
+
+	// Intermediate level: one linear RGBA __m128 per pixel.
+	struct LinearImage
+	{
+		LinearImage(unsigned int width, unsigned int height) :
+			width(width), height(height), pixels(width*height) {}
+
+		unsigned int width, height;
+		std::vector<__m128> pixels;
+	};
+
+	/*
+		Filter kernels (x in destination pixels).
+	*/
+
+	static float Sinc(float x)
+	{
+		if (fabsf(x) < 1e-5f)
+			return 1.f;
+
+		x *= kPI;
+		return sinf(x)/x;
+	}
+
+	// Modified Bessel function of the first kind (order 0), power series.
+	static float BesselI0(float x)
+	{
+		const float xSqrOver4 = x*x*0.25f;
+		float sum = 1.f, term = 1.f;
+		for (unsigned int iTerm = 1; iTerm < 32 && term > sum*1e-8f; ++iTerm)
+		{
+			term *= xSqrOver4/(float) (iTerm*iTerm);
+			sum += term;
+		}
+
+		return sum;
+	}
+
+	const float kKaiserWidth = 3.f;
+	const float kKaiserAlpha = 4.f;
+	const float kLanczosLobes = 3.f;
+
+	static float Kaiser(float x)
+	{
+		if (fabsf(x) >= kKaiserWidth)
+			return 0.f;
+
+		const float t = x/kKaiserWidth;
+		return Sinc(x)*BesselI0(kKaiserAlpha*sqrtf(1.f - t*t))/BesselI0(kKaiserAlpha);
+	}
+
+	static float Lanczos(float x)
+	{
+		if (fabsf(x) >= kLanczosLobes)
+			return 0.f;
+
+		return Sinc(x)*Sinc(x/kLanczosLobes);
+	}
+
+	/*
+		Filter taps for one axis: for each destination pixel a range in 'indices' & 'weights'.
+		Source indices are clamped to the edge, which is what you want for anything but tiling textures.
+	*/
+
+	struct FilterTaps
+	{
+		std::vector<unsigned int> first; // Size + 1 entries.
+		std::vector<unsigned int> indices;
+		std::vector<float> weights;
+	};
+
+	static void ComputeTaps(MipFilter filter, unsigned int srcSize, unsigned int dstSize, FilterTaps &taps)
+	{
+		taps.first.resize(dstSize+1);
+		taps.indices.clear();
+		taps.weights.clear();
+
+		const float scale = (float) srcSize/dstSize;
+
+		for (unsigned int iDest = 0; iDest < dstSize; ++iDest)
+		{
+			taps.first[iDest] = (unsigned int) taps.indices.size();
+
+			if (kMipFilterBox == filter)
+			{
+				// Exact coverage of [iDest, iDest+1] in source space; handles odd sizes without bias.
+				const float left = iDest*scale;
+				const float right = (iDest+1)*scale;
+				const int iFirst = (int) floorf(left);
+				const int iLast = std::min<int>((int) ceilf(right), srcSize) - 1;
+				for (int iSrc = iFirst; iSrc <= iLast; ++iSrc)
+				{
+					const float coverage = std::min<float>((float) iSrc+1, right) - std::max<float>((float) iSrc, left);
+					if (coverage > 0.f)
+					{
+						taps.indices.push_back(iSrc);
+						taps.weights.push_back(coverage);
+					}
+				}
+			}
+			else
+			{
+				const float support = ((kMipFilterKaiser == filter) ? kKaiserWidth : kLanczosLobes)*scale;
+				const float center = (iDest + 0.5f)*scale;
+				const int iFirst = (int) floorf(center - support);
+				const int iLast = (int) ceilf(center + support);
+				for (int iSrc = iFirst; iSrc <= iLast; ++iSrc)
+				{
+					const float x = (iSrc + 0.5f - center)/scale;
+					const float weight = (kMipFilterKaiser == filter) ? Kaiser(x) : Lanczos(x);
+					if (0.f != weight)
+					{
+						taps.indices.push_back(std::min<int>(std::max<int>(iSrc, 0), srcSize-1));
+						taps.weights.push_back(weight);
+					}
+				}
+			}
+
+			// Normalize (sum to 1).
+			const unsigned int iFirstTap = taps.first[iDest];
+			float sum = 0.f;
+			for (size_t iTap = iFirstTap; iTap < taps.weights.size(); ++iTap)
+				sum += taps.weights[iTap];
+
+			ASSERT(sum > 0.f);
+			for (size_t iTap = iFirstTap; iTap < taps.weights.size(); ++iTap)
+				taps.weights[iTap] /= sum;
+		}
+
+		taps.first[dstSize] = (unsigned int) taps.indices.size();
+	}
+
+	/*
+		Conversion.
+	*/
+
+	static void ToLinear(const Image &source, bool isSRGB, LinearImage &target)
+	{
+		const ConversionTables &tables = GetTables();
+		const __m128 oneOver255 = _mm_set1_ps(1.f/255.f);
+
+		ParallelFor(source.height, kRowGrain, [&](unsigned int iRow)
+		{
+			const uint32_t *pSrc = source.GetRow(iRow);
+			__m128 *pDest = &target.pixels[iRow*target.width];
+			for (unsigned int iPixel = 0; iPixel < source.width; ++iPixel)
+			{
+				const uint32_t pixel = pSrc[iPixel];
+				const unsigned int C0 = pixel & 0xff, C1 = (pixel >> 8) & 0xff, C2 = (pixel >> 16) & 0xff, A = pixel >> 24;
+				if (true == isSRGB)
+					pDest[iPixel] = _mm_set_ps(A/255.f, tables.toLinear[C2], tables.toLinear[C1], tables.toLinear[C0]);
+				else
+					pDest[iPixel] = _mm_mul_ps(_mm_set_ps((float) A, (float) C2, (float) C1, (float) C0), oneOver255);
+			}
+		});
+	}
+
+	static void FromLinear(const LinearImage &source, bool isSRGB, Image &target)
+	{
+		const ConversionTables &tables = GetTables();
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.f);
+
+		// Colour channels scale to the table range if sRGB, alpha always scales to 255.
+		const float colorScale = (true == isSRGB) ? (float) (kLinearToSRGBSize-1) : 255.f;
+		const __m128 scale = _mm_set_ps(255.f, colorScale, colorScale, colorScale);
+		const __m128 half = _mm_set1_ps(0.5f);
+
+		ParallelFor(source.height, kRowGrain, [&](unsigned int iRow)
+		{
+			const __m128 *pSrc = &source.pixels[iRow*source.width];
+			uint32_t *pDest = target.GetRow(iRow);
+			for (unsigned int iPixel = 0; iPixel < source.width; ++iPixel)
+			{
+				// Clamp (Kaiser & Lanczos have negative lobes), scale, round.
+				const __m128 clamped = _mm_min_ps(_mm_max_ps(pSrc[iPixel], zero), one);
+				const __m128i rounded = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(clamped, scale), half));
+
+				alignas(16) int32_t values[4];
+				_mm_store_si128(reinterpret_cast<__m128i *>(values), rounded);
+
+				if (true == isSRGB)
+				{
+					values[0] = tables.toSRGB[values[0]];
+					values[1] = tables.toSRGB[values[1]];
+					values[2] = tables.toSRGB[values[2]];
+				}
+
+				pDest[iPixel] = values[0] | (values[1] << 8) | (values[2] << 16) | ((uint32_t) values[3] << 24);
+			}
+		});
+	}
+
+	/*
+		Separable resample.
+	*/
+
+	static void Downsample(const LinearImage &source, MipFilter filter, LinearImage &target)
+	{
+		FilterTaps horzTaps, vertTaps;
+		ComputeTaps(filter, source.width, target.width, horzTaps);
+		ComputeTaps(filter, source.height, target.height, vertTaps);
+
+		// Horizontal pass: source.height rows of target.width pixels.
+		LinearImage horizontal(target.width, source.height);
+		ParallelFor(source.height, kRowGrain, [&](unsigned int iRow)
+		{
+			const __m128 *pSrc = &source.pixels[iRow*source.width];
+			__m128 *pDest = &horizontal.pixels[iRow*target.width];
+			for (unsigned int iPixel = 0; iPixel < target.width; ++iPixel)
+			{
+				__m128 sum = _mm_setzero_ps();
+				for (unsigned int iTap = horzTaps.first[iPixel]; iTap < horzTaps.first[iPixel+1]; ++iTap)
+					sum = _mm_add_ps(sum, _mm_mul_ps(pSrc[horzTaps.indices[iTap]], _mm_set1_ps(horzTaps.weights[iTap])));
+
+				pDest[iPixel] = sum;
+			}
+		});
+
+		// Vertical pass: accumulate whole rows, which keeps the inner loop streaming.
+		ParallelFor(target.height, kRowGrain, [&](unsigned int iRow)
+		{
+			__m128 *pDest = &target.pixels[iRow*target.width];
+			for (unsigned int iPixel = 0; iPixel < target.width; ++iPixel)
+				pDest[iPixel] = _mm_setzero_ps();
+
+			for (unsigned int iTap = vertTaps.first[iRow]; iTap < vertTaps.first[iRow+1]; ++iTap)
+			{
+				const __m128 *pSrc = &horizontal.pixels[vertTaps.indices[iTap]*target.width];
+				const __m128 weight = _mm_set1_ps(vertTaps.weights[iTap]);
+				for (unsigned int iPixel = 0; iPixel < target.width; ++iPixel)
+					pDest[iPixel] = _mm_add_ps(pDest[iPixel], _mm_mul_ps(pSrc[iPixel], weight));
+			}
+		});
+	}
+
+	unsigned int GetNumMipLevels(unsigned int width, unsigned int height)
+	{
+		unsigned int numLevels = 1;
+		while (width > 1 || height > 1)
+		{
+			width = std::max<unsigned int>(1, width >> 1);
+			height = std::max<unsigned int>(1, height >> 1);
+			++numLevels;
+		}
+
+		return numLevels;
+	}
+
+	void GenerateMipChain(const Image &source, MipFilter filter, bool isSRGB, std::vector<Image> &chain)
+	{
+		ASSERT(0 != source.width && 0 != source.height);
+		ASSERT(source.pixels.size() == source.width*source.height);
+
+		const unsigned int numLevels = GetNumMipLevels(source.width, source.height);
+		chain.resize(numLevels);
+		chain[0] = source;
+
+		std::unique_ptr<LinearImage> previous(new LinearImage(source.width, source.height));
+		ToLinear(source, isSRGB, *previous);
+
+		for (unsigned int iLevel = 1; iLevel < numLevels; ++iLevel)
+		{
+			const unsigned int width = std::max<unsigned int>(1, previous->width >> 1);
+			const unsigned int height = std::max<unsigned int>(1, previous->height >> 1);
+
+			std::unique_ptr<LinearImage> current(new LinearImage(width, height));
+			Downsample(*previous, filter, *current);
+
+			chain[iLevel] = Image(width, height);
+			FromLinear(*current, isSRGB, chain[iLevel]);
+
+			previous = std::move(current);
+		}
+	}
+}
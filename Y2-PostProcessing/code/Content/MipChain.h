@@ -0,0 +1,30 @@
+/*
+	Year 2 Direct3D 11 workshop template.
+	Content - Mip chain generation (offline/load time).
+
+	Levels follow Direct3D sizing (floor(size/2), clamped to 1) so non-power-of-two images work as-is.
+*/
+
+#if !defined(MIP_CHAIN_H)
+#define MIP_CHAIN_H
+
+#include "Image.h"
+
+namespace Content
+{
+	enum MipFilter
+	{
+		kMipFilterBox,     // Exact area average: fastest, a bit blurry.
+		kMipFilterKaiser,  // Kaiser-windowed sinc: sharp, very little ringing (good default).
+		kMipFilterLanczos  // Lanczos (3 lobes): sharpest, may ring around hard edges.
+	};
+
+	// Number of levels in a full chain down to 1x1.
+	unsigned int GetNumMipLevels(unsigned int width, unsigned int height);
+
+	// Generates a full chain; chain[0] is a copy of the source.
+	// If 'isSRGB' is set colour is filtered in linear space (alpha is always linear).
+	void GenerateMipChain(const Image &source, MipFilter filter, bool isSRGB, std::vector<Image> &chain);
+}
+
+#endif // MIP_CHAIN_H
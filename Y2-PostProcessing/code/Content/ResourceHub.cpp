@@ -0,0 +1,67 @@
+/*
+	Year 2 Direct3D 11 workshop template.
+	Content - Resource hub: one instance of each loaded resource, shared by ID (64-bit hash of the path).
+*/
+
+#include "../Platform.h"
+#include "../D3D.h"
+#include "ResourceHub.h"
+#include "TextureFile.h"
+
+namespace Content
+{
+	// Asynchronous halves: the file's read & parsed here, the closure creates the resource on the render thread.
+	static std::function<D3D::Texture *()> ReadTexture(const std::string &path)
+	{
+		std::shared_ptr<TextureFile> file = std::make_shared<TextureFile>();
+		if (false == ReadTextureFile(path, *file))
+			return nullptr;
+
+		return [file, path]() { return CreateTexture(*file, path); };
+	}
+
+	static std::function<Mesh *()> ReadMesh(const std::string &path)
+	{
+		std::shared_ptr<MeshFile> file = std::make_shared<MeshFile>();
+		if (false == file->Open(path))
+			return nullptr;
+
+		return [file]() { return CreateMesh(*file); };
+	}
+
+	static ResourceCache<D3D::Texture> s_textures(LoadTexture, ReadTexture);
+	static ResourceCache<Mesh> s_meshes(LoadMesh, ReadMesh);
+
+	TextureHandle RequestTexture(const std::string &path) { return s_textures.Request(path); }
+	MeshHandle RequestMesh(const std::string &path)       { return s_meshes.Request(path); }
+
+	TextureHandle RequestTextureAsync(const std::string &path) { return s_textures.RequestAsync(path); }
+	MeshHandle RequestMeshAsync(const std::string &path)       { return s_meshes.RequestAsync(path); }
+
+	D3D::Texture *FindTexture(ResourceID ID) { return s_textures.Find(ID); }
+	Mesh *FindMesh(ResourceID ID)            { return s_meshes.Find(ID); }
+
+	void ReleaseUnusedResources()
+	{
+		s_textures.ReleaseUnused();
+		s_meshes.ReleaseUnused();
+	}
+
+	void DestroyResources()
+	{
+		s_textures.Clear();
+		s_meshes.Clear();
+	}
+
+	const ResourceStats GetResourceStats()
+	{
+		const ResourceStats textures = s_textures.GetStats(), meshes = s_meshes.GetStats();
+
+		ResourceStats stats;
+		stats.numRequests = textures.numRequests + meshes.numRequests;
+		stats.numLoads = textures.numLoads + meshes.numLoads;
+		stats.numReleased = textures.numReleased + meshes.numReleased;
+		stats.numResident = textures.numResident + meshes.numResident;
+		return stats;
+	}
+}
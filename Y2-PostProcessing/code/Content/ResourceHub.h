@@ -0,0 +1,330 @@
+/*
+	Year 2 Direct3D 11 workshop template.
+	Content - Resource hub: one instance of each loaded resource, shared by ID (64-bit hash of the path).
+
+	Loaders read through the mounted archives (see Archive.h), so the same IDs find packed and loose files alike.
+
+	- Request*Async() returns right away: the file is read & decoded on a loader thread and the resource is
+	  created on the render thread (see AsyncLoad.h). Until then Get() & Find*() return nullptr.
+
+	- Request*() may be called from any thread; concurrent requests for the same path wait on a single load.
+	- Handles are reference counted. When the last one goes the resource isn't released right away, but by
+	  ReleaseUnusedResources() at the end of the frame (if it hasn't been requested again by then).
+	- Find*() is meant for the render thread and doesn't lock: it searches an immutable snapshot of the table,
+	  which is replaced under the lock whenever the table changes. Old snapshots are freed at the end of the
+	  frame as well, so a pointer returned by Find*() is good until then.
+*/
+
+#if !defined(RESOURCE_HUB_H)
+#define RESOURCE_HUB_H
+
+#include <future>
+#include <unordered_map>
+#include "Archive.h"
+#include "AsyncLoad.h"
+#include "MeshFile.h"
+
+namespace Content
+{
+	template<typename T> class ResourceCache;
+
+	template<typename T>
+	struct ResourceEntry
+	{
+		ResourceID ID;
+		std::string path;
+		ResourceCache<T> *pCache;
+		std::atomic<int> refCount;
+		std::atomic<bool> isReady;
+		std::shared_future<void> loaded;
+		std::unique_ptr<T> resource; // Null if the load failed.
+	};
+
+	template<typename T>
+	class ResourceHandle
+	{
+	public:
+		ResourceHandle() : m_pEntry(nullptr) {}
+		ResourceHandle(const ResourceHandle &handle) : m_pEntry(handle.m_pEntry) { if (nullptr != m_pEntry) ++m_pEntry->refCount; }
+		ResourceHandle(ResourceHandle &&handle) : m_pEntry(handle.m_pEntry) { handle.m_pEntry = nullptr; }
+		~ResourceHandle() { Reset(); }
+
+		ResourceHandle &operator =(ResourceHandle handle)
+		{
+			std::swap(m_pEntry, handle.m_pEntry);
+			return *this;
+		}
+
+		void Reset()
+		{
+			if (nullptr != m_pEntry)
+			{
+				// The entry may be gone as soon as the count hits zero.
+				const ResourceID ID = m_pEntry->ID;
+				ResourceCache<T> *pCache = m_pEntry->pCache;
+				if (1 == m_pEntry->refCount.fetch_sub(1))
+					pCache->OnUnused(ID);
+
+				m_pEntry = nullptr;
+			}
+		}
+
+		// Done loading (whether it succeeded or not).
+		bool IsReady() const { return nullptr != m_pEntry && true == m_pEntry->isReady.load(std::memory_order_acquire); }
+
+		// Null if the handle is empty, the load is still in flight or it failed (see GetLastError()).
+		T *Get() const { return (true == IsReady()) ? m_pEntry->resource.get() : nullptr; }
+		T *operator ->() const { ASSERT(nullptr != Get()); return Get(); }
+
+		ResourceID GetID() const { ASSERT(nullptr != m_pEntry); return m_pEntry->ID; }
+
+	private:
+		friend class ResourceCache<T>;
+		explicit ResourceHandle(ResourceEntry<T> *pEntry) : m_pEntry(pEntry) {}
+
+		ResourceEntry<T> *m_pEntry;
+	};
+
+	struct ResourceStats
+	{
+		unsigned int numRequests;
+		unsigned int numLoads;    // Requests that weren't served from the cache (asynchronous ones included).
+		unsigned int numReleased;
+		unsigned int numResident;
+	};
+
+	template<typename T>
+	class ResourceCache : public boost::noncopyable
+	{
+	public:
+		typedef T *(*LoadFunction)(const std::string &path);
+
+		// Asynchronous: runs on a loader thread and returns what creates the resource on the render thread.
+		typedef std::function<T *()> CreateFunction;
+		typedef CreateFunction (*ReadFunction)(const std::string &path);
+
+		ResourceCache(LoadFunction load, ReadFunction read) :
+			m_load(load), m_read(read), m_pTable(new Table())
+		{
+			memset(&m_stats, 0, sizeof(m_stats));
+		}
+
+		~ResourceCache()
+		{
+			Clear();
+			delete m_pTable.load();
+		}
+
+		ResourceHandle<T> Request(const std::string &path)
+		{
+			const ResourceID ID = GetResourceID(path);
+
+			std::shared_ptr<std::promise<void>> loaded;
+			ResourceEntry<T> *pEntry = Acquire(path, ID, loaded);
+
+			// Load outside of the lock; anyone else asking for it in the meantime waits.
+			if (nullptr != loaded)
+			{
+				pEntry->resource.reset(m_load(path));
+				pEntry->isReady.store(true, std::memory_order_release);
+				loaded->set_value();
+			}
+			else
+				WaitForAsyncLoad(pEntry->loaded);
+
+			return ResourceHandle<T>(pEntry);
+		}
+
+		ResourceHandle<T> RequestAsync(const std::string &path)
+		{
+			const ResourceID ID = GetResourceID(path);
+
+			std::shared_ptr<std::promise<void>> loaded;
+			ResourceEntry<T> *pEntry = Acquire(path, ID, loaded);
+
+			// The entry outlives the load: ReleaseUnused() leaves entries alone until they're ready.
+			if (nullptr != loaded)
+			{
+				const ReadFunction read = m_read;
+				RunAsync([read, pEntry, loaded]() -> AsyncFinish
+				{
+					const CreateFunction create = read(pEntry->path);
+					return [pEntry, loaded, create]()
+					{
+						if (create)
+							pEntry->resource.reset(create());
+
+						pEntry->isReady.store(true, std::memory_order_release);
+						loaded->set_value();
+					};
+				});
+			}
+
+			return ResourceHandle<T>(pEntry);
+		}
+
+		// Render thread only: no locks, returns nullptr if not (yet) loaded.
+		T *Find(ResourceID ID) const
+		{
+			const Table *pTable = m_pTable.load(std::memory_order_acquire);
+			auto iEntry = std::lower_bound(pTable->begin(), pTable->end(), ID,
+				[](const ResourceEntry<T> *pEntry, ResourceID ID) { return pEntry->ID < ID; });
+
+			if (pTable->end() != iEntry && ID == (*iEntry)->ID && true == (*iEntry)->isReady.load(std::memory_order_acquire))
+				return (*iEntry)->resource.get();
+
+			return nullptr;
+		}
+
+		// End of frame: releases what's still unused & frees old snapshots.
+		void ReleaseUnused()
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+
+			bool isChanged = false;
+			std::vector<ResourceID> stillLoading;
+			for (ResourceID ID : m_unused)
+			{
+				auto iEntry = m_entries.find(ID);
+				if (m_entries.end() != iEntry && 0 == iEntry->second->refCount)
+				{
+					// Still loading: try again next frame.
+					if (false == iEntry->second->isReady.load(std::memory_order_acquire))
+					{
+						stillLoading.push_back(ID);
+						continue;
+					}
+
+					m_entries.erase(iEntry);
+					++m_stats.numReleased;
+					isChanged = true;
+				}
+			}
+
+			m_unused.swap(stillLoading);
+
+			if (true == isChanged)
+				Publish();
+
+			for (const Table *pTable : m_retired)
+				delete pTable;
+
+			m_retired.clear();
+		}
+
+		// Shutdown: all handles (and asynchronous loads, see StopAsyncLoading()) should be gone by now.
+		void Clear()
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			for (auto &entry : m_entries)
+				ASSERT(0 == entry.second->refCount);
+
+			m_entries.clear();
+			m_unused.clear();
+			Publish();
+
+			for (const Table *pTable : m_retired)
+				delete pTable;
+
+			m_retired.clear();
+		}
+
+		const ResourceStats GetStats() const
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			ResourceStats stats = m_stats;
+			stats.numResident = (unsigned int) m_entries.size();
+			return stats;
+		}
+
+	private:
+		friend class ResourceHandle<T>;
+
+		// Sorted by ID.
+		typedef std::vector<const ResourceEntry<T> *> Table;
+
+		// Finds or adds the entry & takes a reference; 'loaded' is set if the caller is to load it.
+		ResourceEntry<T> *Acquire(const std::string &path, ResourceID ID, std::shared_ptr<std::promise<void>> &loaded)
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			++m_stats.numRequests;
+
+			auto iEntry = m_entries.find(ID);
+			if (m_entries.end() != iEntry)
+			{
+				ResourceEntry<T> *pEntry = iEntry->second.get();
+				ASSERT(GetResourceID(pEntry->path) == ID);
+				++pEntry->refCount;
+				return pEntry;
+			}
+
+			loaded = std::make_shared<std::promise<void>>();
+
+			ResourceEntry<T> *pEntry = new ResourceEntry<T>();
+			pEntry->ID = ID;
+			pEntry->path = path;
+			pEntry->pCache = this;
+			pEntry->refCount = 1;
+			pEntry->isReady = false;
+			pEntry->loaded = loaded->get_future().share();
+			m_entries[ID].reset(pEntry);
+			Publish();
+
+			++m_stats.numLoads;
+			return pEntry;
+		}
+
+		void OnUnused(ResourceID ID)
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			m_unused.push_back(ID);
+		}
+
+		// Call with lock held.
+		void Publish()
+		{
+			Table *pTable = new Table();
+			pTable->reserve(m_entries.size());
+			for (auto &entry : m_entries)
+				pTable->push_back(entry.second.get());
+
+			std::sort(pTable->begin(), pTable->end(), [](const ResourceEntry<T> *pA, const ResourceEntry<T> *pB) { return pA->ID < pB->ID; });
+			m_retired.push_back(m_pTable.exchange(pTable, std::memory_order_acq_rel));
+		}
+
+		const LoadFunction m_load;
+		const ReadFunction m_read;
+
+		mutable std::mutex m_lock;
+		std::unordered_map<ResourceID, std::unique_ptr<ResourceEntry<T>>> m_entries; // See std::hash<HashedString>.
+		std::vector<ResourceID> m_unused;
+		ResourceStats m_stats;
+
+		std::atomic<const Table *> m_pTable;
+		std::vector<const Table *> m_retired;
+	};
+
+	/*
+		The hub itself.
+	*/
+
+	typedef ResourceHandle<D3D::Texture> TextureHandle;
+	typedef ResourceHandle<Mesh> MeshHandle;
+
+	TextureHandle RequestTexture(const std::string &path);
+	MeshHandle RequestMesh(const std::string &path);
+
+	TextureHandle RequestTextureAsync(const std::string &path);
+	MeshHandle RequestMeshAsync(const std::string &path);
+
+	D3D::Texture *FindTexture(ResourceID ID);
+	Mesh *FindMesh(ResourceID ID);
+
+	// Call once per frame, after the last draw; DestroyResources() before D3D::Destroy().
+	void ReleaseUnusedResources();
+	void DestroyResources();
+
+	const ResourceStats GetResourceStats();
+}
+
+#endif // RESOURCE_HUB_H
@@ -0,0 +1,346 @@
+/*
+	Year 2 Direct3D 11 workshop template.
+	Content - Texture atlas packing (skyline, bottom-left), offline & at runtime.
+
+	Skyline: J. Jylanki, 'A Thousand Ways to Pack the Bin'.
+*/
+
+#include "../Platform.h"
+#include <limits.h>
+#include "../D3D.h"
+#include "TextureAtlas.h"
+
+namespace Content
+{
+	static unsigned int AlignUp(unsigned int value, unsigned int alignment)
+	{
+		return (value + alignment-1) / alignment * alignment;
+	}
+
+	const Vector4 GetAtlasUVs(const AtlasRect &rect, unsigned int pageSize)
+	{
+		const float scale = 1.f/pageSize;
+		return Vector4(rect.X*scale, rect.Y*scale, (rect.X + rect.width)*scale, (rect.Y + rect.height)*scale);
+	}
+
+	// Writes the image plus a gutter of clamped edge pixels: (width + 2*gutter) by (height + 2*gutter) pixels.
+	static void BlitWithGutter(const Image &image, unsigned int gutter, uint32_t *pTarget, size_t targetPitch /* In pixels */)
+	{
+		const int size = (int) gutter;
+		for (int iY = -size; iY < (int) image.height + size; ++iY)
+		{
+			const uint32_t *pSource = image.GetRow((unsigned int) std::min<int>(std::max<int>(iY, 0), image.height-1));
+			uint32_t *pRow = pTarget + (iY + size)*targetPitch;
+
+			for (int iX = 0; iX < size; ++iX)
+				*pRow++ = pSource[0];
+
+			memcpy(pRow, pSource, image.width*sizeof(uint32_t));
+			pRow += image.width;
+
+			for (int iX = 0; iX < size; ++iX)
+				*pRow++ = pSource[image.width-1];
+		}
+	}
+
+	/*
+		SkylinePacker.
+	*/
+
+	SkylinePacker::SkylinePacker(unsigned int width, unsigned int height) :
+		m_width(width), m_height(height)
+	{
+		const Segment floor = { 0, 0, width };
+		m_skyline.push_back(floor);
+	}
+
+	bool SkylinePacker::Fit(size_t iSegment, unsigned int width, unsigned int height, unsigned int &Y, unsigned int &waste) const
+	{
+		const unsigned int X = m_skyline[iSegment].X;
+		if (X + width > m_width)
+			return false;
+
+		// Rests on the highest segment it spans.
+		Y = 0;
+		size_t iLast = iSegment;
+		for (unsigned int spanned = 0; spanned < width; spanned += m_skyline[iLast++].width)
+			Y = std::max<unsigned int>(Y, m_skyline[iLast].Y);
+
+		if (Y + height > m_height)
+			return false;
+
+		waste = 0;
+		for (size_t iSpanned = iSegment; iSpanned < iLast; ++iSpanned)
+		{
+			const Segment &segment = m_skyline[iSpanned];
+			const unsigned int spannedWidth = std::min<unsigned int>(segment.X + segment.width, X + width) - segment.X;
+			waste += (Y - segment.Y)*spannedWidth;
+		}
+
+		return true;
+	}
+
+	bool SkylinePacker::Insert(unsigned int width, unsigned int height, unsigned int &X, unsigned int &Y)
+	{
+		size_t iBest = m_skyline.size();
+		unsigned int bestTop = UINT_MAX, bestWaste = UINT_MAX;
+		for (size_t iSegment = 0; iSegment < m_skyline.size(); ++iSegment)
+		{
+			unsigned int segmentY, waste;
+			if (true == Fit(iSegment, width, height, segmentY, waste))
+			{
+				const unsigned int top = segmentY + height;
+				if (top < bestTop || (top == bestTop && waste < bestWaste))
+				{
+					iBest = iSegment;
+					bestTop = top;
+					bestWaste = waste;
+					Y = segmentY;
+				}
+			}
+		}
+
+		if (m_skyline.size() == iBest)
+			return false;
+
+		X = m_skyline[iBest].X;
+
+		// Raise the skyline & cut off (or remove) the segments now underneath.
+		const Segment raised = { X, Y + height, width };
+		m_skyline.insert(m_skyline.begin() + iBest, raised);
+
+		const unsigned int right = X + width;
+		size_t iNext = iBest+1;
+		while (iNext < m_skyline.size() && m_skyline[iNext].X < right)
+		{
+			Segment &segment = m_skyline[iNext];
+			const unsigned int overlap = right - segment.X;
+			if (overlap >= segment.width)
+			{
+				m_skyline.erase(m_skyline.begin() + iNext);
+				continue;
+			}
+
+			segment.X += overlap;
+			segment.width -= overlap;
+			break;
+		}
+
+		// Merge neighbours of equal height.
+		for (size_t iSegment = 0; iSegment+1 < m_skyline.size(); )
+		{
+			if (m_skyline[iSegment].Y == m_skyline[iSegment+1].Y)
+			{
+				m_skyline[iSegment].width += m_skyline[iSegment+1].width;
+				m_skyline.erase(m_skyline.begin() + iSegment+1);
+			}
+			else
+				++iSegment;
+		}
+
+		return true;
+	}
+
+	/*
+		AtlasPacker.
+	*/
+
+	AtlasPacker::AtlasPacker(const AtlasSettings &settings) :
+		m_settings(settings)
+		, m_alignment(1 << (std::max<unsigned int>(settings.numMipLevels, 1) - 1))
+		, m_usedArea(0)
+	{
+		m_gutter = AlignUp(std::max<unsigned int>(settings.gutter, (settings.numMipLevels > 1) ? m_alignment : 0), m_alignment);
+	}
+
+	bool AtlasPacker::Insert(unsigned int width, unsigned int height, AtlasRect &rect)
+	{
+		ASSERT(0 != width && 0 != height);
+
+		const unsigned int cellWidth = AlignUp(width + 2*m_gutter + m_settings.padding, m_alignment);
+		const unsigned int cellHeight = AlignUp(height + 2*m_gutter + m_settings.padding, m_alignment);
+		if (cellWidth > m_settings.pageSize || cellHeight > m_settings.pageSize)
+		{
+			SetLastError("Image too large for atlas page: " + std::to_string(width) + "x" + std::to_string(height));
+			return false;
+		}
+
+		// First page it fits on; otherwise open a new one.
+		unsigned int X, Y;
+		size_t iPage = 0;
+		while (iPage < m_pages.size() && false == m_pages[iPage].Insert(cellWidth, cellHeight, X, Y))
+			++iPage;
+
+		if (m_pages.size() == iPage)
+		{
+			m_pages.push_back(SkylinePacker(m_settings.pageSize, m_settings.pageSize));
+			VERIFY(true == m_pages.back().Insert(cellWidth, cellHeight, X, Y));
+		}
+
+		rect.page = (unsigned int) iPage;
+		rect.X = X + m_gutter;
+		rect.Y = Y + m_gutter;
+		rect.width = width;
+		rect.height = height;
+
+		m_usedArea += width*height;
+		return true;
+	}
+
+	void AtlasPacker::RemoveLastPage(const AtlasRect &rect)
+	{
+		ASSERT(false == m_pages.empty() && rect.page+1 == m_pages.size());
+		m_pages.pop_back();
+		m_usedArea -= rect.width*rect.height;
+	}
+
+	float AtlasPacker::GetFillRate() const
+	{
+		const uint64_t pageArea = (uint64_t) m_settings.pageSize*m_settings.pageSize;
+		return (false == m_pages.empty()) ? (float) ((double) m_usedArea/(pageArea*m_pages.size())) : 0.f;
+	}
+
+	/*
+		Offline.
+	*/
+
+	bool BuildAtlas(const std::vector<const Image *> &images, const AtlasSettings &settings,
+		std::vector<Image> &pages, std::vector<AtlasRect> &rects, AtlasStats *pStats /* = nullptr */)
+	{
+		pages.clear();
+		rects.resize(images.size());
+
+		std::vector<size_t> order(images.size());
+		for (size_t iImage = 0; iImage < images.size(); ++iImage)
+			order[iImage] = iImage;
+
+		std::stable_sort(order.begin(), order.end(), [&images](size_t iA, size_t iB)
+		{
+			const Image &A = *images[iA], &B = *images[iB];
+			return (A.height != B.height) ? A.height > B.height : A.width > B.width;
+		});
+
+		AtlasPacker packer(settings);
+		for (size_t iImage : order)
+		{
+			if (false == packer.Insert(images[iImage]->width, images[iImage]->height, rects[iImage]))
+			{
+				rects.clear();
+				return false;
+			}
+		}
+
+		// Pages start out transparent black.
+		pages.resize(packer.GetNumPages(), Image(settings.pageSize, settings.pageSize));
+
+		const unsigned int gutter = packer.GetGutter();
+		for (size_t iImage = 0; iImage < images.size(); ++iImage)
+		{
+			const AtlasRect &rect = rects[iImage];
+			uint32_t *pTarget = pages[rect.page].GetRow(rect.Y - gutter) + (rect.X - gutter);
+			BlitWithGutter(*images[iImage], gutter, pTarget, settings.pageSize);
+		}
+
+		if (nullptr != pStats)
+		{
+			pStats->numImages = (unsigned int) images.size();
+			pStats->numPages = packer.GetNumPages();
+			pStats->fillRate = packer.GetFillRate();
+		}
+
+		return true;
+	}
+
+	/*
+		Runtime.
+	*/
+
+	TextureAtlas::TextureAtlas(const AtlasSettings &settings /* = AtlasSettings() */) :
+		m_settings(settings)
+		, m_packer(settings)
+		, m_numImages(0)
+	{
+	}
+
+	bool TextureAtlas::Add(const Image &image, D3D::SpriteFrame &frame)
+	{
+		AtlasRect rect;
+		if (false == m_packer.Insert(image.width, image.height, rect))
+			return false;
+
+		if (m_pages.size() == rect.page)
+		{
+			const bool hasMips = m_settings.numMipLevels > 1;
+
+			// Unused areas are never sampled, so there's no need to clear it.
+			D3D11_TEXTURE2D_DESC desc;
+			memset(&desc, 0, sizeof(desc));
+			desc.Width = m_settings.pageSize;
+			desc.Height = m_settings.pageSize;
+			desc.MipLevels = m_settings.numMipLevels;
+			desc.ArraySize = 1;
+			desc.Format = (m_settings.isSRGB) ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+			desc.SampleDesc.Count = 1;
+			desc.Usage = D3D11_USAGE_DEFAULT;
+			desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | ((hasMips) ? D3D11_BIND_RENDER_TARGET : 0);
+			desc.MiscFlags = (hasMips) ? D3D11_RESOURCE_MISC_GENERATE_MIPS : 0;
+
+			ComPtr<ID3D11Texture2D> texture;
+			ComPtr<ID3D11ShaderResourceView> shaderView;
+			if (FAILED(D3D::GetDevice()->CreateTexture2D(&desc, nullptr, &texture)) ||
+				FAILED(D3D::GetDevice()->CreateShaderResourceView(texture.Get(), nullptr, &shaderView)))
+			{
+				// Or the packer would be a page ahead, and later images would go on it.
+				m_packer.RemoveLastPage(rect);
+
+				SetLastError("Can not create texture atlas page.");
+				return false;
+			}
+
+			m_pages.push_back(D3D::Texture::Ptr(new D3D::Texture(texture.Detach(), shaderView.Detach())));
+			m_isDirty.push_back(false);
+		}
+
+		// Upload, gutter included.
+		const unsigned int gutter = m_packer.GetGutter();
+		const unsigned int width = image.width + 2*gutter, height = image.height + 2*gutter;
+		std::vector<uint32_t> pixels(width*height);
+		BlitWithGutter(image, gutter, pixels.data(), width);
+
+		D3D11_BOX box;
+		box.left = rect.X - gutter;
+		box.top = rect.Y - gutter;
+		box.front = 0;
+		box.right = box.left + width;
+		box.bottom = box.top + height;
+		box.back = 1;
+		D3D::GetContext()->UpdateSubresource(m_pages[rect.page]->GetTexture(), 0, &box, pixels.data(), width*sizeof(uint32_t), 0);
+		m_isDirty[rect.page] = true;
+
+		frame.pTexture = m_pages[rect.page].get();
+		frame.UVs = GetAtlasUVs(rect, m_settings.pageSize);
+
+		++m_numImages;
+		return true;
+	}
+
+	void TextureAtlas::Update()
+	{
+		for (size_t iPage = 0; iPage < m_pages.size(); ++iPage)
+		{
+			if (true == m_isDirty[iPage] && m_settings.numMipLevels > 1)
+				D3D::GetContext()->GenerateMips(m_pages[iPage]->GetShaderView());
+
+			m_isDirty[iPage] = false;
+		}
+	}
+
+	const AtlasStats TextureAtlas::GetStats() const
+	{
+		AtlasStats stats;
+		stats.numImages = m_numImages;
+		stats.numPages = m_packer.GetNumPages();
+		stats.fillRate = m_packer.GetFillRate();
+		return stats;
+	}
+}
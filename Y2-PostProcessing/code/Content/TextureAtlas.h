@@ -0,0 +1,125 @@
+/*
+	Year 2 Direct3D 11 workshop template.
+	Content - Texture atlas packing (skyline, bottom-left), offline & at runtime.
+
+	Each image gets a gutter of replicated edge pixels, so bilinear filtering doesn't pick up its neighbours.
+	To keep the first N mip levels free of bleeding too, rectangles are aligned to (and gutters rounded up to)
+	2^(N-1) pixels: at level N-1 every image then still starts on a texel edge with at least a texel of gutter.
+*/
+
+#if !defined(TEXTURE_ATLAS_H)
+#define TEXTURE_ATLAS_H
+
+#include "Image.h"
+
+namespace Content
+{
+	struct AtlasSettings
+	{
+		AtlasSettings() :
+			pageSize(2048), gutter(2), padding(0), numMipLevels(1), isSRGB(true) {}
+
+		unsigned int pageSize;     // Square pages.
+		unsigned int gutter;       // Replicated edge pixels around each image.
+		unsigned int padding;      // Additional empty pixels between images.
+		unsigned int numMipLevels; // Levels that must not bleed (and the number of levels runtime pages get).
+		bool isSRGB;               // Runtime pages only.
+	};
+
+	// Image area (gutter excluded) within a page.
+	struct AtlasRect
+	{
+		unsigned int page;
+		unsigned int X, Y, width, height;
+	};
+
+	// (left, top, right, bottom) texture coordinates, as used by D3D::SpriteBatcher.
+	const Vector4 GetAtlasUVs(const AtlasRect &rect, unsigned int pageSize);
+
+	// A single page.
+	class SkylinePacker
+	{
+	public:
+		SkylinePacker(unsigned int width, unsigned int height);
+
+		// Lowest (then leftmost) spot with the least wasted area underneath.
+		bool Insert(unsigned int width, unsigned int height, unsigned int &X, unsigned int &Y);
+
+	private:
+		struct Segment
+		{
+			unsigned int X, Y, width;
+		};
+
+		bool Fit(size_t iSegment, unsigned int width, unsigned int height, unsigned int &Y, unsigned int &waste) const;
+
+		const unsigned int m_width, m_height;
+		std::vector<Segment> m_skyline;
+	};
+
+	// Pages are opened as needed.
+	class AtlasPacker
+	{
+	public:
+		AtlasPacker(const AtlasSettings &settings);
+
+		// Fails only if the image (plus gutter) doesn't fit an empty page.
+		bool Insert(unsigned int width, unsigned int height, AtlasRect &rect);
+
+		// Takes back the last Insert() if it opened a new page ('rect' is what it returned): for when that page can't be created.
+		void RemoveLastPage(const AtlasRect &rect);
+
+		unsigned int GetGutter() const { return m_gutter; }
+		unsigned int GetNumPages() const { return (unsigned int) m_pages.size(); }
+
+		// Image area over page area (gutters & padding count as waste).
+		float GetFillRate() const;
+
+	private:
+		const AtlasSettings m_settings;
+		unsigned int m_gutter, m_alignment;
+		std::vector<SkylinePacker> m_pages;
+		uint64_t m_usedArea;
+	};
+
+	struct AtlasStats
+	{
+		unsigned int numImages, numPages;
+		float fillRate;
+
+		// Texture switches saved, worst case (all images drawn interleaved): one per image, down to one per page.
+		unsigned int GetNumDrawCallsSaved() const { return numImages - numPages; }
+	};
+
+	// Offline: packs all images (largest first, for a better fill rate) into pages; clears 'pages' & 'rects'.
+	// Generate mip levels from the pages (up to settings.numMipLevels) as you would for any texture.
+	bool BuildAtlas(const std::vector<const Image *> &images, const AtlasSettings &settings,
+		std::vector<Image> &pages, std::vector<AtlasRect> &rects, AtlasStats *pStats = nullptr);
+
+	// Runtime: images are uploaded as they're added (i.e. loaded), into R8G8B8A8 pages.
+	class TextureAtlas : public boost::noncopyable
+	{
+	public:
+		typedef std::unique_ptr<TextureAtlas> Ptr;
+
+		TextureAtlas(const AtlasSettings &settings = AtlasSettings());
+		~TextureAtlas() {}
+
+		// The frame can be passed to D3D::SpriteBatcher::Add() as-is; it stays valid as long as the atlas lives.
+		bool Add(const Image &image, D3D::SpriteFrame &frame);
+
+		// Regenerates mip levels of pages that were added to; call before drawing.
+		void Update();
+
+		const AtlasStats GetStats() const;
+
+	private:
+		const AtlasSettings m_settings;
+		AtlasPacker m_packer;
+		std::vector<D3D::Texture::Ptr> m_pages;
+		std::vector<bool> m_isDirty;
+		unsigned int m_numImages;
+	};
+}
+
+#endif // TEXTURE_ATLAS_H
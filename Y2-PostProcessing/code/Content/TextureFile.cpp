@@ -0,0 +1,439 @@
+/*
+	Year 2 Direct3D 11 workshop template.
+	Content - DDS & KTX (1.1) texture loading.
+
+	Supported: 2D textures, arrays & cube maps in 8-bit (s)RGBA/BGRA, R8, R8G8, a few HDR formats and BC1-7.
+	Volume textures and big-endian KTX files are rejected.
+*/
+
+#include "../Platform.h"
+#include "../D3D.h"
+#include "MipChain.h" // For GetNumMipLevels().
+#include "TextureFile.h"
+
+namespace Content
+{
+	/*
+		DDS.
+	*/
+
+	const uint32_t kDDSMagic = 0x20534444; // "DDS "
+
+	struct DDSPixelFormat
+	{
+		uint32_t size, flags, fourCC, RGBBitCount;
+		uint32_t RMask, GMask, BMask, AMask;
+	};
+
+	struct DDSHeader
+	{
+		uint32_t size, flags, height, width, pitchOrLinearSize, depth, mipMapCount;
+		uint32_t reserved1[11];
+		DDSPixelFormat pixelFormat;
+		uint32_t caps, caps2, caps3, caps4, reserved2;
+	};
+
+	struct DDSHeaderDX10
+	{
+		uint32_t DXGIFormat, resourceDimension, miscFlag, arraySize, miscFlags2;
+	};
+
+	const uint32_t kDDPFFourCC = 0x4;
+	const uint32_t kDDPFRGB = 0x40;
+	const uint32_t kDDSCaps2Cubemap = 0x200;
+	const uint32_t kDDSCaps2Volume = 0x200000;
+	const uint32_t kDDSDimensionTexture2D = 3;
+
+	static uint32_t FourCC(char A, char B, char C, char D)
+	{
+		return (uint32_t) A | ((uint32_t) B << 8) | ((uint32_t) C << 16) | ((uint32_t) D << 24);
+	}
+
+	static DXGI_FORMAT GetLegacyDDSFormat(const DDSPixelFormat &pixelFormat)
+	{
+		if (pixelFormat.flags & kDDPFFourCC)
+		{
+			const uint32_t fourCC = pixelFormat.fourCC;
+			if (FourCC('D', 'X', 'T', '1') == fourCC) return DXGI_FORMAT_BC1_UNORM;
+			if (FourCC('D', 'X', 'T', '3') == fourCC) return DXGI_FORMAT_BC2_UNORM;
+			if (FourCC('D', 'X', 'T', '5') == fourCC) return DXGI_FORMAT_BC3_UNORM;
+			if (FourCC('A', 'T', 'I', '1') == fourCC || FourCC('B', 'C', '4', 'U') == fourCC) return DXGI_FORMAT_BC4_UNORM;
+			if (FourCC('A', 'T', 'I', '2') == fourCC || FourCC('B', 'C', '5', 'U') == fourCC) return DXGI_FORMAT_BC5_UNORM;
+			if (113 == fourCC) return DXGI_FORMAT_R16G16B16A16_FLOAT; // D3DFMT_A16B16G16R16F
+			if (116 == fourCC) return DXGI_FORMAT_R32G32B32A32_FLOAT; // D3DFMT_A32B32G32R32F
+		}
+		else if ((pixelFormat.flags & kDDPFRGB) && 32 == pixelFormat.RGBBitCount)
+		{
+			if (0x000000ff == pixelFormat.RMask && 0x0000ff00 == pixelFormat.GMask && 0x00ff0000 == pixelFormat.BMask) return DXGI_FORMAT_R8G8B8A8_UNORM;
+			if (0x00ff0000 == pixelFormat.RMask && 0x0000ff00 == pixelFormat.GMask && 0x000000ff == pixelFormat.BMask) return DXGI_FORMAT_B8G8R8A8_UNORM;
+		}
+
+		return DXGI_FORMAT_UNKNOWN;
+	}
+
+	/*
+		KTX (1.1, little endian only).
+	*/
+
+	static const uint8_t kKTXIdentifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+	const uint32_t kKTXEndianness = 0x04030201;
+
+	struct KTXHeader
+	{
+		uint8_t identifier[12];
+		uint32_t endianness;
+		uint32_t glType, glTypeSize, glFormat, glInternalFormat, glBaseInternalFormat;
+		uint32_t pixelWidth, pixelHeight, pixelDepth;
+		uint32_t numberOfArrayElements, numberOfFaces, numberOfMipmapLevels;
+		uint32_t bytesOfKeyValueData;
+	};
+
+	static DXGI_FORMAT GetKTXFormat(uint32_t glInternalFormat)
+	{
+		switch (glInternalFormat)
+		{
+		case 0x8058: return DXGI_FORMAT_R8G8B8A8_UNORM;      // GL_RGBA8
+		case 0x8C43: return DXGI_FORMAT_R8G8B8A8_UNORM_SRGB; // GL_SRGB8_ALPHA8
+		case 0x8229: return DXGI_FORMAT_R8_UNORM;            // GL_R8
+		case 0x822B: return DXGI_FORMAT_R8G8_UNORM;          // GL_RG8
+		case 0x881A: return DXGI_FORMAT_R16G16B16A16_FLOAT;  // GL_RGBA16F
+		case 0x8814: return DXGI_FORMAT_R32G32B32A32_FLOAT;  // GL_RGBA32F
+		case 0x83F0:                                         // GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+		case 0x83F1: return DXGI_FORMAT_BC1_UNORM;           // GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+		case 0x8C4C:                                         // GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+		case 0x8C4D: return DXGI_FORMAT_BC1_UNORM_SRGB;      // GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT
+		case 0x83F2: return DXGI_FORMAT_BC2_UNORM;           // GL_COMPRESSED_RGBA_S3TC_DXT3_EXT
+		case 0x83F3: return DXGI_FORMAT_BC3_UNORM;           // GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+		case 0x8C4F: return DXGI_FORMAT_BC3_UNORM_SRGB;      // GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+		case 0x8DBB: return DXGI_FORMAT_BC4_UNORM;           // GL_COMPRESSED_RED_RGTC1
+		case 0x8DBD: return DXGI_FORMAT_BC5_UNORM;           // GL_COMPRESSED_RG_RGTC2
+		case 0x8E8C: return DXGI_FORMAT_BC7_UNORM;           // GL_COMPRESSED_RGBA_BPTC_UNORM
+		case 0x8E8D: return DXGI_FORMAT_BC7_UNORM_SRGB;      // GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM
+		default:     return DXGI_FORMAT_UNKNOWN;
+		}
+	}
+
+	/*
+		Shared.
+	*/
+
+	bool GetFormatBlockInfo(DXGI_FORMAT format, unsigned int &blockDim, unsigned int &blockBytes)
+	{
+		blockDim = 1;
+		switch (format)
+		{
+		case DXGI_FORMAT_R8_UNORM:
+			blockBytes = 1;
+			return true;
+
+		case DXGI_FORMAT_R8G8_UNORM:
+			blockBytes = 2;
+			return true;
+
+		case DXGI_FORMAT_R8G8B8A8_UNORM:
+		case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+		case DXGI_FORMAT_B8G8R8A8_UNORM:
+		case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+		case DXGI_FORMAT_R10G10B10A2_UNORM:
+		case DXGI_FORMAT_R11G11B10_FLOAT:
+			blockBytes = 4;
+			return true;
+
+		case DXGI_FORMAT_R16G16B16A16_FLOAT:
+			blockBytes = 8;
+			return true;
+
+		case DXGI_FORMAT_R32G32B32A32_FLOAT:
+			blockBytes = 16;
+			return true;
+
+		case DXGI_FORMAT_BC1_UNORM:
+		case DXGI_FORMAT_BC1_UNORM_SRGB:
+		case DXGI_FORMAT_BC4_UNORM:
+			blockDim = 4;
+			blockBytes = 8;
+			return true;
+
+		case DXGI_FORMAT_BC2_UNORM:
+		case DXGI_FORMAT_BC3_UNORM:
+		case DXGI_FORMAT_BC3_UNORM_SRGB:
+		case DXGI_FORMAT_BC5_UNORM:
+		case DXGI_FORMAT_BC6H_UF16:
+		case DXGI_FORMAT_BC7_UNORM:
+		case DXGI_FORMAT_BC7_UNORM_SRGB:
+			blockDim = 4;
+			blockBytes = 16;
+			return true;
+
+		default:
+			return false;
+		}
+	}
+
+	static void InitializeDesc(D3D11_TEXTURE2D_DESC &desc, DXGI_FORMAT format, unsigned int width, unsigned int height, unsigned int mipLevels, unsigned int arraySize, bool isCube)
+	{
+		desc.Width = width;
+		desc.Height = height;
+		desc.MipLevels = std::max<unsigned int>(1, mipLevels);
+		desc.ArraySize = arraySize;
+		desc.Format = format;
+		desc.SampleDesc.Count = 1;
+		desc.SampleDesc.Quality = 0;
+		desc.Usage = D3D11_USAGE_IMMUTABLE;
+		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		desc.CPUAccessFlags = 0;
+		desc.MiscFlags = (isCube) ? D3D11_RESOURCE_MISC_TEXTURECUBE : 0;
+	}
+
+	// Array size in faces (6 per cube), as taken from the header: checked before it's narrowed into a desc.
+	static bool ValidateArraySize(uint64_t arraySize)
+	{
+		if (0 == arraySize || arraySize > D3D11_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION)
+		{
+			SetLastError("Texture file: invalid array size.");
+			return false;
+		}
+
+		return true;
+	}
+
+	static bool ValidateDesc(const D3D11_TEXTURE2D_DESC &desc)
+	{
+		unsigned int blockDim, blockBytes;
+		if (false == GetFormatBlockInfo(desc.Format, blockDim, blockBytes))
+		{
+			SetLastError("Texture file: unsupported pixel format.");
+			return false;
+		}
+
+		const bool isCube = 0 != (desc.MiscFlags & D3D11_RESOURCE_MISC_TEXTURECUBE);
+		const unsigned int maxDimension = (isCube) ? D3D11_REQ_TEXTURECUBE_DIMENSION : D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION;
+		if (0 == desc.Width || 0 == desc.Height || desc.Width > maxDimension || desc.Height > maxDimension ||
+			desc.MipLevels > GetNumMipLevels(desc.Width, desc.Height))
+		{
+			SetLastError("Texture file: invalid dimensions.");
+			return false;
+		}
+
+		return true;
+	}
+
+	// Sizes the subresource list, after checking the file could hold them at all (each takes at least a block).
+	static bool ReserveSubresources(TextureLayout &layout, size_t size, uint64_t offset)
+	{
+		unsigned int blockDim, blockBytes;
+		VERIFY(GetFormatBlockInfo(layout.desc.Format, blockDim, blockBytes));
+
+		const uint64_t numSubresources = (uint64_t) layout.desc.ArraySize*layout.desc.MipLevels;
+		if (offset > size || numSubresources*blockBytes > size - offset)
+		{
+			SetLastError("Texture file: truncated.");
+			return false;
+		}
+
+		layout.subresources.resize((size_t) numSubresources);
+		return true;
+	}
+
+	// Describes one subresource at 'offset'; checks it lies within the file.
+	static bool AddSubresource(TextureLayout &layout, const uint8_t *pData, size_t size, uint64_t &offset, unsigned int mip, unsigned int rowAlignment, unsigned int subresource)
+	{
+		unsigned int blockDim, blockBytes;
+		VERIFY(GetFormatBlockInfo(layout.desc.Format, blockDim, blockBytes));
+
+		const unsigned int width = std::max<unsigned int>(1, layout.desc.Width >> mip);
+		const unsigned int height = std::max<unsigned int>(1, layout.desc.Height >> mip);
+		const uint64_t rowPitch = ((uint64_t) (width+blockDim-1)/blockDim*blockBytes + rowAlignment-1) & ~(uint64_t) (rowAlignment-1);
+		const uint64_t slicePitch = rowPitch*((height+blockDim-1)/blockDim);
+
+		if (offset + slicePitch > size)
+		{
+			SetLastError("Texture file: truncated.");
+			return false;
+		}
+
+		D3D11_SUBRESOURCE_DATA &data = layout.subresources[subresource];
+		data.pSysMem = pData + offset;
+		data.SysMemPitch = (UINT) rowPitch;
+		data.SysMemSlicePitch = (UINT) slicePitch;
+
+		offset += slicePitch;
+		return true;
+	}
+
+	static bool ParseDDS(const uint8_t *pData, size_t size, TextureLayout &layout)
+	{
+		if (size < 4 + sizeof(DDSHeader))
+		{
+			SetLastError("DDS: truncated header.");
+			return false;
+		}
+
+		const DDSHeader &header = *reinterpret_cast<const DDSHeader *>(pData + 4);
+		if (sizeof(DDSHeader) != header.size || sizeof(DDSPixelFormat) != header.pixelFormat.size)
+		{
+			SetLastError("DDS: invalid header.");
+			return false;
+		}
+
+		uint64_t offset = 4 + sizeof(DDSHeader);
+		DXGI_FORMAT format;
+		uint64_t arraySize = 1;
+		bool isCube = false;
+
+		if ((header.pixelFormat.flags & kDDPFFourCC) && FourCC('D', 'X', '1', '0') == header.pixelFormat.fourCC)
+		{
+			if (size < offset + sizeof(DDSHeaderDX10))
+			{
+				SetLastError("DDS: truncated header.");
+				return false;
+			}
+
+			const DDSHeaderDX10 &headerDX10 = *reinterpret_cast<const DDSHeaderDX10 *>(pData + offset);
+			offset += sizeof(DDSHeaderDX10);
+
+			if (kDDSDimensionTexture2D != headerDX10.resourceDimension)
+			{
+				SetLastError("DDS: only 2D textures are supported.");
+				return false;
+			}
+
+			format = (DXGI_FORMAT) headerDX10.DXGIFormat;
+			isCube = 0 != (headerDX10.miscFlag & D3D11_RESOURCE_MISC_TEXTURECUBE);
+			arraySize = (uint64_t) headerDX10.arraySize*((isCube) ? 6 : 1);
+		}
+		else
+		{
+			if (header.caps2 & kDDSCaps2Volume)
+			{
+				SetLastError("DDS: volume textures are not supported.");
+				return false;
+			}
+
+			format = GetLegacyDDSFormat(header.pixelFormat);
+			isCube = 0 != (header.caps2 & kDDSCaps2Cubemap);
+			arraySize = (isCube) ? 6 : 1;
+		}
+
+		if (false == ValidateArraySize(arraySize))
+			return false;
+
+		InitializeDesc(layout.desc, format, header.width, header.height, header.mipMapCount, (unsigned int) arraySize, isCube);
+		if (false == ValidateDesc(layout.desc) || false == ReserveSubresources(layout, size, offset))
+			return false;
+
+		// Slice by slice, each with it's full mip chain (which happens to be D3D subresource order).
+		const unsigned int numMips = layout.desc.MipLevels;
+		for (unsigned int iSlice = 0; iSlice < layout.desc.ArraySize; ++iSlice)
+			for (unsigned int iMip = 0; iMip < numMips; ++iMip)
+				if (false == AddSubresource(layout, pData, size, offset, iMip, 1, iSlice*numMips + iMip))
+					return false;
+
+		return true;
+	}
+
+	static bool ParseKTX(const uint8_t *pData, size_t size, TextureLayout &layout)
+	{
+		if (size < sizeof(KTXHeader))
+		{
+			SetLastError("KTX: truncated header.");
+			return false;
+		}
+
+		const KTXHeader &header = *reinterpret_cast<const KTXHeader *>(pData);
+		if (kKTXEndianness != header.endianness)
+		{
+			SetLastError("KTX: big endian files are not supported.");
+			return false;
+		}
+
+		if (header.pixelDepth > 1 || (1 != header.numberOfFaces && 6 != header.numberOfFaces))
+		{
+			SetLastError("KTX: only 2D textures, arrays & cube maps are supported.");
+			return false;
+		}
+
+		const bool isCube = 6 == header.numberOfFaces;
+		const uint64_t numElements = std::max<unsigned int>(1, header.numberOfArrayElements);
+		if (false == ValidateArraySize(numElements*header.numberOfFaces))
+			return false;
+
+		const unsigned int arraySize = (unsigned int) numElements*header.numberOfFaces;
+		InitializeDesc(layout.desc, GetKTXFormat(header.glInternalFormat), header.pixelWidth, std::max<unsigned int>(1, header.pixelHeight), header.numberOfMipmapLevels, arraySize, isCube);
+
+		uint64_t offset = sizeof(KTXHeader) + header.bytesOfKeyValueData;
+		if (false == ValidateDesc(layout.desc) || false == ReserveSubresources(layout, size, offset))
+			return false;
+
+		// Uncompressed rows are 4-byte aligned (GL_UNPACK_ALIGNMENT).
+		unsigned int blockDim, blockBytes;
+		VERIFY(GetFormatBlockInfo(layout.desc.Format, blockDim, blockBytes));
+		const unsigned int rowAlignment = (1 == blockDim) ? 4 : 1;
+
+		// Mip by mip, preceded by it's size, each containing all elements & faces (padded to 4 bytes).
+		const unsigned int numMips = layout.desc.MipLevels;
+		for (unsigned int iMip = 0; iMip < numMips; ++iMip)
+		{
+			offset += sizeof(uint32_t); // imageSize
+			for (unsigned int iSlice = 0; iSlice < arraySize; ++iSlice)
+			{
+				if (false == AddSubresource(layout, pData, size, offset, iMip, rowAlignment, iSlice*numMips + iMip))
+					return false;
+
+				offset = (offset+3) & ~3ull;
+			}
+		}
+
+		return true;
+	}
+
+	bool ParseTextureFile(const uint8_t *pData, size_t size, TextureLayout &layout)
+	{
+		ASSERT(nullptr != pData);
+
+		if (size >= 4 && kDDSMagic == *reinterpret_cast<const uint32_t *>(pData))
+			return ParseDDS(pData, size, layout);
+
+		if (size >= sizeof(kKTXIdentifier) && 0 == memcmp(pData, kKTXIdentifier, sizeof(kKTXIdentifier)))
+			return ParseKTX(pData, size, layout);
+
+		SetLastError("Texture file: not a DDS or KTX file.");
+		return false;
+	}
+
+	bool ReadTextureFile(const std::string &path, TextureFile &file)
+	{
+		return true == ReadResource(path, file.data) && true == ParseTextureFile(file.data.GetData(), file.data.GetSize(), file.layout);
+	}
+
+	D3D::Texture *CreateTexture(const TextureFile &file, const std::string &path)
+	{
+		const TextureLayout &layout = file.layout;
+
+		// The driver reads (and thus faults in) the mapped pages directly, unless the archive entry was compressed.
+		ComPtr<ID3D11Texture2D> texture;
+		if (FAILED(D3D::GetDevice()->CreateTexture2D(&layout.desc, layout.subresources.data(), &texture)))
+		{
+			SetLastError("Can not create texture: " + path);
+			return nullptr;
+		}
+
+		ComPtr<ID3D11ShaderResourceView> shaderView;
+		if (FAILED(D3D::GetDevice()->CreateShaderResourceView(texture.Get(), nullptr, &shaderView)))
+		{
+			SetLastError("Can not create shader resource view: " + path);
+			return nullptr;
+		}
+
+		return new D3D::Texture(texture.Detach(), shaderView.Detach());
+	}
+
+	D3D::Texture *LoadTexture(const std::string &path)
+	{
+		TextureFile file;
+		if (false == ReadTextureFile(path, file))
+			return nullptr;
+
+		return CreateTexture(file, path);
+	}
+}
@@ -0,0 +1,45 @@
+/*
+	Year 2 Direct3D 11 workshop template.
+	Content - DDS & KTX (1.1) texture loading.
+
+	Files (or stored archive entries) are memory mapped and checked in place; the subresources handed to
+	CreateTexture2D() point straight into the mapping, so texel data is never copied on our side.
+*/
+
+#if !defined(TEXTURE_FILE_H)
+#define TEXTURE_FILE_H
+
+#include "Archive.h"
+
+namespace Content
+{
+	// A file's contents: Direct3D description and subresources (in D3D order: mip + slice*MipLevels).
+	// The subresources point into the file's memory, so keep the file mapped for as long as you use them.
+	struct TextureLayout
+	{
+		D3D11_TEXTURE2D_DESC desc;
+		std::vector<D3D11_SUBRESOURCE_DATA> subresources;
+	};
+
+	// Block dimension (1 for plain formats, 4 for BCn) and bytes per block (or pixel); false if not supported.
+	bool GetFormatBlockInfo(DXGI_FORMAT format, unsigned int &blockDim, unsigned int &blockBytes);
+
+	// Validates a DDS or KTX file in place and describes it.
+	bool ParseTextureFile(const uint8_t *pData, size_t size, TextureLayout &layout);
+
+	// A file read & parsed, ready for CreateTexture().
+	struct TextureFile : public boost::noncopyable
+	{
+		ResourceData data;
+		TextureLayout layout;
+	};
+
+	// LoadTexture() in two steps, so the first can run on a loader thread (see AsyncLoad.h).
+	bool ReadTextureFile(const std::string &path, TextureFile &file);
+	D3D::Texture *CreateTexture(const TextureFile &file, const std::string &path);
+
+	// Reads (see ReadResource()), parses & creates an immutable texture; returns nullptr on failure (see SetLastError()).
+	D3D::Texture *LoadTexture(const std::string &path);
+}
+
+#endif // TEXTURE_FILE_H
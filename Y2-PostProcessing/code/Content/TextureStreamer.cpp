@@ -0,0 +1,326 @@
+/*
+	Year 2 Direct3D 11 workshop template.
+	Content - Texture streaming: low mips always resident, higher ones loaded on demand within a memory budget.
+*/
+
+#include "../Platform.h"
+#include "../D3D.h"
+#include "AsyncLoad.h"
+#include "TextureStreamer.h"
+
+namespace Content
+{
+	static unsigned int GetMipSize(unsigned int size, unsigned int mip)
+	{
+		return std::max<unsigned int>(size >> mip, 1);
+	}
+
+	// Bytes taken by mips [topMip, MipLevels) of all slices.
+	static uint64_t GetSize(const D3D11_TEXTURE2D_DESC &desc, unsigned int topMip)
+	{
+		unsigned int blockDim, blockBytes;
+		VERIFY(true == GetFormatBlockInfo(desc.Format, blockDim, blockBytes));
+
+		uint64_t size = 0;
+		for (unsigned int iMip = topMip; iMip < desc.MipLevels; ++iMip)
+		{
+			const uint64_t numBlocksX = (GetMipSize(desc.Width, iMip) + blockDim-1)/blockDim;
+			const uint64_t numBlocksY = (GetMipSize(desc.Height, iMip) + blockDim-1)/blockDim;
+			size += numBlocksX*numBlocksY*blockBytes;
+		}
+
+		return size*desc.ArraySize;
+	}
+
+	// Block compressed textures must have a top level that's a whole number of blocks.
+	static bool IsValidTopMip(const D3D11_TEXTURE2D_DESC &desc, unsigned int topMip)
+	{
+		unsigned int blockDim, blockBytes;
+		VERIFY(true == GetFormatBlockInfo(desc.Format, blockDim, blockBytes));
+		return 0 == topMip || (0 == GetMipSize(desc.Width, topMip) % blockDim && 0 == GetMipSize(desc.Height, topMip) % blockDim);
+	}
+
+	static D3D11_TEXTURE2D_DESC GetTopDesc(const D3D11_TEXTURE2D_DESC &desc, unsigned int topMip)
+	{
+		D3D11_TEXTURE2D_DESC topDesc = desc;
+		topDesc.Width = GetMipSize(desc.Width, topMip);
+		topDesc.Height = GetMipSize(desc.Height, topMip);
+		topDesc.MipLevels = desc.MipLevels - topMip;
+		return topDesc;
+	}
+
+	static D3D::Texture *CreateTexture(ID3D11Texture2D *pTexture, const std::string &path)
+	{
+		ComPtr<ID3D11ShaderResourceView> shaderView;
+		if (FAILED(D3D::GetDevice()->CreateShaderResourceView(pTexture, nullptr, &shaderView)))
+		{
+			SAFE_RELEASE(pTexture);
+			SetLastError("Can not create shader resource view: " + path);
+			return nullptr;
+		}
+
+		return new D3D::Texture(pTexture, shaderView.Detach());
+	}
+
+	// Mips [topMip, MipLevels) straight from the file.
+	static D3D::Texture *CreateFromFile(const TextureFile &file, unsigned int topMip, const std::string &path)
+	{
+		const D3D11_TEXTURE2D_DESC &fullDesc = file.layout.desc;
+		const D3D11_TEXTURE2D_DESC desc = GetTopDesc(fullDesc, topMip);
+
+		std::vector<D3D11_SUBRESOURCE_DATA> subresources;
+		for (unsigned int iSlice = 0; iSlice < fullDesc.ArraySize; ++iSlice)
+		{
+			for (unsigned int iMip = topMip; iMip < fullDesc.MipLevels; ++iMip)
+				subresources.push_back(file.layout.subresources[iMip + iSlice*fullDesc.MipLevels]);
+		}
+
+		ID3D11Texture2D *pTexture;
+		if (FAILED(D3D::GetDevice()->CreateTexture2D(&desc, subresources.data(), &pTexture)))
+		{
+			SetLastError("Can not create texture: " + path);
+			return nullptr;
+		}
+
+		return CreateTexture(pTexture, path);
+	}
+
+	void StreamedTexture::Touch(float screenSize)
+	{
+		m_screenSize = std::max<float>(m_screenSize, screenSize);
+	}
+
+	/*
+		TextureStreamer.
+	*/
+
+	TextureStreamer::TextureStreamer(const StreamingSettings &settings /* = StreamingSettings() */) :
+		m_settings(settings)
+		, m_frame(0)
+		, m_residentBytes(0)
+		, m_numPending(0)
+	{
+		memset(&m_stats, 0, sizeof(m_stats));
+		memset(&m_frameStats, 0, sizeof(m_frameStats));
+	}
+
+	TextureStreamer::~TextureStreamer()
+	{
+		// Loads in flight point to us.
+		if (0 != m_numPending)
+			WaitForAsyncLoads();
+
+		ASSERT(0 == m_numPending);
+	}
+
+	StreamedTexture *TextureStreamer::Add(const std::string &path)
+	{
+		TextureFile file;
+		if (false == ReadTextureFile(path, file))
+			return nullptr;
+
+		const D3D11_TEXTURE2D_DESC &desc = file.layout.desc;
+		const unsigned int size = std::max<unsigned int>(desc.Width, desc.Height);
+
+		unsigned int baseMip = 0;
+		while (baseMip+1 < desc.MipLevels && GetMipSize(size, baseMip) > m_settings.residentSize)
+			++baseMip;
+
+		while (false == IsValidTopMip(desc, baseMip))
+			--baseMip;
+
+		std::unique_ptr<StreamedTexture> texture(new StreamedTexture());
+		texture->m_texture.reset(CreateFromFile(file, baseMip, path));
+		if (nullptr == texture->m_texture)
+			return nullptr;
+
+		texture->m_path = path;
+		texture->m_desc = desc;
+		texture->m_residentMip = baseMip;
+		texture->m_baseMip = baseMip;
+		texture->m_wantedMip = baseMip;
+		texture->m_size = GetSize(desc, baseMip);
+		texture->m_screenSize = 0.f;
+		texture->m_lastUsedFrame = m_frame;
+		texture->m_isPending = false;
+		texture->m_isFailed = false;
+
+		m_residentBytes += texture->m_size;
+		m_textures.push_back(std::move(texture));
+		return m_textures.back().get();
+	}
+
+	void TextureStreamer::Update()
+	{
+		// What's wanted & what needs loading for it.
+		std::vector<StreamedTexture *> requests;
+		for (auto &texture : m_textures)
+		{
+			if (0.f == texture->m_screenSize)
+				continue;
+
+			const D3D11_TEXTURE2D_DESC &desc = texture->m_desc;
+			const unsigned int size = std::max<unsigned int>(desc.Width, desc.Height);
+
+			unsigned int wantedMip = texture->m_baseMip;
+			while (wantedMip > 0 && GetMipSize(size, wantedMip) < texture->m_screenSize)
+				--wantedMip;
+
+			while (false == IsValidTopMip(desc, wantedMip))
+				--wantedMip;
+
+			texture->m_wantedMip = wantedMip;
+			texture->m_lastUsedFrame = m_frame;
+
+			if (wantedMip < texture->m_residentMip && false == texture->m_isPending && false == texture->m_isFailed)
+				requests.push_back(texture.get());
+		}
+
+		// Largest on screen first.
+		std::sort(requests.begin(), requests.end(), [](const StreamedTexture *pA, const StreamedTexture *pB) { return pA->m_screenSize > pB->m_screenSize; });
+
+		for (StreamedTexture *pTexture : requests)
+		{
+			if (m_numPending >= m_settings.maxLoadsInFlight)
+				break;
+
+			// If it won't fit, a smaller one further down might.
+			const uint64_t size = GetSize(pTexture->m_desc, pTexture->m_wantedMip);
+			if (m_residentBytes + size > m_settings.budget && false == EvictFor(*pTexture, size))
+				continue;
+
+			Load(*pTexture, pTexture->m_wantedMip);
+		}
+
+		for (auto &texture : m_textures)
+			texture->m_screenSize = 0.f;
+
+		m_frameStats = m_stats;
+		m_frameStats.budget = m_settings.budget;
+		m_frameStats.residentBytes = m_residentBytes;
+		m_frameStats.numTextures = (unsigned int) m_textures.size();
+		m_frameStats.numPending = m_numPending;
+
+		memset(&m_stats, 0, sizeof(m_stats));
+		++m_frame;
+	}
+
+	// Least we can go down to right now.
+	unsigned int TextureStreamer::GetKeepMip(const StreamedTexture &texture) const
+	{
+		return (m_frame == texture.m_lastUsedFrame) ? texture.m_wantedMip : texture.m_baseMip;
+	}
+
+	bool TextureStreamer::Trim(StreamedTexture &texture, unsigned int topMip)
+	{
+		ASSERT(topMip > texture.m_residentMip && false == texture.m_isPending);
+
+		D3D11_TEXTURE2D_DESC desc = GetTopDesc(texture.m_desc, topMip);
+		desc.Usage = D3D11_USAGE_DEFAULT;
+
+		ID3D11Texture2D *pTexture;
+		if (FAILED(D3D::GetDevice()->CreateTexture2D(&desc, nullptr, &pTexture)))
+		{
+			SetLastError("Can not create texture: " + texture.m_path);
+			return false;
+		}
+
+		const unsigned int numResidentMips = texture.m_desc.MipLevels - texture.m_residentMip;
+		const unsigned int mipOffset = topMip - texture.m_residentMip;
+		for (unsigned int iSlice = 0; iSlice < desc.ArraySize; ++iSlice)
+		{
+			for (unsigned int iMip = 0; iMip < desc.MipLevels; ++iMip)
+			{
+				D3D::GetContext()->CopySubresourceRegion(pTexture, iMip + iSlice*desc.MipLevels, 0, 0, 0,
+					texture.m_texture->GetTexture(), iMip + mipOffset + iSlice*numResidentMips, nullptr);
+			}
+		}
+
+		D3D::Texture *pTrimmed = CreateTexture(pTexture, texture.m_path);
+		if (nullptr == pTrimmed)
+			return false;
+
+		const uint64_t size = GetSize(texture.m_desc, topMip);
+		++m_stats.numEvicted;
+		m_stats.evictedBytes += texture.m_size - size;
+		m_residentBytes -= texture.m_size - size;
+
+		texture.m_texture.reset(pTrimmed);
+		texture.m_residentMip = topMip;
+		texture.m_size = size;
+		return true;
+	}
+
+	bool TextureStreamer::EvictFor(const StreamedTexture &requester, uint64_t numBytes)
+	{
+		while (m_residentBytes + numBytes > m_settings.budget)
+		{
+			// Least recently used, largest first.
+			StreamedTexture *pVictim = nullptr;
+			for (auto &texture : m_textures)
+			{
+				if (&requester == texture.get() || true == texture->m_isPending || GetKeepMip(*texture) <= texture->m_residentMip)
+					continue;
+
+				if (nullptr == pVictim || texture->m_lastUsedFrame < pVictim->m_lastUsedFrame ||
+					(texture->m_lastUsedFrame == pVictim->m_lastUsedFrame && texture->m_size > pVictim->m_size))
+					pVictim = texture.get();
+			}
+
+			if (nullptr == pVictim || false == Trim(*pVictim, GetKeepMip(*pVictim)))
+				return false;
+		}
+
+		return true;
+	}
+
+	void TextureStreamer::Load(StreamedTexture &texture, unsigned int topMip)
+	{
+		// The old texture stays until the new one's created, so count both in the meantime.
+		const uint64_t size = GetSize(texture.m_desc, topMip);
+		m_residentBytes += size;
+		texture.m_isPending = true;
+		++m_numPending;
+
+		TextureStreamer *pStreamer = this;
+		StreamedTexture *pTexture = &texture;
+		const std::string path = texture.m_path;
+		RunAsync([pStreamer, pTexture, path, topMip, size]() -> AsyncFinish
+		{
+			std::shared_ptr<TextureFile> file = std::make_shared<TextureFile>();
+			bool isRead = ReadTextureFile(path, *file);
+
+			// Changed on disk since?
+			const D3D11_TEXTURE2D_DESC &desc = pTexture->m_desc, &fileDesc = file->layout.desc;
+			if (true == isRead && (desc.Width != fileDesc.Width || desc.Height != fileDesc.Height || desc.MipLevels != fileDesc.MipLevels
+				|| desc.ArraySize != fileDesc.ArraySize || desc.Format != fileDesc.Format))
+			{
+				SetLastError("Streamed texture changed: " + path);
+				isRead = false;
+			}
+
+			return [pStreamer, pTexture, path, topMip, size, file, isRead]()
+			{
+				pTexture->m_isPending = false;
+				--pStreamer->m_numPending;
+
+				D3D::Texture *pLoaded = (true == isRead) ? CreateFromFile(*file, topMip, path) : nullptr;
+				if (nullptr == pLoaded)
+				{
+					// Don't try again.
+					pTexture->m_isFailed = true;
+					pStreamer->m_residentBytes -= size;
+					return;
+				}
+
+				pStreamer->m_residentBytes -= pTexture->m_size;
+				++pStreamer->m_stats.numLoaded;
+				pStreamer->m_stats.loadedBytes += size;
+
+				pTexture->m_texture.reset(pLoaded);
+				pTexture->m_residentMip = topMip;
+				pTexture->m_size = size;
+			};
+		});
+	}
+}
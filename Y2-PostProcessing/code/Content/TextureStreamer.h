@@ -0,0 +1,115 @@
+/*
+	Year 2 Direct3D 11 workshop template.
+	Content - Texture streaming: low mips always resident, higher ones loaded on demand within a memory budget.
+
+	Each frame, call Touch() on every texture you draw with the size it covers on screen, then Update():
+	- The mip that's wanted is the smallest one that still covers the screen size (more would be minified away).
+	- Loads are issued by priority (largest on screen first) and run asynchronously (see AsyncLoad.h);
+	  the texture is recreated with the new mips and swapped in when done.
+	- If a load doesn't fit the budget, least recently used textures are trimmed first: those not drawn this frame
+	  down to their resident mips, others down to what they want. The copy happens on the GPU, no reads involved.
+
+	Direct3D 11 has no partially resident textures (without tiled resources), hence the recreation; while a load
+	is in flight both textures exist, and the budget accounts for that.
+*/
+
+#if !defined(TEXTURE_STREAMER_H)
+#define TEXTURE_STREAMER_H
+
+#include "TextureFile.h"
+
+namespace Content
+{
+	struct StreamingSettings
+	{
+		StreamingSettings() :
+			budget(256 << 20), residentSize(64), maxLoadsInFlight(4) {}
+
+		uint64_t budget;               // Bytes, all textures together (resident mips can exceed it).
+		unsigned int residentSize;     // Mips this size (in their largest dimension) or smaller are always resident.
+		unsigned int maxLoadsInFlight;
+	};
+
+	// Per frame (i.e. since the previous Update()), apart from the totals.
+	struct StreamingStats
+	{
+		uint64_t budget, residentBytes;
+		unsigned int numTextures, numPending;
+		unsigned int numLoaded, numEvicted;
+		uint64_t loadedBytes, evictedBytes;
+	};
+
+	// Size in pixels an object of 'worldSize' covers at 'distance'; 'errorScale' as returned by GetLODErrorScale().
+	inline float GetScreenSize(float worldSize, float distance, float errorScale)
+	{
+		return worldSize*errorScale/std::max<float>(distance, 0.001f);
+	}
+
+	class StreamedTexture : public boost::noncopyable
+	{
+	public:
+		// Changes as mips come & go, so don't hang on to it beyond the frame.
+		const D3D::Texture *GetTexture() const { return m_texture.get(); }
+
+		// Full chain (as in the file).
+		const D3D11_TEXTURE2D_DESC &GetDesc() const { return m_desc; }
+
+		// Most detailed mip resident.
+		unsigned int GetResidentMip() const { return m_residentMip; }
+
+		// Call for each use this frame: screen size in texels along the largest dimension (e.g. GetScreenSize() times UV scale).
+		void Touch(float screenSize);
+
+	private:
+		friend class TextureStreamer;
+
+		StreamedTexture() {}
+
+		std::string m_path;
+		D3D11_TEXTURE2D_DESC m_desc;
+		D3D::Texture::Ptr m_texture;
+		unsigned int m_residentMip, m_baseMip; // Current & always resident.
+		unsigned int m_wantedMip;              // This frame (if touched).
+		uint64_t m_size;                       // Bytes resident.
+		float m_screenSize;                    // Largest this frame (0 if not touched).
+		uint32_t m_lastUsedFrame;
+		bool m_isPending, m_isFailed;
+	};
+
+	class TextureStreamer : public boost::noncopyable
+	{
+	public:
+		typedef std::unique_ptr<TextureStreamer> Ptr;
+
+		TextureStreamer(const StreamingSettings &settings = StreamingSettings());
+		~TextureStreamer(); // Waits for loads in flight.
+
+		// Render thread: reads the file & creates the resident mips; nullptr on failure (see SetLastError()).
+		// Textures live as long as the streamer.
+		StreamedTexture *Add(const std::string &path);
+
+		// Render thread, once per frame after all Touch() calls.
+		void Update();
+
+		void SetBudget(uint64_t budget) { m_settings.budget = budget; }
+
+		// Of the last Update().
+		const StreamingStats &GetStats() const { return m_frameStats; }
+
+	private:
+		unsigned int GetKeepMip(const StreamedTexture &texture) const;
+
+		bool Trim(StreamedTexture &texture, unsigned int topMip);
+		bool EvictFor(const StreamedTexture &requester, uint64_t numBytes);
+		void Load(StreamedTexture &texture, unsigned int topMip);
+
+		StreamingSettings m_settings;
+		std::vector<std::unique_ptr<StreamedTexture>> m_textures;
+		uint32_t m_frame;
+		uint64_t m_residentBytes; // Including loads in flight.
+		unsigned int m_numPending;
+		StreamingStats m_stats, m_frameStats;
+	};
+}
+
+#endif // TEXTURE_STREAMER_H
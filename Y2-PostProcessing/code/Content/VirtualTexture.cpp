@@ -0,0 +1,529 @@
+/*
+	Year 2 Direct3D 11 workshop template.
+	Content - Software virtual texturing: a huge (virtual) texture backed by a fixed cache of pages.
+*/
+
+#include "../Platform.h"
+#include "../D3D.h"
+#include "AsyncLoad.h"
+#include "VirtualTexture.h"
+
+namespace Content
+{
+	// Frames between rendering feedback & reading it back.
+	const unsigned int kFeedbackLatency = 2;
+
+	static unsigned int Log2(unsigned int value)
+	{
+		unsigned int log = 0;
+		while (value >> (log+1))
+			++log;
+
+		return log;
+	}
+
+	// Slots per side: what fits the budget, within the limits of a texture and our 8-bit indirection entries.
+	static unsigned int GetCacheSide(const VirtualTextureSettings &settings)
+	{
+		const size_t pageTexels = settings.pageSize + 2*settings.border;
+		const unsigned int maxSide = std::min<unsigned int>(16384/(unsigned int) pageTexels, 255);
+
+		unsigned int side = 1;
+		while (side < maxSide && (side+1)*(side+1)*pageTexels*pageTexels*sizeof(uint32_t) <= settings.cacheBytes)
+			++side;
+
+		return side;
+	}
+
+	VirtualTexture::VirtualTexture(const VirtualTextureSettings &settings, const PageProvider &provider) :
+		m_settings(settings)
+		, m_provider(provider)
+		, m_numPages(settings.virtualSize/settings.pageSize)
+		, m_numMips(Log2(settings.virtualSize/settings.pageSize) + 1)
+		, m_pageTexels(settings.pageSize + 2*settings.border)
+		, m_cacheSide(GetCacheSide(settings))
+		, m_isIndirectionDirty(true)
+		, m_feedbackWidth(0), m_feedbackHeight(0)
+		, m_frame(0)
+		, m_numPending(0)
+	{
+		ASSERT(0 == (settings.virtualSize & (settings.virtualSize-1)) && 0 == (settings.pageSize & (settings.pageSize-1)));
+		ASSERT(m_numPages <= 4096 && m_numMips <= 16);
+
+		const Slot freeSlot = { kNoVirtualPage, 0, false, false };
+		m_slots.resize(m_cacheSide*m_cacheSide, freeSlot);
+
+		m_indirectionTable.resize(m_numMips);
+		for (unsigned int iMip = 0; iMip < m_numMips; ++iMip)
+			m_indirectionTable[iMip].resize((m_numPages >> iMip)*(m_numPages >> iMip), 0);
+
+		memset(&m_stats, 0, sizeof(m_stats));
+		memset(&m_frameStats, 0, sizeof(m_frameStats));
+
+		// The single page covering everything is always there to fall back on.
+		m_slots[0].isLocked = true;
+		Load(PackVirtualPage(m_numMips-1, 0, 0), 0);
+	}
+
+	VirtualTexture::~VirtualTexture()
+	{
+		// Loads in flight point to us.
+		if (0 != m_numPending)
+			WaitForAsyncLoads();
+
+		for (ID3D11Texture2D *pStaging : m_feedbackStaging)
+			SAFE_RELEASE(pStaging);
+	}
+
+	bool VirtualTexture::CreateResources(unsigned int viewWidth, unsigned int viewHeight)
+	{
+		ID3D11Device *pDevice = D3D::GetDevice();
+
+		// Page cache.
+		{
+			D3D11_TEXTURE2D_DESC desc;
+			memset(&desc, 0, sizeof(desc));
+			desc.Width = desc.Height = m_cacheSide*m_pageTexels;
+			desc.MipLevels = 1;
+			desc.ArraySize = 1;
+			desc.Format = (m_settings.isSRGB) ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+			desc.SampleDesc.Count = 1;
+			desc.Usage = D3D11_USAGE_DEFAULT;
+			desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+			ComPtr<ID3D11Texture2D> texture;
+			ComPtr<ID3D11ShaderResourceView> shaderView;
+			if (FAILED(pDevice->CreateTexture2D(&desc, nullptr, &texture)) || FAILED(pDevice->CreateShaderResourceView(texture.Get(), nullptr, &shaderView)))
+			{
+				SetLastError("Can not create virtual texture page cache.");
+				return false;
+			}
+
+			m_cache.reset(new D3D::Texture(texture.Detach(), shaderView.Detach()));
+		}
+
+		// Indirection table.
+		{
+			D3D11_TEXTURE2D_DESC desc;
+			memset(&desc, 0, sizeof(desc));
+			desc.Width = desc.Height = m_numPages;
+			desc.MipLevels = m_numMips;
+			desc.ArraySize = 1;
+			desc.Format = DXGI_FORMAT_R8G8B8A8_UINT;
+			desc.SampleDesc.Count = 1;
+			desc.Usage = D3D11_USAGE_DEFAULT;
+			desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+			ComPtr<ID3D11Texture2D> texture;
+			ComPtr<ID3D11ShaderResourceView> shaderView;
+			if (FAILED(pDevice->CreateTexture2D(&desc, nullptr, &texture)) || FAILED(pDevice->CreateShaderResourceView(texture.Get(), nullptr, &shaderView)))
+			{
+				SetLastError("Can not create virtual texture indirection table.");
+				return false;
+			}
+
+			m_indirection.reset(new D3D::Texture(texture.Detach(), shaderView.Detach()));
+			m_isIndirectionDirty = true;
+		}
+
+		// Feedback target & the staging textures it's copied to for read back.
+		{
+			m_feedbackWidth = std::max<unsigned int>(viewWidth/m_settings.feedbackDivisor, 1);
+			m_feedbackHeight = std::max<unsigned int>(viewHeight/m_settings.feedbackDivisor, 1);
+
+			D3D11_TEXTURE2D_DESC desc;
+			memset(&desc, 0, sizeof(desc));
+			desc.Width = m_feedbackWidth;
+			desc.Height = m_feedbackHeight;
+			desc.MipLevels = 1;
+			desc.ArraySize = 1;
+			desc.Format = DXGI_FORMAT_R32_UINT;
+			desc.SampleDesc.Count = 1;
+			desc.Usage = D3D11_USAGE_DEFAULT;
+			desc.BindFlags = D3D11_BIND_RENDER_TARGET;
+
+			ComPtr<ID3D11Texture2D> texture;
+			ComPtr<ID3D11RenderTargetView> targetView;
+			if (FAILED(pDevice->CreateTexture2D(&desc, nullptr, &texture)) || FAILED(pDevice->CreateRenderTargetView(texture.Get(), nullptr, &targetView)))
+			{
+				SetLastError("Can not create virtual texture feedback target.");
+				return false;
+			}
+
+			m_feedbackTarget.reset(new D3D::RenderTarget(desc.Format, texture.Detach(), targetView.Detach(), nullptr));
+
+			desc.Usage = D3D11_USAGE_STAGING;
+			desc.BindFlags = 0;
+			desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+			for (unsigned int iStaging = 0; iStaging <= kFeedbackLatency; ++iStaging)
+			{
+				ID3D11Texture2D *pStaging;
+				if (FAILED(pDevice->CreateTexture2D(&desc, nullptr, &pStaging)))
+				{
+					SetLastError("Can not create virtual texture feedback staging texture.");
+					return false;
+				}
+
+				m_feedbackStaging.push_back(pStaging);
+			}
+		}
+
+		// Pages that finished loading before there was a cache to upload to (the root, at least) never made it
+		// to the GPU: their texels are gone, so load them again.
+		for (uint32_t iSlot = 0; iSlot < m_slots.size(); ++iSlot)
+		{
+			const Slot &slot = m_slots[iSlot];
+			if (kNoVirtualPage != slot.page && false == slot.isPending)
+				Load(slot.page, iSlot);
+		}
+
+		return true;
+	}
+
+	void VirtualTexture::AddFeedback(const uint32_t *pPages, size_t count)
+	{
+		for (size_t iPage = 0; iPage < count; ++iPage)
+		{
+			// Rejects anything outside the texture (feedback is read back from the GPU, so never trust it).
+			const uint32_t page = pPages[iPage];
+			if (kNoVirtualPage == page)
+				continue;
+
+			const unsigned int mip = GetVirtualPageMip(page);
+			if (mip < m_numMips && GetVirtualPageX(page) < (m_numPages >> mip) && GetVirtualPageY(page) < (m_numPages >> mip))
+				++m_feedback[page];
+		}
+	}
+
+	void VirtualTexture::ReadFeedback()
+	{
+		if (nullptr == m_feedbackTarget)
+			return;
+
+		// Copy this frame's, read the oldest (which the GPU should be long done with).
+		ID3D11DeviceContext *pContext = D3D::GetContext();
+		const unsigned int numStaging = (unsigned int) m_feedbackStaging.size();
+		pContext->CopyResource(m_feedbackStaging[m_frame % numStaging], m_feedbackTarget->GetTexture());
+
+		if (m_frame < kFeedbackLatency)
+			return;
+
+		ID3D11Texture2D *pStaging = m_feedbackStaging[(m_frame + 1) % numStaging];
+		D3D11_MAPPED_SUBRESOURCE mapped;
+		if (S_OK == pContext->Map(pStaging, 0, D3D11_MAP_READ, 0, &mapped))
+		{
+			for (unsigned int iY = 0; iY < m_feedbackHeight; ++iY)
+				AddFeedback(reinterpret_cast<const uint32_t *>(static_cast<const uint8_t *>(mapped.pData) + iY*mapped.RowPitch), m_feedbackWidth);
+
+			pContext->Unmap(pStaging, 0);
+		}
+	}
+
+	void VirtualTexture::Update()
+	{
+		ReadFeedback();
+
+		// Everything sampled plus it's ancestors; counts add up towards the root.
+		std::unordered_map<uint32_t, uint32_t> requested;
+		requested.reserve(m_feedback.size()*2);
+		for (const auto &feedback : m_feedback)
+		{
+			unsigned int X = GetVirtualPageX(feedback.first), Y = GetVirtualPageY(feedback.first);
+			for (unsigned int iMip = GetVirtualPageMip(feedback.first); iMip < m_numMips; ++iMip, X >>= 1, Y >>= 1)
+				requested[PackVirtualPage(iMip, X, Y)] += feedback.second;
+		}
+
+		m_feedback.clear();
+
+		// Touch what's there, collect what's not.
+		std::vector<std::pair<uint32_t, uint32_t>> missing;
+		for (const auto &request : requested)
+		{
+			auto iSlot = m_pageToSlot.find(request.first);
+			if (m_pageToSlot.end() != iSlot)
+			{
+				Slot &slot = m_slots[iSlot->second];
+				slot.lastUsedFrame = m_frame;
+				if (false == slot.isPending)
+					++m_stats.numHits;
+			}
+			else
+				missing.push_back(request);
+		}
+
+		m_stats.numRequested = (unsigned int) requested.size();
+
+		// Coarsest first (so there's something sensible to show soon), then most sampled.
+		std::sort(missing.begin(), missing.end(), [](const std::pair<uint32_t, uint32_t> &A, const std::pair<uint32_t, uint32_t> &B)
+		{
+			const unsigned int mipA = GetVirtualPageMip(A.first), mipB = GetVirtualPageMip(B.first);
+			return (mipA != mipB) ? mipA > mipB : A.second > B.second;
+		});
+
+		for (const auto &request : missing)
+		{
+			uint32_t iSlot;
+			if (m_numPending >= m_settings.maxLoadsPerFrame || false == AllocateSlot(iSlot))
+				break;
+
+			Load(request.first, iSlot);
+		}
+
+		if (true == m_isIndirectionDirty)
+			UpdateIndirection();
+
+		m_frameStats = m_stats;
+		m_frameStats.numPending = m_numPending;
+		m_frameStats.numResident = (unsigned int) m_pageToSlot.size() - m_numPending;
+		m_frameStats.numCachePages = (unsigned int) m_slots.size();
+
+		memset(&m_stats, 0, sizeof(m_stats));
+		++m_frame;
+	}
+
+	bool VirtualTexture::AllocateSlot(uint32_t &iSlot)
+	{
+		// Free, or else least recently used (as long as it wasn't used this frame).
+		uint32_t iBest = (uint32_t) m_slots.size();
+		for (uint32_t iCandidate = 0; iCandidate < m_slots.size(); ++iCandidate)
+		{
+			const Slot &slot = m_slots[iCandidate];
+			if (kNoVirtualPage == slot.page)
+			{
+				iBest = iCandidate;
+				break;
+			}
+
+			if (false == slot.isPending && false == slot.isLocked && slot.lastUsedFrame != m_frame &&
+				(m_slots.size() == iBest || slot.lastUsedFrame < m_slots[iBest].lastUsedFrame))
+				iBest = iCandidate;
+		}
+
+		if (m_slots.size() == iBest)
+			return false;
+
+		Slot &slot = m_slots[iBest];
+		if (kNoVirtualPage != slot.page)
+		{
+			m_pageToSlot.erase(slot.page);
+			slot.page = kNoVirtualPage;
+			m_isIndirectionDirty = true;
+			++m_stats.numEvicted;
+		}
+
+		iSlot = iBest;
+		return true;
+	}
+
+	void VirtualTexture::Load(uint32_t page, uint32_t iSlot)
+	{
+		Slot &slot = m_slots[iSlot];
+		slot.page = page;
+		slot.lastUsedFrame = m_frame;
+		slot.isPending = true;
+		m_pageToSlot[page] = iSlot;
+		++m_numPending;
+
+		VirtualTexture *pTexture = this;
+		RunAsync([pTexture, page, iSlot]() -> AsyncFinish
+		{
+			const unsigned int pageTexels = pTexture->m_pageTexels;
+			std::shared_ptr<std::vector<uint32_t>> texels = std::make_shared<std::vector<uint32_t>>(pageTexels*pageTexels);
+			const bool isLoaded = pTexture->m_provider(GetVirtualPageMip(page), GetVirtualPageX(page), GetVirtualPageY(page), texels->data());
+
+			return [pTexture, page, iSlot, texels, isLoaded]()
+			{
+				Slot &slot = pTexture->m_slots[iSlot];
+				ASSERT(page == slot.page && true == slot.isPending);
+				slot.isPending = false;
+				--pTexture->m_numPending;
+
+				// Free the slot, it'll be requested again (the locked root never fails, or there's nothing to show).
+				if (false == isLoaded && false == slot.isLocked)
+				{
+					pTexture->m_pageToSlot.erase(page);
+					slot.page = kNoVirtualPage;
+					return;
+				}
+
+				if (nullptr != pTexture->m_cache)
+				{
+					const unsigned int pageTexels = pTexture->m_pageTexels;
+					D3D11_BOX box;
+					box.left = (iSlot % pTexture->m_cacheSide)*pageTexels;
+					box.top = (iSlot / pTexture->m_cacheSide)*pageTexels;
+					box.front = 0;
+					box.right = box.left + pageTexels;
+					box.bottom = box.top + pageTexels;
+					box.back = 1;
+					D3D::GetContext()->UpdateSubresource(pTexture->m_cache->GetTexture(), 0, &box, texels->data(), pageTexels*sizeof(uint32_t), 0);
+				}
+
+				pTexture->m_isIndirectionDirty = true;
+				++pTexture->m_stats.numLoaded;
+			};
+		});
+	}
+
+	void VirtualTexture::UpdateIndirection()
+	{
+		// Resident pages first, then top-down: whatever's not resident inherits from it's parent.
+		for (auto &table : m_indirectionTable)
+			std::fill(table.begin(), table.end(), 0);
+
+		for (uint32_t iSlot = 0; iSlot < m_slots.size(); ++iSlot)
+		{
+			const Slot &slot = m_slots[iSlot];
+			if (kNoVirtualPage == slot.page || true == slot.isPending)
+				continue;
+
+			const unsigned int mip = GetVirtualPageMip(slot.page);
+			const unsigned int numPages = m_numPages >> mip;
+			m_indirectionTable[mip][GetVirtualPageY(slot.page)*numPages + GetVirtualPageX(slot.page)] =
+				(iSlot % m_cacheSide) | ((iSlot / m_cacheSide) << 8) | (mip << 16) | (1 << 24);
+		}
+
+		for (unsigned int iMip = m_numMips-1; iMip-- > 0; )
+		{
+			const unsigned int numPages = m_numPages >> iMip, numParentPages = numPages >> 1;
+			std::vector<uint32_t> &table = m_indirectionTable[iMip];
+			const std::vector<uint32_t> &parentTable = m_indirectionTable[iMip+1];
+			for (unsigned int iY = 0; iY < numPages; ++iY)
+			{
+				for (unsigned int iX = 0; iX < numPages; ++iX)
+				{
+					uint32_t &entry = table[iY*numPages + iX];
+					if (0 == entry)
+						entry = parentTable[(iY >> 1)*numParentPages + (iX >> 1)];
+				}
+			}
+		}
+
+		if (nullptr != m_indirection)
+		{
+			for (unsigned int iMip = 0; iMip < m_numMips; ++iMip)
+				D3D::GetContext()->UpdateSubresource(m_indirection->GetTexture(), iMip, nullptr, m_indirectionTable[iMip].data(), (m_numPages >> iMip)*sizeof(uint32_t), 0);
+		}
+
+		m_isIndirectionDirty = false;
+	}
+
+	const VirtualTextureConstants VirtualTexture::GetConstants() const
+	{
+		VirtualTextureConstants constants;
+		constants.numPages = (float) m_numPages;
+		constants.maxMip = (float) (m_numMips-1);
+		constants.pageSize = (float) m_settings.pageSize;
+		constants.border = (float) m_settings.border;
+		constants.cacheSizeInv = 1.f/(m_cacheSide*m_pageTexels);
+		constants.virtualSize = (float) m_settings.virtualSize;
+		constants.feedbackBias = -(float) Log2(m_settings.feedbackDivisor);
+		constants.padding = 0.f;
+		return constants;
+	}
+
+	/*
+		Benchmark.
+	*/
+
+	void BenchmarkVirtualTexture()
+	{
+		const VirtualTextureSettings settings;
+		const unsigned int pageTexels = settings.pageSize + 2*settings.border;
+
+		// Cheap procedural content: a checker tinted per mip, plus a per-texel hash to keep the writes honest.
+		const PageProvider provider = [&settings, pageTexels](unsigned int mip, unsigned int X, unsigned int Y, uint32_t *pTexels)
+		{
+			const int originX = (int) (X*settings.pageSize) - (int) settings.border, originY = (int) (Y*settings.pageSize) - (int) settings.border;
+			for (unsigned int iY = 0; iY < pageTexels; ++iY)
+			{
+				for (unsigned int iX = 0; iX < pageTexels; ++iX)
+				{
+					const uint32_t U = (uint32_t) (originX + (int) iX) << mip, V = (uint32_t) (originY + (int) iY) << mip;
+					const uint32_t checker = ((U >> 10) ^ (V >> 10)) & 1;
+					const uint32_t noise = (U*73856093u ^ V*19349663u) >> 28;
+					*pTexels++ = 0xff000000 | ((checker*0x80 + noise) << (8*(mip % 3)));
+				}
+			}
+
+			return true;
+		};
+
+		VirtualTexture texture(settings, provider);
+
+		// Camera 20m over a 4km square, looking ahead & down; feedback at 1280x720/8 like the GPU pass would.
+		const unsigned int feedbackWidth = 160, feedbackHeight = 90;
+		const float worldSize = 4096.f, texelsPerMeter = settings.virtualSize/worldSize;
+		const float tanHalfFOV = tanf(0.5f*kPI/3.f), aspectRatio = 16.f/9.f;
+		const float pixelAngle = 2.f*tanHalfFOV/720.f;
+		const float height = 20.f, pitch = 0.35f;
+
+		std::vector<uint32_t> feedback(feedbackWidth*feedbackHeight);
+		const unsigned int numFrames = 600;
+		float totalTime = 0.f, maxTime = 0.f, totalHitRate = 0.f;
+		unsigned int totalLoaded = 0, totalEvicted = 0;
+
+		for (unsigned int iFrame = 0; iFrame < numFrames; ++iFrame)
+		{
+			// Forward at 120m/s, slowly turning.
+			const float time = iFrame/60.f;
+			const float heading = 0.2f*time;
+			const float camX = 1024.f + 120.f*time*cosf(heading), camZ = 1024.f + 120.f*time*sinf(heading);
+
+			for (unsigned int iY = 0; iY < feedbackHeight; ++iY)
+			{
+				for (unsigned int iX = 0; iX < feedbackWidth; ++iX)
+				{
+					// View ray (right, up, forward), pitched down, then turned.
+					const float rayX = (2.f*(iX + 0.5f)/feedbackWidth - 1.f)*tanHalfFOV*aspectRatio;
+					const float rayY = (1.f - 2.f*(iY + 0.5f)/feedbackHeight)*tanHalfFOV;
+					const float down = sinf(pitch) - rayY*cosf(pitch), forward = cosf(pitch) + rayY*sinf(pitch);
+
+					uint32_t &page = feedback[iY*feedbackWidth + iX];
+					if (down <= 0.f)
+					{
+						page = kNoVirtualPage; // Sky.
+						continue;
+					}
+
+					const float distance = height/down;
+					const float worldX = camX + distance*(forward*cosf(heading) - rayX*sinf(heading));
+					const float worldZ = camZ + distance*(forward*sinf(heading) + rayX*cosf(heading));
+					if (worldX < 0.f || worldZ < 0.f || worldX >= worldSize || worldZ >= worldSize)
+					{
+						page = kNoVirtualPage;
+						continue;
+					}
+
+					// Texels per pixel, stretched along the view at grazing angles (like anisotropic footprint's major axis).
+					const float footprint = distance*sqrtf(1.f + rayX*rayX + rayY*rayY)*pixelAngle*texelsPerMeter/down;
+					const unsigned int mip = std::min<unsigned int>((unsigned int) std::max<float>(log2f(footprint), 0.f), Log2(settings.virtualSize/settings.pageSize));
+					const unsigned int pageSize = settings.pageSize << mip;
+					page = PackVirtualPage(mip, (unsigned int) (worldX*texelsPerMeter)/pageSize, (unsigned int) (worldZ*texelsPerMeter)/pageSize);
+				}
+			}
+
+			Timer timer;
+			texture.AddFeedback(feedback.data(), feedback.size());
+			texture.Update();
+			ProcessAsyncLoads(FLT_MAX);
+			const float frameTime = timer.Get();
+
+			totalTime += frameTime;
+			maxTime = std::max<float>(maxTime, frameTime);
+
+			const VirtualTextureStats &stats = texture.GetStats();
+			totalHitRate += stats.GetHitRate();
+			totalLoaded += stats.numLoaded;
+			totalEvicted += stats.numEvicted;
+		}
+
+		const VirtualTextureStats &stats = texture.GetStats();
+		const float cacheMB = stats.numCachePages*pageTexels*pageTexels*4/(1024.f*1024.f);
+		DEBUG_LOG("Virtual texture benchmark (%ux%u, %u pages of %u texels, %.1fMB cache, %u frames):",
+			settings.virtualSize, settings.virtualSize, stats.numCachePages, settings.pageSize, cacheMB, numFrames);
+		DEBUG_LOG("- Hit rate %.1f%% on average, %u pages resident at the end", 100.f*totalHitRate/numFrames, stats.numResident);
+		DEBUG_LOG("- %u pages loaded, %u evicted (%.1f loads per frame)", totalLoaded, totalEvicted, (float) totalLoaded/numFrames);
+		DEBUG_LOG("- Update (feedback analysis, finished loads & indirection): %.3f ms per frame on average, %.3f ms at most", 1000.f*totalTime/numFrames, 1000.f*maxTime);
+	}
+}
@@ -0,0 +1,141 @@
+/*
+	Year 2 Direct3D 11 workshop template.
+	Content - Software virtual texturing: a huge (virtual) texture backed by a fixed cache of pages.
+
+	- The virtual texture is split into square pages at every mip level; pages are produced on demand by a
+	  PageProvider (on loader threads, see AsyncLoad.h) and uploaded into a slot of the physical page cache.
+	- The indirection table has a texel per page (with a mip chain to match): the cache slot of that page, or
+	  of the nearest resident ancestor, plus the level of the page that's actually there. See VirtualTexture.inc.
+	- Feedback says which pages were sampled: either rendered into GetFeedbackTarget() (at a fraction of the
+	  resolution, read back a few frames late so there's no stall) or handed over by AddFeedback().
+	- Update() requests every page sampled plus it's ancestors (so there's always something close to fall back on),
+	  coarsest first, and evicts the least recently used pages to make room.
+
+	Page IDs (as the feedback shader writes them): X in bits 0-11, Y in bits 12-23, mip in bits 24-27.
+*/
+
+#if !defined(VIRTUAL_TEXTURE_H)
+#define VIRTUAL_TEXTURE_H
+
+#include <functional>
+#include <unordered_map>
+
+namespace Content
+{
+	const uint32_t kNoVirtualPage = 0xffffffff;
+
+	inline uint32_t PackVirtualPage(unsigned int mip, unsigned int X, unsigned int Y) { return X | (Y << 12) | (mip << 24); }
+	inline unsigned int GetVirtualPageMip(uint32_t page) { return (page >> 24) & 15; }
+	inline unsigned int GetVirtualPageX(uint32_t page)   { return page & 0xfff; }
+	inline unsigned int GetVirtualPageY(uint32_t page)   { return (page >> 12) & 0xfff; }
+
+	// Fills a page, borders included: (pageSize + 2*border)^2 R8G8B8A8 texels. Called on loader threads.
+	typedef std::function<bool (unsigned int mip, unsigned int X, unsigned int Y, uint32_t *pTexels)> PageProvider;
+
+	struct VirtualTextureSettings
+	{
+		VirtualTextureSettings() :
+			virtualSize(65536), pageSize(128), border(4), cacheBytes(128 << 20), maxLoadsPerFrame(32), feedbackDivisor(8), isSRGB(true) {}
+
+		unsigned int virtualSize;      // Texels, square & a power of 2.
+		unsigned int pageSize;         // Texels (border excluded), a power of 2.
+		unsigned int border;           // Texels on each side, for filtering across pages.
+		size_t cacheBytes;             // Physical page cache size (rounded down to a square number of pages).
+		unsigned int maxLoadsPerFrame; // Pages in flight.
+		unsigned int feedbackDivisor;  // Feedback target resolution (view size divided by this).
+		bool isSRGB;
+	};
+
+	// Matches the cbuffer in VirtualTexture.inc.
+	struct VirtualTextureConstants
+	{
+		float numPages;     // Per side, at mip 0.
+		float maxMip;
+		float pageSize;
+		float border;
+		float cacheSizeInv; // 1/texels per side.
+		float virtualSize;
+		float feedbackBias; // Mip bias for the (lower resolution) feedback pass.
+		float padding;
+	};
+
+	// Per frame, apart from the totals.
+	struct VirtualTextureStats
+	{
+		unsigned int numRequested, numHits; // Distinct pages sampled (ancestors included) & how many were resident.
+		unsigned int numLoaded, numEvicted, numPending;
+		unsigned int numResident, numCachePages;
+
+		float GetHitRate() const { return (0 != numRequested) ? (float) numHits/numRequested : 1.f; }
+	};
+
+	class VirtualTexture : public boost::noncopyable
+	{
+	public:
+		typedef std::unique_ptr<VirtualTexture> Ptr;
+
+		VirtualTexture(const VirtualTextureSettings &settings, const PageProvider &provider);
+		~VirtualTexture(); // Waits for loads in flight.
+
+		// The GPU side: page cache, indirection table & feedback target (for a view of the given size).
+		// Without it everything but the uploads still runs, which is what BenchmarkVirtualTexture() does.
+		bool CreateResources(unsigned int viewWidth, unsigned int viewHeight);
+
+		// Render the scene's feedback pass into this (cleared to kNoVirtualPage first); see VTFeedback().
+		D3D::RenderTarget *GetFeedbackTarget() const { return m_feedbackTarget.get(); }
+
+		// Feedback from elsewhere (e.g. a software rasterizer); kNoVirtualPage entries are skipped.
+		void AddFeedback(const uint32_t *pPages, size_t count);
+
+		// Render thread, once per frame: reads back feedback, loads & evicts pages and updates the indirection table.
+		void Update();
+
+		ID3D11ShaderResourceView *GetCacheView()       const { return (nullptr != m_cache) ? m_cache->GetShaderView() : nullptr; }
+		ID3D11ShaderResourceView *GetIndirectionView() const { return (nullptr != m_indirection) ? m_indirection->GetShaderView() : nullptr; }
+
+		const VirtualTextureConstants GetConstants() const;
+
+		// Of the last Update().
+		const VirtualTextureStats &GetStats() const { return m_frameStats; }
+
+	private:
+		struct Slot
+		{
+			uint32_t page;          // Or kNoVirtualPage if free.
+			uint32_t lastUsedFrame;
+			bool isPending, isLocked;
+		};
+
+		bool AllocateSlot(uint32_t &iSlot);
+		void Load(uint32_t page, uint32_t iSlot);
+		void ReadFeedback();
+		void UpdateIndirection();
+
+		const VirtualTextureSettings m_settings;
+		const PageProvider m_provider;
+		const unsigned int m_numPages, m_numMips; // Per side at mip 0, mip levels.
+		const unsigned int m_pageTexels;          // Page size, borders included.
+		const unsigned int m_cacheSide;           // Slots per side.
+
+		std::vector<Slot> m_slots;
+		std::unordered_map<uint32_t, uint32_t> m_pageToSlot; // Resident & pending pages.
+		std::unordered_map<uint32_t, uint32_t> m_feedback;   // Page to sample count, this frame.
+		std::vector<std::vector<uint32_t>> m_indirectionTable; // Per mip, R8G8B8A8_UINT: slot X, slot Y, mip, valid.
+		bool m_isIndirectionDirty;
+
+		D3D::Texture::Ptr m_cache, m_indirection;
+		D3D::RenderTarget::Ptr m_feedbackTarget;
+		std::vector<ID3D11Texture2D *> m_feedbackStaging; // Ring, read back with a latency of it's size minus 1.
+		unsigned int m_feedbackWidth, m_feedbackHeight;
+
+		uint32_t m_frame;
+		unsigned int m_numPending;
+		VirtualTextureStats m_stats, m_frameStats;
+	};
+
+	// A camera flying over a procedural 64K x 64K texture with a 128MB cache, feedback computed analytically
+	// (no device needed); logs hit rate, pages streamed & time spent per frame.
+	void BenchmarkVirtualTexture();
+}
+
+#endif // VIRTUAL_TEXTURE_H
@@ -25,10 +25,18 @@ namespace D3D
 	static ID3D11Device        *s_pDev = nullptr;
 	static ID3D11DeviceContext *s_pContext = nullptr;
 	static IDXGISwapChain      *s_pSwapChain = nullptr;
+	static StateCache          *s_pStateCache = nullptr;
+	static ConstantRing        *s_pConstantRing = nullptr;
+	static InputLayoutCache    *s_pInputLayoutCache = nullptr;
+	static RenderTargetPool    *s_pRenderTargetPool = nullptr;
 
 	// Device & context access.
 	ID3D11Device *GetDevice() { ASSERT(nullptr != s_pDev); return s_pDev; }
 	ID3D11DeviceContext *GetContext() { ASSERT(nullptr != s_pContext); return s_pContext; }
+	StateCache &GetStateCache() { ASSERT(nullptr != s_pStateCache); return *s_pStateCache; }
+	ConstantRing *GetConstantRing() { return s_pConstantRing; }
+	InputLayoutCache &GetInputLayoutCache() { ASSERT(nullptr != s_pInputLayoutCache); return *s_pInputLayoutCache; }
+	RenderTargetPool &GetRenderTargetPool() { ASSERT(nullptr != s_pRenderTargetPool); return *s_pRenderTargetPool; }
 
 	// Resources.
 	// This won't scale well at all, so I'd advise wrapping them in renderer-specific objects.
@@ -37,7 +45,7 @@ namespace D3D
 	static ID3D11BlendState *s_pBlendState = nullptr;
 	static ID3D11SamplerState *s_pSamplerState = nullptr;
 	static ID3D11Buffer *s_pQuadVB = nullptr;
-	static ID3D11InputLayout *s_pInputLayout = nullptr;
+	static ID3D11InputLayout *s_pInputLayout = nullptr; // Owned by s_pInputLayoutCache.
 	static ID3D11VertexShader *s_pVertexShader = nullptr;
 	static ID3D11PixelShader *s_pPixelShader = nullptr;
 
@@ -57,10 +65,6 @@ namespace D3D
 		Vector3(-1.f, -1.f, 0.f), // 2						
 	};
 
-	const D3D11_INPUT_ELEMENT_DESC kElements[] = {
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-	};
-
 	bool Create(ID3D11Device *pDevice, ID3D11DeviceContext *pContext, IDXGISwapChain *pSwapChain, const DXGI_SAMPLE_DESC &multiDesc,
 		float renderAspectRatio /* Content */, float displayAspectRatio /* Physical */)
 	{
@@ -74,6 +78,9 @@ namespace D3D
 		s_pDev = pDevice;
 		s_pContext = pContext;
 		s_pSwapChain = pSwapChain;
+		s_pStateCache = new StateCache(StateContext::Ptr(new DeviceStateContext(pContext)));
+		s_pInputLayoutCache = new InputLayoutCache();
+		s_pRenderTargetPool = new RenderTargetPool();
 
 		// Create render target for back buffer.
 		{
@@ -92,11 +99,10 @@ namespace D3D
 		}
 
 		// Bind back buffer.
-		ID3D11RenderTargetView *pView = s_pBackBuffer->GetTargetView();
-		s_pContext->OMSetRenderTargets(1, &pView, nullptr);
+		s_pStateCache->SetRenderTarget(s_pBackBuffer->GetTargetView(), nullptr);
 
 		// We'll be rendering triangle lists.
-		s_pContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		s_pStateCache->SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
 		// Create and set a fixed rasterizer state.
 		D3D11_RASTERIZER_DESC rasterDesc;
@@ -113,7 +119,7 @@ namespace D3D
 		rasterDesc.AntialiasedLineEnable = FALSE;
 		VERIFY(S_OK == s_pDev->CreateRasterizerState(&rasterDesc, &s_pRasterizerState));
 
-		s_pContext->RSSetState(s_pRasterizerState);
+		s_pStateCache->SetRasterizerState(s_pRasterizerState);
 
 		// Fetch back buffer dimensions.
 		D3D11_TEXTURE2D_DESC backbufferDesc;
@@ -170,7 +176,7 @@ namespace D3D
 		s_sceneVP.MaxDepth = 1.f;
 
 		// Set full viewport by default.
-		s_pContext->RSSetViewports(1, &s_backVP);
+		s_pStateCache->SetViewport(s_backVP);
 
 		// Default (opaque) blend state (NULL is valid in this case).
 		s_pBlendState = nullptr;
@@ -209,18 +215,20 @@ namespace D3D
 		VERIFY(S_OK == s_pDev->CreateBuffer(&bufferDesc, &bufferData, &s_pQuadVB));
 
 		// Create an input layout for the vertex buffer (describing what exactly this buffer contains).
-		const D3D11_INPUT_ELEMENT_DESC elemDesc[] = {
-			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		};
+		VertexDecl quadDecl;
+		quadDecl.Add("POSITION", 0, kVertexFloat3);
 
 		// This is verified against the vertex shader's signature.
-		HRESULT hResult = s_pDev->CreateInputLayout(elemDesc, 1, g_Passthrough_VS, sizeof(g_Passthrough_VS), &s_pInputLayout);
-		ASSERT(S_OK == hResult);
+		s_pInputLayout = s_pInputLayoutCache->Get(quadDecl, g_Passthrough_VS, sizeof(g_Passthrough_VS));
+		ASSERT(nullptr != s_pInputLayout);
 
 		// Create passthrough shaders (model 4.0).
 		VERIFY(S_OK == s_pDev->CreateVertexShader(g_Passthrough_VS, sizeof(g_Passthrough_VS), nullptr, &s_pVertexShader));
 		VERIFY(S_OK == s_pDev->CreatePixelShader(g_Passthrough_PS, sizeof(g_Passthrough_PS), nullptr, &s_pPixelShader));
 
+		// Ring for per-draw constants; without it constant buffers are uploaded one by one.
+		s_pConstantRing = CreateConstantRing();
+
 		// Exercise to the reader: 
 		// - Create and use a 2D texture.
 		// - Create and set a depth (stencil) buffer?
@@ -232,18 +240,30 @@ namespace D3D
 	{
 		SAFE_RELEASE(s_pPixelShader);
 		SAFE_RELEASE(s_pVertexShader);
-		SAFE_RELEASE(s_pInputLayout);
+		s_pInputLayout = nullptr;
 		SAFE_RELEASE(s_pQuadVB);
 		SAFE_RELEASE(s_pSamplerState);
 		SAFE_RELEASE(s_pBlendState);
 		SAFE_RELEASE(s_pRasterizerState);
 		delete s_pBackBuffer;
+		delete s_pConstantRing;
+		delete s_pRenderTargetPool;
+		delete s_pInputLayoutCache;
+		delete s_pStateCache;
 	}
 
 	void BeginFrame()
 	{
+		s_pStateCache->ResetStats();
+		ResetUploadStats();
+
+		if (nullptr != s_pConstantRing)
+			s_pConstantRing->BeginFrame();
+
+		s_pRenderTargetPool->BeginFrame();
+
 		// Set full viewport.
-		s_pContext->RSSetViewports(1, &s_backVP);
+		s_pStateCache->SetViewport(s_backVP);
 
 		// Clear it (black).
 		// This is something you can do in different ways that beat clearing the entire buffer each frame.
@@ -251,16 +271,17 @@ namespace D3D
 		s_pContext->ClearRenderTargetView(s_pBackBuffer->GetTargetView(), black);
 
 		// Set adjusted viewport.
-		s_pContext->RSSetViewports(1, &s_backAdjVP);
-
-		// FIXME (test!)
-		DrawQuad();
+		s_pStateCache->SetViewport(s_backAdjVP);
 	}
 
 	void EndFrame()
 	{
 		// Restore full viewport.
-		s_pContext->RSSetViewports(1, &s_backVP);
+		s_pStateCache->SetViewport(s_backVP);
+
+		// Fence this frame's constants.
+		if (nullptr != s_pConstantRing)
+			s_pConstantRing->EndFrame();
 	}
 
 	// Call only if a frame has been drawn, and, the output window has focus.
@@ -270,21 +291,105 @@ namespace D3D
 		ASSERT(S_OK == hRes); // FIXME!
 	}
 
-	void DrawQuad()
+	void DrawQuad(ID3D11PixelShader *pPixelShader /* = nullptr */)
 	{
 		// Bind quad vertex buffer.
 		const UINT stride = sizeof(Vector3); // Size of each element (a single 3D point).
-		const UINT offset = 0;
-		s_pContext->IASetVertexBuffers(0, 1, &s_pQuadVB, &stride, &offset);
+		s_pStateCache->SetVertexBuffer(0, s_pQuadVB, stride);
 
 		// And it's input layout, so the shader can be fed.
-		s_pContext->IASetInputLayout(s_pInputLayout);
+		s_pStateCache->SetInputLayout(s_pInputLayout);
 
 		// Set vertex & pixel shader.
-		s_pContext->VSSetShader(s_pVertexShader, nullptr, 0);
-		s_pContext->PSSetShader(s_pPixelShader, nullptr, 0);
+		s_pStateCache->SetVertexShader(s_pVertexShader);
+		s_pStateCache->SetPixelShader((nullptr != pPixelShader) ? pPixelShader : s_pPixelShader);
 
 		// Draw it, without using an index buffer.
 		s_pContext->Draw(6, 0);
 	}
+
+	static ID3D11Buffer *CreateBuffer(size_t numBytes, const void *pData, UINT bindFlags, BufferUsage usage)
+	{
+		ASSERT(0 != numBytes);
+		ASSERT(kBufferImmutable != usage || nullptr != pData);
+
+		const bool dynamic = kBufferDynamic == usage || kBufferDynamicShadowed == usage;
+
+		D3D11_BUFFER_DESC bufferDesc;
+		bufferDesc.Usage = (dynamic) ? D3D11_USAGE_DYNAMIC : (kBufferUpdatable == usage) ? D3D11_USAGE_DEFAULT : D3D11_USAGE_IMMUTABLE;
+		bufferDesc.ByteWidth = (UINT) numBytes;
+		bufferDesc.BindFlags = bindFlags;
+		bufferDesc.CPUAccessFlags = (dynamic) ? D3D11_CPU_ACCESS_WRITE : 0;
+		bufferDesc.MiscFlags = 0;
+		bufferDesc.StructureByteStride = 0;
+
+		D3D11_SUBRESOURCE_DATA bufferData;
+		bufferData.pSysMem = pData;
+		bufferData.SysMemPitch = 0;
+		bufferData.SysMemSlicePitch = 0;
+
+		ID3D11Buffer *pBuffer = nullptr;
+		if (FAILED(s_pDev->CreateBuffer(&bufferDesc, (nullptr != pData) ? &bufferData : nullptr, &pBuffer)))
+		{
+			SetLastError("Can not create Direct3D buffer.");
+			return nullptr;
+		}
+
+		return pBuffer;
+	}
+
+	static bool HasShadow(BufferUsage usage)
+	{
+		return kBufferDynamicShadowed == usage || kBufferUpdatable == usage;
+	}
+
+	VertexBuffer *CreateVertexBuffer(size_t numBytes, const void *pData, BufferUsage usage /* = kBufferImmutable */)
+	{
+		ID3D11Buffer *pBuffer = CreateBuffer(numBytes, pData, D3D11_BIND_VERTEX_BUFFER, usage);
+		return (nullptr != pBuffer) ? new VertexBuffer(*pBuffer, numBytes, pData, HasShadow(usage)) : nullptr;
+	}
+
+	IndexBuffer *CreateIndexBuffer(size_t numBytes, const void *pData, DXGI_FORMAT format, BufferUsage usage /* = kBufferImmutable */)
+	{
+		ID3D11Buffer *pBuffer = CreateBuffer(numBytes, pData, D3D11_BIND_INDEX_BUFFER, usage);
+		return (nullptr != pBuffer) ? new IndexBuffer(*pBuffer, numBytes, format, pData, HasShadow(usage)) : nullptr;
+	}
+
+	RenderTarget &GetBackBuffer() { ASSERT(nullptr != s_pBackBuffer); return *s_pBackBuffer; }
+	const D3D11_VIEWPORT &GetBackViewport() { return s_backAdjVP; }
+	const D3D11_VIEWPORT &GetSceneViewport() { return s_sceneVP; }
+
+	RenderTarget *CreateRenderTarget(const RenderTargetDesc &desc)
+	{
+		ASSERT(0 != desc.width && 0 != desc.height && 0 != desc.sampleCount);
+
+		D3D11_TEXTURE2D_DESC textureDesc;
+		textureDesc.Width = desc.width;
+		textureDesc.Height = desc.height;
+		textureDesc.MipLevels = 1;
+		textureDesc.ArraySize = 1;
+		textureDesc.Format = desc.format;
+		textureDesc.SampleDesc.Count = desc.sampleCount;
+		textureDesc.SampleDesc.Quality = desc.sampleQuality;
+		textureDesc.Usage = D3D11_USAGE_DEFAULT;
+		textureDesc.BindFlags = desc.bindFlags | D3D11_BIND_RENDER_TARGET;
+		textureDesc.CPUAccessFlags = 0;
+		textureDesc.MiscFlags = 0;
+
+		// Views take their dimension (multisampled or not) from the texture.
+		const bool hasShaderView = 0 != (desc.bindFlags & D3D11_BIND_SHADER_RESOURCE);
+
+		ComPtr<ID3D11Texture2D> texture;
+		ComPtr<ID3D11RenderTargetView> targetView;
+		ComPtr<ID3D11ShaderResourceView> shaderView;
+		if (FAILED(s_pDev->CreateTexture2D(&textureDesc, nullptr, &texture)) ||
+			FAILED(s_pDev->CreateRenderTargetView(texture.Get(), nullptr, &targetView)) ||
+			(true == hasShaderView && FAILED(s_pDev->CreateShaderResourceView(texture.Get(), nullptr, &shaderView))))
+		{
+			SetLastError("Can not create render target.");
+			return nullptr;
+		}
+
+		return new RenderTarget(desc.format, texture.Detach(), targetView.Detach(), shaderView.Detach());
+	}
 }
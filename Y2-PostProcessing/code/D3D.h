@@ -9,14 +9,41 @@
 
 namespace D3D 
 {
+	class StateCache;
+	class ConstantRing;
+	class InputLayoutCache;
+	class RenderTargetPool;
+
 	// Device & context access.
 	ID3D11Device *GetDevice();
 	ID3D11DeviceContext *GetContext();
+
+	// Bind state through this rather than the context, so redundant calls are dropped (see D3D/StateCache.h).
+	StateCache &GetStateCache();
+
+	// Per-frame constants (see D3D/ConstantRing.h); nullptr if the device can't bind them by offset.
+	ConstantRing *GetConstantRing();
+
+	// Input layouts by vertex declaration & shader (see D3D/VertexDecl.h).
+	InputLayoutCache &GetInputLayoutCache();
+
+	// Render targets by description, reused across frames (see D3D/RenderTargetPool.h).
+	RenderTargetPool &GetRenderTargetPool();
 }
 
 // Helper classes.
+#include "D3D/StateContext.h"
+#include "D3D/StateCache.h"
 #include "D3D/Buffers.h"
+#include "D3D/VertexDecl.h"
+#include "D3D/ConstantRing.h"
 #include "D3D/RenderTarget.h"
+#include "D3D/RenderTargetPool.h"
+#include "D3D/Texture.h"
+#include "D3D/Instancing.h"
+#include "D3D/SpriteBatcher.h"
+#include "D3D/RenderQueue.h"
+#include "D3D/RenderGraph.h"
 
 namespace D3D
 {
@@ -29,7 +56,31 @@ namespace D3D
 	void EndFrame();
 	void Flip(unsigned int syncInterval);
 
-	void DrawQuad();
+	// Full viewport quad with the passthrough vertex shader; 'pPixelShader' replaces the passthrough one.
+	void DrawQuad(ID3D11PixelShader *pPixelShader = nullptr);
+
+	// Back buffer, the (aspect ratio adjusted) viewport to draw the scene to it, and that of the scene
+	// on a render target of its own (so also its size).
+	RenderTarget &GetBackBuffer();
+	const D3D11_VIEWPORT &GetBackViewport();
+	const D3D11_VIEWPORT &GetSceneViewport();
+
+	// Render target (with shader view if bound as such); returns nullptr on failure (see SetLastError()).
+	// For those needed only for a while (like a frame) use GetRenderTargetPool() instead.
+	RenderTarget *CreateRenderTarget(const RenderTargetDesc &desc);
+
+	// Buffer creation: immutable ones require 'pData', others are CPU-writable through Upload() (see D3D/Buffers.h).
+	// Those with a shadow copy also take Write() & skip uploads that change nothing, at the cost of that copy & a compare.
+	enum BufferUsage
+	{
+		kBufferImmutable,
+		kBufferDynamic,         // Changes (mostly) as a whole, e.g. every frame.
+		kBufferDynamicShadowed, // Same, but large & often (partly) unchanged: shadowed.
+		kBufferUpdatable        // Changes in parts (D3D11_USAGE_DEFAULT, so those can be sent by themselves); shadowed.
+	};
+
+	VertexBuffer *CreateVertexBuffer(size_t numBytes, const void *pData, BufferUsage usage = kBufferImmutable);
+	IndexBuffer *CreateIndexBuffer(size_t numBytes, const void *pData, DXGI_FORMAT format, BufferUsage usage = kBufferImmutable);
 };
 
 #endif // D3D_H
@@ -0,0 +1,264 @@
+/*
+	D3D: buffer wrappers.
+*/
+
+#include "../Platform.h"
+#include <emmintrin.h>
+#include "../D3D.h"
+
+namespace D3D
+{
+	// Ranges this close together are sent as one (an extra call costs more than a few bytes).
+	const size_t kCoalesceGap = 64;
+
+	// If this much changed, send the lot.
+	const float kWholeUploadFraction = 0.5f;
+
+	// Below this memcpy() is just as quick, and it's not worth evicting the cache for.
+	const size_t kStreamThreshold = 16384;
+
+	static UploadStats s_uploadStats = { 0, 0, 0, 0 };
+
+	const UploadStats &GetUploadStats()
+	{
+		return s_uploadStats;
+	}
+
+	void ResetUploadStats()
+	{
+		memset(&s_uploadStats, 0, sizeof(s_uploadStats));
+	}
+
+	void StreamCopy(void *pDest, const void *pSource, size_t numBytes)
+	{
+		if (numBytes < kStreamThreshold)
+		{
+			memcpy(pDest, pSource, numBytes);
+			return;
+		}
+
+		uint8_t *pDestBytes = static_cast<uint8_t *>(pDest);
+		const uint8_t *pSourceBytes = static_cast<const uint8_t *>(pSource);
+
+		// Stores must be aligned; the source needn't be.
+		const size_t head = (16 - (reinterpret_cast<uintptr_t>(pDestBytes) & 15)) & 15;
+		memcpy(pDestBytes, pSourceBytes, head);
+		pDestBytes += head;
+		pSourceBytes += head;
+		numBytes -= head;
+
+		// A cache line (and write-combining buffer) at a time.
+		const size_t numLines = numBytes >> 6;
+		for (size_t iLine = 0; iLine < numLines; ++iLine)
+		{
+			const __m128i *pSourceLine = reinterpret_cast<const __m128i *>(pSourceBytes);
+			__m128i *pDestLine = reinterpret_cast<__m128i *>(pDestBytes);
+
+			const __m128i A = _mm_loadu_si128(pSourceLine);
+			const __m128i B = _mm_loadu_si128(pSourceLine+1);
+			const __m128i C = _mm_loadu_si128(pSourceLine+2);
+			const __m128i D = _mm_loadu_si128(pSourceLine+3);
+			_mm_stream_si128(pDestLine, A);
+			_mm_stream_si128(pDestLine+1, B);
+			_mm_stream_si128(pDestLine+2, C);
+			_mm_stream_si128(pDestLine+3, D);
+
+			pDestBytes += 64;
+			pSourceBytes += 64;
+		}
+
+		numBytes &= 63;
+		for (; numBytes >= 16; numBytes -= 16)
+		{
+			_mm_stream_si128(reinterpret_cast<__m128i *>(pDestBytes), _mm_loadu_si128(reinterpret_cast<const __m128i *>(pSourceBytes)));
+			pDestBytes += 16;
+			pSourceBytes += 16;
+		}
+
+		memcpy(pDestBytes, pSourceBytes, numBytes);
+
+		// Streaming stores aren't ordered; make sure they're all out before Unmap().
+		_mm_sfence();
+	}
+
+	Buffer::Buffer(ID3D11Buffer &buffer, size_t size, const void *pData /* = nullptr */, bool hasShadow /* = false */) :
+		m_pBuffer(&buffer), m_size(size)
+		, m_isStale(nullptr == pData)
+	{
+		D3D11_BUFFER_DESC desc;
+		buffer.GetDesc(&desc);
+		m_usage = desc.Usage;
+		m_hasBoxes = D3D11_USAGE_DEFAULT == desc.Usage && 0 == (desc.BindFlags & D3D11_BIND_CONSTANT_BUFFER);
+
+		// Partial updates are sent from the shadow, so updatable buffers need one.
+		ASSERT(false == m_hasBoxes || true == hasShadow);
+		ASSERT(D3D11_USAGE_IMMUTABLE != m_usage || false == hasShadow);
+
+		if (true == hasShadow)
+		{
+			m_shadow.resize(size, 0);
+			if (nullptr != pData)
+				memcpy(m_shadow.data(), pData, size);
+		}
+	}
+
+	void Buffer::Upload(const void* data, size_t numBytes)
+	{
+		// I figure this mistake will be made a couple of times, better catch it here.
+		ASSERT(m_size == numBytes);
+		ASSERT(D3D11_USAGE_IMMUTABLE != m_usage);
+
+		if (false == HasShadow())
+		{
+			UploadWhole(data);
+			return;
+		}
+
+		// Compare by 16 bytes (a constant, or a typical vertex attribute), copying what differs.
+		const uint8_t *pSource = static_cast<const uint8_t *>(data);
+		uint8_t *pShadow = m_shadow.data();
+		if (true == m_isStale)
+			memcpy(pShadow, pSource, m_size);
+		else
+		{
+			size_t runStart = SIZE_MAX;
+			for (size_t offset = 0; offset < m_size; offset += 16)
+			{
+				const size_t blockSize = std::min<size_t>(16, m_size - offset);
+				if (0 != memcmp(pShadow + offset, pSource + offset, blockSize))
+				{
+					memcpy(pShadow + offset, pSource + offset, blockSize);
+					if (SIZE_MAX == runStart)
+						runStart = offset;
+				}
+				else if (SIZE_MAX != runStart)
+				{
+					AddDirty(runStart, offset);
+					runStart = SIZE_MAX;
+				}
+			}
+
+			if (SIZE_MAX != runStart)
+				AddDirty(runStart, m_size);
+		}
+
+		Flush();
+	}
+
+	void Buffer::Write(size_t offset, const void *pData, size_t numBytes)
+	{
+		ASSERT(offset + numBytes <= m_size);
+		ASSERT(true == HasShadow());
+
+		memcpy(m_shadow.data() + offset, pData, numBytes);
+		AddDirty(offset, offset + numBytes);
+	}
+
+	void Buffer::AddDirty(size_t offset, size_t end)
+	{
+		// Extend the last range if it's a continuation (the common case); Flush() sorts out the rest.
+		if (false == m_dirty.empty() && offset >= m_dirty.back().first && offset <= m_dirty.back().second + kCoalesceGap)
+			m_dirty.back().second = std::max<size_t>(m_dirty.back().second, end);
+		else
+			m_dirty.push_back(std::make_pair(offset, end));
+	}
+
+	void Buffer::UploadWhole(const void *pData)
+	{
+		ID3D11DeviceContext *pContext = GetContext();
+		if (D3D11_USAGE_DYNAMIC == m_usage)
+		{
+			D3D11_MAPPED_SUBRESOURCE mappedRes;
+			VERIFY(S_OK == pContext->Map(m_pBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedRes));
+			{
+				StreamCopy(mappedRes.pData, pData, m_size);
+			}
+			pContext->Unmap(m_pBuffer, 0);
+		}
+		else
+			pContext->UpdateSubresource(m_pBuffer, 0, nullptr, pData, 0, 0);
+
+		s_uploadStats.numBytes += m_size;
+		++s_uploadStats.numUploads;
+		++s_uploadStats.numWhole;
+	}
+
+	void Buffer::Flush()
+	{
+		ASSERT(true == HasShadow());
+
+		if (false == m_isStale && true == m_dirty.empty())
+		{
+			++s_uploadStats.numSkipped;
+			return;
+		}
+
+		// Coalesce.
+		size_t numDirtyBytes = 0;
+		if (false == m_dirty.empty())
+		{
+			std::sort(m_dirty.begin(), m_dirty.end());
+
+			size_t iMerged = 0;
+			for (size_t iRange = 1; iRange < m_dirty.size(); ++iRange)
+			{
+				std::pair<size_t, size_t> &merged = m_dirty[iMerged];
+				if (m_dirty[iRange].first <= merged.second + kCoalesceGap)
+					merged.second = std::max<size_t>(merged.second, m_dirty[iRange].second);
+				else
+					m_dirty[++iMerged] = m_dirty[iRange];
+			}
+
+			m_dirty.resize(iMerged+1);
+
+			for (const auto &range : m_dirty)
+				numDirtyBytes += range.second - range.first;
+		}
+
+		const bool isWhole = true == m_isStale || false == m_hasBoxes || numDirtyBytes >= kWholeUploadFraction*m_size;
+		if (true == isWhole)
+			UploadWhole(m_shadow.data());
+		else
+		{
+			ID3D11DeviceContext *pContext = GetContext();
+			for (const auto &range : m_dirty)
+			{
+				D3D11_BOX box;
+				box.left = (UINT) range.first;
+				box.right = (UINT) range.second;
+				box.top = box.front = 0;
+				box.bottom = box.back = 1;
+				pContext->UpdateSubresource(m_pBuffer, 0, &box, m_shadow.data() + range.first, 0, 0);
+
+				s_uploadStats.numBytes += range.second - range.first;
+				++s_uploadStats.numUploads;
+			}
+		}
+
+		m_dirty.clear();
+		m_isStale = false;
+	}
+
+	void *Buffer::MapDiscard()
+	{
+		ASSERT(D3D11_USAGE_DYNAMIC == m_usage);
+
+		D3D11_MAPPED_SUBRESOURCE mappedRes;
+		VERIFY(S_OK == GetContext()->Map(m_pBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedRes));
+
+		// Written in place, so the shadow no longer says what's on the GPU.
+		m_dirty.clear();
+		m_isStale = true;
+
+		s_uploadStats.numBytes += m_size;
+		++s_uploadStats.numUploads;
+		++s_uploadStats.numWhole;
+
+		return mappedRes.pData;
+	}
+
+	void Buffer::Unmap()
+	{
+		GetContext()->Unmap(m_pBuffer, 0);
+	}
+}
@@ -7,35 +7,62 @@
 
 namespace D3D
 {
+	// Since the last ResetUploadStats() (which D3D::BeginFrame() calls).
+	struct UploadStats
+	{
+		uint64_t numBytes;       // Sent to the driver.
+		unsigned int numUploads; // Map() or UpdateSubresource() calls.
+		unsigned int numWhole;   // Of which whole buffers (discards for dynamic ones).
+		unsigned int numSkipped; // Uploads or flushes with nothing changed.
+	};
+
+	const UploadStats &GetUploadStats();
+	void ResetUploadStats();
+
+	// For copies to mapped (write-combined) memory: large ones use streaming stores, bypassing the cache.
+	void StreamCopy(void *pDest, const void *pSource, size_t numBytes);
+
+	template<typename T> class BufferView;
+
+	// Buffers with a shadow (a copy of their contents; see kBufferUpdatable & kBufferDynamicShadowed) only upload what changed:
+	// - Upload() compares to it (by 16 bytes) & Write() marks what it writes; Flush() sends dirty ranges.
+	// - Ranges close to each other are coalesced; if most of the buffer changed, all of it is sent.
+	// - Ranges are written with UpdateSubresource() boxes, which needs D3D11_USAGE_DEFAULT (kBufferUpdatable).
+	//   Dynamic buffers are sent whole (discarding), but only if anything changed.
+	// Without one (constant buffers, which keep their own copy, and plain dynamic buffers) Upload() always sends all of it.
 	class Buffer : public boost::noncopyable
 	{
 	public:
 		typedef std::unique_ptr<Buffer> Ptr;
 
-		Buffer(ID3D11Buffer &buffer, size_t size) :
-			m_pBuffer(&buffer), m_size(size)
-		{
-		}
+		// 'pData' is what the buffer was created with, if anything.
+		Buffer(ID3D11Buffer &buffer, size_t size, const void *pData = nullptr, bool hasShadow = false);
 
 		virtual ~Buffer()
 		{
 			SAFE_RELEASE(m_pBuffer);
 		}
 
-		// Always upload the entire buffer; this suffices in most designs and is most hardware-friendly.
-		void Upload(const void* data, size_t numBytes)
+		// Entire buffer; uploads right away (what changed, see above).
+		void Upload(const void* data, size_t numBytes);
+
+		// Part of it; uploaded by Flush(). Requires a shadow.
+		void Write(size_t offset, const void *pData, size_t numBytes);
+		void Flush();
+
+		bool HasShadow() const { return false == m_shadow.empty(); }
+
+		// Dynamic buffers only: all of it (WRITE_DISCARD) to write to in place, see BufferView.
+		// This bypasses the shadow copy, so don't mix with Upload() or Write() unless all of it is written again.
+		template<typename T>
+		BufferView<T> Map()
 		{
-			// I figure this mistake will be made a couple of times, better catch it here.
-			ASSERT(m_size == numBytes);
-
-			D3D11_MAPPED_SUBRESOURCE mappedRes;
-			VERIFY(S_OK == GetContext()->Map(m_pBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedRes));
-			{
-				memcpy(mappedRes.pData, data, m_size);
-			}
-			GetContext()->Unmap(m_pBuffer, 0);
+			return BufferView<T>(*this);
 		}
 
+		void *MapDiscard();
+		void Unmap();
+
 		ID3D11Buffer *Get() const { return m_pBuffer; }
 		operator ID3D11Buffer *() const { return Get(); }
 
@@ -45,8 +72,17 @@ namespace D3D
 		// I can't reasonably cast to this without it being confusing and bad design.
 
 	private:
+		void AddDirty(size_t offset, size_t end);
+		void UploadWhole(const void *pData);
+
 		ID3D11Buffer *m_pBuffer;
 		size_t m_size;
+
+		D3D11_USAGE m_usage;
+		bool m_hasBoxes;                 // Partial updates possible.
+		bool m_isStale;                  // Contents undefined, so upload all of it next.
+		std::vector<uint8_t> m_shadow;   // What's on the GPU (once flushed), if kept.
+		std::vector<std::pair<size_t, size_t>> m_dirty; // [offset, end)
 	};
 
 	class VertexBuffer : public Buffer
@@ -54,8 +90,8 @@ namespace D3D
 	public:
 		typedef std::unique_ptr<VertexBuffer> Ptr;
 
-		VertexBuffer(ID3D11Buffer &buffer, size_t numBytes) :
-			Buffer(buffer, numBytes)
+		VertexBuffer(ID3D11Buffer &buffer, size_t numBytes, const void *pData = nullptr, bool hasShadow = false) :
+			Buffer(buffer, numBytes, pData, hasShadow)
 		{
 		}
 
@@ -69,14 +105,20 @@ namespace D3D
 	public:
 		typedef std::unique_ptr<IndexBuffer> Ptr;
 
-		IndexBuffer(ID3D11Buffer &buffer, size_t numBytes) :
-			Buffer(buffer, numBytes)
+		IndexBuffer(ID3D11Buffer &buffer, size_t numBytes, DXGI_FORMAT format = DXGI_FORMAT_R32_UINT, const void *pData = nullptr, bool hasShadow = false) :
+			Buffer(buffer, numBytes, pData, hasShadow)
+			, m_format(format)
 		{
+			ASSERT(DXGI_FORMAT_R16_UINT == format || DXGI_FORMAT_R32_UINT == format);
 		}
 
 		~IndexBuffer() {}
 
+		DXGI_FORMAT GetFormat() const { return m_format; }
+		size_t GetNumIndices() const { return GetSize() / ((DXGI_FORMAT_R16_UINT == m_format) ? 2 : 4); }
+
 	private:
+		const DXGI_FORMAT m_format;
 	};
 
 	class ConstantBufferGPU : public Buffer
@@ -105,6 +147,60 @@ namespace D3D
 		const std::string &m_name;
 	};
 
+	// Scoped, typed write view of a mapped buffer (see Buffer::Map()); unmaps when it goes out of scope.
+	// It points straight into driver memory, which is write-combined & undefined after a discard:
+	// write all of it (in order, ideally) and never read it back.
+	template<typename T>
+	class BufferView : public boost::noncopyable
+	{
+	public:
+		explicit BufferView(Buffer &buffer) :
+			m_pBuffer(&buffer)
+			, m_pData(static_cast<T *>(buffer.MapDiscard()))
+			, m_count(buffer.GetSize() / sizeof(T))
+		{
+			ASSERT(0 != m_count);
+		}
+
+		BufferView(BufferView &&view) :
+			m_pBuffer(view.m_pBuffer)
+			, m_pData(view.m_pData)
+			, m_count(view.m_count)
+		{
+			view.m_pBuffer = nullptr;
+		}
+
+		~BufferView()
+		{
+			if (nullptr != m_pBuffer)
+				m_pBuffer->Unmap();
+		}
+
+		T *operator->() const { return m_pData; }
+		T &operator*() const { return *m_pData; }
+
+		T &operator[](size_t index) const
+		{
+			ASSERT(index < m_count);
+			return m_pData[index];
+		}
+
+		T *Get() const { return m_pData; }
+		size_t GetCount() const { return m_count; }
+
+		// Bulk copy of vertices, instances and such (see StreamCopy()).
+		void Write(size_t index, const T *pSource, size_t count)
+		{
+			ASSERT(index + count <= m_count);
+			StreamCopy(m_pData + index, pSource, count*sizeof(T));
+		}
+
+	private:
+		Buffer *m_pBuffer;
+		T *m_pData;
+		const size_t m_count;
+	};
+
 	// This is a workaround to keep ConstantBufferGPU non-templatized and easy to pass around.
 	template <typename T>
 	class ConstantBuffer : public ConstantBufferGPU
@@ -125,6 +221,13 @@ namespace D3D
 			ConstantBufferGPU::Upload(&m_local, sizeof(T));
 		}
 
+		// Skips 'm_local' (and the copy from it) altogether: cb.Map()->field = ...;
+		// Requires a dynamic buffer; see BufferView for the rules.
+		BufferView<T> Map()
+		{
+			return Buffer::Map<T>();
+		}
+
 		T m_local;
 	};
 }
@@ -0,0 +1,170 @@
+/*
+	D3D: per-frame constant buffer ring.
+*/
+
+#include "../Platform.h"
+#include "../D3D.h"
+
+namespace D3D
+{
+	// Constant buffer offsets & sizes go by 16 constants.
+	const size_t kConstantRingAlignment = 256;
+
+	ConstantRing::~ConstantRing()
+	{
+		Unmap();
+
+		for (ID3D11Query *pFence : m_fences)
+			SAFE_RELEASE(pFence);
+
+		for (ID3D11Buffer *pBuffer : m_buffers)
+			SAFE_RELEASE(pBuffer);
+	}
+
+	void ConstantRing::BeginFrame()
+	{
+		ASSERT(nullptr == m_pMapped);
+
+		memset(&m_stats, 0, sizeof(m_stats));
+		m_stats.frameSize = m_frameSize;
+
+		m_iFrame = (m_iFrame+1) % m_buffers.size();
+		m_head = 0;
+
+		// With a few frames of latency this shouldn't be waiting, unless the GPU's the bottleneck.
+		if (true == m_isFenced[m_iFrame])
+		{
+			ID3D11DeviceContext *pContext = GetContext();
+			if (S_FALSE == pContext->GetData(m_fences[m_iFrame], nullptr, 0, 0))
+			{
+				++m_stats.numFenceWaits;
+				while (S_FALSE == pContext->GetData(m_fences[m_iFrame], nullptr, 0, 0))
+					std::this_thread::yield();
+			}
+
+			m_isFenced[m_iFrame] = false;
+		}
+	}
+
+	void ConstantRing::EndFrame()
+	{
+		Unmap();
+
+		if (0 != m_head)
+		{
+			GetContext()->End(m_fences[m_iFrame]);
+			m_isFenced[m_iFrame] = true;
+		}
+	}
+
+	bool ConstantRing::Allocate(const void *pData, size_t size, ConstantAllocation &allocation)
+	{
+		// Must be a multiple of 16 bytes (128-bit vector), like ConstantBufferGPU; at most 4096 of them can be bound.
+		ASSERT(0 == (size & 15) && 0 != size && size <= 65536);
+
+		const size_t alignedSize = (size + kConstantRingAlignment-1) & ~(kConstantRingAlignment-1);
+		if (m_head + alignedSize > m_frameSize)
+		{
+			++m_stats.numOverflows;
+			return false;
+		}
+
+		if (nullptr == m_pMapped)
+		{
+			// The fence says the GPU's done with this buffer & what's been written this frame is left alone.
+			D3D11_MAPPED_SUBRESOURCE mappedRes;
+			VERIFY(S_OK == GetContext()->Map(m_buffers[m_iFrame], 0, D3D11_MAP_WRITE_NO_OVERWRITE, 0, &mappedRes));
+			m_pMapped = static_cast<uint8_t *>(mappedRes.pData);
+			++m_stats.numMaps;
+		}
+
+		StreamCopy(m_pMapped + m_head, pData, size);
+
+		allocation.pBuffer = m_buffers[m_iFrame];
+		allocation.firstConstant = (UINT) (m_head/16);
+		allocation.numConstants = (UINT) (alignedSize/16);
+
+		m_head += alignedSize;
+
+		++m_stats.numAllocations;
+		m_stats.numBytes = m_head;
+
+		return true;
+	}
+
+	void ConstantRing::Unmap()
+	{
+		if (nullptr != m_pMapped)
+		{
+			GetContext()->Unmap(m_buffers[m_iFrame], 0);
+			m_pMapped = nullptr;
+		}
+	}
+
+	void ConstantRing::BindVS(unsigned int slot, const ConstantAllocation &allocation)
+	{
+		Unmap();
+		GetStateCache().SetVSConstantBufferRange(slot, allocation.pBuffer, allocation.firstConstant, allocation.numConstants);
+	}
+
+	void ConstantRing::BindPS(unsigned int slot, const ConstantAllocation &allocation)
+	{
+		Unmap();
+		GetStateCache().SetPSConstantBufferRange(slot, allocation.pBuffer, allocation.firstConstant, allocation.numConstants);
+	}
+
+	ConstantRing *CreateConstantRing(size_t frameSize /* = 1 << 20 */, unsigned int numFrames /* = 3 */)
+	{
+		ASSERT(0 != numFrames && 0 == (frameSize % kConstantRingAlignment));
+
+		ID3D11Device *pDevice = GetDevice();
+
+		// Offsets need the 11.1 runtime as well as driver support, as does mapping constant buffers without discarding.
+		D3D11_FEATURE_DATA_D3D11_OPTIONS options;
+		memset(&options, 0, sizeof(options));
+		if (false == GetStateCache().HasConstantBufferOffsets() ||
+			FAILED(pDevice->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))) ||
+			FALSE == options.ConstantBufferOffsetting || FALSE == options.MapNoOverwriteOnDynamicConstantBuffer)
+		{
+			// Not an error: callers fall back to uploading constant buffers one by one.
+			DEBUG_LOG("%s", "Constant buffer offsets not supported (requires Direct3D 11.1).");
+			return nullptr;
+		}
+
+		std::unique_ptr<ConstantRing> ring(new ConstantRing());
+		ring->m_frameSize = frameSize;
+		ring->m_isFenced.resize(numFrames, false);
+
+		D3D11_BUFFER_DESC bufferDesc;
+		bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+		bufferDesc.ByteWidth = (UINT) frameSize;
+		bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		bufferDesc.MiscFlags = 0;
+		bufferDesc.StructureByteStride = 0;
+
+		D3D11_QUERY_DESC queryDesc;
+		queryDesc.Query = D3D11_QUERY_EVENT;
+		queryDesc.MiscFlags = 0;
+
+		for (unsigned int iFrame = 0; iFrame < numFrames; ++iFrame)
+		{
+			ID3D11Buffer *pBuffer = nullptr;
+			ID3D11Query *pFence = nullptr;
+			if (FAILED(pDevice->CreateBuffer(&bufferDesc, nullptr, &pBuffer)) || FAILED(pDevice->CreateQuery(&queryDesc, &pFence)))
+			{
+				SAFE_RELEASE(pBuffer);
+				SetLastError("Can not create constant ring buffer.");
+				return nullptr;
+			}
+
+			ring->m_buffers.push_back(pBuffer);
+			ring->m_fences.push_back(pFence);
+		}
+
+		memset(&ring->m_stats, 0, sizeof(ring->m_stats));
+		ring->m_stats.frameSize = frameSize;
+
+		return ring.release();
+	}
+}
@@ -0,0 +1,80 @@
+/*
+	D3D: per-frame constant buffer ring.
+
+	Per-draw constants in a ConstantBuffer each mean a WRITE_DISCARD, and thus a buffer rename in the driver.
+	This sub-allocates them from one large dynamic buffer per frame in flight instead:
+
+	- Allocate() is a pointer bump & a memcpy; the frame's buffer is mapped (WRITE_NO_OVERWRITE) on first use.
+	- Allocations are bound by offset (Direct3D 11.1), which requires them to start at & span multiples of
+	  256 bytes; sizes must be multiples of 16 bytes, like any constant buffer.
+	- A buffer can't be drawn from while mapped, so Unmap() (or bind, which does it) before drawing.
+	  Allocate everything for a batch first, then draw, to map once.
+	- An event query per frame fences each buffer; BeginFrame() waits for the GPU to be done with it.
+*/
+
+#pragma once
+
+namespace D3D
+{
+	struct ConstantAllocation
+	{
+		ID3D11Buffer *pBuffer;
+		UINT firstConstant, numConstants; // In 16-byte constants.
+	};
+
+	class ConstantRing : public boost::noncopyable
+	{
+	public:
+		typedef std::unique_ptr<ConstantRing> Ptr;
+
+		// Of the current frame.
+		struct Stats
+		{
+			size_t numBytes, frameSize;
+			unsigned int numAllocations;
+			unsigned int numMaps;
+			unsigned int numOverflows; // Allocations that didn't fit.
+			unsigned int numFenceWaits;
+		};
+
+		~ConstantRing();
+
+		// Waits for the frame that last used this buffer, if needed.
+		void BeginFrame();
+		void EndFrame();
+
+		// False if the frame's buffer is full.
+		bool Allocate(const void *pData, size_t size, ConstantAllocation &allocation);
+
+		template<typename T>
+		bool Allocate(const T &constants, ConstantAllocation &allocation)
+		{
+			return Allocate(&constants, sizeof(T), allocation);
+		}
+
+		void Unmap();
+
+		// Through the state cache; unmaps.
+		void BindVS(unsigned int slot, const ConstantAllocation &allocation);
+		void BindPS(unsigned int slot, const ConstantAllocation &allocation);
+
+		const Stats &GetStats() const { return m_stats; }
+
+	private:
+		friend ConstantRing *CreateConstantRing(size_t frameSize, unsigned int numFrames);
+		ConstantRing() {}
+
+		std::vector<ID3D11Buffer *> m_buffers;
+		std::vector<ID3D11Query *> m_fences;
+		std::vector<bool> m_isFenced;
+		unsigned int m_iFrame = 0;
+		size_t m_frameSize = 0, m_head = 0;
+		uint8_t *m_pMapped = nullptr;
+
+		Stats m_stats;
+	};
+
+	// Returns nullptr if the device or driver can't bind constant buffers by offset (no error set),
+	// or if creating it's resources fails (see SetLastError()).
+	ConstantRing *CreateConstantRing(size_t frameSize = 1 << 20, unsigned int numFrames = 3);
+}
@@ -0,0 +1,200 @@
+/*
+	D3D: instanced drawing.
+*/
+
+#include "../Platform.h"
+#include "../D3D.h"
+
+// Include headers with the instancing shader bytecode.
+#include "../../shaders/Instanced_VS.h"
+#include "../../shaders/Instanced_PS.h"
+
+namespace D3D
+{
+	static_assert(sizeof(InstanceData) == 52, "InstanceData must match kInstanceElements.");
+
+	const D3D11_INPUT_ELEMENT_DESC kInstanceElements[kNumInstanceElements] = {
+		{ "TRANSFORM", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, kInstanceSlot,  0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "TRANSFORM", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, kInstanceSlot, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "TRANSFORM", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, kInstanceSlot, 32, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "COLOR",     1, DXGI_FORMAT_R8G8B8A8_UNORM,     kInstanceSlot, 48, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	};
+
+	void AppendInstanceElements(VertexDecl &decl)
+	{
+		decl.Add("TRANSFORM", 0, kVertexFloat4, kInstanceSlot)
+			.Add("TRANSFORM", 1, kVertexFloat4, kInstanceSlot)
+			.Add("TRANSFORM", 2, kVertexFloat4, kInstanceSlot)
+			.Add("COLOR", 1, kVertexUNorm8x4, kInstanceSlot)
+			.SetInstanced(kInstanceSlot);
+	}
+
+	/*
+		InstanceBuffer.
+	*/
+
+	void InstanceBuffer::Add(const Matrix44 &transform, uint32_t color /* = 0xffffffff */)
+	{
+		InstanceData instance;
+		for (unsigned int iColumn = 0; iColumn < 3; ++iColumn)
+		{
+			float *column = instance.columns[iColumn];
+			column[0] = (&transform.rows[0].x)[iColumn];
+			column[1] = (&transform.rows[1].x)[iColumn];
+			column[2] = (&transform.rows[2].x)[iColumn];
+			column[3] = (&transform.rows[3].x)[iColumn];
+		}
+
+		instance.color = color;
+		m_instances.push_back(instance);
+	}
+
+	void InstanceBuffer::Add(const Matrix44 *pTransforms, const uint32_t *pColors, size_t count)
+	{
+		m_instances.reserve(m_instances.size() + count);
+		for (size_t iInstance = 0; iInstance < count; ++iInstance)
+			Add(pTransforms[iInstance], (nullptr != pColors) ? pColors[iInstance] : 0xffffffff);
+	}
+
+	bool InstanceBuffer::Upload()
+	{
+		const size_t count = m_instances.size();
+		if (0 == count)
+			return true;
+
+		if (nullptr == m_buffer || m_buffer->GetSize() < count*sizeof(InstanceData))
+		{
+			size_t capacity = 64;
+			while (capacity < count)
+				capacity *= 2;
+
+			m_buffer.reset(CreateVertexBuffer(capacity*sizeof(InstanceData), nullptr, kBufferDynamic));
+			if (nullptr == m_buffer)
+			{
+				SetLastError("Can not create instance buffer.");
+				return false;
+			}
+		}
+
+		m_buffer->Map<InstanceData>().Write(0, m_instances.data(), count);
+		return true;
+	}
+
+	void DrawInstanced(const InstanceBuffer &instances, unsigned int numVertices, unsigned int startVertex /* = 0 */)
+	{
+		ASSERT(nullptr != instances.GetBuffer());
+
+		GetStateCache().SetVertexBuffer(kInstanceSlot, instances.GetBuffer()->Get(), sizeof(InstanceData));
+		GetContext()->DrawInstanced(numVertices, instances.GetCount(), startVertex, 0);
+	}
+
+	void DrawIndexedInstanced(const InstanceBuffer &instances, unsigned int numIndices, unsigned int startIndex /* = 0 */, int baseVertex /* = 0 */)
+	{
+		ASSERT(nullptr != instances.GetBuffer());
+
+		GetStateCache().SetVertexBuffer(kInstanceSlot, instances.GetBuffer()->Get(), sizeof(InstanceData));
+		GetContext()->DrawIndexedInstanced(numIndices, instances.GetCount(), startIndex, baseVertex, 0);
+	}
+
+	/*
+		Benchmark.
+	*/
+
+	void BenchmarkInstancing(unsigned int numInstances /* = 10000 */)
+	{
+		ID3D11Device *pDevice = GetDevice();
+		ID3D11DeviceContext *pContext = GetContext();
+		StateCache &stateCache = GetStateCache();
+
+		// Quad (2 triangles).
+		const Vector3 quad[] =
+		{
+			Vector3(-1.f,  1.f, 0.f), Vector3(1.f,  1.f, 0.f), Vector3(1.f, -1.f, 0.f),
+			Vector3(-1.f,  1.f, 0.f), Vector3(1.f, -1.f, 0.f), Vector3(-1.f, -1.f, 0.f)
+		};
+
+		std::unique_ptr<VertexBuffer> vertices(CreateVertexBuffer(sizeof(quad), quad));
+
+		VertexDecl decl;
+		decl.Add("POSITION", 0, kVertexFloat3);
+		AppendInstanceElements(decl);
+
+		ID3D11InputLayout *pInputLayout = GetInputLayoutCache().Get(decl, g_Instanced_VS, sizeof(g_Instanced_VS));
+		ID3D11VertexShader *pVertexShader = nullptr;
+		ID3D11PixelShader *pPixelShader = nullptr;
+		VERIFY(nullptr != pInputLayout);
+		VERIFY(S_OK == pDevice->CreateVertexShader(g_Instanced_VS, sizeof(g_Instanced_VS), nullptr, &pVertexShader));
+		VERIFY(S_OK == pDevice->CreatePixelShader(g_Instanced_PS, sizeof(g_Instanced_PS), nullptr, &pPixelShader));
+
+		// A grid of small quads, each a little turned.
+		InstanceBuffer instances;
+		const unsigned int gridSize = (unsigned int) ceilf(sqrtf((float) numInstances));
+		const float cellSize = 2.f/gridSize;
+		for (unsigned int iInstance = 0; iInstance < numInstances; ++iInstance)
+		{
+			const float X = -1.f + cellSize*(iInstance % gridSize + 0.5f), Y = 1.f - cellSize*(iInstance / gridSize + 0.5f);
+			Matrix44 transform = Matrix44::Scaling(Vector3(0.4f*cellSize)) * Matrix44::RotationZ(0.1f*iInstance);
+			transform.SetTranslation(Vector3(X, Y, 0.f));
+			instances.Add(transform, 0xff000000 | (iInstance*2654435761u >> 8));
+		}
+
+		VERIFY(true == instances.Upload());
+
+		stateCache.SetInputLayout(pInputLayout);
+		stateCache.SetVertexShader(pVertexShader);
+		stateCache.SetPixelShader(pPixelShader);
+		stateCache.SetVertexBuffer(0, vertices->Get(), sizeof(Vector3));
+		stateCache.SetVertexBuffer(kInstanceSlot, instances.GetBuffer()->Get(), sizeof(InstanceData));
+		stateCache.SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+		D3D11_QUERY_DESC queryDesc;
+		queryDesc.Query = D3D11_QUERY_EVENT;
+		queryDesc.MiscFlags = 0;
+		ID3D11Query *pFence = nullptr;
+		VERIFY(S_OK == pDevice->CreateQuery(&queryDesc, &pFence));
+
+		// CPU time is submission only; GPU time is until the fence says it's done.
+		// Before: a draw per quad; the start instance picks its data, so only the number of calls differs.
+		// After: one instanced draw.
+		const unsigned int numRuns = 8;
+		float submitTime[2] = { 0.f, 0.f }, totalTime[2] = { 0.f, 0.f };
+		for (unsigned int iRun = 0; iRun < numRuns*2; ++iRun)
+		{
+			const unsigned int iMethod = iRun & 1;
+
+			Timer timer;
+			if (0 == iMethod)
+			{
+				for (unsigned int iInstance = 0; iInstance < numInstances; ++iInstance)
+					pContext->DrawInstanced(6, 1, 0, iInstance);
+			}
+			else
+				pContext->DrawInstanced(6, numInstances, 0, 0);
+
+			submitTime[iMethod] += timer.Get();
+
+			pContext->End(pFence);
+			while (S_FALSE == pContext->GetData(pFence, nullptr, 0, 0))
+				std::this_thread::yield();
+
+			totalTime[iMethod] += timer.Get();
+		}
+
+		// Unbind before release, lest the state cache skip binding whatever's created at the same address next.
+		stateCache.SetInputLayout(nullptr);
+		stateCache.SetVertexShader(nullptr);
+		stateCache.SetPixelShader(nullptr);
+		stateCache.SetVertexBuffer(0, nullptr, 0);
+		stateCache.SetVertexBuffer(kInstanceSlot, nullptr, 0);
+
+		SAFE_RELEASE(pFence);
+		SAFE_RELEASE(pPixelShader);
+		SAFE_RELEASE(pVertexShader);
+
+		DEBUG_LOG("Instancing (%u quads, average of %u runs):", numInstances, numRuns);
+		DEBUG_LOG("- Draw per quad: %.3f ms. submit, %.3f ms. total, %.1fM quads/sec.",
+			1000.f*submitTime[0]/numRuns, 1000.f*totalTime[0]/numRuns, numRuns*numInstances/(1000000.f*totalTime[0]));
+		DEBUG_LOG("- Instanced:     %.3f ms. submit, %.3f ms. total, %.1fM quads/sec.",
+			1000.f*submitTime[1]/numRuns, 1000.f*totalTime[1]/numRuns, numRuns*numInstances/(1000000.f*totalTime[1]));
+	}
+}
@@ -0,0 +1,69 @@
+/*
+	D3D: instanced drawing.
+
+	Per-instance data lives in a vertex buffer of its own, bound to kInstanceSlot and stepped once per
+	instance (D3D11_INPUT_PER_INSTANCE_DATA), so a single DrawInstanced() or DrawIndexedInstanced() replaces
+	a draw (and a constant upload) per copy.
+
+	- Add the instance elements to a vertex declaration with AppendInstanceElements() (or kInstanceElements
+	  to an array of your own); the matching shader input & transform are in shaders/Instanced.inc.
+	- InstanceBuffer gathers transforms & colors and uploads them in one go (a single discard).
+	- To draw: DrawGeometry::pInstances & RenderQueue::AddInstanced(), or DrawInstanced() below.
+*/
+
+#pragma once
+
+namespace D3D
+{
+	const unsigned int kInstanceSlot = 1;
+
+	// An affine transform in 3 float4s (a Matrix44 keeps translation in its bottom row, so these are its
+	// first 3 columns: a shader transforms with 3 dot products), plus a color.
+	struct InstanceData
+	{
+		float columns[3][4];
+		uint32_t color; // ABGR, so RGBA in memory (like sprites).
+	};
+
+	const unsigned int kNumInstanceElements = 4;
+	extern const D3D11_INPUT_ELEMENT_DESC kInstanceElements[kNumInstanceElements];
+
+	// Adds kInstanceElements to 'decl' (as stream kInstanceSlot).
+	void AppendInstanceElements(VertexDecl &decl);
+
+	class InstanceBuffer : public boost::noncopyable
+	{
+	public:
+		typedef std::unique_ptr<InstanceBuffer> Ptr;
+
+		InstanceBuffer() {}
+		~InstanceBuffer() {}
+
+		void Clear() { m_instances.clear(); }
+
+		void Add(const Matrix44 &transform, uint32_t color = 0xffffffff);
+
+		// Arrays of 'count'; 'pColors' may be nullptr (white).
+		void Add(const Matrix44 *pTransforms, const uint32_t *pColors, size_t count);
+
+		// All instances to the GPU, growing the buffer (to the next power of 2) if they don't fit.
+		// Returns false (see SetLastError()) if that fails.
+		bool Upload();
+
+		// After Upload().
+		VertexBuffer *GetBuffer() const { return m_buffer.get(); }
+		unsigned int GetCount() const { return (unsigned int) m_instances.size(); }
+
+	private:
+		std::vector<InstanceData> m_instances;
+		VertexBuffer::Ptr m_buffer;
+	};
+
+	// Binds 'instances' to kInstanceSlot (through the state cache) & draws; the rest must be bound already.
+	void DrawInstanced(const InstanceBuffer &instances, unsigned int numVertices, unsigned int startVertex = 0);
+	void DrawIndexedInstanced(const InstanceBuffer &instances, unsigned int numIndices, unsigned int startIndex = 0, int baseVertex = 0);
+
+	// Draws 'numInstances' small quads (with the Instanced shaders) to the bound target, a draw per quad vs. one
+	// instanced draw, and logs the CPU & GPU time of both. Call after D3D::Create().
+	void BenchmarkInstancing(unsigned int numInstances = 10000);
+}
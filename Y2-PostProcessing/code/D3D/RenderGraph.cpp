@@ -0,0 +1,294 @@
+/*
+	D3D: render graph.
+*/
+
+#include "../Platform.h"
+#include <limits.h>
+#include "../D3D.h"
+
+namespace D3D
+{
+	RenderGraph::PassBuilder &RenderGraph::PassBuilder::Read(GraphTarget target)
+	{
+		ASSERT(target < m_graph.m_targets.size());
+
+		Pass &pass = m_graph.m_passes[m_iPass];
+		ASSERT(pass.reads.size() < kMaxPassReads);
+		pass.reads.push_back(target);
+
+		++m_graph.m_targets[target].refCount;
+		return *this;
+	}
+
+	RenderGraph::PassBuilder &RenderGraph::PassBuilder::Write(GraphTarget target)
+	{
+		ASSERT(target < m_graph.m_targets.size());
+
+		// One target per pass.
+		Pass &pass = m_graph.m_passes[m_iPass];
+		ASSERT(kInvalidGraphTarget == pass.write);
+		pass.write = target;
+		pass.refCount = 1;
+
+		m_graph.m_targets[target].writers.push_back(m_iPass);
+		return *this;
+	}
+
+	RenderGraph::RenderGraph()
+	{
+		memset(&m_stats, 0, sizeof(m_stats));
+	}
+
+	RenderGraph::~RenderGraph()
+	{
+		ReleaseTextures();
+	}
+
+	void RenderGraph::Reset()
+	{
+		ReleaseTextures();
+		m_targets.clear();
+		m_passes.clear();
+	}
+
+	void RenderGraph::ReleaseTextures()
+	{
+		RenderTargetPool &pool = GetRenderTargetPool();
+		for (const Texture &texture : m_textures)
+			pool.Release(texture.pTarget);
+
+		m_textures.clear();
+	}
+
+	GraphTarget RenderGraph::CreateTarget(const char *name, const RenderTargetDesc &desc)
+	{
+		Target target;
+		target.name = name;
+		target.desc = desc;
+		target.viewport.TopLeftX = 0.f;
+		target.viewport.TopLeftY = 0.f;
+		target.viewport.Width = (float) desc.width;
+		target.viewport.Height = (float) desc.height;
+		target.viewport.MinDepth = 0.f;
+		target.viewport.MaxDepth = 1.f;
+		target.pTarget = nullptr;
+		target.refCount = 0;
+		target.firstPass = UINT_MAX;
+		target.lastPass = 0;
+		target.isImported = false;
+		m_targets.push_back(target);
+
+		return (GraphTarget) m_targets.size()-1;
+	}
+
+	GraphTarget RenderGraph::ImportTarget(const char *name, RenderTarget &renderTarget, const D3D11_VIEWPORT &viewport)
+	{
+		Target target;
+		target.name = name;
+		target.desc.width = (unsigned int) viewport.Width;
+		target.desc.height = (unsigned int) viewport.Height;
+		target.desc.format = DXGI_FORMAT_UNKNOWN;
+		target.viewport = viewport;
+		target.pTarget = &renderTarget;
+		target.refCount = 1; // Output, so always needed.
+		target.firstPass = UINT_MAX;
+		target.lastPass = 0;
+		target.isImported = true;
+		m_targets.push_back(target);
+
+		return (GraphTarget) m_targets.size()-1;
+	}
+
+	RenderGraph::PassBuilder RenderGraph::AddPass(const char *name, const PassFunction &execute)
+	{
+		Pass pass;
+		pass.name = name;
+		pass.execute = execute;
+		pass.write = kInvalidGraphTarget;
+		pass.refCount = 0;
+		pass.isCulled = false;
+		m_passes.push_back(pass);
+
+		return PassBuilder(*this, (unsigned int) m_passes.size()-1);
+	}
+
+	// Reference counting, from the targets nobody reads back to the passes that (only) write those.
+	void RenderGraph::Cull()
+	{
+		std::vector<GraphTarget> unused;
+		for (GraphTarget iTarget = 0; iTarget < m_targets.size(); ++iTarget)
+		{
+			if (0 == m_targets[iTarget].refCount)
+				unused.push_back(iTarget);
+		}
+
+		// Passes that write nothing can't contribute either.
+		for (Pass &pass : m_passes)
+		{
+			if (kInvalidGraphTarget == pass.write)
+				pass.isCulled = true;
+		}
+
+		while (false == unused.empty())
+		{
+			const Target &target = m_targets[unused.back()];
+			unused.pop_back();
+
+			for (unsigned int iWriter : target.writers)
+			{
+				Pass &pass = m_passes[iWriter];
+				if (0 == --pass.refCount)
+				{
+					pass.isCulled = true;
+					for (GraphTarget iRead : pass.reads)
+					{
+						if (0 == --m_targets[iRead].refCount)
+							unused.push_back(iRead);
+					}
+				}
+			}
+		}
+	}
+
+	// Assigns textures to transients: first come, first served, from those free by then & of the same description.
+	bool RenderGraph::Assign()
+	{
+		std::vector<GraphTarget> transients;
+		for (GraphTarget iTarget = 0; iTarget < m_targets.size(); ++iTarget)
+		{
+			const Target &target = m_targets[iTarget];
+			if (false == target.isImported && UINT_MAX != target.firstPass)
+			{
+				transients.push_back(iTarget);
+				m_stats.transientBytes += target.desc.GetNumBytes();
+			}
+		}
+
+		std::stable_sort(transients.begin(), transients.end(), [this](GraphTarget A, GraphTarget B)
+		{
+			return m_targets[A].firstPass < m_targets[B].firstPass;
+		});
+
+		// In case Execute() wasn't called.
+		ReleaseTextures();
+
+		RenderTargetPool &pool = GetRenderTargetPool();
+		for (GraphTarget iTarget : transients)
+		{
+			Target &target = m_targets[iTarget];
+
+			Texture *pTexture = nullptr;
+			for (Texture &texture : m_textures)
+			{
+				if (texture.desc == target.desc && texture.lastPass < target.firstPass)
+				{
+					pTexture = &texture;
+					break;
+				}
+			}
+
+			if (nullptr == pTexture)
+			{
+				Texture texture;
+				texture.pTarget = pool.Acquire(target.desc);
+				if (nullptr == texture.pTarget)
+					return false;
+
+				texture.desc = target.desc;
+				m_textures.push_back(texture);
+				pTexture = &m_textures.back();
+
+				m_stats.textureBytes += target.desc.GetNumBytes();
+			}
+
+			pTexture->lastPass = target.lastPass;
+			target.pTarget = pTexture->pTarget;
+		}
+
+		m_stats.numTransients = (unsigned int) transients.size();
+		m_stats.numTextures = (unsigned int) m_textures.size();
+		return true;
+	}
+
+	bool RenderGraph::Compile()
+	{
+		memset(&m_stats, 0, sizeof(m_stats));
+		m_stats.numPasses = (unsigned int) m_passes.size();
+
+		Cull();
+
+		// Lifetimes.
+		for (unsigned int iPass = 0; iPass < m_passes.size(); ++iPass)
+		{
+			const Pass &pass = m_passes[iPass];
+			if (true == pass.isCulled)
+			{
+				++m_stats.numCulled;
+				continue;
+			}
+
+			auto use = [this, iPass](GraphTarget iTarget)
+			{
+				Target &target = m_targets[iTarget];
+				target.firstPass = std::min<unsigned int>(target.firstPass, iPass);
+				target.lastPass = std::max<unsigned int>(target.lastPass, iPass);
+			};
+
+			for (GraphTarget iRead : pass.reads)
+				use(iRead);
+
+			use(pass.write);
+		}
+
+		return Assign();
+	}
+
+	void RenderGraph::Execute()
+	{
+		StateCache &stateCache = GetStateCache();
+		ID3D11ShaderResourceView *const kNoViews[kMaxPassReads] = { nullptr };
+
+		const Target *pLastWrite = nullptr;
+		for (const Pass &pass : m_passes)
+		{
+			if (true == pass.isCulled)
+				continue;
+
+			// Unbind the last pass's inputs first, as one of those might be the target now.
+			stateCache.SetPSShaderResources(0, kMaxPassReads, kNoViews);
+
+			const Target &write = m_targets[pass.write];
+			pLastWrite = &write;
+			stateCache.SetRenderTarget(write.pTarget->GetTargetView(), nullptr);
+			stateCache.SetViewport(write.viewport);
+
+			ID3D11ShaderResourceView *pViews[kMaxPassReads];
+			for (size_t iRead = 0; iRead < pass.reads.size(); ++iRead)
+				pViews[iRead] = m_targets[pass.reads[iRead]].pTarget->GetShaderView();
+
+			if (false == pass.reads.empty())
+				stateCache.SetPSShaderResources(0, (unsigned int) pass.reads.size(), pViews);
+
+			pass.execute(*this);
+		}
+
+		// Leave no texture bound, as the pool may release it.
+		stateCache.SetPSShaderResources(0, kMaxPassReads, kNoViews);
+		if (nullptr != pLastWrite && false == pLastWrite->isImported)
+			stateCache.SetRenderTarget(nullptr, nullptr);
+
+		ReleaseTextures();
+	}
+
+	RenderTarget &RenderGraph::GetTarget(GraphTarget target) const
+	{
+		ASSERT(target < m_targets.size() && nullptr != m_targets[target].pTarget);
+		return *m_targets[target].pTarget;
+	}
+
+	const D3D11_VIEWPORT &RenderGraph::GetViewport(GraphTarget target) const
+	{
+		ASSERT(target < m_targets.size());
+		return m_targets[target].viewport;
+	}
+}
@@ -0,0 +1,122 @@
+/*
+	D3D: render graph.
+
+	Each frame passes are declared along with the targets they read (bound as PS shader resources, t0 onwards)
+	and the one they write (bound as render target, with a viewport covering it). Compile() then:
+
+	- Culls passes that contribute nothing to an imported target (see ImportTarget()), which count as output.
+	- Computes the lifetime of each transient target (see CreateTarget()): first to last pass that uses it.
+	- Aliases transients whose lifetimes don't overlap. Direct3D 11 can't place resources in shared memory,
+	  so this means transients with the same description share a texture; contents don't carry over from
+	  one to the next, so write a transient before reading it.
+
+	Execute() runs what's left, in declaration order. Textures come from the render target pool (see
+	RenderTargetPool) and go back to it once executed, so once the declarations settle the next frame
+	gets the same ones and nothing is created anymore.
+	Target handles are valid until the next Reset().
+*/
+
+#pragma once
+
+#include <functional>
+
+namespace D3D
+{
+	typedef uint32_t GraphTarget;
+	const GraphTarget kInvalidGraphTarget = 0xffffffff;
+
+	const unsigned int kMaxPassReads = 8;
+
+	// Of the last Compile().
+	struct RenderGraphStats
+	{
+		unsigned int numPasses, numCulled;
+		unsigned int numTransients, numTextures; // Transient targets & the textures they share.
+		size_t transientBytes, textureBytes;     // Memory that'd take without aliasing & the actual amount.
+	};
+
+	class RenderGraph : public boost::noncopyable
+	{
+	public:
+		typedef std::unique_ptr<RenderGraph> Ptr;
+		typedef std::function<void (const RenderGraph &graph)> PassFunction;
+
+		// Returned by AddPass() to declare what it reads & writes.
+		class PassBuilder
+		{
+		public:
+			PassBuilder(RenderGraph &graph, unsigned int iPass) : m_graph(graph), m_iPass(iPass) {}
+
+			PassBuilder &Read(GraphTarget target);
+			PassBuilder &Write(GraphTarget target);
+
+		private:
+			RenderGraph &m_graph;
+			const unsigned int m_iPass;
+		};
+
+		RenderGraph();
+		~RenderGraph();
+
+		// Drops the last frame's declarations (and textures, if not executed).
+		void Reset();
+
+		GraphTarget CreateTarget(const char *name, const RenderTargetDesc &desc);
+		GraphTarget ImportTarget(const char *name, RenderTarget &target, const D3D11_VIEWPORT &viewport);
+
+		PassBuilder AddPass(const char *name, const PassFunction &execute);
+
+		// Returns false (see SetLastError()) if a texture can't be created.
+		bool Compile();
+
+		// Returns the textures to the pool when done.
+		void Execute();
+
+		// For pass functions (or after Compile()).
+		RenderTarget &GetTarget(GraphTarget target) const;
+		const D3D11_VIEWPORT &GetViewport(GraphTarget target) const;
+
+		const RenderGraphStats &GetStats() const { return m_stats; }
+
+	private:
+		struct Target
+		{
+			const char *name;
+			RenderTargetDesc desc;
+			D3D11_VIEWPORT viewport;
+			RenderTarget *pTarget;           // Imported, or assigned by Compile().
+			std::vector<unsigned int> writers;
+			unsigned int refCount;           // Readers left (during culling).
+			unsigned int firstPass, lastPass;
+			bool isImported;
+		};
+
+		struct Pass
+		{
+			const char *name;
+			PassFunction execute;
+			std::vector<GraphTarget> reads;
+			GraphTarget write;
+			unsigned int refCount;           // Targets written that are still needed (during culling).
+			bool isCulled;
+		};
+
+		// Shared by transients; from the pool.
+		struct Texture
+		{
+			RenderTarget *pTarget;
+			RenderTargetDesc desc;
+			unsigned int lastPass;           // Of the transient last assigned to it.
+		};
+
+		void Cull();
+		bool Assign();
+		void ReleaseTextures();
+
+		std::vector<Target> m_targets;
+		std::vector<Pass> m_passes;
+		std::vector<Texture> m_textures;
+
+		RenderGraphStats m_stats;
+	};
+}
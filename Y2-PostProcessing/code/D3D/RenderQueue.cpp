@@ -0,0 +1,263 @@
+/*
+	D3D: sort-key render queue.
+*/
+
+#include "../Platform.h"
+#include <limits.h>
+#include "../D3D.h"
+
+namespace D3D
+{
+	uint64_t MakeSortKey(unsigned int layer, unsigned int pass, float depth, const DrawState &state)
+	{
+		ASSERT(layer < 16 && pass < 16);
+
+		const uint64_t quantDepth = (uint64_t) (std::min<float>(std::max<float>(depth, 0.f), 1.f)*0xffffff);
+		const uint64_t shader = state.shaderID, material = state.materialID;
+		const uint64_t key = ((uint64_t) layer << 60) | ((uint64_t) pass << 56);
+
+		if (false == state.isTranslucent)
+			return key | (shader << 40) | (material << 24) | quantDepth;
+		else
+			return key | ((0xffffff - quantDepth) << 32) | (shader << 16) | material;
+	}
+
+	/*
+		ContextBackend.
+	*/
+
+	void ContextBackend::Submit(const DrawPacket *pPackets, const uint32_t *pOrder, size_t count, const uint8_t *pConstants, RenderQueueStats &stats)
+	{
+		ID3D11DeviceContext *pContext = GetContext();
+		StateCache &stateCache = GetStateCache();
+
+		const unsigned int numIssued = stateCache.GetStats().GetNumIssued(), numFiltered = stateCache.GetStats().GetNumFiltered();
+
+		// Per-draw constants into the ring up front, so it's mapped just once (packets that don't fit are uploaded as usual).
+		ConstantRing *pRing = GetConstantRing();
+		if (nullptr != pRing)
+		{
+			m_allocations.resize(count);
+			for (size_t iPacket = 0; iPacket < count; ++iPacket)
+			{
+				const DrawPacket &packet = pPackets[pOrder[iPacket]];
+				ConstantAllocation &allocation = m_allocations[iPacket];
+				allocation.pBuffer = nullptr;
+
+				if (UINT_MAX != packet.constantsOffset)
+				{
+					if (true == pRing->Allocate(pConstants + packet.constantsOffset, packet.pState->pDrawConstants->GetSize(), allocation))
+						++stats.numUploads;
+				}
+			}
+
+			pRing->Unmap();
+		}
+
+		for (size_t iPacket = 0; iPacket < count; ++iPacket)
+		{
+			const DrawPacket &packet = pPackets[pOrder[iPacket]];
+			const DrawState &state = *packet.pState;
+			const DrawGeometry &geometry = *packet.pGeometry;
+
+			// Material.
+			stateCache.SetInputLayout(state.pInputLayout);
+			stateCache.SetVertexShader(state.pVertexShader);
+			stateCache.SetPixelShader(state.pPixelShader);
+			stateCache.SetBlendState(state.pBlendState);
+			stateCache.SetDepthStencilState(state.pDepthState);
+			stateCache.SetRasterizerState(state.pRasterizerState);
+			stateCache.SetPSSamplers(0, 1, &state.pSampler);
+			stateCache.SetPSShaderResources(0, kMaxDrawTextures, state.pTextures);
+
+			if (nullptr != state.pMaterialConstants)
+			{
+				ID3D11Buffer *pBuffer = state.pMaterialConstants->Get();
+				stateCache.SetVSConstantBuffers(1, 1, &pBuffer);
+				stateCache.SetPSConstantBuffers(1, 1, &pBuffer);
+			}
+
+			// Per-draw constants: from the ring, or else the upload is always needed & the binding only when the buffer changes.
+			if (nullptr != pRing && nullptr != m_allocations[iPacket].pBuffer)
+			{
+				pRing->BindVS(0, m_allocations[iPacket]);
+				pRing->BindPS(0, m_allocations[iPacket]);
+			}
+			else if (nullptr != state.pDrawConstants)
+			{
+				ID3D11Buffer *pBuffer = state.pDrawConstants->Get();
+				stateCache.SetVSConstantBuffers(0, 1, &pBuffer);
+				stateCache.SetPSConstantBuffers(0, 1, &pBuffer);
+
+				if (UINT_MAX != packet.constantsOffset)
+				{
+					state.pDrawConstants->Upload(pConstants + packet.constantsOffset, state.pDrawConstants->GetSize());
+					++stats.numUploads;
+				}
+			}
+
+			// Geometry.
+			stateCache.SetVertexBuffer(0, geometry.pVertices->Get(), geometry.stride);
+			stateCache.SetPrimitiveTopology(geometry.topology);
+
+			if (0 != packet.numInstances)
+				stateCache.SetVertexBuffer(kInstanceSlot, geometry.pInstances->Get(), geometry.instanceStride);
+
+			if (nullptr != geometry.pIndices)
+			{
+				stateCache.SetIndexBuffer(geometry.pIndices->Get(), geometry.pIndices->GetFormat());
+				if (0 == packet.numInstances)
+					pContext->DrawIndexed(packet.count, packet.start, packet.baseVertex);
+				else
+					pContext->DrawIndexedInstanced(packet.count, packet.numInstances, packet.start, packet.baseVertex, packet.startInstance);
+			}
+			else
+			{
+				if (0 == packet.numInstances)
+					pContext->Draw(packet.count, packet.start);
+				else
+					pContext->DrawInstanced(packet.count, packet.numInstances, packet.start, packet.startInstance);
+			}
+
+			++stats.numDrawCalls;
+			stats.numInstances += packet.numInstances;
+		}
+
+		stats.numStateChanges += stateCache.GetStats().GetNumIssued() - numIssued;
+		stats.numStateFiltered += stateCache.GetStats().GetNumFiltered() - numFiltered;
+	}
+
+	/*
+		RenderQueue.
+	*/
+
+	RenderQueue::RenderQueue() :
+		m_numMaterials(0)
+	{
+		memset(&m_stats, 0, sizeof(m_stats));
+	}
+
+	void RenderQueue::Register(DrawState &state)
+	{
+		// Shader pairs are shared, so look them up; materials are all unique.
+		const auto shaders = std::make_pair(state.pVertexShader, state.pPixelShader);
+		const auto iShader = std::find(m_shaders.begin(), m_shaders.end(), shaders);
+		state.shaderID = (uint16_t) (iShader - m_shaders.begin());
+		if (m_shaders.end() == iShader)
+			m_shaders.push_back(shaders);
+
+		state.materialID = (uint16_t) m_numMaterials++;
+
+		ASSERT(m_shaders.size() <= 65536 && m_numMaterials <= 65536);
+	}
+
+	void RenderQueue::Add(unsigned int layer, unsigned int pass, float depth, const DrawState &state, const DrawGeometry &geometry,
+		uint32_t count, uint32_t start /* = 0 */, int32_t baseVertex /* = 0 */, const void *pConstants /* = nullptr */)
+	{
+		ASSERT(nullptr != geometry.pVertices);
+
+		DrawPacket packet;
+		packet.pState = &state;
+		packet.pGeometry = &geometry;
+		packet.count = count;
+		packet.start = start;
+		packet.baseVertex = baseVertex;
+		packet.constantsOffset = UINT_MAX;
+		packet.numInstances = 0;
+		packet.startInstance = 0;
+
+		if (nullptr != pConstants)
+		{
+			ASSERT(nullptr != state.pDrawConstants);
+			const size_t size = state.pDrawConstants->GetSize();
+			packet.constantsOffset = (uint32_t) m_constants.size();
+			m_constants.insert(m_constants.end(), static_cast<const uint8_t *>(pConstants), static_cast<const uint8_t *>(pConstants) + size);
+		}
+
+		m_packets.push_back(packet);
+		m_keys.push_back(MakeSortKey(layer, pass, depth, state));
+	}
+
+	void RenderQueue::AddInstanced(unsigned int layer, unsigned int pass, float depth, const DrawState &state, const DrawGeometry &geometry,
+		uint32_t count, uint32_t numInstances, uint32_t startInstance /* = 0 */, uint32_t start /* = 0 */, int32_t baseVertex /* = 0 */, const void *pConstants /* = nullptr */)
+	{
+		ASSERT(nullptr != geometry.pInstances && 0 != numInstances);
+
+		Add(layer, pass, depth, state, geometry, count, start, baseVertex, pConstants);
+
+		DrawPacket &packet = m_packets.back();
+		packet.numInstances = numInstances;
+		packet.startInstance = startInstance;
+	}
+
+	// LSD radix sort, 8 bits at a time (which is stable, so equal keys keep submission order).
+	// Keys tend to share most bytes (few layers, passes & shaders), and those passes are skipped.
+	void RenderQueue::Sort()
+	{
+		const size_t count = m_keys.size();
+
+		m_order.resize(count);
+		for (uint32_t iPacket = 0; iPacket < count; ++iPacket)
+			m_order[iPacket] = iPacket;
+
+		m_sortedKeys.resize(count);
+		m_sortedOrder.resize(count);
+
+		// All histograms in one go.
+		uint32_t histograms[8][256];
+		memset(histograms, 0, sizeof(histograms));
+		for (uint64_t key : m_keys)
+		{
+			for (unsigned int iByte = 0; iByte < 8; ++iByte)
+				++histograms[iByte][(key >> (iByte*8)) & 255];
+		}
+
+		for (unsigned int iByte = 0; iByte < 8; ++iByte)
+		{
+			uint32_t *histogram = histograms[iByte];
+			const unsigned int shift = iByte*8;
+			if (count == histogram[(m_keys[0] >> shift) & 255])
+				continue;
+
+			// Counts to offsets.
+			uint32_t offset = 0;
+			for (unsigned int iBucket = 0; iBucket < 256; ++iBucket)
+			{
+				const uint32_t bucketSize = histogram[iBucket];
+				histogram[iBucket] = offset;
+				offset += bucketSize;
+			}
+
+			for (size_t iKey = 0; iKey < count; ++iKey)
+			{
+				const uint32_t iTarget = histogram[(m_keys[iKey] >> shift) & 255]++;
+				m_sortedKeys[iTarget] = m_keys[iKey];
+				m_sortedOrder[iTarget] = m_order[iKey];
+			}
+
+			m_keys.swap(m_sortedKeys);
+			m_order.swap(m_sortedOrder);
+		}
+	}
+
+	void RenderQueue::Flush(RenderBackend &backend)
+	{
+		memset(&m_stats, 0, sizeof(m_stats));
+		m_stats.numPackets = (unsigned int) m_packets.size();
+
+		if (false == m_packets.empty())
+		{
+			Timer timer;
+			Sort();
+			m_stats.sortTime = timer.Get();
+
+			timer.Reset();
+			backend.Submit(m_packets.data(), m_order.data(), m_packets.size(), m_constants.data(), m_stats);
+			m_stats.submitTime = timer.Get();
+		}
+
+		m_packets.clear();
+		m_keys.clear();
+		m_constants.clear();
+	}
+}
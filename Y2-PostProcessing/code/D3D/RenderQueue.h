@@ -0,0 +1,133 @@
+/*
+	D3D: sort-key render queue.
+
+	Instead of drawing right away, Add() records a compact packet with a 64-bit sort key; Flush() radix sorts
+	the keys and hands the packets, in order, to a RenderBackend. The key, from most to least significant:
+
+	- Opaque:      layer (4) | pass (4) | shader (16) | material (16) | depth (24, front to back)
+	- Translucent: layer (4) | pass (4) | depth (24, back to front) | shader (16) | material (16)
+
+	So state changes are grouped as far as drawing order allows. Equal keys keep submission order.
+	The default backend (ContextBackend) binds through the state cache (see StateCache.h), which skips what's already bound.
+
+	States & geometry are referenced, not copied: they must stay put until Flush().
+*/
+
+#pragma once
+
+namespace D3D
+{
+	const unsigned int kMaxDrawTextures = 4;
+
+	// Everything bound for a draw besides geometry & per-draw constants (i.e. a material); see RenderQueue::Register().
+	struct DrawState
+	{
+		ID3D11InputLayout *pInputLayout;
+		ID3D11VertexShader *pVertexShader;
+		ID3D11PixelShader *pPixelShader;
+		ID3D11BlendState *pBlendState;           // nullptr for the defaults (as with OMSetBlendState() et cetera).
+		ID3D11DepthStencilState *pDepthState;
+		ID3D11RasterizerState *pRasterizerState;
+		ID3D11SamplerState *pSampler;            // PS slot 0.
+		ID3D11ShaderResourceView *pTextures[kMaxDrawTextures]; // PS slots 0 onwards.
+		ConstantBufferGPU *pMaterialConstants;   // VS & PS slot 1, optional.
+		ConstantBufferGPU *pDrawConstants;       // VS & PS slot 0, uploaded per packet; optional.
+		bool isTranslucent;                      // Sorted back to front.
+
+		// Assigned by Register().
+		uint16_t shaderID, materialID;
+	};
+
+	struct DrawGeometry
+	{
+		VertexBuffer *pVertices;
+		unsigned int stride;
+		IndexBuffer *pIndices; // Optional.
+		D3D11_PRIMITIVE_TOPOLOGY topology;
+		VertexBuffer *pInstances; // Optional, bound to kInstanceSlot (see Instancing.h) for AddInstanced().
+		unsigned int instanceStride;
+	};
+
+	struct DrawPacket
+	{
+		const DrawState *pState;
+		const DrawGeometry *pGeometry;
+		uint32_t count, start; // Indices (or vertices if not indexed).
+		int32_t baseVertex;
+		uint32_t constantsOffset; // Into the queue's per-draw constants, or UINT_MAX.
+		uint32_t numInstances, startInstance; // Zero instances if not instanced.
+	};
+
+	struct RenderQueueStats
+	{
+		unsigned int numPackets;
+		unsigned int numDrawCalls;
+		unsigned int numInstances;     // Drawn by instanced calls.
+		unsigned int numStateChanges;  // Calls that set state (constant uploads not included).
+		unsigned int numStateFiltered; // Redundant ones dropped by the state cache.
+		unsigned int numUploads;       // Per-draw constants (to the ring or ConstantBufferGPU::Upload()).
+		float sortTime, submitTime;    // Seconds.
+	};
+
+	// As described above; 'layer' & 'pass' are 0-15.
+	uint64_t MakeSortKey(unsigned int layer, unsigned int pass, float depth, const DrawState &state);
+
+	class RenderBackend
+	{
+	public:
+		virtual ~RenderBackend() {}
+
+		// Packets in the order given; 'pConstants' is the queue's per-draw constant storage.
+		virtual void Submit(const DrawPacket *pPackets, const uint32_t *pOrder, size_t count, const uint8_t *pConstants, RenderQueueStats &stats) = 0;
+	};
+
+	// Draws through the (immediate) context & state cache, which skips whatever's already bound.
+	// Per-draw constants go through the constant ring, if there is one (see D3D::GetConstantRing()).
+	class ContextBackend : public RenderBackend
+	{
+	public:
+		void Submit(const DrawPacket *pPackets, const uint32_t *pOrder, size_t count, const uint8_t *pConstants, RenderQueueStats &stats) override;
+
+	private:
+		std::vector<ConstantAllocation> m_allocations; // Per packet (in order) if there's a constant ring.
+	};
+
+	class RenderQueue : public boost::noncopyable
+	{
+	public:
+		typedef std::unique_ptr<RenderQueue> Ptr;
+
+		RenderQueue();
+
+		// Assigns shader & material IDs used in the key; call once per state, after filling it in.
+		void Register(DrawState &state);
+
+		// 'depth' is view space depth normalized to [0, 1]; 'pConstants' (if any) is copied & uploaded to
+		// the state's draw constants, so it's 'pDrawConstants->GetSize()' bytes.
+		void Add(unsigned int layer, unsigned int pass, float depth, const DrawState &state, const DrawGeometry &geometry,
+			uint32_t count, uint32_t start = 0, int32_t baseVertex = 0, const void *pConstants = nullptr);
+
+		// Instanced: 'geometry.pInstances' supplies 'numInstances' instances from 'startInstance' on.
+		void AddInstanced(unsigned int layer, unsigned int pass, float depth, const DrawState &state, const DrawGeometry &geometry,
+			uint32_t count, uint32_t numInstances, uint32_t startInstance = 0, uint32_t start = 0, int32_t baseVertex = 0, const void *pConstants = nullptr);
+
+		// Sorts & submits, then starts over.
+		void Flush(RenderBackend &backend);
+
+		// Of the last Flush().
+		const RenderQueueStats &GetStats() const { return m_stats; }
+
+	private:
+		void Sort();
+
+		std::vector<std::pair<ID3D11VertexShader *, ID3D11PixelShader *>> m_shaders;
+		unsigned int m_numMaterials;
+
+		std::vector<DrawPacket> m_packets;
+		std::vector<uint64_t> m_keys, m_sortedKeys;
+		std::vector<uint32_t> m_order, m_sortedOrder;
+		std::vector<uint8_t> m_constants;
+
+		RenderQueueStats m_stats;
+	};
+}
@@ -7,6 +7,78 @@
 
 namespace D3D
 {
+	const UINT kDefaultTargetBindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+
+	// See D3D::CreateRenderTarget() & RenderTargetPool.
+	struct RenderTargetDesc
+	{
+		RenderTargetDesc() :
+			width(0), height(0), format(DXGI_FORMAT_UNKNOWN), sampleCount(1), sampleQuality(0), bindFlags(kDefaultTargetBindFlags) {}
+
+		RenderTargetDesc(unsigned int width, unsigned int height, DXGI_FORMAT format, unsigned int sampleCount = 1, unsigned int sampleQuality = 0, UINT bindFlags = kDefaultTargetBindFlags) :
+			width(width), height(height), format(format), sampleCount(sampleCount), sampleQuality(sampleQuality), bindFlags(bindFlags) {}
+
+		unsigned int width, height;
+		DXGI_FORMAT format;
+		unsigned int sampleCount, sampleQuality; // MSAA.
+		UINT bindFlags;
+
+		bool operator ==(const RenderTargetDesc &desc) const
+		{
+			return width == desc.width && height == desc.height && format == desc.format &&
+				sampleCount == desc.sampleCount && sampleQuality == desc.sampleQuality && bindFlags == desc.bindFlags;
+		}
+
+		bool operator !=(const RenderTargetDesc &desc) const { return !(*this == desc); }
+
+		uint64_t GetHash() const
+		{
+			const uint32_t fields[6] = { width, height, (uint32_t) format, sampleCount, sampleQuality, bindFlags };
+			return FNV1a(reinterpret_cast<const char *>(fields), sizeof(fields));
+		}
+
+		size_t GetNumBytes() const
+		{
+			size_t pixelSize = 0;
+			switch (format)
+			{
+			case DXGI_FORMAT_R8_UNORM:
+				pixelSize = 1;
+				break;
+
+			case DXGI_FORMAT_R8G8_UNORM:
+			case DXGI_FORMAT_R16_FLOAT:
+				pixelSize = 2;
+				break;
+
+			case DXGI_FORMAT_R8G8B8A8_UNORM:
+			case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+			case DXGI_FORMAT_B8G8R8A8_UNORM:
+			case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+			case DXGI_FORMAT_R10G10B10A2_UNORM:
+			case DXGI_FORMAT_R11G11B10_FLOAT:
+			case DXGI_FORMAT_R16G16_FLOAT:
+			case DXGI_FORMAT_R32_FLOAT:
+				pixelSize = 4;
+				break;
+
+			case DXGI_FORMAT_R16G16B16A16_FLOAT:
+			case DXGI_FORMAT_R32G32_FLOAT:
+				pixelSize = 8;
+				break;
+
+			case DXGI_FORMAT_R32G32B32A32_FLOAT:
+				pixelSize = 16;
+				break;
+
+			default:
+				ASSERT(false); // Add it.
+			}
+
+			return (size_t) width*height*sampleCount*pixelSize;
+		}
+	};
+
 	class RenderTarget : public boost::noncopyable
 	{
 	public:
@@ -0,0 +1,135 @@
+/*
+	D3D: render target pool.
+*/
+
+#include "../Platform.h"
+#include "../D3D.h"
+
+namespace D3D
+{
+	RenderTargetPool::RenderTargetPool(unsigned int maxIdleFrames /* = 4 */) :
+		m_maxIdleFrames(maxIdleFrames)
+	{
+		memset(&m_stats, 0, sizeof(m_stats));
+	}
+
+	RenderTargetPool::~RenderTargetPool()
+	{
+		// Everything should've been released by now.
+		ASSERT(true == m_inUse.empty());
+	}
+
+	void RenderTargetPool::BeginFrame()
+	{
+		++m_frame;
+
+		m_stats.numAcquired = 0;
+		m_stats.numHits = 0;
+		m_stats.numCreated = 0;
+		m_stats.numEvicted = 0;
+
+		Evict(m_maxIdleFrames);
+	}
+
+	RenderTarget *RenderTargetPool::Acquire(const RenderTargetDesc &desc)
+	{
+		++m_stats.numAcquired;
+		++m_stats.totalAcquired;
+
+		// Most recently released first: it's the likeliest to still be resident.
+		Entry entry;
+		const auto iBucket = m_free.find(desc.GetHash());
+		if (m_free.end() != iBucket)
+		{
+			std::vector<Entry> &entries = iBucket->second;
+			for (auto iEntry = entries.rbegin(); iEntry != entries.rend(); ++iEntry)
+			{
+				if (iEntry->desc == desc)
+				{
+					entry = std::move(*iEntry);
+					entries.erase(std::next(iEntry).base());
+					break;
+				}
+			}
+
+			if (true == entries.empty())
+				m_free.erase(iBucket);
+		}
+
+		if (nullptr != entry.target)
+		{
+			++m_stats.numHits;
+			++m_stats.totalHits;
+			--m_stats.numFree;
+			m_stats.freeBytes -= desc.GetNumBytes();
+		}
+		else
+		{
+			entry.target.reset(CreateRenderTarget(desc));
+			if (nullptr == entry.target)
+				return nullptr;
+
+			entry.desc = desc;
+
+			++m_stats.numCreated;
+			++m_stats.numTargets;
+			m_stats.numBytes += desc.GetNumBytes();
+		}
+
+		RenderTarget *pTarget = entry.target.get();
+		m_inUse[pTarget] = std::move(entry);
+		return pTarget;
+	}
+
+	void RenderTargetPool::Release(RenderTarget *pTarget)
+	{
+		if (nullptr == pTarget)
+			return;
+
+		const auto iEntry = m_inUse.find(pTarget);
+		ASSERT(m_inUse.end() != iEntry); // Not (or no longer) from this pool.
+		if (m_inUse.end() == iEntry)
+			return;
+
+		Entry &entry = iEntry->second;
+		entry.lastFrame = m_frame;
+
+		++m_stats.numFree;
+		m_stats.freeBytes += entry.desc.GetNumBytes();
+
+		m_free[entry.desc.GetHash()].push_back(std::move(entry));
+		m_inUse.erase(iEntry);
+	}
+
+	void RenderTargetPool::Trim()
+	{
+		Evict(0);
+	}
+
+	void RenderTargetPool::Evict(unsigned int maxIdleFrames)
+	{
+		for (auto iBucket = m_free.begin(); iBucket != m_free.end(); )
+		{
+			std::vector<Entry> &entries = iBucket->second;
+			entries.erase(std::remove_if(entries.begin(), entries.end(), [this, maxIdleFrames](const Entry &entry)
+			{
+				// Trim() evicts everything, even what was released this frame.
+				if (0 != maxIdleFrames && m_frame - entry.lastFrame <= maxIdleFrames)
+					return false;
+
+				const size_t numBytes = entry.desc.GetNumBytes();
+				++m_stats.numEvicted;
+				--m_stats.numTargets;
+				--m_stats.numFree;
+				m_stats.numBytes -= numBytes;
+				m_stats.freeBytes -= numBytes;
+				return true;
+			}), entries.end());
+
+			if (true == entries.empty())
+				iBucket = m_free.erase(iBucket);
+			else
+				++iBucket;
+		}
+	}
+}
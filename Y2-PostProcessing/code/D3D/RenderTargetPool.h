@@ -0,0 +1,68 @@
+/*
+	D3D: render target pool.
+
+	Hands out render targets by description (size, format, MSAA & bind flags) instead of creating and
+	releasing them by hand. Released targets go back on a free list of their description and are handed
+	out again, so a frame that asks for what the last one did creates nothing. Targets that stay free for
+	more than a given number of frames are released; after a resize (or resolution change) the old sizes
+	thus age out once, instead of targets being created & released every time the size changes back.
+*/
+
+#pragma once
+
+namespace D3D
+{
+	class RenderTargetPool : public boost::noncopyable
+	{
+	public:
+		typedef std::unique_ptr<RenderTargetPool> Ptr;
+
+		struct Stats
+		{
+			unsigned int numAcquired, numHits;      // This frame.
+			unsigned int numCreated, numEvicted;    // This frame.
+			unsigned int numTargets, numFree;
+			size_t numBytes, freeBytes;
+			uint64_t totalAcquired, totalHits;      // Since creation.
+
+			float GetHitRate() const { return (0 != totalAcquired) ? (float) totalHits/totalAcquired : 1.f; }
+		};
+
+		// Free targets are released after 'maxIdleFrames' BeginFrame() calls.
+		explicit RenderTargetPool(unsigned int maxIdleFrames = 4);
+		~RenderTargetPool();
+
+		// Evicts targets that have idled for too long & resets the per-frame stats.
+		void BeginFrame();
+
+		// Returns nullptr (see SetLastError()) if a target must be created & that fails.
+		// The target belongs to the pool, and contents are undefined: write it before reading it.
+		RenderTarget *Acquire(const RenderTargetDesc &desc);
+
+		// Back to the pool; unbind it first (through the state cache) if it might be bound.
+		void Release(RenderTarget *pTarget);
+
+		// Releases all free targets now.
+		void Trim();
+
+		const Stats &GetStats() const { return m_stats; }
+
+	private:
+		struct Entry
+		{
+			RenderTarget::Ptr target;
+			RenderTargetDesc desc;
+			unsigned int lastFrame; // Released during.
+		};
+
+		void Evict(unsigned int maxIdleFrames);
+
+		const unsigned int m_maxIdleFrames;
+		unsigned int m_frame = 0;
+
+		std::unordered_map<uint64_t, std::vector<Entry>> m_free; // By description hash.
+		std::unordered_map<RenderTarget *, Entry> m_inUse;
+
+		Stats m_stats;
+	};
+}
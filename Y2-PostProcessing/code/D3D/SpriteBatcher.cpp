@@ -0,0 +1,269 @@
+/*
+	D3D: sprite batcher.
+*/
+
+#include "../Platform.h"
+#include "../D3D.h"
+
+// Include headers with the sprite shader bytecode.
+#include "../../shaders/Sprite_VS.h"
+#include "../../shaders/Sprite_PS.h"
+
+namespace D3D
+{
+	const unsigned int kMaxSpriteRingSize = 65536/4; // 16-bit indices.
+
+	SpriteBatcher::~SpriteBatcher()
+	{
+		SAFE_RELEASE(m_pWhiteTexture);
+		for (ID3D11BlendState *pBlendState : m_pBlendStates)
+			SAFE_RELEASE(pBlendState);
+
+		SAFE_RELEASE(m_pSamplerState);
+		SAFE_RELEASE(m_pPixelShader);
+		SAFE_RELEASE(m_pVertexShader);
+		SAFE_RELEASE(m_pInputLayout);
+		SAFE_RELEASE(m_pIB);
+		SAFE_RELEASE(m_pVB);
+	}
+
+	void SpriteBatcher::Begin()
+	{
+		m_sprites.clear();
+	}
+
+	void SpriteBatcher::Add(const Texture *pTexture, SpriteBlend blend, const Vector2 &topLeft, const Vector2 &bottomRight,
+		uint32_t color /* = 0xffffffff */, const Vector4 &UVs /* = Vector4(0.f, 0.f, 1.f, 1.f) */, unsigned int layer /* = 0 */)
+	{
+		ASSERT(blend < kNumSpriteBlendModes);
+
+		Sprite sprite;
+		sprite.layer = layer;
+		sprite.blend = blend;
+		sprite.pTexture = (nullptr != pTexture) ? pTexture->GetShaderView() : m_pWhiteTexture;
+		sprite.left = topLeft.x;
+		sprite.top = topLeft.y;
+		sprite.right = bottomRight.x;
+		sprite.bottom = bottomRight.y;
+		sprite.U0 = UVs.x;
+		sprite.V0 = UVs.y;
+		sprite.U1 = UVs.z;
+		sprite.V1 = UVs.w;
+		sprite.color = color;
+		m_sprites.push_back(sprite);
+	}
+
+	void SpriteBatcher::End()
+	{
+		m_stats.numSprites = (unsigned int) m_sprites.size();
+		m_stats.numDrawCalls = 0;
+		m_stats.numDiscards = 0;
+
+		if (true == m_sprites.empty())
+			return;
+
+		// Sort (indices) by state; ties keep submission order.
+		m_order.resize(m_sprites.size());
+		for (uint32_t iSprite = 0; iSprite < m_order.size(); ++iSprite)
+			m_order[iSprite] = iSprite;
+
+		auto isSameState = [](const Sprite &A, const Sprite &B)
+		{
+			return A.layer == B.layer && A.blend == B.blend && A.pTexture == B.pTexture;
+		};
+
+		std::sort(m_order.begin(), m_order.end(), [this](uint32_t iA, uint32_t iB)
+		{
+			const Sprite &A = m_sprites[iA], &B = m_sprites[iB];
+			if (A.layer != B.layer) return A.layer < B.layer;
+			if (A.blend != B.blend) return A.blend < B.blend;
+			if (A.pTexture != B.pTexture) return A.pTexture < B.pTexture;
+			return iA < iB;
+		});
+
+		ID3D11DeviceContext *pContext = GetContext();
+		StateCache &stateCache = GetStateCache();
+
+		// Fixed state for the whole batch.
+		stateCache.SetVertexBuffer(0, m_pVB, sizeof(SpriteVertex));
+		stateCache.SetIndexBuffer(m_pIB, DXGI_FORMAT_R16_UINT);
+		stateCache.SetInputLayout(m_pInputLayout);
+		stateCache.SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		stateCache.SetVertexShader(m_pVertexShader);
+		stateCache.SetPixelShader(m_pPixelShader);
+		stateCache.SetPSSamplers(0, 1, &m_pSamplerState);
+
+		const size_t numSprites = m_order.size();
+		size_t iFirst = 0;
+		while (iFirst < numSprites)
+		{
+			// Append as much as fits; only discard when the ring is full.
+			if (m_ringSize == m_ringPosition)
+				m_ringPosition = 0;
+
+			const D3D11_MAP mapType = (0 == m_ringPosition) ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE;
+			if (D3D11_MAP_WRITE_DISCARD == mapType)
+				++m_stats.numDiscards;
+
+			const size_t count = std::min<size_t>(numSprites - iFirst, m_ringSize - m_ringPosition);
+
+			D3D11_MAPPED_SUBRESOURCE mappedRes;
+			VERIFY(S_OK == pContext->Map(m_pVB, 0, mapType, 0, &mappedRes));
+			{
+				SpriteVertex *pVertex = static_cast<SpriteVertex *>(mappedRes.pData) + m_ringPosition*4;
+				for (size_t iSprite = iFirst; iSprite < iFirst + count; ++iSprite)
+				{
+					const Sprite &sprite = m_sprites[m_order[iSprite]];
+					const SpriteVertex quad[4] =
+					{
+						{ sprite.left,  sprite.top,    sprite.U0, sprite.V0, sprite.color }, // 0
+						{ sprite.right, sprite.top,    sprite.U1, sprite.V0, sprite.color }, // 1
+						{ sprite.left,  sprite.bottom, sprite.U0, sprite.V1, sprite.color }, // 2
+						{ sprite.right, sprite.bottom, sprite.U1, sprite.V1, sprite.color }, // 3
+					};
+
+					memcpy(pVertex, quad, sizeof(quad));
+					pVertex += 4;
+				}
+			}
+			pContext->Unmap(m_pVB, 0);
+
+			// One draw per run of equal state.
+			size_t iRun = iFirst;
+			for (size_t iSprite = iFirst; iSprite < iFirst + count; ++iSprite)
+			{
+				const Sprite &sprite = m_sprites[m_order[iSprite]];
+				if (iSprite+1 < iFirst + count && true == isSameState(sprite, m_sprites[m_order[iSprite+1]]))
+					continue;
+
+				stateCache.SetPSShaderResources(0, 1, &sprite.pTexture);
+				stateCache.SetBlendState(m_pBlendStates[sprite.blend]);
+
+				const unsigned int numRunSprites = (unsigned int) (iSprite+1 - iRun);
+				pContext->DrawIndexed(numRunSprites*6, 0, (INT) (m_ringPosition + iRun - iFirst)*4);
+				++m_stats.numDrawCalls;
+
+				iRun = iSprite+1;
+			}
+
+			m_ringPosition += (unsigned int) count;
+			iFirst += count;
+		}
+
+		// Back to the default (opaque) blend state.
+		stateCache.SetBlendState(nullptr);
+	}
+
+	SpriteBatcher *CreateSpriteBatcher(unsigned int ringSize /* = 16384 */)
+	{
+		ASSERT(0 != ringSize && ringSize <= kMaxSpriteRingSize);
+
+		ID3D11Device *pDevice = GetDevice();
+		std::unique_ptr<SpriteBatcher> batcher(new SpriteBatcher());
+		batcher->m_ringSize = ringSize;
+
+		// Ring vertex buffer.
+		D3D11_BUFFER_DESC bufferDesc;
+		bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+		bufferDesc.ByteWidth = (UINT) (ringSize*4*sizeof(SpriteBatcher::SpriteVertex));
+		bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		bufferDesc.MiscFlags = 0;
+		bufferDesc.StructureByteStride = 0;
+		if (FAILED(pDevice->CreateBuffer(&bufferDesc, nullptr, &batcher->m_pVB)))
+		{
+			SetLastError("Can not create sprite vertex buffer.");
+			return nullptr;
+		}
+
+		// Static index buffer: 2 triangles (clockwise) per quad.
+		std::vector<uint16_t> indices(ringSize*6);
+		for (unsigned int iQuad = 0; iQuad < ringSize; ++iQuad)
+		{
+			const uint16_t base = (uint16_t) (iQuad*4);
+			const uint16_t quad[6] = { base, (uint16_t) (base+1), (uint16_t) (base+3), base, (uint16_t) (base+3), (uint16_t) (base+2) };
+			memcpy(&indices[iQuad*6], quad, sizeof(quad));
+		}
+
+		bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+		bufferDesc.ByteWidth = (UINT) (indices.size()*sizeof(uint16_t));
+		bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+		bufferDesc.CPUAccessFlags = 0;
+
+		D3D11_SUBRESOURCE_DATA bufferData;
+		bufferData.pSysMem = indices.data();
+		bufferData.SysMemPitch = 0;
+		bufferData.SysMemSlicePitch = 0;
+		if (FAILED(pDevice->CreateBuffer(&bufferDesc, &bufferData, &batcher->m_pIB)))
+		{
+			SetLastError("Can not create sprite index buffer.");
+			return nullptr;
+		}
+
+		// Shaders & input layout.
+		const D3D11_INPUT_ELEMENT_DESC elemDesc[] = {
+			{ "POSITION", 0, DXGI_FORMAT_R32G32_FLOAT,   0,  0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+			{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT,   0,  8, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+			{ "COLOR",    0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 16, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		};
+
+		VERIFY(S_OK == pDevice->CreateInputLayout(elemDesc, 3, g_Sprite_VS, sizeof(g_Sprite_VS), &batcher->m_pInputLayout));
+		VERIFY(S_OK == pDevice->CreateVertexShader(g_Sprite_VS, sizeof(g_Sprite_VS), nullptr, &batcher->m_pVertexShader));
+		VERIFY(S_OK == pDevice->CreatePixelShader(g_Sprite_PS, sizeof(g_Sprite_PS), nullptr, &batcher->m_pPixelShader));
+
+		// Bilinear, clamped.
+		D3D11_SAMPLER_DESC samplerDesc;
+		memset(&samplerDesc, 0, sizeof(samplerDesc));
+		samplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+		samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+		samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+		samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+		samplerDesc.ComparisonFunc = D3D11_COMPARISON_ALWAYS;
+		samplerDesc.MaxLOD = FLT_MAX;
+		VERIFY(S_OK == pDevice->CreateSamplerState(&samplerDesc, &batcher->m_pSamplerState));
+
+		// Blend states (see SpriteBlend).
+		for (unsigned int iBlend = 0; iBlend < kNumSpriteBlendModes; ++iBlend)
+		{
+			D3D11_BLEND_DESC blendDesc;
+			memset(&blendDesc, 0, sizeof(blendDesc));
+			D3D11_RENDER_TARGET_BLEND_DESC &targetDesc = blendDesc.RenderTarget[0];
+			targetDesc.BlendEnable = (kSpriteOpaque != iBlend);
+			targetDesc.SrcBlend = D3D11_BLEND_SRC_ALPHA;
+			targetDesc.DestBlend = (kSpriteAdditive == iBlend) ? D3D11_BLEND_ONE : D3D11_BLEND_INV_SRC_ALPHA;
+			targetDesc.BlendOp = D3D11_BLEND_OP_ADD;
+			targetDesc.SrcBlendAlpha = D3D11_BLEND_ONE;
+			targetDesc.DestBlendAlpha = D3D11_BLEND_INV_SRC_ALPHA;
+			targetDesc.BlendOpAlpha = D3D11_BLEND_OP_ADD;
+			targetDesc.RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+			VERIFY(S_OK == pDevice->CreateBlendState(&blendDesc, &batcher->m_pBlendStates[iBlend]));
+		}
+
+		// 1x1 white texture for untextured sprites.
+		{
+			const uint32_t white = 0xffffffff;
+
+			D3D11_TEXTURE2D_DESC textureDesc;
+			memset(&textureDesc, 0, sizeof(textureDesc));
+			textureDesc.Width = 1;
+			textureDesc.Height = 1;
+			textureDesc.MipLevels = 1;
+			textureDesc.ArraySize = 1;
+			textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+			textureDesc.SampleDesc.Count = 1;
+			textureDesc.Usage = D3D11_USAGE_IMMUTABLE;
+			textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+			D3D11_SUBRESOURCE_DATA textureData;
+			textureData.pSysMem = &white;
+			textureData.SysMemPitch = sizeof(white);
+			textureData.SysMemSlicePitch = 0;
+
+			ComPtr<ID3D11Texture2D> texture;
+			VERIFY(S_OK == pDevice->CreateTexture2D(&textureDesc, &textureData, &texture));
+			VERIFY(S_OK == pDevice->CreateShaderResourceView(texture.Get(), nullptr, &batcher->m_pWhiteTexture));
+		}
+
+		return batcher.release();
+	}
+}
@@ -0,0 +1,101 @@
+/*
+	D3D: sprite batcher.
+
+	Sprites are collected on the CPU between Begin() and End(), then sorted by layer, blend mode and texture.
+	End() appends them to a single dynamic ring vertex buffer (D3D11_MAP_WRITE_NO_OVERWRITE, discarding
+	only when it wraps) and issues one draw per state change.
+
+	Positions are in clip space, like DrawQuad(): (-1, 1) is the top left of the viewport.
+	Within a layer draw order isn't kept, so put overlapping alpha blended sprites in increasing layers.
+*/
+
+#pragma once
+
+namespace D3D
+{
+	enum SpriteBlend
+	{
+		kSpriteOpaque,
+		kSpriteAlpha,    // Straight (non-premultiplied) alpha.
+		kSpriteAdditive,
+		kNumSpriteBlendModes
+	};
+
+	// Texture & UV rectangle, i.e. a region of an atlas page (see Content/TextureAtlas.h) or a whole texture.
+	struct SpriteFrame
+	{
+		const Texture *pTexture;
+		Vector4 UVs;
+	};
+
+	class SpriteBatcher : public boost::noncopyable
+	{
+	public:
+		typedef std::unique_ptr<SpriteBatcher> Ptr;
+
+		struct Stats
+		{
+			unsigned int numSprites;
+			unsigned int numDrawCalls;
+			unsigned int numDiscards; // Ring buffer wraps.
+		};
+
+		~SpriteBatcher();
+
+		void Begin();
+
+		// Texture may be nullptr (plain color); 'UVs' is (left, top, right, bottom).
+		void Add(const Texture *pTexture, SpriteBlend blend, const Vector2 &topLeft, const Vector2 &bottomRight,
+			uint32_t color = 0xffffffff /* ABGR, so RGBA in memory */, const Vector4 &UVs = Vector4(0.f, 0.f, 1.f, 1.f), unsigned int layer = 0);
+
+		void Add(const SpriteFrame &frame, SpriteBlend blend, const Vector2 &topLeft, const Vector2 &bottomRight, uint32_t color = 0xffffffff, unsigned int layer = 0)
+		{
+			Add(frame.pTexture, blend, topLeft, bottomRight, color, frame.UVs, layer);
+		}
+
+		void End();
+
+		// Of the last End().
+		const Stats &GetStats() const { return m_stats; }
+
+	private:
+		friend SpriteBatcher *CreateSpriteBatcher(unsigned int ringSize);
+		SpriteBatcher() {}
+
+		struct SpriteVertex
+		{
+			float x, y;
+			float u, v;
+			uint32_t color;
+		};
+
+		struct Sprite
+		{
+			unsigned int layer;
+			SpriteBlend blend;
+			ID3D11ShaderResourceView *pTexture;
+			float left, top, right, bottom;
+			float U0, V0, U1, V1;
+			uint32_t color;
+		};
+
+		unsigned int m_ringSize = 0; // In sprites.
+		unsigned int m_ringPosition = 0;
+
+		ID3D11Buffer *m_pVB = nullptr;
+		ID3D11Buffer *m_pIB = nullptr;
+		ID3D11InputLayout *m_pInputLayout = nullptr;
+		ID3D11VertexShader *m_pVertexShader = nullptr;
+		ID3D11PixelShader *m_pPixelShader = nullptr;
+		ID3D11SamplerState *m_pSamplerState = nullptr;
+		ID3D11BlendState *m_pBlendStates[kNumSpriteBlendModes] = { nullptr };
+		ID3D11ShaderResourceView *m_pWhiteTexture = nullptr;
+
+		std::vector<Sprite> m_sprites;
+		std::vector<uint32_t> m_order;
+		Stats m_stats = { 0, 0, 0 };
+	};
+
+	// The ring holds 'ringSize' sprites (max. 16384, as 16-bit indices are used); 100K sprites then take 7+ draws.
+	SpriteBatcher *CreateSpriteBatcher(unsigned int ringSize = 16384);
+}
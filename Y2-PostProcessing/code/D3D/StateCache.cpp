@@ -0,0 +1,295 @@
+/*
+	D3D: shadow state cache.
+*/
+
+#include "../Platform.h"
+#include <limits.h>
+#include "../D3D.h"
+
+namespace D3D
+{
+	unsigned int StateCache::Stats::GetNumIssued() const
+	{
+		unsigned int total = 0;
+		for (unsigned int count : numIssued)
+			total += count;
+
+		return total;
+	}
+
+	unsigned int StateCache::Stats::GetNumFiltered() const
+	{
+		unsigned int total = 0;
+		for (unsigned int count : numFiltered)
+			total += count;
+
+		return total;
+	}
+
+	StateCache::StateCache(StateContext::Ptr context) :
+		m_context(std::move(context))
+	{
+		ASSERT(nullptr != m_context);
+
+		Invalidate();
+		ResetStats();
+	}
+
+	void StateCache::Invalidate()
+	{
+		memset(&m_shadow, 0xff, sizeof(m_shadow));
+	}
+
+	void StateCache::ResetStats()
+	{
+		memset(&m_stats, 0, sizeof(m_stats));
+	}
+
+	template<typename T>
+	bool StateCache::Update(T *pShadow, unsigned int firstSlot, unsigned int count, const T *pNew, unsigned int &first, unsigned int &last)
+	{
+		first = UINT_MAX;
+		for (unsigned int iSlot = 0; iSlot < count; ++iSlot)
+		{
+			if (0 != memcmp(&pShadow[firstSlot + iSlot], &pNew[iSlot], sizeof(T)))
+			{
+				if (UINT_MAX == first)
+					first = iSlot;
+
+				last = iSlot;
+				pShadow[firstSlot + iSlot] = pNew[iSlot];
+			}
+		}
+
+		return UINT_MAX != first;
+	}
+
+	void StateCache::SetInputLayout(ID3D11InputLayout *pInputLayout)
+	{
+		if (false == Filter(kInputLayout, m_shadow.pInputLayout == pInputLayout))
+		{
+			m_context->IASetInputLayout(pInputLayout);
+			m_shadow.pInputLayout = pInputLayout;
+		}
+	}
+
+	void StateCache::SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology)
+	{
+		if (false == Filter(kPrimitiveTopology, m_shadow.topology == topology))
+		{
+			m_context->IASetPrimitiveTopology(topology);
+			m_shadow.topology = topology;
+		}
+	}
+
+	void StateCache::SetVertexBuffers(unsigned int firstSlot, unsigned int numBuffers, ID3D11Buffer *const *ppBuffers, const UINT *pStrides, const UINT *pOffsets)
+	{
+		ASSERT(firstSlot + numBuffers <= kMaxVertexStreams);
+
+		// A slot differs if any of the three does, so compare them together.
+		unsigned int first = UINT_MAX, last = 0;
+		for (unsigned int iSlot = 0; iSlot < numBuffers; ++iSlot)
+		{
+			const unsigned int slot = firstSlot + iSlot;
+			if (m_shadow.pVertexBuffers[slot] != ppBuffers[iSlot] || m_shadow.strides[slot] != pStrides[iSlot] || m_shadow.offsets[slot] != pOffsets[iSlot])
+			{
+				if (UINT_MAX == first)
+					first = iSlot;
+
+				last = iSlot;
+				m_shadow.pVertexBuffers[slot] = ppBuffers[iSlot];
+				m_shadow.strides[slot] = pStrides[iSlot];
+				m_shadow.offsets[slot] = pOffsets[iSlot];
+			}
+		}
+
+		if (false == Filter(kVertexBuffers, UINT_MAX == first))
+			m_context->IASetVertexBuffers(firstSlot + first, last+1 - first, ppBuffers + first, pStrides + first, pOffsets + first);
+	}
+
+	void StateCache::SetIndexBuffer(ID3D11Buffer *pBuffer, DXGI_FORMAT format, UINT offset /* = 0 */)
+	{
+		if (false == Filter(kIndexBuffer, m_shadow.pIndexBuffer == pBuffer && m_shadow.indexFormat == format && m_shadow.indexOffset == offset))
+		{
+			m_context->IASetIndexBuffer(pBuffer, format, offset);
+			m_shadow.pIndexBuffer = pBuffer;
+			m_shadow.indexFormat = format;
+			m_shadow.indexOffset = offset;
+		}
+	}
+
+	void StateCache::SetVertexShader(ID3D11VertexShader *pShader)
+	{
+		if (false == Filter(kVertexShader, m_shadow.pVertexShader == pShader))
+		{
+			m_context->VSSetShader(pShader);
+			m_shadow.pVertexShader = pShader;
+		}
+	}
+
+	void StateCache::SetPixelShader(ID3D11PixelShader *pShader)
+	{
+		if (false == Filter(kPixelShader, m_shadow.pPixelShader == pShader))
+		{
+			m_context->PSSetShader(pShader);
+			m_shadow.pPixelShader = pShader;
+		}
+	}
+
+	// The array setters only pass on the range of slots that differs.
+
+	void StateCache::ResetRanges(ID3D11Buffer **pShadow, UINT *pRanges, unsigned int firstSlot, unsigned int count)
+	{
+		for (unsigned int iSlot = firstSlot; iSlot < firstSlot + count; ++iSlot)
+		{
+			if (0 != pRanges[iSlot*2+1])
+			{
+				pShadow[iSlot] = reinterpret_cast<ID3D11Buffer *>(~uintptr_t(0));
+				pRanges[iSlot*2] = pRanges[iSlot*2+1] = 0;
+			}
+		}
+	}
+
+	bool StateCache::UpdateRange(ID3D11Buffer **pShadow, UINT *pRanges, unsigned int slot, ID3D11Buffer *pBuffer, UINT firstConstant, UINT numConstants)
+	{
+		ASSERT(true == m_context->HasConstantBufferOffsets());
+		ASSERT(slot < kMaxConstantBuffers && 0 != numConstants);
+		ASSERT(0 == (firstConstant & 15) && 0 == (numConstants & 15));
+
+		if (pShadow[slot] == pBuffer && pRanges[slot*2] == firstConstant && pRanges[slot*2+1] == numConstants)
+			return false;
+
+		pShadow[slot] = pBuffer;
+		pRanges[slot*2] = firstConstant;
+		pRanges[slot*2+1] = numConstants;
+		return true;
+	}
+
+	void StateCache::SetVSConstantBuffers(unsigned int firstSlot, unsigned int numBuffers, ID3D11Buffer *const *ppBuffers)
+	{
+		ASSERT(firstSlot + numBuffers <= kMaxConstantBuffers);
+
+		ResetRanges(m_shadow.pVSConstantBuffers, m_shadow.VSConstantRanges, firstSlot, numBuffers);
+
+		unsigned int first, last;
+		if (false == Filter(kVSConstantBuffers, false == Update(m_shadow.pVSConstantBuffers, firstSlot, numBuffers, ppBuffers, first, last)))
+			m_context->VSSetConstantBuffers(firstSlot + first, last+1 - first, ppBuffers + first);
+	}
+
+	void StateCache::SetPSConstantBuffers(unsigned int firstSlot, unsigned int numBuffers, ID3D11Buffer *const *ppBuffers)
+	{
+		ASSERT(firstSlot + numBuffers <= kMaxConstantBuffers);
+
+		ResetRanges(m_shadow.pPSConstantBuffers, m_shadow.PSConstantRanges, firstSlot, numBuffers);
+
+		unsigned int first, last;
+		if (false == Filter(kPSConstantBuffers, false == Update(m_shadow.pPSConstantBuffers, firstSlot, numBuffers, ppBuffers, first, last)))
+			m_context->PSSetConstantBuffers(firstSlot + first, last+1 - first, ppBuffers + first);
+	}
+
+	void StateCache::SetVSConstantBufferRange(unsigned int slot, ID3D11Buffer *pBuffer, UINT firstConstant, UINT numConstants)
+	{
+		if (false == Filter(kVSConstantBuffers, false == UpdateRange(m_shadow.pVSConstantBuffers, m_shadow.VSConstantRanges, slot, pBuffer, firstConstant, numConstants)))
+			m_context->VSSetConstantBuffers1(slot, 1, &pBuffer, &firstConstant, &numConstants);
+	}
+
+	void StateCache::SetPSConstantBufferRange(unsigned int slot, ID3D11Buffer *pBuffer, UINT firstConstant, UINT numConstants)
+	{
+		if (false == Filter(kPSConstantBuffers, false == UpdateRange(m_shadow.pPSConstantBuffers, m_shadow.PSConstantRanges, slot, pBuffer, firstConstant, numConstants)))
+			m_context->PSSetConstantBuffers1(slot, 1, &pBuffer, &firstConstant, &numConstants);
+	}
+
+	void StateCache::SetPSShaderResources(unsigned int firstSlot, unsigned int numViews, ID3D11ShaderResourceView *const *ppViews)
+	{
+		ASSERT(firstSlot + numViews <= kMaxShaderResources);
+
+		unsigned int first, last;
+		if (false == Filter(kPSShaderResources, false == Update(m_shadow.pPSShaderResources, firstSlot, numViews, ppViews, first, last)))
+			m_context->PSSetShaderResources(firstSlot + first, last+1 - first, ppViews + first);
+	}
+
+	void StateCache::SetPSSamplers(unsigned int firstSlot, unsigned int numSamplers, ID3D11SamplerState *const *ppSamplers)
+	{
+		ASSERT(firstSlot + numSamplers <= kMaxSamplers);
+
+		unsigned int first, last;
+		if (false == Filter(kPSSamplers, false == Update(m_shadow.pPSSamplers, firstSlot, numSamplers, ppSamplers, first, last)))
+			m_context->PSSetSamplers(firstSlot + first, last+1 - first, ppSamplers + first);
+	}
+
+	void StateCache::SetBlendState(ID3D11BlendState *pState)
+	{
+		if (false == Filter(kBlendState, m_shadow.pBlendState == pState))
+		{
+			m_context->OMSetBlendState(pState, nullptr, 0xffffffff);
+			m_shadow.pBlendState = pState;
+		}
+	}
+
+	void StateCache::SetDepthStencilState(ID3D11DepthStencilState *pState, UINT stencilRef /* = 0 */)
+	{
+		if (false == Filter(kDepthStencilState, m_shadow.pDepthStencilState == pState && m_shadow.stencilRef == stencilRef))
+		{
+			m_context->OMSetDepthStencilState(pState, stencilRef);
+			m_shadow.pDepthStencilState = pState;
+			m_shadow.stencilRef = stencilRef;
+		}
+	}
+
+	void StateCache::SetRasterizerState(ID3D11RasterizerState *pState)
+	{
+		if (false == Filter(kRasterizerState, m_shadow.pRasterizerState == pState))
+		{
+			m_context->RSSetState(pState);
+			m_shadow.pRasterizerState = pState;
+		}
+	}
+
+	void StateCache::SetViewport(const D3D11_VIEWPORT &viewport)
+	{
+		// Bitwise, as the invalidated one is all NaNs.
+		if (false == Filter(kViewports, 0 == memcmp(&m_shadow.viewport, &viewport, sizeof(viewport))))
+		{
+			m_context->RSSetViewports(1, &viewport);
+			m_shadow.viewport = viewport;
+		}
+	}
+
+	void StateCache::SetRenderTarget(ID3D11RenderTargetView *pTargetView, ID3D11DepthStencilView *pDepthView)
+	{
+		if (false == Filter(kRenderTargets, m_shadow.pTargetView == pTargetView && m_shadow.pDepthView == pDepthView))
+		{
+			m_context->OMSetRenderTargets((nullptr != pTargetView) ? 1 : 0, &pTargetView, pDepthView);
+			m_shadow.pTargetView = pTargetView;
+			m_shadow.pDepthView = pDepthView;
+
+			// The runtime unbinds shader resources that alias a new target (ping-ponging), so forget those.
+			memset(m_shadow.pPSShaderResources, 0xff, sizeof(m_shadow.pPSShaderResources));
+		}
+	}
+
+	const char *GetStateCallName(StateCache::Call call)
+	{
+		static const char *kNames[StateCache::kNumCalls] =
+		{
+			"IASetInputLayout",
+			"IASetPrimitiveTopology",
+			"IASetVertexBuffers",
+			"IASetIndexBuffer",
+			"VSSetShader",
+			"PSSetShader",
+			"VSSetConstantBuffers",
+			"PSSetConstantBuffers",
+			"PSSetShaderResources",
+			"PSSetSamplers",
+			"OMSetBlendState",
+			"OMSetDepthStencilState",
+			"RSSetState",
+			"RSSetViewports",
+			"OMSetRenderTargets"
+		};
+
+		ASSERT(call < StateCache::kNumCalls);
+		return kNames[call];
+	}
+}
@@ -0,0 +1,140 @@
+/*
+	D3D: shadow state cache.
+
+	Sits in front of the device context and keeps a copy of what's bound, so calls that wouldn't change
+	anything never reach the driver; they're counted instead (see Stats). What does get through goes to a
+	StateContext (see D3D/StateContext.h): the device's, or a mock's when testing.
+
+	Only works if every state change goes through it: call Invalidate() after binding anything directly.
+	Objects are compared by address, so also Invalidate() when something bound is released & recreated.
+*/
+
+#pragma once
+
+namespace D3D
+{
+	class StateCache : public boost::noncopyable
+	{
+	public:
+		typedef std::unique_ptr<StateCache> Ptr;
+
+		enum Call
+		{
+			kInputLayout,
+			kPrimitiveTopology,
+			kVertexBuffers,
+			kIndexBuffer,
+			kVertexShader,
+			kPixelShader,
+			kVSConstantBuffers,
+			kPSConstantBuffers,
+			kPSShaderResources,
+			kPSSamplers,
+			kBlendState,
+			kDepthStencilState,
+			kRasterizerState,
+			kViewports,
+			kRenderTargets,
+			kNumCalls
+		};
+
+		struct Stats
+		{
+			unsigned int numIssued[kNumCalls];
+			unsigned int numFiltered[kNumCalls];
+
+			unsigned int GetNumIssued() const;
+			unsigned int GetNumFiltered() const;
+		};
+
+		static const unsigned int kMaxVertexStreams = 8;
+		static const unsigned int kMaxConstantBuffers = 14; // D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT
+		static const unsigned int kMaxShaderResources = 16; // Tracked slots (of 128).
+		static const unsigned int kMaxSamplers = 16;        // D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT
+
+		explicit StateCache(StateContext::Ptr context);
+		~StateCache() {}
+
+		// Forget everything; the next call of each kind goes through.
+		void Invalidate();
+
+		void SetInputLayout(ID3D11InputLayout *pInputLayout);
+		void SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology);
+		void SetVertexBuffers(unsigned int firstSlot, unsigned int numBuffers, ID3D11Buffer *const *ppBuffers, const UINT *pStrides, const UINT *pOffsets);
+		void SetVertexBuffer(unsigned int slot, ID3D11Buffer *pBuffer, UINT stride, UINT offset = 0) { SetVertexBuffers(slot, 1, &pBuffer, &stride, &offset); }
+		void SetIndexBuffer(ID3D11Buffer *pBuffer, DXGI_FORMAT format, UINT offset = 0);
+
+		void SetVertexShader(ID3D11VertexShader *pShader);
+		void SetPixelShader(ID3D11PixelShader *pShader);
+		void SetVSConstantBuffers(unsigned int firstSlot, unsigned int numBuffers, ID3D11Buffer *const *ppBuffers);
+		void SetPSConstantBuffers(unsigned int firstSlot, unsigned int numBuffers, ID3D11Buffer *const *ppBuffers);
+
+		// Part of a buffer (Direct3D 11.1, see HasConstantBufferOffsets()): in constants, both multiples of 16.
+		void SetVSConstantBufferRange(unsigned int slot, ID3D11Buffer *pBuffer, UINT firstConstant, UINT numConstants);
+		void SetPSConstantBufferRange(unsigned int slot, ID3D11Buffer *pBuffer, UINT firstConstant, UINT numConstants);
+		void SetPSShaderResources(unsigned int firstSlot, unsigned int numViews, ID3D11ShaderResourceView *const *ppViews);
+		void SetPSSamplers(unsigned int firstSlot, unsigned int numSamplers, ID3D11SamplerState *const *ppSamplers);
+
+		// Default blend factor & sample mask (as used throughout).
+		void SetBlendState(ID3D11BlendState *pState);
+		void SetDepthStencilState(ID3D11DepthStencilState *pState, UINT stencilRef = 0);
+		void SetRasterizerState(ID3D11RasterizerState *pState);
+		void SetViewport(const D3D11_VIEWPORT &viewport);
+
+		// Single render target (or none); shader resources are invalidated when it changes.
+		void SetRenderTarget(ID3D11RenderTargetView *pTargetView, ID3D11DepthStencilView *pDepthView);
+
+		bool HasConstantBufferOffsets() const { return m_context->HasConstantBufferOffsets(); }
+
+		// Since the last ResetStats() (which D3D::BeginFrame() calls).
+		const Stats &GetStats() const { return m_stats; }
+		void ResetStats();
+
+	private:
+		// Copies the range that differs into the shadow array and returns it; false if nothing does.
+		template<typename T>
+		bool Update(T *pShadow, unsigned int firstSlot, unsigned int count, const T *pNew, unsigned int &first, unsigned int &last);
+
+		// Whole buffers bound over ranges don't match what's in the shadow.
+		void ResetRanges(ID3D11Buffer **pShadow, UINT *pRanges, unsigned int firstSlot, unsigned int count);
+		bool UpdateRange(ID3D11Buffer **pShadow, UINT *pRanges, unsigned int slot, ID3D11Buffer *pBuffer, UINT firstConstant, UINT numConstants);
+
+		bool Filter(Call call, bool isRedundant)
+		{
+			++((isRedundant) ? m_stats.numFiltered : m_stats.numIssued)[call];
+			return isRedundant;
+		}
+
+		const StateContext::Ptr m_context;
+
+		// Set to all ones by Invalidate(), which no valid state matches.
+		struct Shadow
+		{
+			ID3D11InputLayout *pInputLayout;
+			D3D11_PRIMITIVE_TOPOLOGY topology;
+			ID3D11Buffer *pVertexBuffers[kMaxVertexStreams];
+			UINT strides[kMaxVertexStreams], offsets[kMaxVertexStreams];
+			ID3D11Buffer *pIndexBuffer;
+			DXGI_FORMAT indexFormat;
+			UINT indexOffset;
+			ID3D11VertexShader *pVertexShader;
+			ID3D11PixelShader *pPixelShader;
+			ID3D11Buffer *pVSConstantBuffers[kMaxConstantBuffers];
+			ID3D11Buffer *pPSConstantBuffers[kMaxConstantBuffers];
+			UINT VSConstantRanges[kMaxConstantBuffers*2], PSConstantRanges[kMaxConstantBuffers*2]; // First & count, 0 for whole buffers.
+			ID3D11ShaderResourceView *pPSShaderResources[kMaxShaderResources];
+			ID3D11SamplerState *pPSSamplers[kMaxSamplers];
+			ID3D11BlendState *pBlendState;
+			ID3D11DepthStencilState *pDepthStencilState;
+			UINT stencilRef;
+			ID3D11RasterizerState *pRasterizerState;
+			D3D11_VIEWPORT viewport;
+			ID3D11RenderTargetView *pTargetView;
+			ID3D11DepthStencilView *pDepthView;
+		} m_shadow;
+
+		Stats m_stats;
+	};
+
+	const char *GetStateCallName(StateCache::Call call);
+}
@@ -0,0 +1,112 @@
+/*
+	D3D: state context.
+*/
+
+#include "../Platform.h"
+#include "../D3D.h"
+
+namespace D3D
+{
+	DeviceStateContext::DeviceStateContext(ID3D11DeviceContext *pContext) :
+		m_pContext(pContext)
+		, m_pContext1(nullptr)
+	{
+		ASSERT(nullptr != pContext);
+
+		// Direct3D 11.1 runtime (Windows 8+) for constant buffer offsets; the driver may still not do it (see ConstantRing).
+		if (FAILED(pContext->QueryInterface(__uuidof(ID3D11DeviceContext1), reinterpret_cast<void **>(&m_pContext1))))
+			m_pContext1 = nullptr;
+	}
+
+	DeviceStateContext::~DeviceStateContext()
+	{
+		SAFE_RELEASE(m_pContext1);
+	}
+
+	void DeviceStateContext::IASetInputLayout(ID3D11InputLayout *pInputLayout)
+	{
+		m_pContext->IASetInputLayout(pInputLayout);
+	}
+
+	void DeviceStateContext::IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology)
+	{
+		m_pContext->IASetPrimitiveTopology(topology);
+	}
+
+	void DeviceStateContext::IASetVertexBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *ppBuffers, const UINT *pStrides, const UINT *pOffsets)
+	{
+		m_pContext->IASetVertexBuffers(startSlot, numBuffers, ppBuffers, pStrides, pOffsets);
+	}
+
+	void DeviceStateContext::IASetIndexBuffer(ID3D11Buffer *pBuffer, DXGI_FORMAT format, UINT offset)
+	{
+		m_pContext->IASetIndexBuffer(pBuffer, format, offset);
+	}
+
+	void DeviceStateContext::VSSetShader(ID3D11VertexShader *pShader)
+	{
+		m_pContext->VSSetShader(pShader, nullptr, 0);
+	}
+
+	void DeviceStateContext::PSSetShader(ID3D11PixelShader *pShader)
+	{
+		m_pContext->PSSetShader(pShader, nullptr, 0);
+	}
+
+	void DeviceStateContext::VSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *ppBuffers)
+	{
+		m_pContext->VSSetConstantBuffers(startSlot, numBuffers, ppBuffers);
+	}
+
+	void DeviceStateContext::PSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *ppBuffers)
+	{
+		m_pContext->PSSetConstantBuffers(startSlot, numBuffers, ppBuffers);
+	}
+
+	void DeviceStateContext::VSSetConstantBuffers1(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *ppBuffers, const UINT *pFirstConstant, const UINT *pNumConstants)
+	{
+		ASSERT(nullptr != m_pContext1);
+		m_pContext1->VSSetConstantBuffers1(startSlot, numBuffers, ppBuffers, pFirstConstant, pNumConstants);
+	}
+
+	void DeviceStateContext::PSSetConstantBuffers1(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *ppBuffers, const UINT *pFirstConstant, const UINT *pNumConstants)
+	{
+		ASSERT(nullptr != m_pContext1);
+		m_pContext1->PSSetConstantBuffers1(startSlot, numBuffers, ppBuffers, pFirstConstant, pNumConstants);
+	}
+
+	void DeviceStateContext::PSSetShaderResources(UINT startSlot, UINT numViews, ID3D11ShaderResourceView *const *ppViews)
+	{
+		m_pContext->PSSetShaderResources(startSlot, numViews, ppViews);
+	}
+
+	void DeviceStateContext::PSSetSamplers(UINT startSlot, UINT numSamplers, ID3D11SamplerState *const *ppSamplers)
+	{
+		m_pContext->PSSetSamplers(startSlot, numSamplers, ppSamplers);
+	}
+
+	void DeviceStateContext::OMSetBlendState(ID3D11BlendState *pState, const FLOAT blendFactor[4], UINT sampleMask)
+	{
+		m_pContext->OMSetBlendState(pState, blendFactor, sampleMask);
+	}
+
+	void DeviceStateContext::OMSetDepthStencilState(ID3D11DepthStencilState *pState, UINT stencilRef)
+	{
+		m_pContext->OMSetDepthStencilState(pState, stencilRef);
+	}
+
+	void DeviceStateContext::RSSetState(ID3D11RasterizerState *pState)
+	{
+		m_pContext->RSSetState(pState);
+	}
+
+	void DeviceStateContext::RSSetViewports(UINT numViewports, const D3D11_VIEWPORT *pViewports)
+	{
+		m_pContext->RSSetViewports(numViewports, pViewports);
+	}
+
+	void DeviceStateContext::OMSetRenderTargets(UINT numViews, ID3D11RenderTargetView *const *ppTargetViews, ID3D11DepthStencilView *pDepthView)
+	{
+		m_pContext->OMSetRenderTargets(numViews, ppTargetViews, pDepthView);
+	}
+}
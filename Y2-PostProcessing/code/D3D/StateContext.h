@@ -0,0 +1,77 @@
+/*
+	D3D: state context.
+
+	The calls StateCache passes on: to the device context (DeviceStateContext), or to anything else that
+	takes them, such as a mock that records what gets through to test the cache without a device.
+	Named & typed after their ID3D11DeviceContext(1) counterparts, minus the arguments the cache never uses.
+*/
+
+#pragma once
+
+namespace D3D
+{
+	class StateContext
+	{
+	public:
+		typedef std::unique_ptr<StateContext> Ptr;
+
+		virtual ~StateContext() {}
+
+		virtual void IASetInputLayout(ID3D11InputLayout *pInputLayout) = 0;
+		virtual void IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology) = 0;
+		virtual void IASetVertexBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *ppBuffers, const UINT *pStrides, const UINT *pOffsets) = 0;
+		virtual void IASetIndexBuffer(ID3D11Buffer *pBuffer, DXGI_FORMAT format, UINT offset) = 0;
+
+		virtual void VSSetShader(ID3D11VertexShader *pShader) = 0;
+		virtual void PSSetShader(ID3D11PixelShader *pShader) = 0;
+		virtual void VSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *ppBuffers) = 0;
+		virtual void PSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *ppBuffers) = 0;
+		virtual void VSSetConstantBuffers1(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *ppBuffers, const UINT *pFirstConstant, const UINT *pNumConstants) = 0;
+		virtual void PSSetConstantBuffers1(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *ppBuffers, const UINT *pFirstConstant, const UINT *pNumConstants) = 0;
+		virtual void PSSetShaderResources(UINT startSlot, UINT numViews, ID3D11ShaderResourceView *const *ppViews) = 0;
+		virtual void PSSetSamplers(UINT startSlot, UINT numSamplers, ID3D11SamplerState *const *ppSamplers) = 0;
+
+		virtual void OMSetBlendState(ID3D11BlendState *pState, const FLOAT blendFactor[4], UINT sampleMask) = 0;
+		virtual void OMSetDepthStencilState(ID3D11DepthStencilState *pState, UINT stencilRef) = 0;
+		virtual void RSSetState(ID3D11RasterizerState *pState) = 0;
+		virtual void RSSetViewports(UINT numViewports, const D3D11_VIEWPORT *pViewports) = 0;
+		virtual void OMSetRenderTargets(UINT numViews, ID3D11RenderTargetView *const *ppTargetViews, ID3D11DepthStencilView *pDepthView) = 0;
+
+		// Whether the *SetConstantBuffers1() calls are available (Direct3D 11.1).
+		virtual bool HasConstantBufferOffsets() const = 0;
+	};
+
+	// Straight to the device context.
+	class DeviceStateContext : public StateContext, public boost::noncopyable
+	{
+	public:
+		explicit DeviceStateContext(ID3D11DeviceContext *pContext);
+		~DeviceStateContext();
+
+		void IASetInputLayout(ID3D11InputLayout *pInputLayout) override;
+		void IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology) override;
+		void IASetVertexBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *ppBuffers, const UINT *pStrides, const UINT *pOffsets) override;
+		void IASetIndexBuffer(ID3D11Buffer *pBuffer, DXGI_FORMAT format, UINT offset) override;
+
+		void VSSetShader(ID3D11VertexShader *pShader) override;
+		void PSSetShader(ID3D11PixelShader *pShader) override;
+		void VSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *ppBuffers) override;
+		void PSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *ppBuffers) override;
+		void VSSetConstantBuffers1(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *ppBuffers, const UINT *pFirstConstant, const UINT *pNumConstants) override;
+		void PSSetConstantBuffers1(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *ppBuffers, const UINT *pFirstConstant, const UINT *pNumConstants) override;
+		void PSSetShaderResources(UINT startSlot, UINT numViews, ID3D11ShaderResourceView *const *ppViews) override;
+		void PSSetSamplers(UINT startSlot, UINT numSamplers, ID3D11SamplerState *const *ppSamplers) override;
+
+		void OMSetBlendState(ID3D11BlendState *pState, const FLOAT blendFactor[4], UINT sampleMask) override;
+		void OMSetDepthStencilState(ID3D11DepthStencilState *pState, UINT stencilRef) override;
+		void RSSetState(ID3D11RasterizerState *pState) override;
+		void RSSetViewports(UINT numViewports, const D3D11_VIEWPORT *pViewports) override;
+		void OMSetRenderTargets(UINT numViews, ID3D11RenderTargetView *const *ppTargetViews, ID3D11DepthStencilView *pDepthView) override;
+
+		bool HasConstantBufferOffsets() const override { return nullptr != m_pContext1; }
+
+	private:
+		ID3D11DeviceContext *m_pContext;
+		ID3D11DeviceContext1 *m_pContext1; // If available.
+	};
+}
@@ -0,0 +1,39 @@
+/*
+	D3D: (2D) texture wrapper.
+*/
+
+#pragma once
+
+namespace D3D
+{
+	class Texture : public boost::noncopyable
+	{
+	public:
+		typedef std::unique_ptr<Texture> Ptr;
+
+		Texture(ID3D11Texture2D *pTexture, ID3D11ShaderResourceView *pShaderView) :
+			m_pTexture(pTexture), m_pShaderView(pShaderView)
+		{
+			ASSERT(pTexture != nullptr);
+			ASSERT(pShaderView != nullptr);
+
+			m_pTexture->GetDesc(&m_desc);
+		}
+
+		~Texture()
+		{
+			SAFE_RELEASE(m_pTexture);
+			SAFE_RELEASE(m_pShaderView);
+		}
+
+		ID3D11Texture2D          *GetTexture()    const { return m_pTexture; }
+		ID3D11ShaderResourceView *GetShaderView() const { return m_pShaderView; }
+
+		const D3D11_TEXTURE2D_DESC &GetDesc() const { return m_desc; }
+
+	private:
+		ID3D11Texture2D *m_pTexture;
+		ID3D11ShaderResourceView *m_pShaderView;
+		D3D11_TEXTURE2D_DESC m_desc;
+	};
+}
@@ -0,0 +1,467 @@
+/*
+	D3D: vertex declarations & input layout cache.
+*/
+
+#include "../Platform.h"
+#include "../D3D.h"
+
+namespace D3D
+{
+	struct VertexFormatInfo
+	{
+		DXGI_FORMAT format;
+		unsigned int size, numComponents;
+	};
+
+	// Indexed by VertexFormat.
+	static const VertexFormatInfo kVertexFormats[kNumVertexFormats] =
+	{
+		{ DXGI_FORMAT_R32_FLOAT,          4,  1 },
+		{ DXGI_FORMAT_R32G32_FLOAT,       8,  2 },
+		{ DXGI_FORMAT_R32G32B32_FLOAT,    12, 3 },
+		{ DXGI_FORMAT_R32G32B32A32_FLOAT, 16, 4 },
+		{ DXGI_FORMAT_R16G16_FLOAT,       4,  2 },
+		{ DXGI_FORMAT_R16G16B16A16_FLOAT, 8,  4 },
+		{ DXGI_FORMAT_R8G8B8A8_UNORM,     4,  4 },
+		{ DXGI_FORMAT_R8G8B8A8_SNORM,     4,  4 },
+		{ DXGI_FORMAT_R16G16_UNORM,       4,  2 },
+		{ DXGI_FORMAT_R16G16_SNORM,       4,  2 },
+		{ DXGI_FORMAT_R16G16B16A16_SNORM, 8,  4 },
+		{ DXGI_FORMAT_R10G10B10A2_UNORM,  4,  4 },
+		{ DXGI_FORMAT_R8G8B8A8_UINT,      4,  4 }
+	};
+
+	DXGI_FORMAT GetVertexFormatDXGI(VertexFormat format) { ASSERT(format < kNumVertexFormats); return kVertexFormats[format].format; }
+	unsigned int GetVertexFormatSize(VertexFormat format) { ASSERT(format < kNumVertexFormats); return kVertexFormats[format].size; }
+	unsigned int GetVertexFormatComponents(VertexFormat format) { ASSERT(format < kNumVertexFormats); return kVertexFormats[format].numComponents; }
+
+	/*
+		Conversion (as the input assembler does it, see "Data Conversion Rules" in the Direct3D 11 docs).
+	*/
+
+	static float HalfToFloat(uint16_t half)
+	{
+		const uint32_t sign = (uint32_t) (half & 0x8000) << 16;
+		const uint32_t exponent = (half >> 10) & 0x1f, mantissa = half & 0x3ff;
+
+		uint32_t bits;
+		if (0 == exponent)
+		{
+			// Zero or denormal (a denormal half is a normal float).
+			float value = mantissa/16777216.f; // 2^-24
+			memcpy(&bits, &value, 4);
+			bits |= sign;
+		}
+		else if (31 == exponent)
+			bits = sign | 0x7f800000 | (mantissa << 13); // Infinity or NaN.
+		else
+			bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+
+		float value;
+		memcpy(&value, &bits, 4);
+		return value;
+	}
+
+	static uint16_t FloatToHalf(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, 4);
+
+		const uint16_t sign = (uint16_t) ((bits >> 16) & 0x8000);
+		const uint32_t absBits = bits & 0x7fffffff;
+
+		if (absBits >= 0x7f800000)
+			return sign | ((absBits > 0x7f800000) ? 0x7e00 : 0x7c00); // NaN or infinity.
+
+		if (absBits >= 0x477ff000)
+			return sign | 0x7c00; // Rounds to beyond 65504.
+
+		if (absBits < 0x38800000)
+		{
+			// Denormal (or zero): scale to 2^-24 units & round to nearest.
+			float absValue;
+			memcpy(&absValue, &absBits, 4);
+			return sign | (uint16_t) (absValue*16777216.f + 0.5f);
+		}
+
+		// Round to nearest even on the 13 bits dropped.
+		const uint32_t rebiased = absBits - (112 << 23);
+		return sign | (uint16_t) ((rebiased + 0xfff + ((rebiased >> 13) & 1)) >> 13);
+	}
+
+	static float Clamp(float value, float min, float max)
+	{
+		return std::min<float>(std::max<float>(value, min), max);
+	}
+
+	// To an integer of 'numBits' ([0, 1] unsigned, [-1, 1] signed).
+	static int32_t Normalize(float value, unsigned int numBits, bool isSigned)
+	{
+		if (true == isSigned)
+		{
+			const float scale = (float) ((1 << (numBits-1)) - 1);
+			return (int32_t) floorf(Clamp(value, -1.f, 1.f)*scale + 0.5f);
+		}
+		else
+		{
+			const float scale = (float) ((1 << numBits) - 1);
+			return (int32_t) floorf(Clamp(value, 0.f, 1.f)*scale + 0.5f);
+		}
+	}
+
+	// Signed normalized: both -MAX and -MAX-1 are -1.
+	static float SNorm(int32_t value, unsigned int numBits)
+	{
+		return std::max<float>(value/(float) ((1 << (numBits-1)) - 1), -1.f);
+	}
+
+	/*
+		VertexDecl.
+	*/
+
+	VertexDecl::VertexDecl() :
+		m_hash(kFNV1aBasis)
+	{
+	}
+
+	VertexDecl &VertexDecl::Add(const char *semantic, unsigned int semanticIndex, VertexFormat format, unsigned int stream /* = 0 */)
+	{
+		ASSERT(nullptr != semantic && format < kNumVertexFormats && stream < D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT);
+		ASSERT(-1 == Find(semantic, semanticIndex));
+
+		if (stream >= m_strides.size())
+			m_strides.resize(stream+1, 0);
+
+		VertexElement element;
+		element.semantic = semantic;
+		element.semanticIndex = semanticIndex;
+		element.format = format;
+		element.stream = stream;
+		element.offset = m_strides[stream];
+		m_elements.push_back(element);
+
+		// All formats are multiples of 4 bytes, so this stays aligned.
+		m_strides[stream] += GetVertexFormatSize(format);
+
+		D3D11_INPUT_ELEMENT_DESC inputElement;
+		inputElement.SemanticName = semantic;
+		inputElement.SemanticIndex = semanticIndex;
+		inputElement.Format = GetVertexFormatDXGI(format);
+		inputElement.InputSlot = stream;
+		inputElement.AlignedByteOffset = element.offset;
+		inputElement.InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+		inputElement.InstanceDataStepRate = 0;
+		m_inputElements.push_back(inputElement);
+
+		UpdateHash();
+		return *this;
+	}
+
+	VertexDecl &VertexDecl::SetInstanced(unsigned int stream, unsigned int stepRate /* = 1 */)
+	{
+		ASSERT(0 != stepRate);
+
+		for (D3D11_INPUT_ELEMENT_DESC &inputElement : m_inputElements)
+		{
+			if (stream == inputElement.InputSlot)
+			{
+				inputElement.InputSlotClass = D3D11_INPUT_PER_INSTANCE_DATA;
+				inputElement.InstanceDataStepRate = stepRate;
+			}
+		}
+
+		UpdateHash();
+		return *this;
+	}
+
+	int VertexDecl::Find(const char *semantic, unsigned int semanticIndex /* = 0 */) const
+	{
+		// Semantics are case insensitive.
+		for (size_t iElement = 0; iElement < m_elements.size(); ++iElement)
+		{
+			const VertexElement &element = m_elements[iElement];
+			if (semanticIndex == element.semanticIndex && 0 == _stricmp(semantic, element.semantic))
+				return (int) iElement;
+		}
+
+		return -1;
+	}
+
+	void VertexDecl::UpdateHash()
+	{
+		// Everything CreateInputLayout() gets, semantic names by value.
+		uint64_t hash = kFNV1aBasis;
+		for (const D3D11_INPUT_ELEMENT_DESC &inputElement : m_inputElements)
+		{
+			for (const char *pChar = inputElement.SemanticName; '\0' != *pChar; ++pChar)
+				hash = (hash ^ (uint8_t) toupper(*pChar))*kFNV1aPrime;
+
+			const uint32_t fields[] = { inputElement.SemanticIndex, (uint32_t) inputElement.Format, inputElement.InputSlot,
+				inputElement.AlignedByteOffset, (uint32_t) inputElement.InputSlotClass, inputElement.InstanceDataStepRate };
+			const uint8_t *pBytes = reinterpret_cast<const uint8_t *>(fields);
+			for (size_t iByte = 0; iByte < sizeof(fields); ++iByte)
+				hash = (hash ^ pBytes[iByte])*kFNV1aPrime;
+		}
+
+		m_hash = hash;
+	}
+
+	void VertexDecl::Decode(size_t iElement, const void *pVertex, float values[4]) const
+	{
+		const VertexElement &element = m_elements[iElement];
+		const uint8_t *pData = static_cast<const uint8_t *>(pVertex) + element.offset;
+
+		values[0] = values[1] = values[2] = 0.f;
+		values[3] = 1.f;
+
+		switch (element.format)
+		{
+		case kVertexFloat1:
+		case kVertexFloat2:
+		case kVertexFloat3:
+		case kVertexFloat4:
+			memcpy(values, pData, GetVertexFormatSize(element.format));
+			break;
+
+		case kVertexHalf2:
+		case kVertexHalf4:
+			{
+				uint16_t halves[4];
+				const unsigned int numComponents = GetVertexFormatComponents(element.format);
+				memcpy(halves, pData, numComponents*sizeof(uint16_t));
+				for (unsigned int iComp = 0; iComp < numComponents; ++iComp)
+					values[iComp] = HalfToFloat(halves[iComp]);
+			}
+			break;
+
+		case kVertexUNorm8x4:
+			for (unsigned int iComp = 0; iComp < 4; ++iComp)
+				values[iComp] = pData[iComp]/255.f;
+			break;
+
+		case kVertexSNorm8x4:
+			for (unsigned int iComp = 0; iComp < 4; ++iComp)
+				values[iComp] = SNorm((int8_t) pData[iComp], 8);
+			break;
+
+		case kVertexUNorm16x2:
+			{
+				uint16_t shorts[2];
+				memcpy(shorts, pData, sizeof(shorts));
+				values[0] = shorts[0]/65535.f;
+				values[1] = shorts[1]/65535.f;
+			}
+			break;
+
+		case kVertexSNorm16x2:
+		case kVertexSNorm16x4:
+			{
+				int16_t shorts[4];
+				const unsigned int numComponents = GetVertexFormatComponents(element.format);
+				memcpy(shorts, pData, numComponents*sizeof(int16_t));
+				for (unsigned int iComp = 0; iComp < numComponents; ++iComp)
+					values[iComp] = SNorm(shorts[iComp], 16);
+			}
+			break;
+
+		case kVertexUNorm1010102:
+			{
+				uint32_t packed;
+				memcpy(&packed, pData, 4);
+				values[0] = (packed & 1023)/1023.f;
+				values[1] = ((packed >> 10) & 1023)/1023.f;
+				values[2] = ((packed >> 20) & 1023)/1023.f;
+				values[3] = (packed >> 30)/3.f;
+			}
+			break;
+
+		case kVertexUInt8x4:
+			for (unsigned int iComp = 0; iComp < 4; ++iComp)
+				values[iComp] = (float) pData[iComp];
+			break;
+
+		default:
+			ASSERT(false);
+		}
+	}
+
+	void VertexDecl::Encode(size_t iElement, const float values[4], void *pVertex) const
+	{
+		const VertexElement &element = m_elements[iElement];
+		uint8_t *pData = static_cast<uint8_t *>(pVertex) + element.offset;
+
+		switch (element.format)
+		{
+		case kVertexFloat1:
+		case kVertexFloat2:
+		case kVertexFloat3:
+		case kVertexFloat4:
+			memcpy(pData, values, GetVertexFormatSize(element.format));
+			break;
+
+		case kVertexHalf2:
+		case kVertexHalf4:
+			{
+				uint16_t halves[4];
+				const unsigned int numComponents = GetVertexFormatComponents(element.format);
+				for (unsigned int iComp = 0; iComp < numComponents; ++iComp)
+					halves[iComp] = FloatToHalf(values[iComp]);
+				memcpy(pData, halves, numComponents*sizeof(uint16_t));
+			}
+			break;
+
+		case kVertexUNorm8x4:
+		case kVertexSNorm8x4:
+			for (unsigned int iComp = 0; iComp < 4; ++iComp)
+				pData[iComp] = (uint8_t) Normalize(values[iComp], 8, kVertexSNorm8x4 == element.format);
+			break;
+
+		case kVertexUNorm16x2:
+		case kVertexSNorm16x2:
+		case kVertexSNorm16x4:
+			{
+				uint16_t shorts[4];
+				const unsigned int numComponents = GetVertexFormatComponents(element.format);
+				for (unsigned int iComp = 0; iComp < numComponents; ++iComp)
+					shorts[iComp] = (uint16_t) Normalize(values[iComp], 16, kVertexUNorm16x2 != element.format);
+				memcpy(pData, shorts, numComponents*sizeof(uint16_t));
+			}
+			break;
+
+		case kVertexUNorm1010102:
+			{
+				const uint32_t packed = Normalize(values[0], 10, false) | (Normalize(values[1], 10, false) << 10) |
+					(Normalize(values[2], 10, false) << 20) | ((uint32_t) Normalize(values[3], 2, false) << 30);
+				memcpy(pData, &packed, 4);
+			}
+			break;
+
+		case kVertexUInt8x4:
+			for (unsigned int iComp = 0; iComp < 4; ++iComp)
+				pData[iComp] = (uint8_t) Clamp(floorf(values[iComp] + 0.5f), 0.f, 255.f);
+			break;
+
+		default:
+			ASSERT(false);
+		}
+	}
+
+	void ConvertVertices(const VertexDecl &destDecl, void *const *ppDestStreams, const VertexDecl &sourceDecl, const void *const *ppSourceStreams, size_t numVertices)
+	{
+		// Source element per destination element (or -1).
+		const size_t numElements = destDecl.GetNumElements();
+		std::vector<int> sources(numElements);
+		for (size_t iElement = 0; iElement < numElements; ++iElement)
+		{
+			const VertexElement &element = destDecl.GetElement(iElement);
+			sources[iElement] = sourceDecl.Find(element.semantic, element.semanticIndex);
+		}
+
+		const float kDefault[4] = { 0.f, 0.f, 0.f, 1.f };
+		for (size_t iVertex = 0; iVertex < numVertices; ++iVertex)
+		{
+			for (size_t iElement = 0; iElement < numElements; ++iElement)
+			{
+				const unsigned int destStream = destDecl.GetElement(iElement).stream;
+				uint8_t *pDest = static_cast<uint8_t *>(ppDestStreams[destStream]) + iVertex*destDecl.GetStride(destStream);
+
+				const int iSource = sources[iElement];
+				if (-1 == iSource)
+				{
+					destDecl.Encode(iElement, kDefault, pDest);
+					continue;
+				}
+
+				const unsigned int sourceStream = sourceDecl.GetElement(iSource).stream;
+				const uint8_t *pSource = static_cast<const uint8_t *>(ppSourceStreams[sourceStream]) + iVertex*sourceDecl.GetStride(sourceStream);
+
+				float values[4];
+				sourceDecl.Decode(iSource, pSource, values);
+				destDecl.Encode(iElement, values, pDest);
+			}
+		}
+	}
+
+	uint64_t GetShaderHash(const void *pBytecode, size_t size)
+	{
+		// Compiled shaders start with "DXBC" & a 128-bit checksum of the rest.
+		const char *pBytes = static_cast<const char *>(pBytecode);
+		if (size >= 20 && 0 == memcmp(pBytes, "DXBC", 4))
+			return FNV1a(pBytes + 4, 16);
+
+		return FNV1a(pBytes, size);
+	}
+
+	/*
+		InputLayoutCache.
+	*/
+
+	InputLayoutCache::~InputLayoutCache()
+	{
+		for (auto &bucket : m_layouts)
+			for (Layout &layout : bucket.second)
+				SAFE_RELEASE(layout.pLayout);
+	}
+
+	bool InputLayoutCache::Matches(const Layout &layout, const VertexDecl &decl, uint64_t shaderHash)
+	{
+		const std::vector<D3D11_INPUT_ELEMENT_DESC> &inputElements = decl.GetInputElements();
+		if (shaderHash != layout.shaderHash || inputElements.size() != layout.inputElements.size())
+			return false;
+
+		for (size_t iElement = 0; iElement < inputElements.size(); ++iElement)
+		{
+			const D3D11_INPUT_ELEMENT_DESC &A = inputElements[iElement], &B = layout.inputElements[iElement];
+			const bool isSame =
+				A.SemanticIndex == B.SemanticIndex && A.Format == B.Format && A.InputSlot == B.InputSlot && A.AlignedByteOffset == B.AlignedByteOffset
+				&& A.InputSlotClass == B.InputSlotClass && A.InstanceDataStepRate == B.InstanceDataStepRate
+				&& 0 == _stricmp(A.SemanticName, layout.semantics[iElement].c_str());
+
+			if (false == isSame)
+				return false;
+		}
+
+		return true;
+	}
+
+	ID3D11InputLayout *InputLayoutCache::Get(const VertexDecl &decl, const void *pVertexShaderBytecode, size_t size)
+	{
+		const uint64_t shaderHash = GetShaderHash(pVertexShaderBytecode, size);
+		const uint64_t key = (decl.GetHash() ^ shaderHash)*kFNV1aPrime ^ (shaderHash >> 29);
+
+		std::vector<Layout> &bucket = m_layouts[key];
+		for (const Layout &layout : bucket)
+		{
+			if (true == Matches(layout, decl, shaderHash))
+				return layout.pLayout;
+		}
+
+		// Validated against the shader's input signature here, in debug builds with a message as to what's wrong.
+		const std::vector<D3D11_INPUT_ELEMENT_DESC> &inputElements = decl.GetInputElements();
+		ID3D11InputLayout *pLayout = nullptr;
+		if (FAILED(GetDevice()->CreateInputLayout(inputElements.data(), (UINT) inputElements.size(), pVertexShaderBytecode, size, &pLayout)))
+		{
+			if (true == bucket.empty())
+				m_layouts.erase(key);
+
+			SetLastError("Can not create input layout (vertex declaration does not match shader input).");
+			return nullptr;
+		}
+
+		Layout layout;
+		layout.inputElements = inputElements;
+		for (const D3D11_INPUT_ELEMENT_DESC &inputElement : inputElements)
+			layout.semantics.push_back(inputElement.SemanticName);
+
+		// Not to be used: it'd point into the declaration.
+		for (D3D11_INPUT_ELEMENT_DESC &inputElement : layout.inputElements)
+			inputElement.SemanticName = nullptr;
+
+		layout.shaderHash = shaderHash;
+		layout.pLayout = pLayout;
+		bucket.push_back(std::move(layout));
+
+		++m_numLayouts;
+		return pLayout;
+	}
+}
@@ -0,0 +1,123 @@
+/*
+	D3D: vertex declarations & input layout cache.
+
+	A VertexDecl lists elements (semantic, format, stream) and lays them out: each element goes at the end
+	of its stream, and each stream is a vertex buffer of its own (bound to the slot of the same number).
+	Packed formats keep vertices small & the input assembler widens them (UNORM to [0, 1], SNORM to [-1, 1],
+	half to float); Decode() & Encode() do exactly the same on the CPU, so any layout the GPU reads can be
+	read, written and converted (see ConvertVertices()) by tools & CPU-side code as well.
+
+	An input layout is specific to a declaration & a vertex shader input signature: InputLayoutCache
+	creates each combination once, keyed by the declaration's hash & that of the shader bytecode (and
+	checked against both on a hit).
+*/
+
+#pragma once
+
+namespace D3D
+{
+	enum VertexFormat
+	{
+		kVertexFloat1,
+		kVertexFloat2,
+		kVertexFloat3,
+		kVertexFloat4,
+		kVertexHalf2,
+		kVertexHalf4,
+		kVertexUNorm8x4,     // Colors.
+		kVertexSNorm8x4,     // Normals & tangents (W for handedness).
+		kVertexUNorm16x2,    // Texture coordinates within [0, 1].
+		kVertexSNorm16x2,
+		kVertexSNorm16x4,    // Positions, scaled to their bounds.
+		kVertexUNorm1010102, // Normals biased to [0, 1], with a 2-bit W.
+		kVertexUInt8x4,      // Bone indices.
+		kNumVertexFormats
+	};
+
+	DXGI_FORMAT GetVertexFormatDXGI(VertexFormat format);
+	unsigned int GetVertexFormatSize(VertexFormat format);
+	unsigned int GetVertexFormatComponents(VertexFormat format);
+
+	struct VertexElement
+	{
+		const char *semantic; // Not copied, so use literals.
+		unsigned int semanticIndex;
+		VertexFormat format;
+		unsigned int stream, offset;
+	};
+
+	class VertexDecl
+	{
+	public:
+		VertexDecl();
+
+		// Appended to 'stream' (at a 4-byte aligned offset, as Direct3D requires); returns itself, to chain calls.
+		VertexDecl &Add(const char *semantic, unsigned int semanticIndex, VertexFormat format, unsigned int stream = 0);
+
+		// Makes 'stream' advance once every 'stepRate' instances instead of every vertex (call after adding its elements).
+		VertexDecl &SetInstanced(unsigned int stream, unsigned int stepRate = 1);
+
+		size_t GetNumElements() const { return m_elements.size(); }
+		const VertexElement &GetElement(size_t iElement) const { return m_elements[iElement]; }
+
+		// Index of the element, or -1.
+		int Find(const char *semantic, unsigned int semanticIndex = 0) const;
+
+		unsigned int GetNumStreams() const { return (unsigned int) m_strides.size(); }
+		unsigned int GetStride(unsigned int stream) const { return (stream < m_strides.size()) ? m_strides[stream] : 0; }
+
+		// For CreateInputLayout(); see InputLayoutCache.
+		const std::vector<D3D11_INPUT_ELEMENT_DESC> &GetInputElements() const { return m_inputElements; }
+		uint64_t GetHash() const { return m_hash; }
+
+		// 'pVertex' points to a vertex in the element's stream; missing components are (0, 0, 0, 1), as on the GPU.
+		void Decode(size_t iElement, const void *pVertex, float values[4]) const;
+
+		// Rounds to nearest & clamps to the format's range.
+		void Encode(size_t iElement, const float values[4], void *pVertex) const;
+
+	private:
+		void UpdateHash();
+
+		std::vector<VertexElement> m_elements;
+		std::vector<D3D11_INPUT_ELEMENT_DESC> m_inputElements;
+		std::vector<unsigned int> m_strides;
+		uint64_t m_hash;
+	};
+
+	// Matches elements by semantic (& index); those 'destDecl' has & 'sourceDecl' hasn't are set to (0, 0, 0, 1).
+	// One pointer per stream for both, each to the first of 'numVertices' (so mind per-instance streams).
+	void ConvertVertices(const VertexDecl &destDecl, void *const *ppDestStreams, const VertexDecl &sourceDecl, const void *const *ppSourceStreams, size_t numVertices);
+
+	// Of the bytecode; the DXBC container checksum if there is one.
+	uint64_t GetShaderHash(const void *pBytecode, size_t size);
+
+	class InputLayoutCache : public boost::noncopyable
+	{
+	public:
+		typedef std::unique_ptr<InputLayoutCache> Ptr;
+
+		InputLayoutCache() {}
+		~InputLayoutCache();
+
+		// Owned by the cache; nullptr (see SetLastError()) if 'decl' doesn't provide what the shader takes.
+		ID3D11InputLayout *Get(const VertexDecl &decl, const void *pVertexShaderBytecode, size_t size);
+
+		size_t GetSize() const { return m_numLayouts; }
+
+	private:
+		// What it was created for, to check against on a hit: keys are hashes, which may collide.
+		struct Layout
+		{
+			std::vector<D3D11_INPUT_ELEMENT_DESC> inputElements;
+			std::vector<std::string> semantics; // Copied, as the declaration's names may not outlive it.
+			uint64_t shaderHash;
+			ID3D11InputLayout *pLayout;
+		};
+
+		static bool Matches(const Layout &layout, const VertexDecl &decl, uint64_t shaderHash);
+
+		std::unordered_map<uint64_t, std::vector<Layout>> m_layouts;
+		size_t m_numLayouts = 0;
+	};
+}
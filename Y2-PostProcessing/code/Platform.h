@@ -21,6 +21,7 @@
 #include <windows.h>
 #include <dxgi.h>
 #include <d3d11.h>
+#include <d3d11_1.h>
 #include <d3d11shader.h>
 // #include <DirectXMath.h>
 // #include <DirectXPackedVector.h>
@@ -40,6 +41,10 @@
 #include <algorithm>
 #include <exception>
 #include <memory>
+#include <mutex>
+
+// See (on top of) Win32.cpp (important!)
+extern void SetLastError(const std::string &message);
 
 // Local
 #include "../3rdparty/Std3DMath/Math.h"
@@ -49,14 +54,14 @@
 #include "platform/DebugLog.h"
 #include "platform/Timer.h"
 #include "platform/StringUtil.h"
+#include "platform/HashedString.h"
+#include "platform/Parallel.h"
+#include "platform/MappedFile.h"
 
 // For easy access to DirectXMath types.
 // using namespace DirectX;
 // using namespace DirectX::PackedVector;
 
-// See (on top of) Win32.cpp (important!)
-extern void SetLastError(const std::string &message);
-
 inline bool IsPowerOfTwo(unsigned int X)
 {
 	return (0 != X) && (X & (~X + 1)) == X;
@@ -0,0 +1,154 @@
+/*
+	Frame scheduler: fixed-rate simulation, variable-rate rendering.
+
+	Each frame BeginFrame() adds the real time passed to an accumulator and returns how many fixed steps
+	to simulate to catch up; what's left (less than a step) is GetAlpha(), the fraction of a step rendering
+	is ahead of the last simulated state, to interpolate the previous & current state by (see Interpolated).
+	Simulation thus behaves the same at any frame rate, and rendering is smooth at any of them.
+
+	If frames take too long steps are capped (and the time dropped), so a slow frame can't lead to more
+	steps, which make the next one slower still. EndFrame() paces frames, if asked to, by waiting for the
+	next one's time slot: the thread sleeps (high resolution) instead of rendering frames nobody sees.
+
+	Time comes from a FrameClock: SystemClock (see Platform/SystemClock.h), or one of your own to drive the
+	scheduler without a window or real time passing (tests, replays, offline rendering).
+*/
+
+#pragma once
+
+class FrameClock
+{
+public:
+	virtual ~FrameClock() {}
+
+	// In seconds, from an arbitrary (but fixed) point.
+	virtual double Now() = 0;
+
+	// Returns at 'time' (or as soon as possible after).
+	virtual void WaitUntil(double time) = 0;
+};
+
+class FrameScheduler : public boost::noncopyable
+{
+public:
+	struct Stats
+	{
+		uint64_t numFrames, numSteps;
+		uint64_t numDroppedSteps; // Due to maxStepsPerFrame.
+		double waitTime;          // Total spent in EndFrame().
+	};
+
+	// 'stepTime' is the simulation step, 'frameTime' the shortest time between frames (0 to not pace),
+	// and 'maxStepsPerFrame' the most steps BeginFrame() asks for.
+	FrameScheduler(FrameClock &clock, double stepTime, double frameTime = 0.0, unsigned int maxStepsPerFrame = 5) :
+		m_clock(clock)
+		, m_stepTime(stepTime), m_frameTime(frameTime), m_maxStepsPerFrame(maxStepsPerFrame)
+	{
+		ASSERT(stepTime > 0.0 && frameTime >= 0.0 && 0 != maxStepsPerFrame);
+		memset(&m_stats, 0, sizeof(m_stats));
+		Resync();
+	}
+
+	// Returns the number of steps to simulate before rendering.
+	unsigned int BeginFrame()
+	{
+		const double now = m_clock.Now();
+		m_frameDelta = std::max(now - m_lastTime, 0.0);
+		m_lastTime = now;
+
+		m_accumulator += m_frameDelta;
+		uint64_t numSteps = (uint64_t) (m_accumulator/m_stepTime);
+		if (numSteps > m_maxStepsPerFrame)
+		{
+			const uint64_t numDropped = numSteps - m_maxStepsPerFrame;
+			m_accumulator -= numDropped*m_stepTime;
+			m_stats.numDroppedSteps += numDropped;
+			numSteps = m_maxStepsPerFrame;
+		}
+
+		m_accumulator = std::max(m_accumulator - numSteps*m_stepTime, 0.0);
+
+		++m_stats.numFrames;
+		m_stats.numSteps += numSteps;
+		return (unsigned int) numSteps;
+	}
+
+	// Waits for the next frame's slot, if pacing; a frame that's late starts the next right away.
+	void EndFrame()
+	{
+		if (0.0 == m_frameTime)
+			return;
+
+		const double now = m_clock.Now();
+		m_nextFrame += m_frameTime;
+		if (m_nextFrame <= now)
+		{
+			// Don't rush frames to catch up.
+			m_nextFrame = now;
+			return;
+		}
+
+		m_clock.WaitUntil(m_nextFrame);
+		m_stats.waitTime += m_nextFrame - now;
+	}
+
+	// Forgets the time since the last frame, so a pause (no focus, loading) isn't simulated afterwards.
+	void Resync()
+	{
+		m_lastTime = m_nextFrame = m_clock.Now();
+		m_accumulator = 0.0;
+		m_frameDelta = 0.0;
+	}
+
+	float GetStepTime() const { return (float) m_stepTime; }
+
+	// [0, 1): how far rendering is past the last step.
+	float GetAlpha() const { return (float) (m_accumulator/m_stepTime); }
+
+	// Real time since the last frame (for counters, not simulation).
+	double GetFrameDelta() const { return m_frameDelta; }
+
+	void SetFrameTime(double frameTime) { ASSERT(frameTime >= 0.0); m_frameTime = frameTime; }
+
+	const Stats &GetStats() const { return m_stats; }
+
+private:
+	FrameClock &m_clock;
+	const double m_stepTime;
+	double m_frameTime;
+	const unsigned int m_maxStepsPerFrame;
+
+	double m_lastTime, m_nextFrame;
+	double m_accumulator;
+	double m_frameDelta;
+
+	Stats m_stats;
+};
+
+// A simulated value, for rendering between the last 2 steps: Set() once per step, Get() with GetAlpha().
+template<typename T>
+class Interpolated
+{
+public:
+	explicit Interpolated(const T &value) :
+		m_previous(value), m_current(value) {}
+
+	void Set(const T &value)
+	{
+		m_previous = m_current;
+		m_current = value;
+	}
+
+	// Skips interpolation (a teleport, say).
+	void Reset(const T &value)
+	{
+		m_previous = m_current = value;
+	}
+
+	T Get(float alpha) const { return m_previous + (m_current - m_previous)*alpha; }
+
+	const T &GetCurrent() const { return m_current; }
+
+private:
+	T m_previous, m_current;
+};
@@ -0,0 +1,126 @@
+/*
+	Hashed string IDs: 64-bit FNV-1a.
+
+	FNV1a() is constexpr, so a HashedString made from a literal costs nothing at runtime (in release builds)
+	and lookups by ID never touch string memory. Runtime strings hash at roughly a cycle per byte.
+
+	Debug builds register every string that gets hashed, so GetName() can tell what an ID was made of
+	(and collisions are caught); to do so the literal constructor isn't constexpr there.
+	Use FNV1a() directly where a constant expression is required (case labels, static_assert()).
+*/
+
+#pragma once
+
+#include <unordered_map>
+
+const uint64_t kFNV1aBasis = 14695981039346656037ull;
+const uint64_t kFNV1aPrime = 1099511628211ull;
+
+// Recursive, as VS2015 only does C++11 constexpr.
+constexpr uint64_t FNV1aRecursive(const char *string, uint64_t hash)
+{
+	return ('\0' == *string) ? hash : FNV1aRecursive(string+1, (hash ^ (uint8_t) *string)*kFNV1aPrime);
+}
+
+constexpr uint64_t FNV1a(const char *string)
+{
+	return FNV1aRecursive(string, kFNV1aBasis);
+}
+
+inline uint64_t FNV1a(const char *pData, size_t length)
+{
+	uint64_t hash = kFNV1aBasis;
+	for (size_t iChar = 0; iChar < length; ++iChar)
+		hash = (hash ^ (uint8_t) pData[iChar])*kFNV1aPrime;
+
+	return hash;
+}
+
+#if defined(_DEBUG)
+	#define HASHED_STRING_CONSTEXPR
+#else
+	#define HASHED_STRING_CONSTEXPR constexpr
+#endif
+
+class HashedString
+{
+public:
+	template<size_t N>
+	HASHED_STRING_CONSTEXPR HashedString(const char (&literal)[N]) :
+		m_hash(FNV1a(literal))
+	{
+#if defined(_DEBUG)
+		Register(literal, strlen(literal));
+#endif
+	}
+
+	explicit HashedString(const std::string &string) :
+		m_hash(FNV1a(string.data(), string.size()))
+	{
+#if defined(_DEBUG)
+		Register(string.data(), string.size());
+#endif
+	}
+
+	// The empty string.
+	constexpr HashedString() :
+		m_hash(kFNV1aBasis) {}
+
+	constexpr explicit HashedString(uint64_t hash) :
+		m_hash(hash) {}
+
+	constexpr uint64_t GetHash() const { return m_hash; }
+
+	constexpr bool operator ==(const HashedString &B) const { return m_hash == B.m_hash; }
+	constexpr bool operator !=(const HashedString &B) const { return m_hash != B.m_hash; }
+	constexpr bool operator <(const HashedString &B)  const { return m_hash < B.m_hash; }
+
+	// The original string (debug builds only, and only if it's been hashed before).
+	const std::string GetName() const
+	{
+#if defined(_DEBUG)
+		std::lock_guard<std::mutex> lock(GetRegistryLock());
+		auto iName = GetRegistry().find(m_hash);
+		if (GetRegistry().end() != iName)
+			return iName->second;
+#endif
+
+		char name[32];
+		sprintf_s(name, 32, "#%016llx", (unsigned long long) m_hash);
+		return name;
+	}
+
+private:
+#if defined(_DEBUG)
+	static std::unordered_map<uint64_t, std::string> &GetRegistry()
+	{
+		static std::unordered_map<uint64_t, std::string> registry;
+		return registry;
+	}
+
+	static std::mutex &GetRegistryLock()
+	{
+		static std::mutex lock;
+		return lock;
+	}
+
+	void Register(const char *pString, size_t length) const
+	{
+		std::lock_guard<std::mutex> lock(GetRegistryLock());
+		auto result = GetRegistry().insert(std::make_pair(m_hash, std::string(pString, length)));
+		ASSERT_MSG(true == result.second || result.first->second.compare(0, std::string::npos, pString, length) == 0,
+			"HashedString collision: " << result.first->second << " & " << std::string(pString, length));
+	}
+#endif
+
+	uint64_t m_hash;
+};
+
+namespace std
+{
+	template<>
+	struct hash<HashedString>
+	{
+		size_t operator()(const HashedString &string) const { return (size_t) string.GetHash(); }
+	};
+}
@@ -0,0 +1,78 @@
+/*
+	Read-only memory mapped file (Win32).
+
+	Pages are faulted in on first touch, so parsing a header doesn't read the rest of the file,
+	and pointers into the view can be handed to Direct3D as-is (as long as the file stays open).
+*/
+
+#pragma once
+
+class MappedFile : public boost::noncopyable
+{
+public:
+	MappedFile() :
+		m_hFile(INVALID_HANDLE_VALUE), m_hMapping(NULL), m_pData(nullptr), m_size(0) {}
+
+	~MappedFile()
+	{
+		Close();
+	}
+
+	bool Open(const std::string &path)
+	{
+		Close();
+
+		// Sequential scan hint: most of our files are read front to back exactly once.
+		m_hFile = CreateFile(ToUnicode(path).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (INVALID_HANDLE_VALUE == m_hFile)
+		{
+			SetLastError("Can not open file: " + path);
+			return false;
+		}
+
+		LARGE_INTEGER size;
+		if (FALSE == GetFileSizeEx(m_hFile, &size) || 0 == size.QuadPart)
+		{
+			SetLastError("Can not map empty file: " + path);
+			Close();
+			return false;
+		}
+
+		m_hMapping = CreateFileMapping(m_hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (NULL != m_hMapping)
+			m_pData = static_cast<const uint8_t *>(MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0));
+
+		if (nullptr == m_pData)
+		{
+			SetLastError("Can not map file: " + path);
+			Close();
+			return false;
+		}
+
+		m_size = (size_t) size.QuadPart;
+		return true;
+	}
+
+	void Close()
+	{
+		if (nullptr != m_pData) UnmapViewOfFile(m_pData);
+		if (NULL != m_hMapping) CloseHandle(m_hMapping);
+		if (INVALID_HANDLE_VALUE != m_hFile) CloseHandle(m_hFile);
+
+		m_hFile = INVALID_HANDLE_VALUE;
+		m_hMapping = NULL;
+		m_pData = nullptr;
+		m_size = 0;
+	}
+
+	bool IsOpen() const { return nullptr != m_pData; }
+
+	const uint8_t *GetData() const { return m_pData; }
+	size_t GetSize() const { return m_size; }
+
+private:
+	HANDLE m_hFile;
+	HANDLE m_hMapping;
+	const uint8_t *m_pData;
+	size_t m_size;
+};
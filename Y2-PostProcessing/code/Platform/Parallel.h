@@ -0,0 +1,61 @@
+/*
+	Minimal fork-join helper: ParallelFor() spreads a range of jobs over all hardware threads.
+
+	Threads are spawned per call; that's fine for offline/load-time work (which is what this is for),
+	but don't call it per frame.
+*/
+
+#pragma once
+
+#include <thread>
+#include <atomic>
+
+inline unsigned int GetNumHardwareThreads()
+{
+	const unsigned int numThreads = std::thread::hardware_concurrency();
+	return (0 == numThreads) ? 1 : numThreads;
+}
+
+// Calls func(index) for every index in [0, count), 'grain' consecutive indices per fetch.
+// The calling thread participates, so a count smaller than or equal to 'grain' never spawns a thread.
+template<typename T>
+void ParallelFor(unsigned int count, unsigned int grain, const T &func)
+{
+	ASSERT(0 != grain);
+
+	const unsigned int numBatches = (count + grain - 1) / grain;
+	const unsigned int numThreads = std::min<unsigned int>(GetNumHardwareThreads(), numBatches);
+
+	if (numThreads <= 1)
+	{
+		for (unsigned int iJob = 0; iJob < count; ++iJob)
+			func(iJob);
+
+		return;
+	}
+
+	std::atomic<unsigned int> next(0);
+	auto worker = [&]()
+	{
+		for (;;)
+		{
+			const unsigned int first = next.fetch_add(grain);
+			if (first >= count)
+				break;
+
+			const unsigned int last = std::min<unsigned int>(first + grain, count);
+			for (unsigned int iJob = first; iJob < last; ++iJob)
+				func(iJob);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(numThreads - 1);
+	for (unsigned int iThread = 1; iThread < numThreads; ++iThread)
+		threads.emplace_back(worker);
+
+	worker();
+
+	for (auto &thread : threads)
+		thread.join();
+}
@@ -1,6 +1,6 @@
 
 /*
-	A few string utility functions (hashing & Unicode conversion).
+	A few string utility functions (Unicode conversion); for hashing see HashedString.h.
 */
 
 #pragma once
@@ -9,16 +9,6 @@
 #include <locale>
 #include <codecvt>
 
-// http://stackoverflow.com/questions/98153/whats-the-best-hashing-algorithm-to-use-on-a-stl-string-when-using-hash-map
-inline unsigned int StringHash(const std::string& path, unsigned int seed)
-{
-	unsigned int hash = seed;
-	for (auto character : path)
-		hash = hash*101 + character;
-
-	return hash;
-}
-
 /*
 	ToUnicode() & ToNarrow() are necessary in a few places as the internal convention is C string/UTF-8,
 	but we compile and communicate as a Unicode application.
@@ -0,0 +1,73 @@
+/*
+	System clock for the frame scheduler (see Platform/FrameScheduler.h): real time, and sleeping until then.
+*/
+
+#pragma once
+
+#include "FrameScheduler.h"
+
+#include <mmsystem.h>
+#pragma comment(lib, "winmm.lib")
+
+#if !defined(CREATE_WAITABLE_TIMER_HIGH_RESOLUTION)
+	#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+// Timer ticks (see Platform/Timer.h), and a waitable timer to sleep: high resolution if the OS has those (Windows 10 1803 onwards), otherwise
+// a regular one with the system timer resolution raised to 1ms. The last bit of each wait is spent spinning.
+class SystemClock : public FrameClock, public boost::noncopyable
+{
+public:
+	SystemClock()
+	{
+		m_start = GetTicks();
+
+		m_hTimer = CreateWaitableTimerEx(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+		m_isHighRes = NULL != m_hTimer;
+		if (false == m_isHighRes)
+		{
+			m_hTimer = CreateWaitableTimerEx(NULL, NULL, 0, TIMER_ALL_ACCESS);
+			timeBeginPeriod(1);
+		}
+
+		ASSERT(NULL != m_hTimer);
+		m_spinTime = (true == m_isHighRes) ? 0.0005 : 0.002;
+	}
+
+	~SystemClock()
+	{
+		if (false == m_isHighRes)
+			timeEndPeriod(1);
+
+		if (NULL != m_hTimer)
+			CloseHandle(m_hTimer);
+	}
+
+	double Now() override
+	{
+		return TicksToSeconds(GetTicks() - m_start);
+	}
+
+	void WaitUntil(double time) override
+	{
+		const double remaining = time - Now();
+		if (remaining > m_spinTime && NULL != m_hTimer)
+		{
+			// Relative, in 100ns units.
+			LARGE_INTEGER dueTime;
+			dueTime.QuadPart = -(LONGLONG) ((remaining - m_spinTime)*1e7);
+			if (FALSE != SetWaitableTimer(m_hTimer, &dueTime, 0, NULL, NULL, FALSE))
+				WaitForSingleObject(m_hTimer, INFINITE);
+		}
+
+		while (Now() < time)
+			YieldProcessor();
+	}
+
+private:
+	uint64_t m_start;
+
+	HANDLE m_hTimer;
+	bool m_isHighRes;
+	double m_spinTime; // Wakes up this early, to spin the rest.
+};
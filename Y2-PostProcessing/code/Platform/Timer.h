@@ -1,50 +1,186 @@
-
 /*
-	Simple Win32 timer (uses performance timer if available).
+	Monotonic timer: 64-bit integer ticks (QPC on Windows, CLOCK_MONOTONIC nanoseconds elsewhere).
+
+	Ticks are kept as integers and only converted (to double seconds) when asked, so intervals are exact
+	and precision doesn't degrade with uptime: a float of seconds can't tell milliseconds apart after a
+	few hours, whereas 64 bits of ticks last centuries.
+
+	Where even QPC is too slow (it can take over 100 cycles), as in profiler scopes around small pieces of
+	code, use the time stamp counter (see TSC below) instead: a few cycles to read, calibrated against
+	the timer.
 */
 
 #pragma once
 
+#if defined(_WIN32)
+	#include <intrin.h>
+#else
+	#include <time.h>
+	#include <x86intrin.h>
+	#include <cpuid.h>
+#endif
+
+// Now, in ticks since an arbitrary (but fixed) point.
+inline uint64_t GetTicks()
+{
+#if defined(_WIN32)
+	LARGE_INTEGER count;
+	VERIFY(QueryPerformanceCounter(&count));
+	return (uint64_t) count.QuadPart;
+#else
+	timespec now;
+	VERIFY(0 == clock_gettime(CLOCK_MONOTONIC, &now));
+	return (uint64_t) now.tv_sec*1000000000ull + (uint64_t) now.tv_nsec;
+#endif
+}
+
+// Ticks per second (fixed at boot).
+inline uint64_t GetTickFrequency()
+{
+#if defined(_WIN32)
+	static const uint64_t frequency = []()
+	{
+		LARGE_INTEGER frequency;
+		VERIFY(QueryPerformanceFrequency(&frequency));
+		return (uint64_t) frequency.QuadPart;
+	}();
+
+	return frequency;
+#else
+	return 1000000000ull;
+#endif
+}
+
+// Whole seconds & the remainder separately, so large counts convert exactly.
+inline double TicksToSeconds(uint64_t ticks, uint64_t frequency)
+{
+	return (double) (ticks/frequency) + (double) (ticks%frequency)/frequency;
+}
+
+inline double TicksToSeconds(uint64_t ticks)
+{
+	return TicksToSeconds(ticks, GetTickFrequency());
+}
+
+inline uint64_t SecondsToTicks(double seconds)
+{
+	ASSERT(seconds >= 0.0);
+	return (uint64_t) (seconds*GetTickFrequency() + 0.5);
+}
+
 class Timer
 {
 public:
-	Timer() :
-		m_isHighFreq(QueryPerformanceFrequency(&m_pcFrequency) != 0)
+	Timer()
 	{
 		Reset();
 	}
 
 	void Reset()
 	{
-		if (!m_isHighFreq)
-		{
-			m_offset.LowPart = GetTickCount();
-			m_oneOverFreq = 0.001f;
-		}
-		else
-		{
-			VERIFY(QueryPerformanceCounter(&m_offset));
-			m_oneOverFreq = 1.f / (float) m_pcFrequency.QuadPart;
-		}
+		m_start = GetTicks();
+	}
+
+	uint64_t GetElapsedTicks() const
+	{
+		return GetTicks() - m_start;
 	}
 
-	float Get() const 
+	double GetSeconds() const
 	{
-		if (!m_isHighFreq)
+		return TicksToSeconds(GetElapsedTicks());
+	}
+
+	// Seconds as a float: fine for short intervals (benchmarks, a frame), use the above for anything else.
+	float Get() const
+	{
+		return (float) GetSeconds();
+	}
+
+private:
+	uint64_t m_start;
+};
+
+// Time stamp counter, in cycles of a rate that's calibrated against GetTicks() on first use.
+// Only use it for timing if IsInvariant(): older CPUs change its rate with their clock speed (and
+// don't keep it in sync across cores), so fall back to GetTicks() otherwise.
+namespace TSC
+{
+	inline uint64_t Read()
+	{
+		return __rdtsc();
+	}
+
+	// Constant rate (regardless of power state) & in sync across cores.
+	inline bool IsInvariant()
+	{
+		static const bool isInvariant = []()
 		{
-			return (float) (GetTickCount() - m_offset.LowPart) * m_oneOverFreq;
-		}
-		else
+#if defined(_WIN32)
+			int info[4];
+			__cpuid(info, 0x80000000);
+			if ((unsigned int) info[0] < 0x80000007)
+				return false;
+
+			__cpuid(info, 0x80000007);
+			return 0 != (info[3] & (1 << 8));
+#else
+			unsigned int eax, ebx, ecx, edx;
+			if (0 == __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx))
+				return false;
+
+			return 0 != (edx & (1 << 8));
+#endif
+		}();
+
+		return isInvariant;
+	}
+
+	// Cycles per second; the first call measures it (over about 10ms).
+	inline uint64_t GetFrequency()
+	{
+		static const uint64_t frequency = []()
 		{
-			LARGE_INTEGER curCount;
-			VERIFY(QueryPerformanceCounter(&curCount)); 
-			return (float) (curCount.QuadPart - m_offset.QuadPart) * m_oneOverFreq;
-		}
+			const uint64_t tickFrequency = GetTickFrequency();
+			const uint64_t calibrationTicks = tickFrequency/100;
+
+			const uint64_t startTicks = GetTicks();
+			const uint64_t startCycles = Read();
+
+			uint64_t ticks;
+			do
+			{
+				ticks = GetTicks() - startTicks;
+			}
+			while (ticks < calibrationTicks);
+
+			const uint64_t cycles = Read() - startCycles;
+			return (uint64_t) ((double) cycles*tickFrequency/ticks + 0.5);
+		}();
+
+		return frequency;
+	}
+
+	inline double CyclesToSeconds(uint64_t cycles)
+	{
+		return TicksToSeconds(cycles, GetFrequency());
+	}
+}
+
+// Adds the cycles spent in its scope to a total: { ScopedCycles scope(stats.cycles); ... }
+// Convert the total with TSC::CyclesToSeconds() when reporting, not per scope.
+class ScopedCycles : public boost::noncopyable
+{
+public:
+	explicit ScopedCycles(uint64_t &total) :
+		m_total(total), m_start(TSC::Read()) {}
+
+	~ScopedCycles()
+	{
+		m_total += TSC::Read() - m_start;
 	}
 
 private:
-	const bool m_isHighFreq;
-	LARGE_INTEGER m_pcFrequency; 
-	LARGE_INTEGER m_offset;
-	float m_oneOverFreq;
+	uint64_t &m_total;
+	const uint64_t m_start;
 };
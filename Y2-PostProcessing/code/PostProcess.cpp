@@ -0,0 +1,188 @@
+
+/*
+	Year 2 Direct3D 11 workshop template.
+	PostProcess - Bloom, depth of field (tilt-shift) & tone mapping, as render graph passes.
+
+	Bloom:          scene -> bright pass (1/2) -> downsample (1/4) -> blur H -> blur V
+	Depth of field: scene -> downsample (1/2) -> blur H -> blur V
+	Composite:      scene, bloom & blurred scene -> tone mapped output
+
+	The targets of each chain are short-lived, so the graph gets by with 2 textures per size.
+*/
+
+#include "Platform.h"
+#include "D3D.h"
+#include "PostProcess.h"
+
+// Include headers with the post-processing shader bytecode.
+#include "../shaders/PostBright_PS.h"
+#include "../shaders/PostDownsample_PS.h"
+#include "../shaders/PostBlur_PS.h"
+#include "../shaders/PostComposite_PS.h"
+
+namespace PostProcess
+{
+	const float kBloomThreshold = 1.f;
+	const float kBloomKnee = 0.5f;
+	const float kBloomStrength = 0.6f;
+	const float kFocus = 0.5f;     // Center of the sharp band (V).
+	const float kFocusRange = 0.2f; // Half its height.
+	const float kExposure = 1.f;
+
+	// Matches PostConstants in shaders/Post.inc.
+	struct Constants
+	{
+		float viewport[4];
+		float texel[4];
+		float params[4];
+	};
+
+	static ID3D11PixelShader *s_pBrightPS = nullptr;
+	static ID3D11PixelShader *s_pDownsamplePS = nullptr;
+	static ID3D11PixelShader *s_pBlurPS = nullptr;
+	static ID3D11PixelShader *s_pCompositePS = nullptr;
+	static ID3D11SamplerState *s_pSamplerState = nullptr;
+	static ID3D11Buffer *s_pConstants = nullptr;
+
+	bool Create()
+	{
+		ID3D11Device *pDevice = D3D::GetDevice();
+
+		VERIFY(S_OK == pDevice->CreatePixelShader(g_PostBright_PS, sizeof(g_PostBright_PS), nullptr, &s_pBrightPS));
+		VERIFY(S_OK == pDevice->CreatePixelShader(g_PostDownsample_PS, sizeof(g_PostDownsample_PS), nullptr, &s_pDownsamplePS));
+		VERIFY(S_OK == pDevice->CreatePixelShader(g_PostBlur_PS, sizeof(g_PostBlur_PS), nullptr, &s_pBlurPS));
+		VERIFY(S_OK == pDevice->CreatePixelShader(g_PostComposite_PS, sizeof(g_PostComposite_PS), nullptr, &s_pCompositePS));
+
+		// Bilinear, clamped.
+		D3D11_SAMPLER_DESC samplerDesc;
+		memset(&samplerDesc, 0, sizeof(samplerDesc));
+		samplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+		samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+		samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+		samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+		samplerDesc.ComparisonFunc = D3D11_COMPARISON_ALWAYS;
+		samplerDesc.MaxLOD = FLT_MAX;
+		VERIFY(S_OK == pDevice->CreateSamplerState(&samplerDesc, &s_pSamplerState));
+
+		// Rewritten (discarded) for every pass.
+		D3D11_BUFFER_DESC bufferDesc;
+		bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+		bufferDesc.ByteWidth = sizeof(Constants);
+		bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		bufferDesc.MiscFlags = 0;
+		bufferDesc.StructureByteStride = 0;
+		if (FAILED(pDevice->CreateBuffer(&bufferDesc, nullptr, &s_pConstants)))
+		{
+			SetLastError("Can not create post-processing constant buffer.");
+			return false;
+		}
+
+		return true;
+	}
+
+	void Destroy()
+	{
+		SAFE_RELEASE(s_pConstants);
+		SAFE_RELEASE(s_pSamplerState);
+		SAFE_RELEASE(s_pCompositePS);
+		SAFE_RELEASE(s_pBlurPS);
+		SAFE_RELEASE(s_pDownsamplePS);
+		SAFE_RELEASE(s_pBrightPS);
+	}
+
+	// Draws a full viewport quad to the pass's target; 'source' sets the texel size.
+	static void Draw(const D3D::RenderGraph &graph, D3D::GraphTarget target, D3D::GraphTarget source, ID3D11PixelShader *pShader,
+		float directionX, float directionY, const float params[4])
+	{
+		const D3D11_VIEWPORT &viewport = graph.GetViewport(target);
+		const D3D11_VIEWPORT &sourceViewport = graph.GetViewport(source);
+
+		Constants constants;
+		constants.viewport[0] = viewport.TopLeftX;
+		constants.viewport[1] = viewport.TopLeftY;
+		constants.viewport[2] = 1.f/viewport.Width;
+		constants.viewport[3] = 1.f/viewport.Height;
+		constants.texel[0] = 1.f/sourceViewport.Width;
+		constants.texel[1] = 1.f/sourceViewport.Height;
+		constants.texel[2] = directionX;
+		constants.texel[3] = directionY;
+		memcpy(constants.params, params, sizeof(constants.params));
+
+		ID3D11DeviceContext *pContext = D3D::GetContext();
+		D3D11_MAPPED_SUBRESOURCE mappedRes;
+		VERIFY(S_OK == pContext->Map(s_pConstants, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedRes));
+		memcpy(mappedRes.pData, &constants, sizeof(Constants));
+		pContext->Unmap(s_pConstants, 0);
+
+		D3D::StateCache &stateCache = D3D::GetStateCache();
+		stateCache.SetPSConstantBuffers(0, 1, &s_pConstants);
+		stateCache.SetPSSamplers(0, 1, &s_pSamplerState);
+		stateCache.SetBlendState(nullptr);
+
+		D3D::DrawQuad(pShader);
+	}
+
+	void AddPasses(D3D::RenderGraph &graph, D3D::GraphTarget scene, D3D::GraphTarget output)
+	{
+		const D3D11_VIEWPORT &sceneViewport = D3D::GetSceneViewport();
+		const unsigned int width = (unsigned int) sceneViewport.Width, height = (unsigned int) sceneViewport.Height;
+
+		const D3D::RenderTargetDesc halfDesc = { std::max(width/2, 1u), std::max(height/2, 1u), kSceneFormat };
+		const D3D::RenderTargetDesc quarterDesc = { std::max(width/4, 1u), std::max(height/4, 1u), kSceneFormat };
+
+		const float noParams[4] = { 0.f, 0.f, 0.f, 0.f };
+
+		// Bloom.
+		const D3D::GraphTarget bright = graph.CreateTarget("Bright", halfDesc);
+		graph.AddPass("Bright pass", [=](const D3D::RenderGraph &compiled)
+		{
+			const float params[4] = { kBloomThreshold, kBloomKnee, 0.f, 0.f };
+			Draw(compiled, bright, scene, s_pBrightPS, 0.f, 0.f, params);
+		}).Read(scene).Write(bright);
+
+		const D3D::GraphTarget bloomDown = graph.CreateTarget("Bloom downsample", quarterDesc);
+		graph.AddPass("Bloom downsample", [=](const D3D::RenderGraph &compiled)
+		{
+			Draw(compiled, bloomDown, bright, s_pDownsamplePS, 0.f, 0.f, noParams);
+		}).Read(bright).Write(bloomDown);
+
+		const D3D::GraphTarget bloomH = graph.CreateTarget("Bloom blur H", quarterDesc);
+		graph.AddPass("Bloom blur H", [=](const D3D::RenderGraph &compiled)
+		{
+			Draw(compiled, bloomH, bloomDown, s_pBlurPS, 1.f, 0.f, noParams);
+		}).Read(bloomDown).Write(bloomH);
+
+		const D3D::GraphTarget bloom = graph.CreateTarget("Bloom", quarterDesc);
+		graph.AddPass("Bloom blur V", [=](const D3D::RenderGraph &compiled)
+		{
+			Draw(compiled, bloom, bloomH, s_pBlurPS, 0.f, 1.f, noParams);
+		}).Read(bloomH).Write(bloom);
+
+		// Depth of field.
+		const D3D::GraphTarget dofDown = graph.CreateTarget("DOF downsample", halfDesc);
+		graph.AddPass("DOF downsample", [=](const D3D::RenderGraph &compiled)
+		{
+			Draw(compiled, dofDown, scene, s_pDownsamplePS, 0.f, 0.f, noParams);
+		}).Read(scene).Write(dofDown);
+
+		const D3D::GraphTarget dofH = graph.CreateTarget("DOF blur H", halfDesc);
+		graph.AddPass("DOF blur H", [=](const D3D::RenderGraph &compiled)
+		{
+			Draw(compiled, dofH, dofDown, s_pBlurPS, 1.f, 0.f, noParams);
+		}).Read(dofDown).Write(dofH);
+
+		const D3D::GraphTarget blurred = graph.CreateTarget("DOF", halfDesc);
+		graph.AddPass("DOF blur V", [=](const D3D::RenderGraph &compiled)
+		{
+			Draw(compiled, blurred, dofH, s_pBlurPS, 0.f, 1.f, noParams);
+		}).Read(dofH).Write(blurred);
+
+		// Composite (order of reads matches the shader's registers).
+		graph.AddPass("Composite", [=](const D3D::RenderGraph &compiled)
+		{
+			const float params[4] = { kFocus, kFocusRange, kBloomStrength, kExposure };
+			Draw(compiled, output, scene, s_pCompositePS, 0.f, 0.f, params);
+		}).Read(scene).Read(bloom).Read(blurred).Write(output);
+	}
+}
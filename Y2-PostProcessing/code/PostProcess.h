@@ -0,0 +1,24 @@
+
+/*
+	Year 2 Direct3D 11 workshop template.
+	PostProcess - Bloom, depth of field (tilt-shift) & tone mapping, as render graph passes.
+*/
+
+#if !defined(POST_PROCESS_H)
+#define POST_PROCESS_H
+
+namespace PostProcess
+{
+	// Call after D3D::Create().
+	bool Create();
+	void Destroy();
+
+	// Format of the scene target AddPasses() expects (HDR).
+	const DXGI_FORMAT kSceneFormat = DXGI_FORMAT_R16G16B16A16_FLOAT;
+
+	// Reads 'scene' & writes the result to 'output' (which would usually be the imported back buffer).
+	// Intermediate targets are transient, so the graph aliases them where it can.
+	void AddPasses(D3D::RenderGraph &graph, D3D::GraphTarget scene, D3D::GraphTarget output);
+}
+
+#endif // POST_PROCESS_H
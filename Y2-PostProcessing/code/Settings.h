@@ -23,6 +23,12 @@ const bool WINDOWED_DEV = true;  // Windowed or full screen.
 const bool VSYNC_DEV = true;     // Vertical sync.
 const UINT MULTI_SAMPLE_DEV = 1; // Multi-sampling: 1 means OFF, otherwise pick: 2, 4 or 8 (samples).
 
+// Simulation steps per second (fixed, see Platform/FrameScheduler.h).
+const double SIMULATION_RATE = 60.0;
+
+// Frame rate cap when not synchronized to the display (windowed); 0 for none.
+const double MAX_FRAME_RATE_DEV = 60.0;
+
 // Windowed resolution (fixed).
 const unsigned int WINDOWED_RES_X = 1280;
 const unsigned int WINDOWED_RES_Y = 720;
@@ -34,6 +40,9 @@ const unsigned int WINDOWED_RES_Y = 720;
 const DXGI_FORMAT D3D_BACK_BUFFER_FORMAT = DXGI_FORMAT_B8G8R8A8_UNORM;
 const DXGI_FORMAT D3D_BACK_BUFFER_FORMAT_GAMMA = DXGI_FORMAT_B8G8R8A8_UNORM_SRGB;
 
+// Content archive (see Content/Archive.h), mounted at startup if present; loose files are used otherwise.
+const std::string CONTENT_ARCHIVE = "content.y2pak";
+
 // Set to 'true' to have D3D shut it's trap about lingering binds (applies to debug build only).
 const bool D3D_DISABLE_SPECIFIC_WARNINGS = true; // Unused (FIXME)
 
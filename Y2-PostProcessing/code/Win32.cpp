@@ -30,14 +30,8 @@
 	To-do:
 	- Move quad draw into 'ScreenQuad'-like object (or function).
 	- Shader load (D3DCompile) mechanism from TPBDS.
-	- Texture load.
-	- Model load.
 	- Small render pipeline.
 
-	To-do (medium priority):
-	- Sprite batcher.
-	- Resource hub.
-
 	To-do (low priority):
 	- Debug GUI.
 	- Fix the cock up in the setup dialog (adapters without an output, what to do?).
@@ -58,26 +52,41 @@
 #include <intrin.h> 
 #include "platform/CPUID.h"
 
+// Frame pacing.
+#include "platform/FrameScheduler.h"
+#include "platform/SystemClock.h"
+
 #include "../VS/Resources/resource.h"
 #include "Settings.h"
 #include "DXGI.h"
 #include "SetupDialog.h"
 #include "D3D.h"
 #include "World.h"
+#include "Content/MeshImport.h"
+#include "Content/ResourceHub.h"
+#include "Content/MeshOptimizer.h"
+#include "Content/BlockCompress.h"
+#include "Content/VirtualTexture.h"
+#include <random>
 
 // Configuration: windowed or full screen.
 bool s_windowed = WINDOWED_DEV; // Can be modified later by setup dialog.
 
 // Global error message.
 // This is a simple mechanism to relay an error message in applications that do not need to recover from failure.
+// Guarded, as offline content tools (see Content/) may fail on worker threads.
 static std::string s_lastError;
-void SetLastError(const std::string &message) { s_lastError = message; }
+static std::mutex s_lastErrorLock;
+void SetLastError(const std::string &message) { std::lock_guard<std::mutex> lock(s_lastErrorLock); s_lastError = message; }
 
 // Render/application window variables.
 static bool s_classRegged = false;
 static HWND s_hWnd = NULL;
 static bool s_wndIsActive; // Set by WindowProc()
 
+// Set by WindowProc() (debug key), run in between frames.
+static bool s_runBenchmarks = false;
+
 // Window message loop.
 static LRESULT CALLBACK WindowProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 {
@@ -110,6 +119,13 @@ static LRESULT CALLBACK WindowProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM l
 		case VK_SPACE:
 			// Debug (un)pause.
 			break;
+
+#if defined(_DEBUG) || defined(_DESIGN)
+		case VK_F1:
+			// Debug benchmarks (see RunBenchmarks()).
+			s_runBenchmarks = true;
+			break;
+#endif
 		}
 
 		if (0)
@@ -244,9 +260,9 @@ static bool UpdateAppWindow(bool &renderFrame)
 	// Skip rendering this frame, unless otherwise specified.
 	renderFrame = false;
 
-	// Got a message to process?
+	// Process all pending messages (input included) before the next frame.
 	MSG msg;
-	if (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
+	while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
 	{
 		if (msg.message == WM_QUIT)
 		{
@@ -258,28 +274,26 @@ static bool UpdateAppWindow(bool &renderFrame)
 		TranslateMessage(&msg);
 		DispatchMessage(&msg);
 	}
-	else
+
+	// Window still alive?
+	if (NULL != s_hWnd)
 	{
-		// Window still alive?
-		if (NULL != s_hWnd)
+		if (false == s_windowed && true == s_wndIsActive)
 		{
-			if (false == s_windowed && true == s_wndIsActive)
-			{
-				// Kill cursor for active full screen window.
-				SetCursor(NULL);
-			}
+			// Kill cursor for active full screen window.
+			SetCursor(NULL);
+		}
 
-			// Render frame if windowed or full screen window has focus.
-			if (s_windowed || s_wndIsActive)
-			{
-				renderFrame = true;
-			}
-			else
-			{
-				// Full screen window out of focus: relinquish rest of time slice.
-				// This keeps your loop from spinning (and spiking a core up to 100%).
-				Sleep(0);
-			}
+		// Render frame if windowed or full screen window has focus.
+		if (s_windowed || s_wndIsActive)
+		{
+			renderFrame = true;
+		}
+		else
+		{
+			// Full screen window out of focus: sleep until there's a message.
+			// This keeps your loop from spinning (and spiking a core up to 100%).
+			WaitMessage();
 		}
 	}
 
@@ -303,6 +317,101 @@ void DestroyAppWindow(HINSTANCE hInstance)
 	}
 }
 
+// Logs, next to the FPS counter: pacing since the last call, and the last frame's uploads & state changes
+// (debug & design builds only, like DEBUG_LOG itself).
+static void LogFrameStats(const FrameScheduler &scheduler)
+{
+	// The scheduler's are totals, so report those since the last call.
+	static FrameScheduler::Stats lastStats = { 0, 0, 0, 0.0 };
+	const FrameScheduler::Stats &stats = scheduler.GetStats();
+	const uint64_t numFrames = std::max<uint64_t>(stats.numFrames - lastStats.numFrames, 1);
+	DEBUG_LOG("Frames: %.2f steps & %.3f ms. paced (waiting) each, %llu steps dropped",
+		(double) (stats.numSteps - lastStats.numSteps)/numFrames, 1000.0*(stats.waitTime - lastStats.waitTime)/numFrames,
+		(unsigned long long) (stats.numDroppedSteps - lastStats.numDroppedSteps));
+	lastStats = stats;
+
+	const D3D::UploadStats &uploads = D3D::GetUploadStats();
+	DEBUG_LOG("Buffer uploads: %u (%u whole, %u skipped as unchanged), %.1f KB",
+		uploads.numUploads, uploads.numWhole, uploads.numSkipped, uploads.numBytes/1024.0);
+
+	// Redundant state changes the cache kept from the driver, by call.
+	const D3D::StateCache::Stats &state = D3D::GetStateCache().GetStats();
+	DEBUG_LOG("State changes: %u issued, %u filtered", state.GetNumIssued(), state.GetNumFiltered());
+	for (unsigned int iCall = 0; iCall < D3D::StateCache::kNumCalls; ++iCall)
+	{
+		if (0 != state.numFiltered[iCall])
+		{
+			DEBUG_LOG("- %s: %u issued, %u filtered",
+				D3D::GetStateCallName((D3D::StateCache::Call) iCall), state.numIssued[iCall], state.numFiltered[iCall]);
+		}
+	}
+}
+
+// Runs all benchmarks, each logging to the debug output. There's no content to load for these, so they get stand-ins:
+// an image with gradients, hard edges & noise, and a grid mesh with it's triangles shuffled (as an unoptimized one would be).
+static void RunBenchmarks()
+{
+	Content::Image image(1024, 1024);
+	for (unsigned int Y = 0; Y < image.height; ++Y)
+	{
+		uint32_t *pPixels = image.GetRow(Y);
+		for (unsigned int X = 0; X < image.width; ++X)
+		{
+			const uint32_t noise = (X*73856093u ^ Y*19349663u) >> 28;
+			const uint32_t checker = ((X >> 6) ^ (Y >> 6)) & 1;
+			const uint32_t R = (X >> 2) + noise, G = (Y >> 2) + noise, B = (0 != checker) ? 0xc0 : 0x40, A = (X + Y) >> 3;
+			pPixels[X] = std::min<uint32_t>(R, 255) | std::min<uint32_t>(G, 255) << 8 | B << 16 | (A & 255) << 24;
+		}
+	}
+
+	Content::BenchmarkBlockCompression(image);
+
+	const unsigned int gridSize = 256;
+	Content::MeshData mesh;
+	mesh.vertexFormat = Content::kMeshPosition;
+	for (unsigned int Y = 0; Y <= gridSize; ++Y)
+	{
+		for (unsigned int X = 0; X <= gridSize; ++X)
+		{
+			const float position[3] = { (float) X, 0.f, (float) Y };
+			mesh.vertices.insert(mesh.vertices.end(), position, position+3);
+		}
+	}
+
+	std::vector<std::array<uint32_t, 3>> triangles;
+	for (uint32_t Y = 0; Y < gridSize; ++Y)
+	{
+		for (uint32_t X = 0; X < gridSize; ++X)
+		{
+			const uint32_t A = Y*(gridSize+1) + X, B = A+1, C = A + gridSize+1, D = C+1;
+			triangles.push_back({ { A, C, B } });
+			triangles.push_back({ { B, C, D } });
+		}
+	}
+
+	std::shuffle(triangles.begin(), triangles.end(), std::mt19937(1));
+	for (const auto &triangle : triangles)
+		mesh.indices.insert(mesh.indices.end(), triangle.begin(), triangle.end());
+
+	Content::MeshFileSubmesh submesh;
+	submesh.firstIndex = 0;
+	submesh.numIndices = (uint32_t) mesh.indices.size();
+	submesh.materialHash = 0;
+	submesh.bounds.min[0] = submesh.bounds.min[1] = submesh.bounds.min[2] = 0.f;
+	submesh.bounds.max[0] = submesh.bounds.max[2] = (float) gridSize;
+	submesh.bounds.max[1] = 0.f;
+	mesh.submeshes.push_back(submesh);
+	mesh.bounds = submesh.bounds;
+
+	const Content::MeshFileLOD LOD = { 0, 1, 0.f };
+	mesh.LODs.push_back(LOD);
+
+	Content::BenchmarkMeshOptimizer(mesh);
+
+	Content::BenchmarkVirtualTexture();
+	D3D::BenchmarkInstancing();
+}
+
 // Our own entry point (taken care off in the function below).
 int __stdcall Main(HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, int nCmdShow)
 {
@@ -317,8 +426,43 @@ int __stdcall Main(HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, int nCmdShow
 	}
 */
 
+	// Offline mesh conversion: "-convert <source.obj> <target.y2mesh> [...]" (no window, no device).
+	if (0 == strncmp(lpCmdLine, "-convert ", 9))
+	{
+		std::istringstream arguments(lpCmdLine + 9);
+		std::vector<std::string> sourcePaths, targetPaths;
+		std::string sourcePath, targetPath;
+		while (arguments >> sourcePath >> targetPath)
+		{
+			sourcePaths.push_back(sourcePath);
+			targetPaths.push_back(targetPath);
+		}
+
+		if (true == sourcePaths.empty())
+			SetLastError("Usage: -convert <source.obj> <target.y2mesh> [...]");
+		else
+			Content::ConvertMeshes(sourcePaths, targetPaths);
+	}
+
+	// Offline packing: "-pack <archive.y2pak> <file> [...]", paths as they're requested at runtime.
+	else if (0 == strncmp(lpCmdLine, "-pack ", 6))
+	{
+		std::istringstream arguments(lpCmdLine + 6);
+		std::string archivePath, sourcePath;
+		std::vector<std::string> sourcePaths;
+		arguments >> archivePath;
+		while (arguments >> sourcePath)
+			sourcePaths.push_back(sourcePath);
+
+		Content::ArchiveStats stats;
+		if (true == sourcePaths.empty())
+			SetLastError("Usage: -pack <archive.y2pak> <file> [...]");
+		else if (true == Content::BuildArchive(archivePath, sourcePaths, &stats))
+			DEBUG_LOG("Packed %u files (%u compressed): %llu bytes down to %llu", stats.numEntries, stats.numCompressed, stats.rawSize, stats.storedSize);
+	}
+
 	// Initialize DXGI.
-	if (DXGI::Create(hInstance, s_windowed))
+	else if (DXGI::Create(hInstance, s_windowed))
 	{
 #if (!defined(_DEBUG) && !defined(_DESIGN)) || defined(FORCE_SETUP_DIALOG)
 		
@@ -387,13 +531,24 @@ int __stdcall Main(HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, int nCmdShow
 					// Initialize D3D renderer.
 					if (D3D::Create(DXGI::GetDevice(), DXGI::GetContext(), DXGI::GetSwapChain(), multiDesc, RENDER_ASPECT_RATIO, aspectRatio))
 					{
-						if (World::Create())
+						// Optional, so only mounted if it's there.
+						const bool hasArchive = INVALID_FILE_ATTRIBUTES != GetFileAttributes(ToUnicode(CONTENT_ARCHIVE).c_str());
+
+						// From here on World may load asynchronously (see Content/AsyncLoad.h).
+						Content::StartAsyncLoading();
+
+						if ((false == hasArchive || true == Content::MountArchive(CONTENT_ARCHIVE)) && World::Create())
 						{
+							// Simulation runs in fixed steps, rendering as often as frames are paced: synchronized
+							// to the display (full screen) or capped by the scheduler (windowed, as the desktop ignores vertical sync.).
+							SystemClock clock;
+							const bool isSynced = false == s_windowed && true == vSync;
+							const double frameTime = (false == isSynced && 0.0 != MAX_FRAME_RATE_DEV) ? 1.0/MAX_FRAME_RATE_DEV : 0.0;
+							FrameScheduler scheduler(clock, 1.0/SIMULATION_RATE, frameTime);
+
 							// In windowed mode FPS counter is refreshed every 60 frames.
-							Timer timer;
-							float timeElapsedFPS = 0.f;
+							double timeElapsedFPS = 0.0;
 							unsigned int numFramesFPS = 0;
-							float prevTimeElapsed = timer.Get();
 
 							// Enter (render) loop.
 							bool renderFrame;
@@ -402,18 +557,27 @@ int __stdcall Main(HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, int nCmdShow
 								if (true == renderFrame)
 								{
 									// Render frame.
-									const float time = timer.Get();
-									const float timeElapsed = time - prevTimeElapsed;
-									prevTimeElapsed = time;
+									const unsigned int numSteps = scheduler.BeginFrame();
+									const double timeElapsed = scheduler.GetFrameDelta();
+
+									// Finish loads that are ready for the GPU.
+									Content::ProcessAsyncLoads();
 
 									// Simulate..
-									if (true == World::Simulate())
+									bool isRunning = true;
+									for (unsigned int iStep = 0; iStep < numSteps && true == isRunning; ++iStep)
+										isRunning = World::Simulate(scheduler.GetStepTime());
+
+									if (true == isRunning)
 									{
-										// And render!
-										World::Render();
+										// And render (in between the last 2 steps)!
+										World::Render(scheduler.GetAlpha());
 
 										// Desktop ignores vertical sync., otherwise sync. to refresh rate (usually 60Hz).
 										D3D::Flip((true == s_windowed) ? false : true == vSync);
+
+										// Resources dropped during the frame can go now.
+										Content::ReleaseUnusedResources();
 									}
 									else
 										// We're done, it seems (FIXME: check!).
@@ -426,16 +590,35 @@ int __stdcall Main(HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, int nCmdShow
 
 										if (++numFramesFPS == 60)
 										{
-											const float FPS = 60.f / timeElapsedFPS;
+											const double FPS = 60.0 / timeElapsedFPS;
 
 											wchar_t fpsStr[256];
 											swprintf(fpsStr, 256, L"%s (%2f FPS)", APP_TITLE.c_str(), FPS);
 											SetWindowText(s_hWnd, fpsStr);
 
-											timeElapsedFPS = 0.f;
+											LogFrameStats(scheduler);
+
+											timeElapsedFPS = 0.0;
 											numFramesFPS = 0;
 										}
 									}
+
+									// Wait for the next frame (if capped).
+									scheduler.EndFrame();
+
+									if (true == s_runBenchmarks)
+									{
+										s_runBenchmarks = false;
+										RunBenchmarks();
+
+										// Don't simulate the time they took.
+										scheduler.Resync();
+									}
+								}
+								else
+								{
+									// Idle time isn't simulated afterwards.
+									scheduler.Resync();
 								}
 							}
 						}
@@ -447,6 +630,9 @@ int __stdcall Main(HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, int nCmdShow
 
 	// Destroy resources in reverse order.
 	World::Destroy();
+	Content::StopAsyncLoading();
+	Content::DestroyResources();
+	Content::UnmountArchives();
 	D3D::Destroy();
 	DXGI::DestroyDevice(s_windowed);
 	DestroyAppWindow(hInstance);
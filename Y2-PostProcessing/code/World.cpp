@@ -7,28 +7,81 @@
 #include "Platform.h"
 #include "World.h"
 #include "D3D.h"
+#include "PostProcess.h"
 
 namespace World
 {
+	static D3D::RenderQueue::Ptr s_renderQueue;
+	static std::unique_ptr<D3D::ContextBackend> s_renderBackend;
+	static D3D::RenderGraph::Ptr s_renderGraph;
+
 	bool Create()
 	{
+		if (false == PostProcess::Create())
+			return false;
+
+		s_renderQueue.reset(new D3D::RenderQueue());
+		s_renderBackend.reset(new D3D::ContextBackend());
+		s_renderGraph.reset(new D3D::RenderGraph());
 		return true;
 	}
 
 	void Destroy()
 	{
+		s_renderGraph.reset();
+		s_renderBackend.reset();
+		s_renderQueue.reset();
+		PostProcess::Destroy();
 	}
 
-	bool Simulate() 
+	bool Simulate(float timeStep) 
 	{ 
 		return true;  
 	}
 
-	void Render()
+	void Render(float alpha)
 	{
 		D3D::BeginFrame();
 		{
+			D3D::RenderGraph &graph = *s_renderGraph;
+			graph.Reset();
+
+			const D3D11_VIEWPORT &sceneViewport = D3D::GetSceneViewport();
+			const D3D::RenderTargetDesc sceneDesc = { (unsigned int) sceneViewport.Width, (unsigned int) sceneViewport.Height, PostProcess::kSceneFormat };
+			const D3D::GraphTarget scene = graph.CreateTarget("Scene", sceneDesc);
+			const D3D::GraphTarget backBuffer = graph.ImportTarget("Back buffer", D3D::GetBackBuffer(), D3D::GetBackViewport());
+
+			graph.AddPass("Scene", [scene](const D3D::RenderGraph &compiled)
+			{
+				const float black[4] = { 0.f, 0.f, 0.f, 0.f };
+				D3D::GetContext()->ClearRenderTargetView(compiled.GetTarget(scene).GetTargetView(), black);
+
+				// FIXME (test!)
+				D3D::DrawQuad();
+
+				// Draws go through s_renderQueue->Add().
+				s_renderQueue->Flush(*s_renderBackend);
+			}).Write(scene);
+
+			PostProcess::AddPasses(graph, scene, backBuffer);
+
+			if (true == graph.Compile())
+			{
+				// Log target memory whenever it changes (so once the declarations settle).
+				static size_t s_textureBytes = 0;
+				const D3D::RenderGraphStats &stats = graph.GetStats();
+				if (s_textureBytes != stats.textureBytes)
+				{
+					const D3D::RenderTargetPool::Stats &poolStats = D3D::GetRenderTargetPool().GetStats();
+					DEBUG_LOG("Render graph: %u passes (%u culled), %u targets in %u textures, %.1fMB instead of %.1fMB",
+						stats.numPasses, stats.numCulled, stats.numTransients, stats.numTextures, stats.textureBytes/(1024.f*1024.f), stats.transientBytes/(1024.f*1024.f));
+					DEBUG_LOG("Render target pool: %u targets (%u free), %.1fMB, %.1f%% hits",
+						poolStats.numTargets, poolStats.numFree, poolStats.numBytes/(1024.f*1024.f), 100.f*poolStats.GetHitRate());
+					s_textureBytes = stats.textureBytes;
+				}
 
+				graph.Execute();
+			}
 		}
 		D3D::EndFrame();
 	}
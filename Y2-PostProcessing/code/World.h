@@ -12,9 +12,10 @@ namespace World
 	bool Create();
 	void Destroy();
 
-	// Simulate() can signal a stop to the action; if it doesn't call Render().
-	bool Simulate();
-	void Render();
+	// Simulate() advances a fixed step (in seconds) and can signal a stop to the action; if it doesn't call Render().
+	// Render() draws 'alpha' [0, 1) of a step past the last one, so interpolate state by it (see Interpolated).
+	bool Simulate(float timeStep);
+	void Render(float alpha);
 }
 
 #endif // WORLD_H
@@ -0,0 +1,11 @@
+
+/*
+	Pixel shader for instanced geometry: instance color.
+*/
+
+#include "Instanced.inc"
+
+float4 Instanced_PS(in VS_OUTPUT input) : SV_Target0
+{
+	return input.color;
+}
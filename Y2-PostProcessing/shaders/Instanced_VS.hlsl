@@ -0,0 +1,15 @@
+
+/*
+	Vertex shader for instanced geometry: the instance transform takes it straight to (2D) clip space, like Passthrough_VS.
+*/
+
+#include "Instanced.inc"
+
+VS_OUTPUT Instanced_VS(float3 position : POSITION, INSTANCE_INPUT instance)
+{ 
+	VS_OUTPUT output;
+	const float3 transformed = InstanceTransform(position, instance);
+	output.screenPos = float4(transformed.x, transformed.y, 0.f, 1.f);
+	output.color = instance.color;
+	return output;
+}
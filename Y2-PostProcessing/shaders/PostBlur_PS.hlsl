@@ -0,0 +1,26 @@
+
+/*
+	Post-processing: separable 9-tap Gaussian blur, in 5 bilinear taps (run once per direction).
+*/
+
+#include "Post.inc"
+
+Texture2D source : register(t0);
+
+static const float kOffsets[3] = { 0.f, 1.3846153846f, 3.2307692308f };
+static const float kWeights[3] = { 0.2270270270f, 0.3162162162f, 0.0702702703f };
+
+float4 PostBlur_PS(in VS_OUTPUT input) : SV_Target0
+{
+	const float2 UV = GetUV(input);
+	const float2 step = texel.xy*texel.zw;
+
+	float4 color = source.Sample(postSampler, UV)*kWeights[0];
+	[unroll] for (int iTap = 1; iTap < 3; ++iTap)
+	{
+		color += source.Sample(postSampler, UV + step*kOffsets[iTap])*kWeights[iTap];
+		color += source.Sample(postSampler, UV - step*kOffsets[iTap])*kWeights[iTap];
+	}
+
+	return color;
+}
@@ -0,0 +1,22 @@
+
+/*
+	Post-processing: bright pass (the part of the scene that blooms), at half size.
+	params.x = threshold, params.y = soft knee (fraction of the threshold).
+*/
+
+#include "Post.inc"
+
+Texture2D source : register(t0);
+
+float4 PostBright_PS(in VS_OUTPUT input) : SV_Target0
+{
+	const float3 color = source.Sample(postSampler, GetUV(input)).rgb;
+	const float luminance = GetLuminance(color);
+
+	// Quadratic knee below the threshold, linear above it.
+	const float knee = params.x*params.y + 1e-5f;
+	const float soft = clamp(luminance - params.x + knee, 0.f, 2.f*knee);
+	const float contribution = max(soft*soft/(4.f*knee), luminance - params.x)/max(luminance, 1e-5f);
+
+	return float4(color*contribution, 1.f);
+}
@@ -0,0 +1,29 @@
+
+/*
+	Post-processing: depth of field, bloom & tone mapping, to the back buffer.
+	There's no depth buffer, so depth of field is tilt-shift: sharp in a horizontal band, blurred out of it.
+	params.x = focus (V), params.y = half the band, params.z = bloom strength, params.w = exposure.
+*/
+
+#include "Post.inc"
+
+Texture2D scene : register(t0);
+Texture2D bloom : register(t1);
+Texture2D blurred : register(t2);
+
+// Narkowicz's fit of the ACES filmic curve.
+float3 ToneMapACES(float3 color)
+{
+	return saturate((color*(2.51f*color + 0.03f))/(color*(2.43f*color + 0.59f) + 0.14f));
+}
+
+float4 PostComposite_PS(in VS_OUTPUT input) : SV_Target0
+{
+	const float2 UV = GetUV(input);
+
+	const float defocus = saturate((abs(UV.y - params.x) - params.y)/max(params.y, 1e-3f));
+	float3 color = lerp(scene.Sample(postSampler, UV).rgb, blurred.Sample(postSampler, UV).rgb, defocus);
+	color += bloom.Sample(postSampler, UV).rgb*params.z;
+
+	return float4(ToneMapACES(color*params.w), 1.f);
+}
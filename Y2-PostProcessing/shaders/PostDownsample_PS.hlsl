@@ -0,0 +1,20 @@
+
+/*
+	Post-processing: downsample to half size; 4 bilinear taps, so 16 source texels.
+*/
+
+#include "Post.inc"
+
+Texture2D source : register(t0);
+
+float4 PostDownsample_PS(in VS_OUTPUT input) : SV_Target0
+{
+	const float2 UV = GetUV(input);
+	const float2 offset = texel.xy;
+
+	float4 color = source.Sample(postSampler, UV + float2(-offset.x, -offset.y));
+	color += source.Sample(postSampler, UV + float2( offset.x, -offset.y));
+	color += source.Sample(postSampler, UV + float2(-offset.x,  offset.y));
+	color += source.Sample(postSampler, UV + float2( offset.x,  offset.y));
+	return color*0.25f;
+}
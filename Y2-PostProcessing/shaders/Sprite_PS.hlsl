@@ -0,0 +1,14 @@
+
+/*
+	Pixel shader for the sprite batcher: texture modulated by vertex color.
+*/
+
+#include "Sprite.inc"
+
+Texture2D sprite : register(t0);
+SamplerState spriteSampler : register(s0);
+
+float4 Sprite_PS(in VS_OUTPUT input) : SV_Target0
+{
+	return input.color*sprite.Sample(spriteSampler, input.UV);
+}
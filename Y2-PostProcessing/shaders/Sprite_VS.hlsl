@@ -0,0 +1,15 @@
+
+/*
+	Vertex shader for the sprite batcher: position is already in clip space (2D).
+*/
+
+#include "Sprite.inc"
+
+VS_OUTPUT Sprite_VS(float2 position : POSITION, float2 UV : TEXCOORD0, float4 color : COLOR)
+{ 
+	VS_OUTPUT output;
+	output.screenPos = float4(position.x, position.y, 0.f, 1.f);
+	output.color = color;
+	output.UV = UV;
+	return output;
+}
@@ -0,0 +1,194 @@
+
+/*
+	Year 2 Direct3D 11 workshop template.
+	Tests - FrameScheduler driven by a fake clock.
+
+	Headless: time only passes when the test says so, and waiting just moves the clock. Steps & frame times
+	are powers of 2, so all of the arithmetic is exact and compared as such.
+
+	g++ -std=c++11 FrameSchedulerTest.cpp -o FrameSchedulerTest && ./FrameSchedulerTest
+*/
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <algorithm>
+
+#define ASSERT(condition) assert(condition)
+
+#include "../code/Platform/Noncopyable.h"
+#include "../code/Platform/FrameScheduler.h"
+
+class FakeClock : public FrameClock
+{
+public:
+	FakeClock() :
+		m_now(100.0), m_numWaits(0) {}
+
+	double Now() override { return m_now; }
+
+	void WaitUntil(double time) override
+	{
+		++m_numWaits;
+		m_now = std::max(m_now, time);
+	}
+
+	void Advance(double seconds) { m_now += seconds; }
+
+	unsigned int GetNumWaits() const { return m_numWaits; }
+
+private:
+	double m_now;
+	unsigned int m_numWaits;
+};
+
+static const double kStep = 1.0/64.0;
+static const double kFrame = 1.0/32.0;
+
+static unsigned int s_numFailed = 0;
+
+static void Expect(bool condition, const char *what)
+{
+	if (false == condition)
+	{
+		++s_numFailed;
+		printf("FAILED: %s\n", what);
+	}
+}
+
+// Steps to catch up with the time passed, and the rest as alpha.
+static void TestSteps()
+{
+	FakeClock clock;
+	FrameScheduler scheduler(clock, kStep);
+
+	Expect(0 == scheduler.BeginFrame() && 0.f == scheduler.GetAlpha(), "no time, no steps");
+
+	clock.Advance(2.5*kStep);
+	Expect(2 == scheduler.BeginFrame(), "2.5 steps' time: 2 steps");
+	Expect(0.5f == scheduler.GetAlpha(), "2.5 steps' time: alpha 0.5");
+	Expect(2.5*kStep == scheduler.GetFrameDelta(), "frame delta");
+
+	// The half step left over carries into the next frame.
+	clock.Advance(0.75*kStep);
+	Expect(1 == scheduler.BeginFrame(), "carried over: 1 step");
+	Expect(0.25f == scheduler.GetAlpha(), "carried over: alpha 0.25");
+
+	clock.Advance(0.5*kStep);
+	Expect(0 == scheduler.BeginFrame(), "less than a step: none");
+	Expect(0.75f == scheduler.GetAlpha(), "less than a step: alpha accumulates");
+
+	// A clock that goes back (it shouldn't) doesn't make for negative time.
+	clock.Advance(-kStep);
+	Expect(0 == scheduler.BeginFrame() && 0.0 == scheduler.GetFrameDelta(), "clock going back: ignored");
+
+	const FrameScheduler::Stats &stats = scheduler.GetStats();
+	Expect(5 == stats.numFrames && 3 == stats.numSteps && 0 == stats.numDroppedSteps, "stats");
+	Expect(0.0 == stats.waitTime, "no pacing, no waiting");
+}
+
+// A long frame asks for no more than the maximum, and the rest of it's time is dropped.
+static void TestStepCapping()
+{
+	FakeClock clock;
+	FrameScheduler scheduler(clock, kStep, 0.0, 4);
+
+	clock.Advance(10.25*kStep);
+	Expect(4 == scheduler.BeginFrame(), "capped at 4");
+	Expect(0.25f == scheduler.GetAlpha(), "capped: fraction kept");
+	Expect(6 == scheduler.GetStats().numDroppedSteps, "capped: 6 dropped");
+
+	// Back to normal the next frame: no debt.
+	clock.Advance(kStep);
+	Expect(1 == scheduler.BeginFrame(), "after capping: 1 step");
+	Expect(0.25f == scheduler.GetAlpha(), "after capping: same fraction");
+	Expect(6 == scheduler.GetStats().numDroppedSteps, "after capping: nothing more dropped");
+}
+
+// A pause isn't simulated after Resync().
+static void TestResync()
+{
+	FakeClock clock;
+	FrameScheduler scheduler(clock, kStep);
+
+	clock.Advance(1.5*kStep);
+	Expect(1 == scheduler.BeginFrame(), "before pause");
+
+	clock.Advance(1000.0);
+	scheduler.Resync();
+	Expect(0 == scheduler.BeginFrame(), "after resync: no steps");
+	Expect(0.f == scheduler.GetAlpha(), "after resync: accumulator cleared");
+	Expect(0.0 == scheduler.GetFrameDelta(), "after resync: no frame delta");
+	Expect(0 == scheduler.GetStats().numDroppedSteps, "after resync: nothing dropped");
+
+	clock.Advance(kStep);
+	Expect(1 == scheduler.BeginFrame(), "after resync: back to normal");
+}
+
+// EndFrame() waits for the next frame's slot; a late frame starts the next right away, without rushing after.
+static void TestPacing()
+{
+	FakeClock clock;
+	const double start = clock.Now();
+	FrameScheduler scheduler(clock, kStep, kFrame);
+
+	// Quick frame: wait for the rest of the slot.
+	scheduler.BeginFrame();
+	clock.Advance(0.25*kFrame);
+	scheduler.EndFrame();
+	Expect(start + kFrame == clock.Now(), "quick frame: waits until the slot's end");
+	Expect(0.75*kFrame == scheduler.GetStats().waitTime, "quick frame: wait time");
+	Expect(1 == clock.GetNumWaits(), "quick frame: one wait");
+
+	// Simulation sees whole frames.
+	Expect(2 == scheduler.BeginFrame(), "paced frame: 2 steps");
+
+	// Late frame (1.5 slots): no wait...
+	clock.Advance(1.5*kFrame);
+	scheduler.EndFrame();
+	Expect(start + 2.5*kFrame == clock.Now() && 1 == clock.GetNumWaits(), "late frame: no wait");
+
+	// ... and the next slot is a whole frame from then, not what's left of the one missed.
+	scheduler.BeginFrame();
+	clock.Advance(0.25*kFrame);
+	scheduler.EndFrame();
+	Expect(start + 3.5*kFrame == clock.Now(), "after late frame: a whole slot, no rushing");
+	Expect(1.5*kFrame == scheduler.GetStats().waitTime, "after late frame: wait time");
+
+	// Pacing off: never waits.
+	scheduler.SetFrameTime(0.0);
+	scheduler.BeginFrame();
+	scheduler.EndFrame();
+	Expect(2 == clock.GetNumWaits(), "unpaced: no wait");
+}
+
+static void TestInterpolated()
+{
+	Interpolated<float> value(1.f);
+	Expect(1.f == value.Get(0.5f), "initial");
+
+	value.Set(3.f);
+	Expect(1.f == value.Get(0.f) && 2.f == value.Get(0.5f) && 3.f == value.GetCurrent(), "between steps");
+
+	value.Reset(8.f);
+	Expect(8.f == value.Get(0.5f), "reset: no interpolation");
+}
+
+int main()
+{
+	TestSteps();
+	TestStepCapping();
+	TestResync();
+	TestPacing();
+	TestInterpolated();
+
+	if (0 != s_numFailed)
+	{
+		printf("%u check(s) failed.\n", s_numFailed);
+		return 1;
+	}
+
+	printf("All passed.\n");
+	return 0;
+}
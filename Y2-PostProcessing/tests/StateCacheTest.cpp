@@ -0,0 +1,328 @@
+
+/*
+	Year 2 Direct3D 11 workshop template.
+	Tests - StateCache against a recording StateContext.
+
+	Headless (no Windows SDK or device): stands in for the few Direct3D types the cache uses, then builds
+	D3D/StateCache.cpp as-is. Checks what's filtered and which slot ranges make it through.
+
+	g++ -std=c++11 StateCacheTest.cpp -o StateCacheTest && ./StateCacheTest
+*/
+
+// Instead of Platform.h & D3D.h.
+#define PLATFORM_H
+#define D3D_H
+
+#include <assert.h>
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define ASSERT(condition) assert(condition)
+
+typedef unsigned int UINT;
+typedef float FLOAT;
+
+struct ID3D11DeviceContext;
+struct ID3D11DeviceContext1;
+struct ID3D11InputLayout;
+struct ID3D11Buffer;
+struct ID3D11VertexShader;
+struct ID3D11PixelShader;
+struct ID3D11ShaderResourceView;
+struct ID3D11SamplerState;
+struct ID3D11BlendState;
+struct ID3D11DepthStencilState;
+struct ID3D11RasterizerState;
+struct ID3D11RenderTargetView;
+struct ID3D11DepthStencilView;
+
+enum D3D11_PRIMITIVE_TOPOLOGY { D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST = 4, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP = 5 };
+enum DXGI_FORMAT { DXGI_FORMAT_R32_UINT = 42, DXGI_FORMAT_R16_UINT = 57 };
+struct D3D11_VIEWPORT { FLOAT TopLeftX, TopLeftY, Width, Height, MinDepth, MaxDepth; };
+
+#include "../code/Platform/Noncopyable.h"
+#include "../code/D3D/StateContext.h"
+#include "../code/D3D/StateCache.h"
+#include "../code/D3D/StateCache.cpp"
+
+using namespace D3D;
+
+// Objects are never dereferenced, so any (distinct) address will do; each prints as it's number.
+template<typename T>
+T *Object(unsigned int number) { return reinterpret_cast<T *>((uintptr_t) number*16); }
+
+static std::string Name(const void *pObject) { return std::to_string((uintptr_t) pObject/16); }
+
+// Logs each call that gets through as a line: name, then slots & objects (or values).
+class RecordingContext : public StateContext
+{
+public:
+	explicit RecordingContext(std::vector<std::string> &log, bool hasConstantBufferOffsets = true) :
+		m_log(log), m_hasConstantBufferOffsets(hasConstantBufferOffsets) {}
+
+	void IASetInputLayout(ID3D11InputLayout *pInputLayout) override { Log("IASetInputLayout " + Name(pInputLayout)); }
+	void IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology) override { Log("IASetPrimitiveTopology " + std::to_string(topology)); }
+
+	void IASetVertexBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *ppBuffers, const UINT *pStrides, const UINT *pOffsets) override
+	{
+		std::string line = "IASetVertexBuffers " + std::to_string(startSlot) + ":";
+		for (UINT iBuffer = 0; iBuffer < numBuffers; ++iBuffer)
+			line += " " + Name(ppBuffers[iBuffer]) + "/" + std::to_string(pStrides[iBuffer]) + "/" + std::to_string(pOffsets[iBuffer]);
+
+		Log(line);
+	}
+
+	void IASetIndexBuffer(ID3D11Buffer *pBuffer, DXGI_FORMAT format, UINT offset) override
+	{
+		Log("IASetIndexBuffer " + Name(pBuffer) + " " + std::to_string(format) + " " + std::to_string(offset));
+	}
+
+	void VSSetShader(ID3D11VertexShader *pShader) override { Log("VSSetShader " + Name(pShader)); }
+	void PSSetShader(ID3D11PixelShader *pShader) override { Log("PSSetShader " + Name(pShader)); }
+
+	void VSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *ppBuffers) override { LogArray("VSSetConstantBuffers", startSlot, numBuffers, ppBuffers); }
+	void PSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *ppBuffers) override { LogArray("PSSetConstantBuffers", startSlot, numBuffers, ppBuffers); }
+
+	void VSSetConstantBuffers1(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *ppBuffers, const UINT *pFirstConstant, const UINT *pNumConstants) override
+	{
+		LogRanges("VSSetConstantBuffers1", startSlot, numBuffers, ppBuffers, pFirstConstant, pNumConstants);
+	}
+
+	void PSSetConstantBuffers1(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *ppBuffers, const UINT *pFirstConstant, const UINT *pNumConstants) override
+	{
+		LogRanges("PSSetConstantBuffers1", startSlot, numBuffers, ppBuffers, pFirstConstant, pNumConstants);
+	}
+
+	void PSSetShaderResources(UINT startSlot, UINT numViews, ID3D11ShaderResourceView *const *ppViews) override { LogArray("PSSetShaderResources", startSlot, numViews, ppViews); }
+	void PSSetSamplers(UINT startSlot, UINT numSamplers, ID3D11SamplerState *const *ppSamplers) override { LogArray("PSSetSamplers", startSlot, numSamplers, ppSamplers); }
+
+	void OMSetBlendState(ID3D11BlendState *pState, const FLOAT [4], UINT) override { Log("OMSetBlendState " + Name(pState)); }
+	void OMSetDepthStencilState(ID3D11DepthStencilState *pState, UINT stencilRef) override { Log("OMSetDepthStencilState " + Name(pState) + " " + std::to_string(stencilRef)); }
+	void RSSetState(ID3D11RasterizerState *pState) override { Log("RSSetState " + Name(pState)); }
+	void RSSetViewports(UINT numViewports, const D3D11_VIEWPORT *pViewports) override { Log("RSSetViewports " + std::to_string(numViewports) + " " + std::to_string((int) pViewports[0].Width)); }
+
+	void OMSetRenderTargets(UINT numViews, ID3D11RenderTargetView *const *ppTargetViews, ID3D11DepthStencilView *pDepthView) override
+	{
+		Log("OMSetRenderTargets " + ((0 != numViews) ? Name(ppTargetViews[0]) : std::string("-")) + " " + Name(pDepthView));
+	}
+
+	bool HasConstantBufferOffsets() const override { return m_hasConstantBufferOffsets; }
+
+private:
+	void Log(const std::string &line) { m_log.push_back(line); }
+
+	template<typename T>
+	void LogArray(const char *name, UINT startSlot, UINT count, T *const *ppObjects)
+	{
+		std::string line = std::string(name) + " " + std::to_string(startSlot) + ":";
+		for (UINT iObject = 0; iObject < count; ++iObject)
+			line += " " + Name(ppObjects[iObject]);
+
+		Log(line);
+	}
+
+	void LogRanges(const char *name, UINT startSlot, UINT numBuffers, ID3D11Buffer *const *ppBuffers, const UINT *pFirstConstant, const UINT *pNumConstants)
+	{
+		std::string line = std::string(name) + " " + std::to_string(startSlot) + ":";
+		for (UINT iBuffer = 0; iBuffer < numBuffers; ++iBuffer)
+			line += " " + Name(ppBuffers[iBuffer]) + "@" + std::to_string(pFirstConstant[iBuffer]) + "+" + std::to_string(pNumConstants[iBuffer]);
+
+		Log(line);
+	}
+
+	std::vector<std::string> &m_log;
+	const bool m_hasConstantBufferOffsets;
+};
+
+static unsigned int s_numFailed = 0;
+
+// Compares (and clears) the calls logged since the last check.
+static void Expect(std::vector<std::string> &log, const std::vector<std::string> &expected, const char *what)
+{
+	if (log != expected)
+	{
+		++s_numFailed;
+		printf("FAILED: %s\n  expected:\n", what);
+		for (const std::string &line : expected)
+			printf("    %s\n", line.c_str());
+
+		printf("  got:\n");
+		for (const std::string &line : log)
+			printf("    %s\n", line.c_str());
+	}
+
+	log.clear();
+}
+
+static void ExpectEqual(unsigned int value, unsigned int expected, const char *what)
+{
+	if (value != expected)
+	{
+		++s_numFailed;
+		printf("FAILED: %s: expected %u, got %u\n", what, expected, value);
+	}
+}
+
+static void TestSingleStates()
+{
+	std::vector<std::string> log;
+	StateCache cache(StateContext::Ptr(new RecordingContext(log)));
+
+	cache.SetInputLayout(Object<ID3D11InputLayout>(1));
+	cache.SetInputLayout(Object<ID3D11InputLayout>(1));
+	cache.SetInputLayout(Object<ID3D11InputLayout>(2));
+	Expect(log, { "IASetInputLayout 1", "IASetInputLayout 2" }, "input layout: repeats filtered");
+
+	// Unbinding (nullptr) is a state like any other.
+	cache.SetPixelShader(nullptr);
+	cache.SetPixelShader(nullptr);
+	cache.SetPixelShader(Object<ID3D11PixelShader>(3));
+	Expect(log, { "PSSetShader 0", "PSSetShader 3" }, "pixel shader: nullptr cached");
+
+	// Any argument that differs gets it through.
+	cache.SetIndexBuffer(Object<ID3D11Buffer>(4), DXGI_FORMAT_R16_UINT);
+	cache.SetIndexBuffer(Object<ID3D11Buffer>(4), DXGI_FORMAT_R32_UINT);
+	cache.SetIndexBuffer(Object<ID3D11Buffer>(4), DXGI_FORMAT_R32_UINT, 64);
+	cache.SetIndexBuffer(Object<ID3D11Buffer>(4), DXGI_FORMAT_R32_UINT, 64);
+	cache.SetDepthStencilState(Object<ID3D11DepthStencilState>(5), 1);
+	cache.SetDepthStencilState(Object<ID3D11DepthStencilState>(5), 2);
+	cache.SetDepthStencilState(Object<ID3D11DepthStencilState>(5), 2);
+	Expect(log, { "IASetIndexBuffer 4 57 0", "IASetIndexBuffer 4 42 0", "IASetIndexBuffer 4 42 64",
+		"OMSetDepthStencilState 5 1", "OMSetDepthStencilState 5 2" }, "index buffer & depth-stencil: all arguments compared");
+
+	const D3D11_VIEWPORT viewport = { 0.f, 0.f, 1280.f, 720.f, 0.f, 1.f };
+	D3D11_VIEWPORT smaller = viewport;
+	smaller.Width = 640.f;
+	cache.SetViewport(viewport);
+	cache.SetViewport(viewport);
+	cache.SetViewport(smaller);
+	Expect(log, { "RSSetViewports 1 1280", "RSSetViewports 1 640" }, "viewport: compared by value");
+
+	const StateCache::Stats &stats = cache.GetStats();
+	ExpectEqual(stats.numIssued[StateCache::kInputLayout], 2, "input layouts issued");
+	ExpectEqual(stats.numFiltered[StateCache::kInputLayout], 1, "input layouts filtered");
+	ExpectEqual(stats.GetNumIssued(), 11, "total issued");
+	ExpectEqual(stats.GetNumFiltered(), 5, "total filtered");
+
+	cache.ResetStats();
+	ExpectEqual(cache.GetStats().GetNumIssued() + cache.GetStats().GetNumFiltered(), 0, "stats reset");
+
+	// Everything goes through once after Invalidate().
+	cache.Invalidate();
+	cache.SetInputLayout(Object<ID3D11InputLayout>(2));
+	cache.SetPixelShader(Object<ID3D11PixelShader>(3));
+	cache.SetViewport(smaller);
+	Expect(log, { "IASetInputLayout 2", "PSSetShader 3", "RSSetViewports 1 640" }, "invalidate: next call of each kind goes through");
+}
+
+static void TestSlotRanges()
+{
+	std::vector<std::string> log;
+	StateCache cache(StateContext::Ptr(new RecordingContext(log)));
+
+	ID3D11ShaderResourceView *views[4] = { Object<ID3D11ShaderResourceView>(1), Object<ID3D11ShaderResourceView>(2), Object<ID3D11ShaderResourceView>(3), Object<ID3D11ShaderResourceView>(4) };
+	cache.SetPSShaderResources(0, 4, views);
+	cache.SetPSShaderResources(0, 4, views);
+	Expect(log, { "PSSetShaderResources 0: 1 2 3 4" }, "views: repeat filtered");
+
+	// Only the span between the first & last slot that differ is passed on (the unchanged slot inbetween too).
+	views[1] = Object<ID3D11ShaderResourceView>(5);
+	views[3] = Object<ID3D11ShaderResourceView>(6);
+	cache.SetPSShaderResources(0, 4, views);
+	Expect(log, { "PSSetShaderResources 1: 5 3 6" }, "views: differing span only");
+
+	// Offsets into the shadow by the first slot.
+	ID3D11ShaderResourceView *const pView = Object<ID3D11ShaderResourceView>(5);
+	cache.SetPSShaderResources(1, 1, &pView);
+	ID3D11ShaderResourceView *const pOther = Object<ID3D11ShaderResourceView>(7);
+	cache.SetPSShaderResources(2, 1, &pOther);
+	Expect(log, { "PSSetShaderResources 2: 7" }, "views: first slot");
+
+	// A new render target forgets the views (the runtime may have unbound them).
+	cache.SetRenderTarget(Object<ID3D11RenderTargetView>(8), nullptr);
+	cache.SetRenderTarget(Object<ID3D11RenderTargetView>(8), nullptr);
+	cache.SetPSShaderResources(2, 1, &pOther);
+	cache.SetPSShaderResources(2, 1, &pOther);
+	cache.SetRenderTarget(nullptr, nullptr);
+	Expect(log, { "OMSetRenderTargets 8 0", "PSSetShaderResources 2: 7", "OMSetRenderTargets - 0" }, "render target: views invalidated");
+
+	// Vertex streams differ if any of buffer, stride or offset does.
+	ID3D11Buffer *const buffers[2] = { Object<ID3D11Buffer>(1), Object<ID3D11Buffer>(2) };
+	UINT strides[2] = { 32, 16 }, offsets[2] = { 0, 0 };
+	cache.SetVertexBuffers(0, 2, buffers, strides, offsets);
+	cache.SetVertexBuffers(0, 2, buffers, strides, offsets);
+	strides[1] = 12;
+	cache.SetVertexBuffers(0, 2, buffers, strides, offsets);
+	offsets[0] = 64;
+	cache.SetVertexBuffers(0, 2, buffers, strides, offsets);
+	cache.SetVertexBuffer(1, buffers[1], 12);
+	Expect(log, { "IASetVertexBuffers 0: 1/32/0 2/16/0", "IASetVertexBuffers 1: 2/12/0", "IASetVertexBuffers 0: 1/32/64" }, "vertex streams");
+
+	ID3D11SamplerState *const pSampler = Object<ID3D11SamplerState>(9);
+	cache.SetPSSamplers(15, 1, &pSampler);
+	cache.SetPSSamplers(15, 1, &pSampler);
+	Expect(log, { "PSSetSamplers 15: 9" }, "samplers: last slot");
+}
+
+static void TestConstantBufferRanges()
+{
+	std::vector<std::string> log;
+	StateCache cache(StateContext::Ptr(new RecordingContext(log)));
+	ExpectEqual(true == cache.HasConstantBufferOffsets(), 1, "offsets available (from the context)");
+
+	ID3D11Buffer *const pRing = Object<ID3D11Buffer>(1), *const pWhole = Object<ID3D11Buffer>(2);
+
+	cache.SetVSConstantBufferRange(0, pRing, 0, 16);
+	cache.SetVSConstantBufferRange(0, pRing, 0, 16);
+	cache.SetVSConstantBufferRange(0, pRing, 16, 16);
+	cache.SetVSConstantBufferRange(0, pRing, 16, 32);
+	Expect(log, { "VSSetConstantBuffers1 0: 1@0+16", "VSSetConstantBuffers1 0: 1@16+16", "VSSetConstantBuffers1 0: 1@16+32" }, "ranges: repeats filtered");
+
+	// The same buffer bound whole isn't what's bound (a range of it), so that must go through; once.
+	cache.SetVSConstantBuffers(0, 1, &pRing);
+	cache.SetVSConstantBuffers(0, 1, &pRing);
+	Expect(log, { "VSSetConstantBuffers 0: 1" }, "whole after range");
+
+	// And the other way around.
+	cache.SetVSConstantBufferRange(0, pRing, 0, 16);
+	Expect(log, { "VSSetConstantBuffers1 0: 1@0+16" }, "range after whole");
+
+	// Only the slots bound by range are reset; whole buffers next to them are still filtered.
+	ID3D11Buffer *const buffers[2] = { pRing, pWhole };
+	cache.SetPSConstantBuffers(0, 2, buffers);
+	cache.SetPSConstantBufferRange(0, pRing, 0, 16);
+	cache.SetPSConstantBuffers(0, 2, buffers);
+	Expect(log, { "PSSetConstantBuffers 0: 1 2", "PSSetConstantBuffers1 0: 1@0+16", "PSSetConstantBuffers 0: 1" }, "ranges next to whole buffers");
+
+	// VS & PS are tracked apart.
+	cache.SetPSConstantBufferRange(3, pRing, 0, 16);
+	cache.SetVSConstantBufferRange(3, pRing, 0, 16);
+	Expect(log, { "PSSetConstantBuffers1 3: 1@0+16", "VSSetConstantBuffers1 3: 1@0+16" }, "VS & PS apart");
+
+	ExpectEqual(cache.GetStats().numFiltered[StateCache::kVSConstantBuffers], 2, "VS constant buffers filtered");
+
+	std::vector<std::string> noOffsetsLog;
+	StateCache noOffsets(StateContext::Ptr(new RecordingContext(noOffsetsLog, false)));
+	ExpectEqual(false == noOffsets.HasConstantBufferOffsets(), 1, "offsets unavailable (from the context)");
+}
+
+int main()
+{
+	TestSingleStates();
+	TestSlotRanges();
+	TestConstantBufferRanges();
+
+	if (0 != s_numFailed)
+	{
+		printf("%u check(s) failed.\n", s_numFailed);
+		return 1;
+	}
+
+	printf("All passed.\n");
+	return 0;
+}